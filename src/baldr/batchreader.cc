@@ -0,0 +1,186 @@
+#include "baldr/batchreader.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef ENABLE_IO_URING
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using buffers_t = std::vector<std::optional<std::vector<char>>>;
+
+std::optional<std::vector<char>> read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  size_t filesize = file.tellg();
+  std::vector<char> data(filesize);
+  file.seekg(0, std::ios::beg);
+  if (!file.read(data.data(), filesize)) {
+    return std::nullopt;
+  }
+  return data;
+}
+
+#ifdef ENABLE_IO_URING
+// sets up the ring and makes sure the kernel knows the plain read op (linux 5.6+)
+bool init_ring(io_uring& ring, unsigned queue_depth) {
+  if (io_uring_queue_init(queue_depth, &ring, 0) < 0) {
+    return false;
+  }
+  io_uring_probe* probe = io_uring_get_probe_ring(&ring);
+  bool supported = probe && io_uring_opcode_supported(probe, IORING_OP_READ);
+  if (probe) {
+    io_uring_free_probe(probe);
+  }
+  if (!supported) {
+    io_uring_queue_exit(&ring);
+  }
+  return supported;
+}
+
+// keeps up to queue_depth reads in flight, files are only opened once they are submitted so that
+// large batches don't run into the open file limit. returns false if the ring failed on us, in
+// which case the caller starts over with the synchronous path
+bool read_files_uring(const std::vector<std::string>& paths,
+                      unsigned queue_depth,
+                      buffers_t& buffers) {
+  io_uring ring;
+  if (!init_ring(ring, queue_depth)) {
+    return false;
+  }
+
+  std::vector<int> fds(paths.size(), -1);
+  std::vector<size_t> offsets(paths.size(), 0);
+  auto finish = [&fds](size_t i) {
+    close(fds[i]);
+    fds[i] = -1;
+  };
+
+  // files which got a short read and need another submission
+  std::deque<size_t> partial;
+  size_t next = 0;
+  unsigned in_flight = 0;
+  bool failed = false;
+  while (!failed && (next < paths.size() || !partial.empty() || in_flight > 0)) {
+    // top up the submission queue
+    while (in_flight < queue_depth && (next < paths.size() || !partial.empty())) {
+      size_t i;
+      if (!partial.empty()) {
+        i = partial.front();
+        partial.pop_front();
+      } else {
+        i = next++;
+        fds[i] = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fds[i] < 0 || fstat(fds[i], &st) != 0) {
+          if (fds[i] >= 0) {
+            finish(i);
+          }
+          continue;
+        }
+        buffers[i].emplace(static_cast<size_t>(st.st_size));
+        if (st.st_size == 0) {
+          finish(i);
+          continue;
+        }
+      }
+      auto& buffer = *buffers[i];
+      io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      io_uring_prep_read(sqe, fds[i], buffer.data() + offsets[i], buffer.size() - offsets[i],
+                         offsets[i]);
+      io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+      ++in_flight;
+    }
+    if (in_flight == 0) {
+      break;
+    }
+
+    // hand everything to the kernel and wait for at least one read to complete
+    int ret = io_uring_submit_and_wait(&ring, 1);
+    if (ret < 0 && ret != -EINTR) {
+      LOG_WARN("io_uring submission failed: " + std::to_string(-ret));
+      failed = true;
+      break;
+    }
+
+    io_uring_cqe* cqe;
+    unsigned head, seen = 0;
+    io_uring_for_each_cqe(&ring, head, cqe) {
+      ++seen;
+      --in_flight;
+      auto i = static_cast<size_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+      if (cqe->res == -EAGAIN || cqe->res == -EINTR) {
+        partial.push_back(i);
+      } else if (cqe->res <= 0) {
+        // an error or the file shrank underneath us
+        buffers[i].reset();
+        finish(i);
+      } else if ((offsets[i] += cqe->res) < buffers[i]->size()) {
+        partial.push_back(i);
+      } else {
+        finish(i);
+      }
+    }
+    io_uring_cq_advance(&ring, seen);
+  }
+
+  // tearing down the ring cancels whatever might still be in flight before we touch the buffers
+  io_uring_queue_exit(&ring);
+  for (size_t i = 0; i < fds.size(); ++i) {
+    if (fds[i] >= 0) {
+      finish(i);
+    }
+  }
+  return !failed;
+}
+#endif
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::vector<std::optional<std::vector<char>>> read_files(const std::vector<std::string>& paths,
+                                                         unsigned queue_depth) {
+  buffers_t buffers(paths.size());
+#ifdef ENABLE_IO_URING
+  if (!paths.empty() && read_files_uring(paths, std::max(queue_depth, 1u), buffers)) {
+    return buffers;
+  }
+  buffers.assign(paths.size(), std::nullopt);
+#endif
+  for (size_t i = 0; i < paths.size(); ++i) {
+    buffers[i] = read_file(paths[i]);
+  }
+  return buffers;
+}
+
+bool io_uring_available() {
+#ifdef ENABLE_IO_URING
+  static const bool available = []() {
+    io_uring ring;
+    if (!init_ring(ring, 1)) {
+      return false;
+    }
+    io_uring_queue_exit(&ring);
+    return true;
+  }();
+  return available;
+#else
+  return false;
+#endif
+}
+
+} // namespace baldr
+} // namespace valhalla
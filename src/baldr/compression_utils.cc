@@ -1,5 +1,16 @@
 #include "baldr/compression_utils.h"
 
+#include <lz4frame.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+// the first 4 bytes of every lz4 frame, graph tiles can never start with these since they would
+// need to have a hierarchy level of 4
+constexpr uint32_t kLz4FrameMagic = 0x184D2204;
+} // namespace
+
 namespace valhalla {
 namespace baldr {
 
@@ -121,5 +132,62 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
   return true;
 }
 
+bool lz4_compress(const char* src, size_t size, std::vector<char>& dst, int level) {
+  LZ4F_preferences_t prefs{};
+  prefs.frameInfo.contentSize = size;
+  prefs.compressionLevel = level;
+  dst.resize(LZ4F_compressFrameBound(size, &prefs));
+  size_t written = LZ4F_compressFrame(dst.data(), dst.size(), src, size, &prefs);
+  if (LZ4F_isError(written)) {
+    dst.clear();
+    return false;
+  }
+  dst.resize(written);
+  return true;
+}
+
+bool lz4_decompress(const char* src, size_t size, std::vector<char>& dst) {
+  LZ4F_decompressionContext_t context;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)))
+    return false;
+
+  // the frame header tells us how much room we need, unless the compressor didnt record it
+  LZ4F_frameInfo_t info{};
+  size_t in = size;
+  size_t hint = LZ4F_getFrameInfo(context, &info, src, &in);
+  if (LZ4F_isError(hint)) {
+    LZ4F_freeDecompressionContext(context);
+    return false;
+  }
+  dst.resize(info.contentSize ? info.contentSize : size * 4);
+
+  size_t out = 0;
+  while (hint != 0) {
+    if (out == dst.size())
+      dst.resize(dst.size() * 2);
+    size_t src_size = size - in;
+    size_t dst_size = dst.size() - out;
+    hint = LZ4F_decompress(context, dst.data() + out, &dst_size, src + in, &src_size, nullptr);
+    // either its corrupt or it ended before the frame did
+    if (LZ4F_isError(hint) || (hint != 0 && src_size == 0 && dst_size == 0)) {
+      LZ4F_freeDecompressionContext(context);
+      return false;
+    }
+    in += src_size;
+    out += dst_size;
+  }
+  dst.resize(out);
+  LZ4F_freeDecompressionContext(context);
+  return true;
+}
+
+bool is_lz4_frame(const char* src, size_t size) {
+  uint32_t magic;
+  if (size < sizeof(magic))
+    return false;
+  std::memcpy(&magic, src, sizeof(magic));
+  return magic == kLz4FrameMagic;
+}
+
 } // namespace baldr
 } // namespace valhalla
\ No newline at end of file
@@ -2,11 +2,17 @@
 #include "baldr/graphreader.h"
 #include "baldr/json.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/constants.h"
+#include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/util.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
 #include <random>
 #include <sstream>
 #include <unordered_set>
@@ -99,19 +105,125 @@ std::string to_feature_collection(const std::unordered_map<size_t, polygon_t>& b
   return ss.str();
 }
 
+// the file is a header and a table of the layers, followed by the tiles and colors of each layer
+constexpr char kConnectivityMagic[8] = {'v', 'c', 'o', 'n', 'n', 'm', 'a', 'p'};
+constexpr uint32_t kConnectivityVersion = 2;
+
+struct file_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t layer_count;
+  // the tileset the map was built for, see tileset_stamp
+  uint64_t tileset;
+};
+
+struct file_layer_t {
+  uint32_t level;
+  uint32_t access;
+  uint32_t count;
+  uint32_t spare;
+  // where the tiles of the layer start, the colors follow them
+  uint64_t offset;
+};
+
+// Tells apart the tilesets a map could be built for: the tiles there are and the data they were
+// built from, which the dataset id of any tile tells
+uint64_t tileset_stamp(GraphReader& reader, const std::unordered_set<GraphId>& tiles) {
+  std::vector<GraphId> sorted(tiles.cbegin(), tiles.cend());
+  std::sort(sorted.begin(), sorted.end());
+  uint64_t stamp = 0xcbf29ce484222325ULL ^ sorted.size();
+  for (const auto& id : sorted) {
+    stamp = (stamp ^ id.value) * 0x100000001b3ULL;
+  }
+  for (const auto& id : sorted) {
+    try {
+      if (auto tile = reader.GetGraphTile(id)) {
+        return (stamp ^ tile->header()->dataset_id()) * 0x100000001b3ULL;
+      }
+    } catch (...) {
+      // not a tile after all, try the next one
+    }
+  }
+  return stamp;
+}
+
+// the modes whose components are worked out, by the access mask of the costings using them
+constexpr uint32_t kComponentAccess[] = {kAutoAccess, kTruckAccess, kBicycleAccess,
+                                         kPedestrianAccess};
+
+// tiles of the local level joined into components by the edges between them
+class tile_components_t {
+public:
+  uint32_t find(uint32_t tile) {
+    auto parent = parents_.emplace(tile, tile).first;
+    while (parent->second != tile) {
+      // point at the grandparent on the way up to keep the trees flat
+      auto grandparent = parents_.find(parent->second);
+      parent->second = grandparent->second;
+      tile = grandparent->second;
+      parent = parents_.find(tile);
+    }
+    return tile;
+  }
+
+  void join(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      parents_[std::max(a, b)] = std::min(a, b);
+    }
+  }
+
+  // one color per component, 0 is left for tiles with no color
+  std::unordered_map<uint32_t, size_t> colors() {
+    std::unordered_map<uint32_t, size_t> colors;
+    for (const auto& parent : parents_) {
+      colors.emplace(parent.first, 0);
+    }
+    for (auto& color : colors) {
+      color.second = find(color.first) + 1;
+    }
+    return colors;
+  }
+
+private:
+  std::unordered_map<uint32_t, uint32_t> parents_;
+};
+
+// the local tile a node is in, nodes of the other levels go by where they are
+int32_t local_tile_id(GraphReader& reader, const GraphId& node, graph_tile_ptr& tile) {
+  const auto& local_level = TileHierarchy::levels().back();
+  if (node.level() == local_level.level) {
+    return node.tileid();
+  }
+  if (!reader.GetGraphTile(node, tile)) {
+    return -1;
+  }
+  return local_level.tiles.TileId(tile->get_node_ll(node));
+}
+
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
-                                       const std::shared_ptr<GraphReader>& graph_reader) {
+                                       const std::shared_ptr<GraphReader>& graph_reader,
+                                       bool build_components)
+    : transit_level(TileHierarchy::GetTransitLevel().level) {
   // See what kind of tiles we are dealing with here by getting a graphreader
   std::shared_ptr<GraphReader> reader = graph_reader;
   if (!reader) {
     reader = std::make_shared<GraphReader>(pt);
   }
   auto tiles = reader->GetTileSet();
-  transit_level = TileHierarchy::GetTransitLevel().level;
+  tileset = tileset_stamp(*reader, tiles);
+
+  // a map built ahead of time is mapped as it is, as long as it was built for these tiles
+  auto file_name = pt.get<std::string>("connectivity_map", "");
+  if (!build_components && !file_name.empty() && filesystem::is_regular_file(file_name) &&
+      load(file_name)) {
+    return;
+  }
 
   // Quick hack to remove connectivity between known unconnected regions
   // The only land connection from north to south america is through
@@ -122,11 +234,10 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
                                                        {563451, 564891},
                                                        {564891, 564892},
                                                        {566331, 566332}};
-  // TODO: actually check what neighbor tiles are reachable via looking at
-  // edges end nodes instead of just doing a coloring based on proximity
-  // then use this map as input to this singleton (via geojson?)
 
   // Populate a map for each level of the tiles that exist
+  // this is a map(tile_level, map(tile_id, tile_color))
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
   for (const auto& t : tiles) {
     auto& level_colors =
         colors.insert({t.level(), std::unordered_map<uint32_t, size_t>{}}).first->second;
@@ -144,23 +255,207 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
                                                               ? not_neighbors
                                                               : decltype(not_neighbors){});
     }
+    add_layer(color.first, 0, color.second);
+  }
+
+  // the edges tell which of the neighboring tiles each mode can actually get to
+  if (build_components) {
+    add_components(*reader, tiles);
   }
 }
 
-bool connectivity_map_t::level_color_exists(const uint32_t level) const {
-  return colors.find(level) != colors.end();
+uint32_t connectivity_map_t::layer_t::find(const uint32_t tile_id) const {
+  const auto* end = tiles + count;
+  const auto* tile = std::lower_bound(tiles, end, tile_id);
+  return tile == end || *tile != tile_id ? 0 : colors[tile - tiles];
 }
 
-size_t connectivity_map_t::get_color(const GraphId& id) const {
-  auto level = colors.find(id.level());
-  if (level == colors.cend()) {
-    return 0;
+const connectivity_map_t::layer_t* connectivity_map_t::find_layer(const uint32_t level,
+                                                                  const uint32_t access) const {
+  for (const auto& layer : layers) {
+    if (layer.level == level && layer.access == access) {
+      return &layer;
+    }
   }
-  auto color = level->second.find(id.tileid());
-  if (color == level->second.cend()) {
-    return 0;
+  return nullptr;
+}
+
+void connectivity_map_t::add_layer(const uint32_t level,
+                                   const uint32_t access,
+                                   const std::unordered_map<uint32_t, size_t>& colors) {
+  std::vector<std::pair<uint32_t, size_t>> sorted(colors.cbegin(), colors.cend());
+  std::sort(sorted.begin(), sorted.end());
+
+  // the tiles and then their colors, the same as in the file
+  storage.emplace_back(2 * sorted.size());
+  auto& data = storage.back();
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    data[i] = sorted[i].first;
+    data[sorted.size() + i] = static_cast<uint32_t>(sorted[i].second);
   }
-  return color->second;
+  layers.push_back(layer_t{level, access, static_cast<uint32_t>(sorted.size()), data.data(),
+                           data.data() + sorted.size()});
+}
+
+void connectivity_map_t::add_components(GraphReader& reader,
+                                        const std::unordered_set<GraphId>& tiles) {
+  std::vector<tile_components_t> components(std::size(kComponentAccess));
+  uint32_t component_access = 0;
+  for (auto access : kComponentAccess) {
+    component_access |= access;
+  }
+
+  // every edge joins the local tiles of its nodes for the modes allowed on it, in either
+  // direction or under some condition. that way tiles only end up in different components when
+  // there is no path between them
+  graph_tile_ptr end_tile;
+  for (const auto& tile_id : tiles) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    GraphId node_id = tile_id;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++node_id) {
+      const auto* node = tile->node(i);
+      auto begin = local_tile_id(reader, node_id, tile);
+      if (begin < 0) {
+        continue;
+      }
+      for (auto& component : components) {
+        component.find(begin);
+      }
+
+      // the same node on the other levels
+      for (const auto& transition : tile->GetNodeTransitions(node)) {
+        auto end = local_tile_id(reader, transition.endnode(), end_tile);
+        if (end >= 0 && end != begin) {
+          for (auto& component : components) {
+            component.join(begin, end);
+          }
+        }
+      }
+
+      for (const auto& edge : tile->GetDirectedEdges(node)) {
+        if (edge.is_shortcut() || edge.endnode().level() == transit_level) {
+          continue;
+        }
+        const uint32_t access = edge.forwardaccess() | edge.reverseaccess() |
+                                static_cast<uint32_t>(edge.access_restriction());
+        if (!(access & component_access)) {
+          continue;
+        }
+        auto end = local_tile_id(reader, edge.endnode(), end_tile);
+        if (end < 0 || end == begin) {
+          continue;
+        }
+        for (size_t c = 0; c < components.size(); ++c) {
+          if (access & kComponentAccess[c]) {
+            components[c].join(begin, end);
+          }
+        }
+      }
+    }
+  }
+
+  const auto& local_level = TileHierarchy::levels().back();
+  for (size_t c = 0; c < components.size(); ++c) {
+    add_layer(local_level.level, kComponentAccess[c], components[c].colors());
+  }
+}
+
+bool connectivity_map_t::load(const std::string& file_name) {
+  try {
+    file.map(file_name, filesystem::directory_entry(file_name).file_size(), POSIX_MADV_NORMAL,
+             true);
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map connectivity map " + file_name + ": " + e.what());
+    return false;
+  }
+
+  // check that everything the header and the table point at is in the file
+  const char* data = file.get();
+  const uint64_t size = file.size();
+  file_header_t header;
+  bool valid = size >= sizeof(header);
+  if (valid) {
+    std::memcpy(&header, data, sizeof(header));
+    valid = std::memcmp(header.magic, kConnectivityMagic, sizeof(header.magic)) == 0 &&
+            header.version == kConnectivityVersion &&
+            size >= sizeof(header) + uint64_t(header.layer_count) * sizeof(file_layer_t);
+  }
+  for (uint32_t i = 0; valid && i < header.layer_count; ++i) {
+    file_layer_t layer;
+    std::memcpy(&layer, data + sizeof(header) + i * sizeof(layer), sizeof(layer));
+    const uint64_t layer_size = 2 * uint64_t(layer.count) * sizeof(uint32_t);
+    valid = layer.offset % sizeof(uint32_t) == 0 && layer.offset <= size &&
+            layer_size <= size - layer.offset;
+    if (valid) {
+      const auto* tiles = reinterpret_cast<const uint32_t*>(data + layer.offset);
+      layers.push_back(layer_t{layer.level, layer.access, layer.count, tiles, tiles + layer.count});
+    }
+  }
+
+  if (!valid) {
+    LOG_WARN(file_name + " is not a connectivity map, coloring the tiles instead");
+    layers.clear();
+    file.unmap();
+    return false;
+  }
+  if (header.tileset != tileset) {
+    LOG_WARN(file_name + " was built for other tiles, coloring the tiles instead");
+    layers.clear();
+    file.unmap();
+    return false;
+  }
+  LOG_INFO("Mapped connectivity map " + file_name);
+  return true;
+}
+
+void connectivity_map_t::save(const std::string& file_name) const {
+  file_header_t header{};
+  std::memcpy(header.magic, kConnectivityMagic, sizeof(header.magic));
+  header.version = kConnectivityVersion;
+  header.layer_count = static_cast<uint32_t>(layers.size());
+  header.tileset = tileset;
+
+  std::vector<file_layer_t> table;
+  uint64_t offset = sizeof(header) + layers.size() * sizeof(file_layer_t);
+  for (const auto& layer : layers) {
+    table.push_back(file_layer_t{layer.level, layer.access, layer.count, 0, offset});
+    offset += 2 * uint64_t(layer.count) * sizeof(uint32_t);
+  }
+
+  // write next to it and move it into place so services mapping the old one keep working
+  const std::string tmp_name = file_name + ".tmp";
+  std::ofstream out(tmp_name, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + tmp_name);
+  }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(file_layer_t));
+  for (const auto& layer : layers) {
+    out.write(reinterpret_cast<const char*>(layer.tiles), layer.count * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(layer.colors), layer.count * sizeof(uint32_t));
+  }
+  out.close();
+  if (!out || !filesystem::rename(tmp_name, file_name)) {
+    throw std::runtime_error("Could not write " + file_name);
+  }
+}
+
+bool connectivity_map_t::level_color_exists(const uint32_t level) const {
+  return find_layer(level, 0) != nullptr;
+}
+
+size_t connectivity_map_t::get_color(const GraphId& id) const {
+  const auto* colors = find_layer(id.level(), 0);
+  return colors == nullptr ? 0 : colors->find(id.tileid());
 }
 
 std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel& hierarchy_level,
@@ -168,8 +463,8 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel
                                                           float radius) const {
 
   std::unordered_set<size_t> result;
-  auto level = colors.find(hierarchy_level.level);
-  if (level == colors.cend()) {
+  const auto* colors = find_layer(hierarchy_level.level, 0);
+  if (colors == nullptr) {
     return result;
   }
   std::vector<const decltype(location.edges)*> edge_sets{&location.edges, &location.filtered_edges};
@@ -183,9 +478,9 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel
       AABB2<PointLL> bbox(ll.lng() - lngdeg, ll.lat() - latdeg, ll.lng() + lngdeg, ll.lat() + latdeg);
       std::vector<int32_t> tilelist = hierarchy_level.tiles.TileList(bbox);
       for (const auto& id : tilelist) {
-        auto color = level->second.find(id);
-        if (color != level->second.cend()) {
-          result.emplace(color->second);
+        auto color = colors->find(id);
+        if (color != 0) {
+          result.emplace(color);
         }
       }
     }
@@ -193,6 +488,37 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel
   return result;
 }
 
+bool connectivity_map_t::has_components(const uint32_t access) const {
+  return access != 0 && find_layer(TileHierarchy::levels().back().level, access) != nullptr;
+}
+
+std::unordered_set<size_t> connectivity_map_t::get_components(const uint32_t access,
+                                                              const baldr::PathLocation& location,
+                                                              GraphReader& reader) const {
+  std::unordered_set<size_t> result;
+  const auto* components = find_layer(TileHierarchy::levels().back().level, access);
+  if (access == 0 || components == nullptr) {
+    return result;
+  }
+  // an edge is in the component of the tile its end node is in
+  graph_tile_ptr tile;
+  std::vector<const decltype(location.edges)*> edge_sets{&location.edges, &location.filtered_edges};
+  for (const auto* edges : edge_sets) {
+    for (const auto& edge : *edges) {
+      const auto* directed_edge = reader.directededge(edge.id, tile);
+      if (directed_edge == nullptr) {
+        continue;
+      }
+      auto tile_id = local_tile_id(reader, directed_edge->endnode(), tile);
+      auto component = tile_id < 0 ? 0 : components->find(tile_id);
+      if (component != 0) {
+        result.emplace(component);
+      }
+    }
+  }
+  return result;
+}
+
 std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const {
   // bail if we dont have the level
   if (hierarchy_level > TileHierarchy::GetTransitLevel().level) {
@@ -205,15 +531,10 @@ std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const
   // make a region map (inverse mapping of color to lists of tiles)
   // could cache this but shouldnt need to call it much
   std::unordered_map<size_t, std::unordered_set<uint32_t>> regions;
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (const auto& tile : level->second) {
-      auto region = regions.find(tile.second);
-      if (region == regions.end()) {
-        regions.emplace(tile.second, std::unordered_set<uint32_t>{tile.first});
-      } else {
-        region->second.emplace(tile.first);
-      }
+  const auto* colors = find_layer(hierarchy_level, 0);
+  if (colors != nullptr) {
+    for (uint32_t i = 0; i < colors->count; ++i) {
+      regions[colors->colors[i]].emplace(colors->tiles[i]);
     }
   }
 
@@ -244,12 +565,11 @@ std::vector<size_t> connectivity_map_t::to_image(const uint32_t hierarchy_level)
                                 : TileHierarchy::levels()[hierarchy_level].tiles;
 
   std::vector<size_t> tiles(level_tiles.nrows() * level_tiles.ncolumns(), 0);
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (size_t i = 0; i < tiles.size(); ++i) {
-      const auto color = level->second.find(static_cast<uint32_t>(i));
-      if (color != level->second.cend()) {
-        tiles[i] = color->second;
+  const auto* colors = find_layer(hierarchy_level, 0);
+  if (colors != nullptr) {
+    for (uint32_t i = 0; i < colors->count; ++i) {
+      if (colors->tiles[i] < tiles.size()) {
+        tiles[colors->tiles[i]] = colors->colors[i];
       }
     }
   }
@@ -0,0 +1,206 @@
+#include "baldr/contractiongraph.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr char kContractionMagic[8] = {'v', 'c', 'h', 'g', 'r', 'a', 'p', 'h'};
+constexpr uint32_t kContractionVersion = 3;
+
+struct file_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t vertex_count;
+  uint64_t up_arc_count;
+  uint64_t down_arc_count;
+  uint32_t costing_size;
+  uint32_t spare;
+  uint64_t sweep_arc_count;
+};
+
+// the costing fingerprint is padded so that the arrays after it stay aligned
+uint64_t padded(uint64_t size) {
+  return (size + 7) & ~uint64_t(7);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+ContractionGraph::ContractionGraph(const std::string& file_name)
+    : vertex_count_(0), edges_(nullptr), up_offsets_(nullptr), up_arcs_(nullptr),
+      down_offsets_(nullptr), down_arcs_(nullptr), sweep_order_(nullptr), sweep_positions_(nullptr),
+      sweep_offsets_(nullptr), sweep_arcs_(nullptr) {
+  try {
+    file_.map(file_name, filesystem::directory_entry(file_name).file_size(), POSIX_MADV_RANDOM,
+              true);
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map contraction hierarchy " + file_name + ": " + e.what());
+    return;
+  }
+
+  // check that the header and everything it counts fits in the file
+  const char* data = file_.get();
+  const uint64_t size = file_.size();
+  file_header_t header;
+  bool valid = size >= sizeof(header);
+  uint64_t offset = sizeof(header);
+  if (valid) {
+    std::memcpy(&header, data, sizeof(header));
+    const uint64_t vertices = header.vertex_count;
+    offset += padded(header.costing_size);
+    const uint64_t needed = offset + vertices * sizeof(GraphId) +
+                            3 * (vertices + 1) * sizeof(uint64_t) +
+                            (header.up_arc_count + header.down_arc_count) * sizeof(arc_t) +
+                            header.sweep_arc_count * sizeof(sweep_arc_t) +
+                            2 * vertices * sizeof(uint32_t);
+    valid = std::memcmp(header.magic, kContractionMagic, sizeof(header.magic)) == 0 &&
+            header.version == kContractionVersion && needed == size;
+  }
+  if (valid) {
+    costing_.assign(data + sizeof(header), header.costing_size);
+    edges_ = reinterpret_cast<const GraphId*>(data + offset);
+    up_offsets_ = reinterpret_cast<const uint64_t*>(edges_ + header.vertex_count);
+    down_offsets_ = up_offsets_ + header.vertex_count + 1;
+    sweep_offsets_ = down_offsets_ + header.vertex_count + 1;
+    up_arcs_ = reinterpret_cast<const arc_t*>(sweep_offsets_ + header.vertex_count + 1);
+    down_arcs_ = up_arcs_ + header.up_arc_count;
+    sweep_arcs_ = reinterpret_cast<const sweep_arc_t*>(down_arcs_ + header.down_arc_count);
+    sweep_order_ = reinterpret_cast<const uint32_t*>(sweep_arcs_ + header.sweep_arc_count);
+    sweep_positions_ = sweep_order_ + header.vertex_count;
+    valid = up_offsets_[header.vertex_count] == header.up_arc_count &&
+            down_offsets_[header.vertex_count] == header.down_arc_count &&
+            sweep_offsets_[header.vertex_count] == header.sweep_arc_count;
+  }
+
+  if (!valid) {
+    LOG_WARN(file_name + " is not a contraction hierarchy");
+    costing_.clear();
+    file_.unmap();
+    return;
+  }
+  vertex_count_ = header.vertex_count;
+  LOG_INFO("Mapped contraction hierarchy " + file_name + " with " + std::to_string(vertex_count_) +
+           " edges");
+}
+
+void ContractionGraph::write(const std::string& file_name,
+                             const std::string& costing,
+                             const std::vector<GraphId>& edges,
+                             const std::vector<uint64_t>& up_offsets,
+                             const std::vector<arc_t>& up_arcs,
+                             const std::vector<uint64_t>& down_offsets,
+                             const std::vector<arc_t>& down_arcs,
+                             const std::vector<uint32_t>& sweep_order,
+                             const std::vector<uint64_t>& sweep_offsets,
+                             const std::vector<sweep_arc_t>& sweep_arcs) {
+  if (up_offsets.size() != edges.size() + 1 || down_offsets.size() != edges.size() + 1 ||
+      sweep_offsets.size() != edges.size() + 1) {
+    throw std::logic_error("Every vertex of the contraction hierarchy needs its arc offsets");
+  }
+  if (sweep_order.size() != edges.size()) {
+    throw std::logic_error("Every vertex of the contraction hierarchy needs a sweep position");
+  }
+  std::vector<uint32_t> sweep_positions(sweep_order.size());
+  for (uint32_t position = 0; position < sweep_order.size(); ++position) {
+    sweep_positions[sweep_order[position]] = position;
+  }
+
+  file_header_t header{};
+  std::memcpy(header.magic, kContractionMagic, sizeof(header.magic));
+  header.version = kContractionVersion;
+  header.vertex_count = static_cast<uint32_t>(edges.size());
+  header.up_arc_count = up_arcs.size();
+  header.down_arc_count = down_arcs.size();
+  header.costing_size = static_cast<uint32_t>(costing.size());
+  header.sweep_arc_count = sweep_arcs.size();
+
+  const std::string tmp_name = file_name + ".tmp";
+  std::ofstream out(tmp_name, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + tmp_name);
+  }
+  const std::string padding(padded(costing.size()) - costing.size(), '\0');
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(costing.data(), costing.size());
+  out.write(padding.data(), padding.size());
+  out.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(GraphId));
+  out.write(reinterpret_cast<const char*>(up_offsets.data()), up_offsets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(down_offsets.data()),
+            down_offsets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(sweep_offsets.data()),
+            sweep_offsets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(up_arcs.data()), up_arcs.size() * sizeof(arc_t));
+  out.write(reinterpret_cast<const char*>(down_arcs.data()), down_arcs.size() * sizeof(arc_t));
+  out.write(reinterpret_cast<const char*>(sweep_arcs.data()),
+            sweep_arcs.size() * sizeof(sweep_arc_t));
+  out.write(reinterpret_cast<const char*>(sweep_order.data()),
+            sweep_order.size() * sizeof(uint32_t));
+  out.write(reinterpret_cast<const char*>(sweep_positions.data()),
+            sweep_positions.size() * sizeof(uint32_t));
+  out.close();
+  if (!out || !filesystem::rename(tmp_name, file_name)) {
+    throw std::runtime_error("Could not write " + file_name);
+  }
+}
+
+std::string ContractionGraph::fingerprint(const Costing_Options& options) {
+  Costing_Options copy(options);
+  copy.clear_hierarchy_limits();
+  return copy.SerializeAsString();
+}
+
+uint32_t ContractionGraph::vertex(const GraphId& edge_id) const {
+  const GraphId* end = edges_ + vertex_count_;
+  const GraphId* found = std::lower_bound(edges_, end, edge_id);
+  return found == end || *found != edge_id ? kNoVertex : static_cast<uint32_t>(found - edges_);
+}
+
+const ContractionGraph::arc_t* ContractionGraph::find_arc(const uint32_t from,
+                                                          const uint32_t to) const {
+  // the arc is kept by whichever of the two was contracted first
+  for (const auto* arc = up_begin(from); arc != up_end(from); ++arc) {
+    if (arc->vertex == to) {
+      return arc;
+    }
+  }
+  for (const auto* arc = down_begin(to); arc != down_end(to); ++arc) {
+    if (arc->vertex == from) {
+      return arc;
+    }
+  }
+  return nullptr;
+}
+
+bool ContractionGraph::unpack(const uint32_t from,
+                              const uint32_t to,
+                              std::vector<uint32_t>& vertices) const {
+  std::vector<std::pair<uint32_t, uint32_t>> arcs{{from, to}};
+  while (!arcs.empty()) {
+    auto arc = arcs.back();
+    arcs.pop_back();
+    const auto* found = find_arc(arc.first, arc.second);
+    if (found == nullptr) {
+      return false;
+    }
+    if (found->middle == kNoVertex) {
+      vertices.push_back(arc.second);
+      continue;
+    }
+    // the first half is unpacked first
+    arcs.emplace_back(found->middle, arc.second);
+    arcs.emplace_back(arc.first, found->middle);
+  }
+  return true;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -9,6 +9,7 @@
 #include <boost/algorithm/string/join.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <sstream>
 
 namespace {
@@ -472,6 +473,11 @@ from_cache(const TP& tp,
   infos.emplace_back(tp.get_info());
   return infos.back();
 }
+
+// years on either side of the current one covered by the timezone offsets
+std::atomic<uint32_t> tz_offset_years{10};
+// past this the relative transition indices of a zone could overflow
+constexpr uint32_t kMaxTzOffsetYears = 200;
 } // namespace
 
 using namespace valhalla::baldr;
@@ -514,6 +520,72 @@ const tz_db_t& get_tz_db() {
   return tz_db;
 }
 
+tz_offsets_t::tz_offsets_t(int64_t begin, int64_t end) : begin_(begin), end_(std::max(begin, end)) {
+  size_t max_index = 0;
+  for (const auto& tz_pair : tz_name_to_id) {
+    max_index = std::max(max_index, tz_pair.second);
+  }
+  zones_.resize(max_index + 1);
+  const uint32_t bucket_count = static_cast<uint32_t>((end_ - begin_) >> kBucketShift) + 1;
+
+  const auto& tz_db = get_tz_db();
+  for (size_t index = 0; index < zones_.size(); ++index) {
+    const auto* tz = tz_db.from_index(index);
+    if (!tz) {
+      continue;
+    }
+
+    // walk the zone from one offset to the next over the whole span
+    zone_t& zone = zones_[index];
+    zone.first = static_cast<uint32_t>(begins_.size());
+    for (int64_t t = begin_; t < end_;) {
+      const auto info = tz->get_info(date::sys_seconds(std::chrono::seconds(t)));
+      begins_.push_back(t);
+      offsets_.push_back(static_cast<int32_t>(info.offset.count()));
+      const int64_t next = info.end.time_since_epoch().count();
+      if (next <= t) {
+        break;
+      }
+      t = next;
+    }
+    zone.count = static_cast<uint32_t>(begins_.size()) - zone.first;
+
+    // a zone with a single offset needs no buckets
+    if (zone.count < 2) {
+      continue;
+    }
+    zone.buckets = static_cast<uint32_t>(buckets_.size());
+    uint32_t i = 0;
+    for (uint32_t b = 0; b < bucket_count; ++b) {
+      const int64_t start = begin_ + (static_cast<int64_t>(b) << kBucketShift);
+      while (i + 1 < zone.count && begins_[zone.first + i + 1] <= start) {
+        ++i;
+      }
+      buckets_.push_back(static_cast<uint16_t>(i));
+    }
+  }
+}
+
+const tz_offsets_t& get_tz_offsets() {
+  static const tz_offsets_t tz_offsets = []() {
+    const int years = static_cast<int>(std::min(tz_offset_years.load(), kMaxTzOffsetYears));
+    if (years == 0) {
+      return tz_offsets_t(0, 0);
+    }
+    const date::year_month_day today(date::floor<date::days>(std::chrono::system_clock::now()));
+    const int year = static_cast<int>(today.year());
+    const auto begin = date::sys_days(date::year(year - years) / date::January / 1);
+    const auto end = date::sys_days(date::year(year + years + 1) / date::January / 1);
+    return tz_offsets_t(date::floor<std::chrono::seconds>(begin).time_since_epoch().count(),
+                        date::floor<std::chrono::seconds>(end).time_since_epoch().count());
+  }();
+  return tz_offsets;
+}
+
+void set_tz_offset_years(uint32_t years) {
+  tz_offset_years = years;
+}
+
 // get a formatted date.  date in the format of 2016-11-06T01:00 or 2016-11-06
 date::local_seconds get_formatted_date(const std::string& date, bool can_throw) {
   std::istringstream in{date};
@@ -596,6 +668,24 @@ int timezone_diff(const uint64_t seconds,
           .count());
 }
 
+int timezone_diff(const uint64_t seconds,
+                  const size_t origin_index,
+                  const size_t dest_index,
+                  tz_sys_info_cache_t* cache) {
+  if (origin_index == dest_index) {
+    return 0;
+  }
+  const auto& tz_offsets = get_tz_offsets();
+  int32_t origin_offset, dest_offset;
+  if (tz_offsets.offset(origin_index, static_cast<int64_t>(seconds), origin_offset) &&
+      tz_offsets.offset(dest_index, static_cast<int64_t>(seconds), dest_offset)) {
+    return dest_offset - origin_offset;
+  }
+  const auto& tz_db = get_tz_db();
+  return timezone_diff(seconds, tz_db.from_index(origin_index), tz_db.from_index(dest_index),
+                       cache);
+}
+
 std::string
 seconds_to_date(const uint64_t seconds, const date::time_zone* time_zone, bool tz_format) {
 
@@ -692,24 +782,21 @@ get_duration(const std::string& date_time, const uint32_t seconds, const date::t
   return iso_date;
 }
 
-// does this date fall in the begin and end date range?
-bool is_conditional_active(const bool type,
-                           const uint8_t begin_hrs,
-                           const uint8_t begin_mins,
-                           const uint8_t end_hrs,
-                           const uint8_t end_mins,
-                           const uint8_t dow,
-                           const uint8_t begin_week,
-                           const uint8_t begin_month,
-                           const uint8_t begin_day_dow,
-                           const uint8_t end_week,
-                           const uint8_t end_month,
-                           const uint8_t end_day_dow,
-                           const uint64_t current_time,
-                           const date::time_zone* time_zone) {
-
-  if (!time_zone)
-    return false;
+namespace {
+// does this local date and time fall in the begin and end date range?
+bool is_local_time_active(const bool type,
+                          const uint8_t begin_hrs,
+                          const uint8_t begin_mins,
+                          const uint8_t end_hrs,
+                          const uint8_t end_mins,
+                          const uint8_t dow,
+                          const uint8_t begin_week,
+                          const uint8_t begin_month,
+                          const uint8_t begin_day_dow,
+                          const uint8_t end_week,
+                          const uint8_t end_month,
+                          const uint8_t end_day_dow,
+                          const date::local_seconds local_time) {
 
   bool dow_in_range = true;
   bool dt_in_range = true;
@@ -718,15 +805,11 @@ bool is_conditional_active(const bool type,
   std::chrono::minutes b_td = std::chrono::hours(0);
   std::chrono::minutes e_td = std::chrono::hours(23) + std::chrono::minutes(59);
 
-  std::chrono::seconds dur(current_time);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
   uint32_t e_year = 0, b_year = 0;
-  const auto in_local_time = date::make_zoned(time_zone, tp);
-  auto date = date::floor<date::days>(in_local_time.get_local_time());
+  auto date = date::floor<date::days>(local_time);
   auto d = date::year_month_day(date);
-  auto t = date::make_time(in_local_time.get_local_time() - date); // Yields time_of_day type
-  std::chrono::minutes td = t.hours() + t.minutes();               // Yields time_of_day type
+  auto t = date::make_time(local_time - date);       // Yields time_of_day type
+  std::chrono::minutes td = t.hours() + t.minutes(); // Yields time_of_day type
 
   try {
     date::year_month_day begin_date, end_date;
@@ -899,11 +982,9 @@ bool is_conditional_active(const bool type,
     }
 
     // Time does not matter here; we are only dealing with dates.
-    auto b_in_local_time =
-        date::make_zoned(time_zone, date::local_days(begin_date), date::choose::latest);
-    auto local_dt = date::make_zoned(time_zone, date::local_days(d), date::choose::latest);
-    auto e_in_local_time =
-        date::make_zoned(time_zone, date::local_days(end_date), date::choose::latest);
+    auto b_in_local_time = date::local_days(begin_date);
+    auto local_dt = date::local_days(d);
+    auto e_in_local_time = date::local_days(end_date);
 
     if (edge_case) {
 
@@ -914,22 +995,17 @@ bool is_conditional_active(const bool type,
       // end date = Jan 02, 2021
       date::year_month_day new_ed =
           date::year_month_day(date::year(b_year), date::month(12), date::day(31));
-      auto new_e_in_local_time =
-          date::make_zoned(time_zone, date::local_days(new_ed), date::choose::latest);
+      auto new_e_in_local_time = date::local_days(new_ed);
 
       date::year_month_day new_bd =
           date::year_month_day(date::year(b_year), date::month(1), date::day(1));
-      auto new_b_in_local_time =
-          date::make_zoned(time_zone, date::local_days(new_bd), date::choose::latest);
+      auto new_b_in_local_time = date::local_days(new_bd);
 
       // we need to check Jan 04, 2021 to Dec 31, 2021 and Jan 01, 2021 to Jan 02, 2021
-      dt_in_range = (((b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                       local_dt.get_local_time() <= new_e_in_local_time.get_local_time())) ||
-                     ((new_b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                       local_dt.get_local_time() <= e_in_local_time.get_local_time())));
+      dt_in_range = ((b_in_local_time <= local_dt && local_dt <= new_e_in_local_time) ||
+                     (new_b_in_local_time <= local_dt && local_dt <= e_in_local_time));
     } else {
-      dt_in_range = (b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                     local_dt.get_local_time() <= e_in_local_time.get_local_time());
+      dt_in_range = (b_in_local_time <= local_dt && local_dt <= e_in_local_time);
     }
 
     bool time_in_range = false;
@@ -944,6 +1020,60 @@ bool is_conditional_active(const bool type,
   } catch (std::exception& e) {}
   return (dow_in_range && dt_in_range);
 }
+} // namespace
+
+// does this date fall in the begin and end date range?
+bool is_conditional_active(const bool type,
+                           const uint8_t begin_hrs,
+                           const uint8_t begin_mins,
+                           const uint8_t end_hrs,
+                           const uint8_t end_mins,
+                           const uint8_t dow,
+                           const uint8_t begin_week,
+                           const uint8_t begin_month,
+                           const uint8_t begin_day_dow,
+                           const uint8_t end_week,
+                           const uint8_t end_month,
+                           const uint8_t end_day_dow,
+                           const uint64_t current_time,
+                           const date::time_zone* time_zone) {
+  if (!time_zone)
+    return false;
+
+  std::chrono::seconds dur(current_time);
+  std::chrono::time_point<std::chrono::system_clock> tp(dur);
+  const auto local_time = date::make_zoned(time_zone, tp).get_local_time();
+  return is_local_time_active(type, begin_hrs, begin_mins, end_hrs, end_mins, dow, begin_week,
+                              begin_month, begin_day_dow, end_week, end_month, end_day_dow,
+                              date::floor<std::chrono::seconds>(local_time));
+}
+
+bool is_conditional_active(const bool type,
+                           const uint8_t begin_hrs,
+                           const uint8_t begin_mins,
+                           const uint8_t end_hrs,
+                           const uint8_t end_mins,
+                           const uint8_t dow,
+                           const uint8_t begin_week,
+                           const uint8_t begin_month,
+                           const uint8_t begin_day_dow,
+                           const uint8_t end_week,
+                           const uint8_t end_month,
+                           const uint8_t end_day_dow,
+                           const uint64_t current_time,
+                           const size_t tz_index) {
+  int32_t offset;
+  if (!get_tz_offsets().offset(tz_index, static_cast<int64_t>(current_time), offset)) {
+    return is_conditional_active(type, begin_hrs, begin_mins, end_hrs, end_mins, dow, begin_week,
+                                 begin_month, begin_day_dow, end_week, end_month, end_day_dow,
+                                 current_time, get_tz_db().from_index(tz_index));
+  }
+  const date::local_seconds local_time(
+      std::chrono::seconds(static_cast<int64_t>(current_time) + offset));
+  return is_local_time_active(type, begin_hrs, begin_mins, end_hrs, end_mins, dow, begin_week,
+                              begin_month, begin_day_dow, end_week, end_month, end_day_dow,
+                              local_time);
+}
 
 uint32_t second_of_week(uint32_t epoch_time, const date::time_zone* time_zone) {
   // get the date time in this timezone
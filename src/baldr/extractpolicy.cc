@@ -0,0 +1,146 @@
+#include "baldr/extractpolicy.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+// the kernel works on whole pages
+std::pair<char*, size_t> page_range(const char* data, size_t size) {
+  static const uintptr_t page = sysconf(_SC_PAGESIZE);
+  auto begin = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+  auto end = (reinterpret_cast<uintptr_t>(data) + size + page - 1) & ~(page - 1);
+  return {reinterpret_cast<char*>(begin), end - begin};
+}
+#endif
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+extract_policy_t::extract_policy_t(const boost::property_tree::ptree& pt)
+    : hugepages(pt.get<bool>("tile_extract_hugepages", false)),
+      pin_list(pt.get<std::string>("tile_extract_pin_list", "")) {
+  auto name = pt.get<std::string>("tile_extract_advice", "normal");
+  if (name == "random") {
+    advice = advice_t::random;
+  } else if (name == "sequential") {
+    advice = advice_t::sequential;
+  } else if (name != "normal") {
+    throw std::runtime_error("Unknown tile_extract_advice " + name +
+                             ", expected normal, random or sequential");
+  }
+}
+
+void advise_extract(const char* data, size_t size, const extract_policy_t& policy) {
+#ifndef _WIN32
+  if (!data || !size) {
+    return;
+  }
+  auto range = page_range(data, size);
+
+  // random turns readahead off so that a tile doesn't drag its cold neighbours into memory
+  int advice = policy.advice == extract_policy_t::advice_t::random       ? POSIX_MADV_RANDOM
+               : policy.advice == extract_policy_t::advice_t::sequential ? POSIX_MADV_SEQUENTIAL
+                                                                         : POSIX_MADV_NORMAL;
+  if (int error = posix_madvise(range.first, range.second, advice)) {
+    LOG_WARN("Could not advise the kernel about the tile extract: " +
+             std::string(std::strerror(error)));
+  }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (policy.hugepages) {
+    if (madvise(range.first, range.second, MADV_HUGEPAGE) != 0) {
+      LOG_WARN("Transparent huge pages are not available for the tile extract: " +
+               std::string(std::strerror(errno)));
+      return;
+    }
+    // collapse it right away (linux 6.1+), only whole huge pages within the mapping qualify
+    constexpr int kMadvCollapse = 25;
+    constexpr uintptr_t kHugePage = 2 << 20;
+    auto begin = (reinterpret_cast<uintptr_t>(range.first) + kHugePage - 1) & ~(kHugePage - 1);
+    auto end = (reinterpret_cast<uintptr_t>(range.first) + range.second) & ~(kHugePage - 1);
+    if (begin < end && madvise(reinterpret_cast<void*>(begin), end - begin, kMadvCollapse) != 0) {
+      LOG_INFO("Tile extract is left to khugepaged to be collapsed into huge pages: " +
+               std::string(std::strerror(errno)));
+    }
+  }
+#else
+  if (policy.hugepages) {
+    LOG_WARN("Transparent huge pages are not supported on this platform");
+  }
+#endif
+#else
+  (void)data;
+  (void)size;
+  (void)policy;
+#endif
+}
+
+size_t lock_tiles(const std::vector<std::pair<char*, size_t>>& ranges) {
+  size_t locked = 0;
+#ifndef _WIN32
+  for (const auto& tile : ranges) {
+    // the rest of the extract may have readahead turned off, the hot tiles are read in now
+    auto range = page_range(tile.first, tile.second);
+    posix_madvise(range.first, range.second, POSIX_MADV_NORMAL);
+    posix_madvise(range.first, range.second, POSIX_MADV_WILLNEED);
+    if (mlock(range.first, range.second) != 0) {
+      LOG_WARN("Locked " + std::to_string(locked) + " bytes of hot tiles before running into: " +
+               std::string(std::strerror(errno)) + ", check ulimit -l");
+      break;
+    }
+    locked += tile.second;
+  }
+#else
+  if (!ranges.empty()) {
+    LOG_WARN("Locking tiles into memory is not supported on this platform");
+  }
+#endif
+  return locked;
+}
+
+std::vector<GraphId> read_tile_list(const std::string& path) {
+  std::vector<GraphId> tiles;
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    LOG_WARN("Could not read the tile list " + path);
+    return tiles;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    try {
+      if (std::all_of(line.begin(), line.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        GraphId id(std::stoull(line));
+        if (id.Is_Valid()) {
+          tiles.push_back(id.Tile_Base());
+        }
+      } else {
+        tiles.push_back(GraphTile::GetTileId(line));
+      }
+    } catch (...) {
+      // not a tile, skip it
+    }
+  }
+  return tiles;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,14 +1,27 @@
 #include "baldr/graphreader.h"
+#include "baldr/batchreader.h"
+#include "baldr/compression_utils.h"
 #include "baldr/curl_tilegetter.h"
+#include "baldr/datetime.h"
+#include "baldr/extractpolicy.h"
 #include "filesystem.h"
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "proto/status.pb.h"
 #include "shortcut_recovery.h"
 
+#ifdef __linux__
+#include "baldr/shmtilecache.h"
+#endif
+
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <iterator>
+#include <random>
 #include <string>
+#include <thread>
 #include <utility>
 
 using namespace valhalla::midgard;
@@ -19,17 +32,77 @@ constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
 
+// Matrices load at most this many tiles around their locations in one batch by default
+constexpr size_t kDefaultBatchMaxTiles = 64;
+// How many tiles of a batch are read or fetched before checking the cache has room for more
+constexpr size_t kBatchChunkTiles = 16;
+
 struct tile_index_entry {
   uint64_t offset;  // byte offset from the beginning of the tar
   uint32_t tile_id; // just level and tileindex hence fitting in 32bits
   uint32_t size;    // size of the tile in bytes
 };
 
+// Tells apart the versions of a file, all zeros if there is none
+std::array<uint64_t, 4> file_stamp(const std::string& path) {
+  struct stat buffer;
+  if (path.empty() || stat(path.c_str(), &buffer) != 0) {
+    return {};
+  }
+  return {static_cast<uint64_t>(buffer.st_dev), static_cast<uint64_t>(buffer.st_ino),
+          static_cast<uint64_t>(buffer.st_mtime), static_cast<uint64_t>(buffer.st_size)};
+}
+
+// Unique across the processes of a service too, the workers handling a request may live in any
+uint64_t next_reader_id() {
+  static const uint64_t process = static_cast<uint64_t>(std::random_device{}()) << 32;
+  static std::atomic<uint32_t> count{0};
+  return process | ++count;
+}
+
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 
+namespace {
+
+// Hands out a thread-safe cache that is owned elsewhere, so that every reader can own its handle
+class SharedTileCache final : public TileCache {
+public:
+  explicit SharedTileCache(std::shared_ptr<TileCache> cache) : cache_(std::move(cache)) {
+  }
+  void Reserve(size_t tile_size) override {
+    cache_->Reserve(tile_size);
+  }
+  bool Contains(const GraphId& graphid) const override {
+    return cache_->Contains(graphid);
+  }
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override {
+    return cache_->Put(graphid, std::move(tile), size);
+  }
+  graph_tile_ptr Get(const GraphId& graphid) const override {
+    return cache_->Get(graphid);
+  }
+  bool OverCommitted() const override {
+    return cache_->OverCommitted();
+  }
+  void Clear() override {
+    cache_->Clear();
+  }
+  void Trim() override {
+    cache_->Trim();
+  }
+  uint64_t Evictions() const override {
+    return cache_->Evictions();
+  }
+
+private:
+  std::shared_ptr<TileCache> cache_;
+};
+
+} // namespace
+
 tile_gone_error_t::tile_gone_error_t(const std::string& errormessage)
     : std::runtime_error(errormessage) {
 }
@@ -74,6 +147,7 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
   };
 
   bool scan_tar = pt.get<bool>("data_processing.scan_tar", false);
+  extract_policy_t policy(pt);
 
   // if you really meant to load it
   if (pt.get_optional<std::string>("tile_extract")) {
@@ -108,10 +182,18 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
         archive.reset();
       } // loaded ok but with possibly bad blocks
       else {
-        LOG_INFO("Tile extract successfully loaded with tile count: " + std::to_string(tiles.size()));
+        // extracts are either compressed tile by tile or not at all
+        const auto& first = tiles.begin()->second;
+        compressed = is_lz4_frame(first.first, first.second);
+        LOG_INFO(std::string(compressed ? "Compressed tile" : "Tile") +
+                 " extract successfully loaded with tile count: " + std::to_string(tiles.size()));
         if (archive->corrupt_blocks) {
           LOG_WARN("Tile extract had " + std::to_string(archive->corrupt_blocks) + " corrupt blocks");
         }
+        // the reader pins the hot tiles on top of this, see GraphReader::PinTiles
+        if (!policy.is_default()) {
+          advise_extract(archive->mm.get(), archive->mm.size(), policy);
+        }
       }
     } catch (const std::exception& e) {
       LOG_ERROR(e.what());
@@ -192,6 +274,7 @@ bool FlatTileCache::OverCommitted() const {
 
 // Clears the cache.
 void FlatTileCache::Clear() {
+  evictions_ += cache_.size();
   cache_size_ = 0;
   cache_.clear();
   // TODO: this could be optimized by using the remaining bits in tileid. we need to track a 7bit
@@ -223,6 +306,10 @@ void FlatTileCache::Trim() {
   Clear();
 }
 
+uint64_t FlatTileCache::Evictions() const {
+  return evictions_;
+}
+
 // ----------------------------------------------------------------------------
 // SimpleTileCache implementation
 // ----------------------------------------------------------------------------
@@ -248,6 +335,7 @@ bool SimpleTileCache::OverCommitted() const {
 
 // Clears the cache.
 void SimpleTileCache::Clear() {
+  evictions_ += cache_.size();
   cache_size_ = 0;
   cache_.clear();
 }
@@ -271,6 +359,10 @@ void SimpleTileCache::Trim() {
   Clear();
 }
 
+uint64_t SimpleTileCache::Evictions() const {
+  return evictions_;
+}
+
 // ----------------------------------------------------------------------------
 // TileCacheLRU implementation
 // ----------------------------------------------------------------------------
@@ -296,6 +388,7 @@ bool TileCacheLRU::OverCommitted() const {
 }
 
 void TileCacheLRU::Clear() {
+  evictions_ += cache_.size();
   cache_size_ = 0;
   cache_.clear();
   key_val_lru_list_.clear();
@@ -305,6 +398,10 @@ void TileCacheLRU::Trim() {
   TrimToFit(0);
 }
 
+uint64_t TileCacheLRU::Evictions() const {
+  return evictions_;
+}
+
 graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
   auto cached = cache_.find(graphid);
   if (cached == cache_.cend()) {
@@ -327,6 +424,7 @@ size_t TileCacheLRU::TrimToFit(const size_t required_size) {
     freed_space += tile_size;
     cache_.erase(entry_to_evict.id);
     key_val_lru_list_.pop_back();
+    ++evictions_;
   }
   return freed_space;
 }
@@ -414,6 +512,11 @@ void SynchronizedTileCache::Trim() {
   cache_.Trim();
 }
 
+uint64_t SynchronizedTileCache::Evictions() const {
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  return cache_.Evictions();
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 graph_tile_ptr SynchronizedTileCache::Get(const GraphId& graphid) const {
   std::lock_guard<std::mutex> lock(mutex_ref_);
@@ -426,6 +529,196 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+ShardedTileCache::Table::Table(size_t capacity)
+    : mask(capacity - 1), count(0), slots(new Slot[capacity]) {
+}
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(size_t max_size, size_t shard_count)
+    : table_capacity_(16), reader_slots_(new ReaderSlot[kReaderSlots]), cache_size_(0),
+      max_cache_size_(max_size) {
+  size_t count = 1;
+  while (count < shard_count) {
+    count <<= 1;
+  }
+  shard_mask_ = count - 1;
+  shards_.reset(new Shard[count]);
+  for (size_t i = 0; i < count; ++i) {
+    shards_[i].table.store(new Table(table_capacity_));
+  }
+}
+
+ShardedTileCache::~ShardedTileCache() {
+  for (size_t i = 0; i <= shard_mask_; ++i) {
+    delete shards_[i].table.load();
+  }
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  // keep the tables at most half full to keep the probe sequences short
+  size_t per_shard = 2 * (max_cache_size_ / tile_size) / (shard_mask_ + 1);
+  while (table_capacity_ < per_shard) {
+    table_capacity_ <<= 1;
+  }
+  for (size_t i = 0; i <= shard_mask_; ++i) {
+    auto& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto* current = shard.table.load();
+    if (current->mask + 1 >= table_capacity_) {
+      continue;
+    }
+    Replace(shard, Rehash(*current, table_capacity_));
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  auto h = hash(graphid);
+  return Find(shard(h), graphid.Tile_Base().value, h) != nullptr;
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  return cache_size_.load(std::memory_order_relaxed) > max_cache_size_;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (size_t i = 0; i <= shard_mask_; ++i) {
+    auto& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    evictions_.fetch_add(shard.table.load(std::memory_order_relaxed)->count,
+                         std::memory_order_relaxed);
+    Replace(shard, new Table(table_capacity_));
+    cache_size_.fetch_sub(shard.size, std::memory_order_relaxed);
+    shard.size = 0;
+  }
+}
+
+void ShardedTileCache::Trim() {
+  Clear();
+}
+
+uint64_t ShardedTileCache::Evictions() const {
+  return evictions_.load(std::memory_order_relaxed);
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::Get(const GraphId& graphid) const {
+  auto h = hash(graphid);
+  return Find(shard(h), graphid.Tile_Base().value, h);
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ShardedTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto h = hash(graphid);
+  auto key = graphid.Tile_Base().value;
+  auto& shard = this->shard(h);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // someone else may have beaten us to it, we can't swap the tile under the feet of the readers
+  auto* table = shard.table.load(std::memory_order_relaxed);
+  for (auto i = h & table->mask;; i = (i + 1) & table->mask) {
+    auto slot_key = table->slots[i].key.load(std::memory_order_relaxed);
+    if (slot_key == key) {
+      return table->slots[i].tile;
+    }
+    if (slot_key == kInvalidGraphId) {
+      break;
+    }
+  }
+
+  // grow the table when it would become more than half full
+  if ((table->count + 1) * 2 > table->mask + 1) {
+    auto* bigger = Rehash(*table, (table->mask + 1) * 2);
+    Replace(shard, bigger);
+    table = bigger;
+  }
+
+  shard.size += size;
+  cache_size_.fetch_add(size, std::memory_order_relaxed);
+  return Insert(*table, key, h, std::move(tile));
+}
+
+graph_tile_ptr ShardedTileCache::Find(const Shard& shard, uint64_t key, uint64_t hash) const {
+  // every thread sticks to one slot, threads reading the same shard don't share a counter
+  static std::atomic<size_t> next_slot{0};
+  thread_local const size_t slot_index =
+      next_slot.fetch_add(1, std::memory_order_relaxed) % kReaderSlots;
+  auto& readers = reader_slots_[slot_index].readers;
+
+  // register as a reader of the current epoch so the table we load can't be freed under us. the
+  // table is loaded after the registration, a writer who doesn't see it has swapped the table
+  // before and we get the new one
+  auto parity = epoch_.load(std::memory_order_acquire) & 1;
+  readers[parity].fetch_add(1, std::memory_order_acq_rel);
+  graph_tile_ptr tile;
+  const auto* table = shard.table.load(std::memory_order_acquire);
+  for (auto i = hash & table->mask;; i = (i + 1) & table->mask) {
+    const auto& slot = table->slots[i];
+    auto slot_key = slot.key.load(std::memory_order_acquire);
+    if (slot_key == key) {
+      tile = slot.tile;
+      break;
+    }
+    if (slot_key == kInvalidGraphId) {
+      break;
+    }
+  }
+  readers[parity].fetch_sub(1, std::memory_order_release);
+  return tile;
+}
+
+graph_tile_ptr&
+ShardedTileCache::Insert(Table& table, uint64_t key, uint64_t hash, graph_tile_ptr tile) {
+  auto i = hash & table.mask;
+  while (table.slots[i].key.load(std::memory_order_relaxed) != kInvalidGraphId) {
+    i = (i + 1) & table.mask;
+  }
+  // the tile has to be in place before readers can find the key
+  auto& slot = table.slots[i];
+  slot.tile = std::move(tile);
+  slot.key.store(key, std::memory_order_release);
+  ++table.count;
+  return slot.tile;
+}
+
+ShardedTileCache::Table* ShardedTileCache::Rehash(const Table& table, size_t capacity) {
+  auto* rehashed = new Table(capacity);
+  for (size_t i = 0; i <= table.mask; ++i) {
+    const auto& slot = table.slots[i];
+    auto key = slot.key.load(std::memory_order_relaxed);
+    if (key != kInvalidGraphId) {
+      Insert(*rehashed, key, hash(GraphId(key)), slot.tile);
+    }
+  }
+  return rehashed;
+}
+
+void ShardedTileCache::Replace(Shard& shard, Table* table) {
+  auto* previous = shard.table.exchange(table);
+  // readers who registered before the exchange may still be looking at the previous table. we
+  // flip the epoch twice and wait for each parity to drain on every slot because a slow reader
+  // could have read the epoch before the first flip but registered after it (same idea as
+  // userspace RCU). tables are only replaced on growth or clear, this is the rare path
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::lock_guard<std::mutex> lock(grace_mutex_);
+  for (int flip = 0; flip < 2; ++flip) {
+    auto parity = epoch_.fetch_add(1, std::memory_order_acq_rel) & 1;
+    for (size_t i = 0; i < kReaderSlots; ++i) {
+      while (reader_slots_[i].readers[parity].load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  delete previous;
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -437,6 +730,27 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+#ifdef __linux__
+  // one cache in shared memory for all the processes on the host, its already synchronized
+  if (pt.get<bool>("use_shm_cache", false)) {
+    return new ShmTileCache(pt.get<std::string>("shm_cache_name", "/valhalla_tiles"),
+                            max_cache_size, pt.get<size_t>("shm_cache_local_tiles", 16));
+  }
+#endif
+
+  // one lock-free cache shared by all the readers in the process
+  if (pt.get<bool>("global_synchronized_cache", false) &&
+      pt.get<bool>("use_sharded_mem_cache", false)) {
+    static std::shared_ptr<TileCache> globalShardedCache_;
+    static std::once_flag once;
+    std::call_once(once, [&]() {
+      globalShardedCache_ = std::make_shared<ShardedTileCache>(
+          max_cache_size, pt.get<size_t>("sharded_mem_cache_shards",
+                                         ShardedTileCache::kDefaultShardCount));
+    });
+    return new SharedTileCache(globalShardedCache_);
+  }
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
@@ -470,6 +784,18 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
   return new FlatTileCache(max_cache_size);
 }
 
+class TarballGraphMemory final : public GraphMemory {
+public:
+  TarballGraphMemory(std::shared_ptr<midgard::tar> archive, std::pair<char*, size_t> position)
+      : archive_(std::move(archive)) {
+    data = position.first;
+    size = position.second;
+  }
+
+private:
+  const std::shared_ptr<midgard::tar> archive_;
+};
+
 // Constructor using separate tile files
 GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter,
@@ -478,7 +804,45 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
       tile_dir_(tile_extract_->tiles.empty() ? pt.get<std::string>("tile_dir", "") : ""),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
-      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
+      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)),
+      batch_max_tiles_(pt.get<size_t>("tile_batch_max_tiles", kDefaultBatchMaxTiles)) {
+
+  // Remember where the extracts came from so they can be swapped for newer ones later on, and
+  // where the incidents come from to load them again for the new graph
+  for (const auto* key :
+       {"tile_extract", "traffic_extract", "data_processing.scan_tar", "tile_extract_advice",
+        "tile_extract_hugepages", "tile_extract_pin_list", "incident_log", "incident_dir",
+        "incident_max_loading_latency"}) {
+    if (auto value = pt.get_optional<std::string>(key)) {
+      extract_config_.put(key, *value);
+    }
+  }
+  traffic_readonly_ = traffic_readonly;
+  id_ = next_reader_id();
+  extract_reload_interval_ = std::chrono::seconds(pt.get<size_t>("extract_reload_interval", 0));
+  next_extract_check_ = extract_clock_() + extract_reload_interval_;
+  extract_stamps_ = {file_stamp(extract_config_.get<std::string>("tile_extract", "")),
+                     file_stamp(extract_config_.get<std::string>("traffic_extract", ""))};
+  // Caches shared with other readers could hand out tiles of the previous extract to this one
+  if (extract_reload_interval_.count() && (pt.get<bool>("global_synchronized_cache", false) ||
+                                           pt.get<bool>("use_shm_cache", false))) {
+    LOG_WARN("Extracts are not reloaded when the tile cache is shared between readers");
+    extract_reload_interval_ = std::chrono::seconds(0);
+  }
+
+  // Tiles decode the predicted speeds of whole buckets at a time unless told otherwise, the first
+  // reader to say so decides for the whole process
+  if (auto cache = pt.get_optional<bool>("predicted_speed_cache")) {
+    set_decoded_speed_cache(*cache);
+  }
+
+  // How many years around the current one time dependent routes look up timezone offsets for
+  if (auto years = pt.get_optional<uint32_t>("timezone_offset_years")) {
+    DateTime::set_tz_offset_years(*years);
+  }
+
+  // keep the hot tiles in memory no matter what else is going on
+  PinTiles();
 
   // Make a tile fetcher if we havent passed one in from somewhere else
   if (!tile_getter_ && !tile_url_.empty()) {
@@ -491,9 +855,31 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
 
+  // Missing tiles are fetched from the url and kept in the tile dir, if there is one
+  if (tile_getter_ && !tile_url_.empty()) {
+    url_fetcher_ = std::make_unique<url_tile_fetcher_t>(tile_getter_.get(), tile_url_, tile_dir_,
+                                                        max_concurrent_users_);
+  }
+
   // Reserve cache (based on whether using individual tile files or shared,
-  // mmap'd file
-  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  // mmap'd file, tiles of compressed extracts are as big as individual ones once decompressed)
+  cache_->Reserve(tile_extract_->tiles.empty() || tile_extract_->compressed ? AVERAGE_TILE_SIZE
+                                                                          : AVERAGE_MM_TILE_SIZE);
+
+#ifdef __linux__
+  // Tiles in shared memory come without their traffic, which every process attaches on its own
+  if (auto* shm_cache = dynamic_cast<ShmTileCache*>(cache_.get())) {
+    auto extract = tile_extract_;
+    shm_cache->SetTrafficLoader(
+        [extract](const GraphId& base) -> std::unique_ptr<const GraphMemory> {
+          auto traffic = extract->traffic_tiles.find(base);
+          if (traffic == extract->traffic_tiles.end()) {
+            return nullptr;
+          }
+          return std::make_unique<TarballGraphMemory>(extract->traffic_archive, traffic->second);
+        });
+  }
+#endif
 
   // Initialize the incident cache singleton if we have any kind of configuration to do so. if the
   // configuration is wrong or any kind of problem occurs this throws. the call below will spawn a
@@ -506,6 +892,18 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                                                            : GetTileSet());
   }
 
+  // Load tiles the searches are about to need in the background, only worth it for loose tiles
+  // and tiles fetched from a url
+  auto prefetch_threads = pt.get<size_t>("tile_prefetch_threads", 0);
+  if (prefetch_threads > 0 && tile_extract_->tiles.empty() &&
+      (!tile_dir_.empty() || url_fetcher_)) {
+    auto loader = [this](const GraphId& base) {
+      return url_fetcher_ ? LoadTileFromUrl(base) : LoadTileFromDir(base);
+    };
+    const auto max_tiles = pt.get<size_t>("tile_prefetch_max_tiles", 64);
+    prefetcher_ = std::make_unique<tile_prefetcher_t>(loader, prefetch_threads, max_tiles);
+  }
+
   // Fill shortcut recovery cache if requested or by default in memmap mode
   if (pt.get<bool>("shortcut_caching", false)) {
     shortcut_recovery_t::get_instance(this);
@@ -534,18 +932,6 @@ bool GraphReader::DoesTileExist(const GraphId& graphid) const {
          stat((file_location + ".gz").c_str(), &buffer) == 0;
 }
 
-class TarballGraphMemory final : public GraphMemory {
-public:
-  TarballGraphMemory(std::shared_ptr<midgard::tar> archive, std::pair<char*, size_t> position)
-      : archive_(std::move(archive)) {
-    data = position.first;
-    size = position.second;
-  }
-
-private:
-  const std::shared_ptr<midgard::tar> archive_;
-};
-
 // Get a pointer to a graph tile object given a GraphId. Return nullptr
 // if the tile is not found/empty
 graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
@@ -556,11 +942,24 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
-  if (const auto& cached = cache_->Get(base)) {
+  const auto& cached = cache_->Get(base);
+  metrics_.access(base.level(), cached != nullptr);
+  if (cached) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
     return cached;
   }
 
+  // Otherwise go and get it
+  auto start = std::chrono::steady_clock::now();
+  auto tile = LoadGraphTile(base);
+  if (tile) {
+    metrics_.loaded(tile->header()->end_offset(), std::chrono::steady_clock::now() - start);
+  }
+  return tile;
+}
+
+// Loads a tile which isn't in the cache yet and puts it there
+graph_tile_ptr GraphReader::LoadGraphTile(const GraphId& base) {
   // Try getting it from the memmapped tar extract
   if (!tile_extract_->tiles.empty()) {
     // Do we have this tile
@@ -569,15 +968,27 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
-
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
     auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
                               ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
                                                                      traffic_ptr->second)
                               : nullptr;
 
+    // Tiles in a compressed extract are decompressed into memory and only the cache keeps them
+    // around, so the cache has to account for their real size
+    if (is_lz4_frame(t->second.first, t->second.second)) {
+      std::vector<char> data;
+      if (!lz4_decompress(t->second.first, t->second.second, data)) {
+        LOG_ERROR("Failed to decompress tile " + GraphTile::FileSuffix(base));
+        return nullptr;
+      }
+      auto tile = GraphTile::Create(base, std::move(data), std::move(traffic_memory));
+      const size_t size = tile->header()->end_offset();
+      return cache_->Put(base, std::move(tile), size);
+    }
+
     // This initializes the tile from mmap
+    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
     auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
     if (!tile) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
@@ -590,16 +1001,14 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     return cache_->Put(base, std::move(tile), size);
   } // Try getting it from flat file
   else {
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
-
-    // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    // Maybe it was loaded in the background already, if not try to get it from disk and if we
+    // cant..
+    graph_tile_ptr tile = prefetcher_ ? prefetcher_->Take(base) : nullptr;
+    if (!tile && !url_fetcher_) {
+      tile = LoadTileFromDir(base);
+    }
     if (!tile || !tile->header()) {
-      if (!tile_getter_) {
+      if (!url_fetcher_) {
         return nullptr;
       }
 
@@ -611,11 +1020,15 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
         }
       }
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
+      // Get it from the disk cache or the url, joining any download of it already under way
+      bool not_found = false;
+      tile = LoadTileFromUrl(base, &not_found);
       if (!tile) {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        _404s.insert(base);
+        // dont ask again for tiles that arent there, but do for those that failed otherwise
+        if (not_found) {
+          std::lock_guard<std::mutex> lock(_404s_lock);
+          _404s.insert(base);
+        }
         // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
         return nullptr;
       }
@@ -630,6 +1043,307 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
   }
 }
 
+// Loads a tile from the tile directory along with its live traffic
+graph_tile_ptr GraphReader::LoadTileFromDir(const GraphId& base) const {
+  // the prefetcher calls this from its own threads while the extracts might be swapped
+  auto extract = std::atomic_load(&tile_extract_);
+  auto traffic_ptr = extract->traffic_tiles.find(base);
+  auto traffic_memory = traffic_ptr != extract->traffic_tiles.end()
+                            ? std::make_unique<TarballGraphMemory>(extract->traffic_archive,
+                                                                   traffic_ptr->second)
+                            : nullptr;
+  return GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+}
+
+// Fetches a tile from the url (or its copy on disk) along with its live traffic
+graph_tile_ptr GraphReader::LoadTileFromUrl(const GraphId& base, bool* not_found) const {
+  auto data = url_fetcher_->Fetch(base, not_found);
+  if (data.empty()) {
+    return nullptr;
+  }
+  auto extract = std::atomic_load(&tile_extract_);
+  auto traffic_ptr = extract->traffic_tiles.find(base);
+  auto traffic_memory = traffic_ptr != extract->traffic_tiles.end()
+                            ? std::make_unique<TarballGraphMemory>(extract->traffic_archive,
+                                                                   traffic_ptr->second)
+                            : nullptr;
+  return GraphTile::Create(base, std::move(data), std::move(traffic_memory));
+}
+
+// Returns the tile access counters of this reader
+tile_metrics_t::snapshot_t GraphReader::GetTileMetrics() const {
+  auto metrics = metrics_.snapshot();
+  metrics.evictions = cache_->Evictions();
+  return metrics;
+}
+
+// Sums up the metrics of the readers handling a status request
+void GraphReader::AddTileMetrics(TileMetrics& metrics) const {
+  if (std::find(metrics.readers().begin(), metrics.readers().end(), id_) !=
+      metrics.readers().end()) {
+    return;
+  }
+  metrics.add_readers(id_);
+
+  auto counters = GetTileMetrics();
+  metrics.set_hits(metrics.hits() + counters.hits);
+  metrics.set_misses(metrics.misses() + counters.misses);
+  metrics.set_evictions(metrics.evictions() + counters.evictions);
+  metrics.set_tiles_loaded(metrics.tiles_loaded() + counters.tiles_loaded);
+  metrics.set_bytes_loaded(metrics.bytes_loaded() + counters.bytes_loaded);
+  while (metrics.load_latency_size() < static_cast<int>(counters.load_latency.size())) {
+    metrics.add_load_latency(0);
+  }
+  for (size_t i = 0; i < counters.load_latency.size(); ++i) {
+    metrics.set_load_latency(i, metrics.load_latency(i) + counters.load_latency[i]);
+  }
+  while (metrics.level_touches_size() < static_cast<int>(counters.level_touches.size())) {
+    metrics.add_level_touches(0);
+  }
+  for (size_t i = 0; i < counters.level_touches.size(); ++i) {
+    metrics.set_level_touches(i, metrics.level_touches(i) + counters.level_touches[i]);
+  }
+
+  auto prefetch = GetPrefetchStats();
+  metrics.set_prefetch_hits(metrics.prefetch_hits() + prefetch.hits);
+  metrics.set_prefetch_misses(metrics.prefetch_misses() + prefetch.misses);
+  metrics.set_prefetch_wasted(metrics.prefetch_wasted() + prefetch.wasted);
+}
+
+// Locks the given tiles of the extract into memory
+size_t GraphReader::PinTiles(const std::vector<GraphId>& tile_ids) {
+  std::vector<std::pair<char*, size_t>> hot;
+  for (const auto& id : tile_ids) {
+    auto tile = tile_extract_->tiles.find(id.Tile_Base());
+    if (tile != tile_extract_->tiles.end()) {
+      hot.push_back(tile->second);
+    }
+  }
+  return lock_tiles(hot);
+}
+
+// Locks the tiles of the configured pin list into memory
+size_t GraphReader::PinTiles() {
+  const auto pin_list = extract_config_.get<std::string>("tile_extract_pin_list", "");
+  if (pin_list.empty() || tile_extract_->tiles.empty()) {
+    return 0;
+  }
+  auto locked = PinTiles(read_tile_list(pin_list));
+  LOG_INFO("Locked " + std::to_string(locked) + " bytes of hot tiles into memory");
+  return locked;
+}
+
+// Swaps in the extracts if they were replaced on disk
+bool GraphReader::ReloadExtracts() {
+  if (extract_reload_interval_.count() == 0 ||
+      extract_clock_() < next_extract_check_) {
+    return false;
+  }
+  next_extract_check_ = extract_clock_() + extract_reload_interval_;
+
+  decltype(extract_stamps_) stamps = {
+      file_stamp(extract_config_.get<std::string>("tile_extract", "")),
+      file_stamp(extract_config_.get<std::string>("traffic_extract", ""))};
+  if (stamps == extract_stamps_) {
+    return false;
+  }
+
+  // keep serving the old ones if the new ones are no good, maybe they are fixed by the next check
+  std::shared_ptr<const tile_extract_t> extract(
+      new tile_extract_t(extract_config_, traffic_readonly_));
+  if ((extract->tiles.empty() && !tile_extract_->tiles.empty()) ||
+      (extract->traffic_tiles.empty() && !tile_extract_->traffic_tiles.empty())) {
+    LOG_WARN("Replaced extracts could not be loaded, keeping the previous ones");
+    return false;
+  }
+
+  // tiles in use hold on to the previous archives, which are unmapped once the last one is gone
+  std::atomic_store(&tile_extract_, extract);
+  const bool graph_replaced = stamps[0] != extract_stamps_[0];
+  extract_stamps_ = stamps;
+  Clear();
+  PinTiles();
+  LOG_INFO("Swapped in replaced extracts");
+
+  // The recovered shortcuts and the incidents are kept once per process and refer to the edges of
+  // the previous graph. Every reader notices the new one on its own, the first one to do so
+  // replaces them
+  if (graph_replaced) {
+    static std::mutex mutex;
+    static file_stamp_t replaced_by{};
+    std::lock_guard<std::mutex> lock(mutex);
+    if (replaced_by != stamps[0]) {
+      replaced_by = stamps[0];
+      shortcut_recovery_t::invalidate();
+      if (enable_incidents_) {
+        try {
+          incident_singleton_t::reload(extract_config_, GetTileSet());
+        } catch (const std::exception& e) {
+          LOG_ERROR(std::string("Could not reload incidents for the replaced extract: ") +
+                    e.what());
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Loads a batch of tiles from the tile directory into the cache
+size_t GraphReader::LoadTiles(const std::vector<GraphId>& tile_ids) {
+  if (!tile_extract_->tiles.empty() || (tile_dir_.empty() && !url_fetcher_)) {
+    return 0;
+  }
+
+  // only go to disk for the tiles we dont have yet
+  std::vector<GraphId> bases;
+  std::vector<std::string> paths;
+  std::unordered_set<GraphId> seen;
+  for (const auto& id : tile_ids) {
+    auto base = id.Tile_Base();
+    if (!id.Is_Valid() || base.level() > TileHierarchy::get_max_level() || cache_->Contains(base) ||
+        !seen.insert(base).second) {
+      continue;
+    }
+    bases.push_back(base);
+    paths.push_back(tile_dir_ + filesystem::path::preferred_separator +
+                    GraphTile::FileSuffix(base));
+  }
+  if (url_fetcher_) {
+    return FetchTiles(bases);
+  }
+
+  // read the plain tiles in chunks, the cache limit is checked before each one is submitted so
+  // that no more is read than the cache takes. The expansion loads the rest as it reaches them
+  auto start = std::chrono::steady_clock::now();
+  size_t loaded = 0;
+  std::vector<size_t> sizes;
+  for (size_t first = 0; first < bases.size() && !cache_->OverCommitted();
+       first += kBatchChunkTiles) {
+    const size_t last = std::min(first + kBatchChunkTiles, bases.size());
+    auto buffers = read_files({paths.begin() + first, paths.begin() + last}, kBatchChunkTiles);
+    for (size_t i = first; i < last && !cache_->OverCommitted(); ++i) {
+      const auto& base = bases[i];
+      auto& buffer = buffers[i - first];
+      graph_tile_ptr tile;
+      if (buffer) {
+        auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
+        auto traffic_memory =
+            traffic_ptr != tile_extract_->traffic_tiles.end()
+                ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
+                                                       traffic_ptr->second)
+                : nullptr;
+        tile = GraphTile::Create(base, std::move(*buffer), std::move(traffic_memory));
+      } else {
+        // maybe its gzipped
+        tile = LoadTileFromDir(base);
+      }
+      if (!tile || !tile->header()) {
+        continue;
+      }
+      const size_t size = tile->header()->end_offset();
+      cache_->Put(base, std::move(tile), size);
+      sizes.push_back(size);
+      ++loaded;
+    }
+  }
+
+  // the tiles were loaded together, so they all took an equal share of the time
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  for (auto size : sizes) {
+    metrics_.loaded(size, elapsed / sizes.size());
+  }
+  return loaded;
+}
+
+// Fetches a batch of tiles from the url concurrently and puts them in the cache
+size_t GraphReader::FetchTiles(const std::vector<GraphId>& bases) {
+  // dont ask for tiles we know arent there
+  std::vector<GraphId> missing;
+  {
+    std::lock_guard<std::mutex> lock(_404s_lock);
+    std::copy_if(bases.begin(), bases.end(), std::back_inserter(missing),
+                 [this](const GraphId& base) { return _404s.find(base) == _404s.end(); });
+  }
+
+  // fetch them in chunks, checking the cache limit before each one just like with the tile dir
+  auto start = std::chrono::steady_clock::now();
+  size_t loaded = 0;
+  std::vector<size_t> sizes;
+  for (size_t first = 0; first < missing.size() && !cache_->OverCommitted();
+       first += kBatchChunkTiles) {
+    const size_t last = std::min(first + kBatchChunkTiles, missing.size());
+    std::vector<GraphId> chunk(missing.begin() + first, missing.begin() + last), not_found;
+    auto fetched = url_fetcher_->FetchAll(chunk, &not_found);
+    if (!not_found.empty()) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(not_found.begin(), not_found.end());
+    }
+    for (size_t i = 0; i < chunk.size() && !cache_->OverCommitted(); ++i) {
+      const auto& base = chunk[i];
+      if (fetched[i].empty()) {
+        continue;
+      }
+      auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
+      auto traffic_memory =
+          traffic_ptr != tile_extract_->traffic_tiles.end()
+              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
+                                                     traffic_ptr->second)
+              : nullptr;
+      auto tile = GraphTile::Create(base, std::move(fetched[i]), std::move(traffic_memory));
+      const size_t size = tile->header()->end_offset();
+      cache_->Put(base, std::move(tile), size);
+      sizes.push_back(size);
+      ++loaded;
+    }
+  }
+
+  // the tiles were fetched together, so they all took an equal share of the time
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  for (auto size : sizes) {
+    metrics_.loaded(size, elapsed / sizes.size());
+  }
+  return loaded;
+}
+
+// Loads all the tiles in the bounding box if there aren't too many of them
+size_t GraphReader::LoadTiles(const AABB2<PointLL>& bbox) {
+  if (batch_max_tiles_ == 0 || !tile_extract_->tiles.empty() ||
+      (tile_dir_.empty() && !url_fetcher_)) {
+    return 0;
+  }
+  auto tile_ids = TileHierarchy::GetGraphIds(bbox);
+  if (tile_ids.size() > batch_max_tiles_) {
+    LOG_DEBUG("Not batch loading " + std::to_string(tile_ids.size()) + " tiles, the limit is " +
+              std::to_string(batch_max_tiles_));
+    return 0;
+  }
+  return LoadTiles(tile_ids);
+}
+
+// Queues the 8 tiles surrounding the given tile for prefetching
+void GraphReader::PrefetchNeighborsOf(const GraphId& base) {
+  last_prefetched_ = base;
+  // keep the bookkeeping bounded, worst case we hint at some tiles twice
+  if (prefetched_neighbors_.size() > 1024) {
+    prefetched_neighbors_.clear();
+  }
+  if (!prefetched_neighbors_.insert(base).second) {
+    return;
+  }
+
+  const auto& tiles = TileHierarchy::get_tiling(base.level());
+  const int32_t id = base.tileid();
+  const int32_t left = tiles.LeftNeighbor(id);
+  const int32_t right = tiles.RightNeighbor(id);
+  for (auto neighbor : {left, right, tiles.TopNeighbor(id), tiles.BottomNeighbor(id),
+                        tiles.TopNeighbor(left), tiles.BottomNeighbor(left),
+                        tiles.TopNeighbor(right), tiles.BottomNeighbor(right)}) {
+    if (neighbor != id) {
+      Prefetch(GraphId(neighbor, base.level(), 0));
+    }
+  }
+}
+
 // Convenience method to get an opposing directed edge graph Id.
 GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& opp_tile) {
   // If you cant get the tile you get an invalid id
@@ -834,7 +1548,16 @@ GraphId GraphReader::GetShortcut(const GraphId& id) {
 
 // Unpack edges for a given shortcut edge
 std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
-  return shortcut_recovery_t::get_instance().get(shortcut_id, *this);
+  // tiles built with their shortcut edges have them at hand
+  std::vector<GraphId> edges;
+  auto tile = GetGraphTile(shortcut_id);
+  if (tile && tile->shortcut_edges().get(shortcut_id.id(), edges)) {
+    if (edges.empty()) {
+      edges.push_back(shortcut_id);
+    }
+    return edges;
+  }
+  return shortcut_recovery_t::get_instance()->get(shortcut_id, *this);
 }
 
 // Convenience method to get the relative edge density (from the
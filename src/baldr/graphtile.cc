@@ -142,9 +142,12 @@ graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
   return nullptr;
 }
 
-graph_tile_ptr GraphTile::Create(const GraphId& graphid, std::vector<char>&& memory) {
+graph_tile_ptr GraphTile::Create(const GraphId& graphid,
+                                 std::vector<char>&& memory,
+                                 std::unique_ptr<const GraphMemory>&& traffic_memory) {
   return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(memory)))};
+      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(memory)),
+                    std::move(traffic_memory))};
 }
 
 graph_tile_ptr GraphTile::Create(const GraphId& graphid,
@@ -359,16 +362,47 @@ void GraphTile::Initialize(const GraphId& graphid) {
     char* ptr2 = ptr1 + (header_->directededgecount() * sizeof(int32_t));
     predictedspeeds_.set_offset(reinterpret_cast<uint32_t*>(ptr1));
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
+    if (decoded_speed_cache()) {
+      predictedspeeds_.set_cache(header_->predictedspeeds_count());
+    }
 
     lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
   } else {
-    lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
+    // the optional parts at the end of the tile start with the shortcut edges
+    uint32_t lane_connectivity_end = header_->end_offset();
+    if (header_->hot_edges_offset() > 0) {
+      lane_connectivity_end = header_->hot_edges_offset();
+    }
+    if (header_->shortcut_edges_offset() > 0) {
+      lane_connectivity_end = header_->shortcut_edges_offset();
+    }
+    lane_connectivity_size_ = lane_connectivity_end - header_->lane_connectivity_offset();
   }
 
   // For reference - how to use the end offset to set size of an object (that
   // is not fixed size and count).
   // example_size_ = header_->end_offset() - header_->example_offset();
 
+  // Shortcut edges (if available), they come after the predicted speeds
+  if (header_->shortcut_edges_offset() > 0) {
+    const char* shortcut_edges = tile_ptr + header_->shortcut_edges_offset();
+    if (header_->shortcut_edges_offset() >= tile_size ||
+        ShortcutEdges::size(shortcut_edges, tile_size - header_->shortcut_edges_offset()) == 0) {
+      throw std::runtime_error("Shortcut edges exceed the tile data size = " +
+                               std::to_string(tile_size) + ". Tile file might me corrupted");
+    }
+    shortcut_edges_.set_data(shortcut_edges);
+  }
+
+  // Hot edge columns (if available), they are always the last part of the tile
+  if (header_->hot_edges_offset() > 0) {
+    if (header_->hot_edges_offset() + hot_edges_size(header_->directededgecount()) > tile_size) {
+      throw std::runtime_error("Hot edge columns exceed the tile data size = " +
+                               std::to_string(tile_size) + ". Tile file might me corrupted");
+    }
+    hot_edges_.set_data(tile_ptr + header_->hot_edges_offset(), header_->directededgecount());
+  }
+
   // ANY NEW EXPANSION DATA GOES HERE
 
   // Associate one stop Ids for transit tiles
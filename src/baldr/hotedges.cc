@@ -0,0 +1,89 @@
+#include "baldr/hotedges.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// The columns in the order they are stored, widest first so that every column stays aligned
+// as long as the first one is 8-byte aligned
+constexpr size_t kColumnWidths[] = {sizeof(uint64_t), sizeof(uint32_t), sizeof(uint16_t),
+                                    sizeof(uint16_t), sizeof(uint8_t),  sizeof(uint8_t),
+                                    sizeof(uint8_t),  sizeof(uint8_t),  sizeof(uint8_t),
+                                    sizeof(uint8_t),  sizeof(uint8_t)};
+
+template <typename T> void write_column(char*& ptr, const T* values, uint32_t count) {
+  std::memcpy(ptr, values, count * sizeof(T));
+  ptr += count * sizeof(T);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+size_t hot_edges_size(uint32_t count) {
+  size_t size = 0;
+  for (auto width : kColumnWidths) {
+    size += width * count;
+  }
+  return (size + 7) & ~size_t(7);
+}
+
+std::string encode_hot_edges(const DirectedEdge* edges, uint32_t count) {
+  std::vector<uint64_t> endnode(count);
+  std::vector<uint32_t> length(count);
+  std::vector<uint16_t> forwardaccess(count), reverseaccess(count);
+  std::vector<uint8_t> speed(count), classification(count), use(count), superseded(count),
+      shortcut(count), flags(count), localedgeidx(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& edge = edges[i];
+    endnode[i] = edge.endnode().value;
+    length[i] = edge.length();
+    forwardaccess[i] = edge.forwardaccess();
+    reverseaccess[i] = edge.reverseaccess();
+    speed[i] = edge.speed();
+    classification[i] = static_cast<uint8_t>(edge.classification());
+    use[i] = static_cast<uint8_t>(edge.use());
+    superseded[i] = edge.superseded();
+    shortcut[i] = edge.shortcut();
+    flags[i] = (edge.is_shortcut() ? kHotEdgeShortcut : 0) |
+               (edge.leaves_tile() ? kHotEdgeLeavesTile : 0) |
+               (edge.not_thru() ? kHotEdgeNotThru : 0) | (edge.destonly() ? kHotEdgeDestOnly : 0) |
+               (edge.deadend() ? kHotEdgeDeadend : 0) | (edge.toll() ? kHotEdgeToll : 0) |
+               (edge.has_predicted_speed() ? kHotEdgePredictedSpeed : 0);
+    localedgeidx[i] = edge.localedgeidx();
+  }
+
+  std::string columns(hot_edges_size(count), '\0');
+  char* ptr = &columns[0];
+  write_column(ptr, endnode.data(), count);
+  write_column(ptr, length.data(), count);
+  write_column(ptr, forwardaccess.data(), count);
+  write_column(ptr, reverseaccess.data(), count);
+  write_column(ptr, speed.data(), count);
+  write_column(ptr, classification.data(), count);
+  write_column(ptr, use.data(), count);
+  write_column(ptr, superseded.data(), count);
+  write_column(ptr, shortcut.data(), count);
+  write_column(ptr, flags.data(), count);
+  write_column(ptr, localedgeidx.data(), count);
+  return columns;
+}
+
+void HotEdges::set_data(const char* data, uint32_t count) {
+  endnode_ = reinterpret_cast<const uint64_t*>(data);
+  length_ = reinterpret_cast<const uint32_t*>(endnode_ + count);
+  forwardaccess_ = reinterpret_cast<const uint16_t*>(length_ + count);
+  reverseaccess_ = forwardaccess_ + count;
+  speed_ = reinterpret_cast<const uint8_t*>(reverseaccess_ + count);
+  classification_ = speed_ + count;
+  use_ = classification_ + count;
+  superseded_ = use_ + count;
+  shortcut_ = superseded_ + count;
+  flags_ = shortcut_ + count;
+  localedgeidx_ = flags_ + count;
+}
+
+} // namespace baldr
+} // namespace valhalla
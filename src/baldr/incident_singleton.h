@@ -27,6 +27,7 @@ protected:
   struct state_t {
     std::atomic<bool> initialized;  // whether or not the watcher thread has done 1 load of incidents
     std::atomic<bool> lock_free;    // whether or not we can skip locking around cache operations
+    std::atomic<bool> stop;         // whether the watcher should stop, its graph was replaced
     std::condition_variable signal; // how the watcher tells the main thread its done its first load
     std::mutex mutex;               // for locking on cache operations
     // the actual cache where tiles are stored
@@ -38,16 +39,17 @@ protected:
   // destructed, then the watcher would be making use of a deallocated state object. this way, if the
   // watcher is last to die it own the lifetime of the state and if the singleton is the last to die
   // it owns the lifetime of the state. note that we still need to use atomics inside the state as
-  // only the shared_ptr itself is thread safe, not the thing it points to
+  // only the shared_ptr itself is thread safe, not the thing it points to. when the graph is
+  // replaced a new state and watcher take over, so the shared_ptr is only accessed atomically
   std::shared_ptr<state_t> state;
-  // daemon thread to watch for new incident data
-  std::thread watcher;
 
   // prototype for the watch function. we need this so unit tests can safely test all functionality
   using watch_function_t = std::function<void(boost::property_tree::ptree,
                                               std::unordered_set<valhalla::baldr::GraphId>,
                                               std::shared_ptr<state_t>,
                                               std::function<bool(size_t)>)>;
+  // how the watcher threads are started
+  watch_function_t watch_func;
 
   /**
    * Singleton private constructor that static function uses to instantiate the singleton
@@ -58,19 +60,48 @@ protected:
   incident_singleton_t(const boost::property_tree::ptree& config,
                        const std::unordered_set<valhalla::baldr::GraphId>& tileset,
                        const watch_function_t& watch_func = incident_singleton_t::watch)
-      : state{new state_t{}}, watcher(watch_func, config, tileset, state, interrupt()) {
+      : watch_func(watch_func) {
+    std::atomic_store(&state, start(config, tileset));
+  }
+
+  /**
+   * Starts a watcher thread with a fresh state and waits for it to load all the incidents
+   * @param config      lets the daemon thread know where/how to look for incidents
+   * @param tileset     an mmapped graph tileset (ie static) allows incident loading to be lock-free
+   * @return the state the new watcher keeps up to date
+   */
+  std::shared_ptr<state_t> start(const boost::property_tree::ptree& config,
+                                 const std::unordered_set<valhalla::baldr::GraphId>& tileset) {
+    std::shared_ptr<state_t> fresh{new state_t{}};
     // let the thread control its own lifetime
-    watcher.detach();
+    std::thread(watch_func, config, tileset, fresh, interrupt()).detach();
     // check how long we should wait to find out if its initialized
     auto max_loading_latency =
         config.get<time_t>("incident_max_loading_latency", DEFAULT_MAX_LOADING_LATENCY);
 
     // see if the thread can start up and do a pass to load all the incidents
-    std::unique_lock<std::mutex> lock(state->mutex);
+    std::unique_lock<std::mutex> lock(fresh->mutex);
     auto when = std::chrono::system_clock::now() + std::chrono::seconds(max_loading_latency);
-    if (!state->signal.wait_until(lock, when, [&]() -> bool { return state->initialized.load(); })) {
+    if (!fresh->signal.wait_until(lock, when,
+                                  [&]() -> bool { return fresh->initialized.load(); })) {
       throw std::runtime_error("Unable to initialize incident watcher in the configured time period");
     }
+    return fresh;
+  }
+
+  /**
+   * The singleton, created on the first call
+   * @param config    configures the incident loading the first time
+   * @param tileset   configures the incident loading the first time
+   * @param created   set to true if this call created it
+   */
+  static incident_singleton_t& instance(const boost::property_tree::ptree& config,
+                                        const std::unordered_set<valhalla::baldr::GraphId>& tileset,
+                                        bool& created) {
+    // spawn a daemon to watch for incidents
+    static std::unique_ptr<incident_singleton_t> singleton(
+        (created = true, new incident_singleton_t(config, tileset)));
+    return *singleton;
   }
 
   /**
@@ -328,7 +359,7 @@ protected:
 
       // wait just a little before we check again
       std::this_thread::sleep_for(std::chrono::seconds(wait));
-    } while (!interrupt || !interrupt(run_count));
+    } while (!state->stop.load() && (!interrupt || !interrupt(run_count)));
 
     LOG_INFO("Incident watcher has stopped");
   }
@@ -345,19 +376,35 @@ public:
   get(const valhalla::baldr::GraphId& tile_id,
       const boost::property_tree::ptree& config = {},
       const std::unordered_set<valhalla::baldr::GraphId>& tileset = {}) {
-    // spawn a daemon to watch for incidents
-    static incident_singleton_t singleton{config, tileset};
+    bool created = false;
+    auto state = std::atomic_load(&instance(config, tileset, created).state);
 
     // return the tile from the cache or an empty one if its not there
-    auto scoped_lock = singleton.state->lock_free.load()
-                           ? std::unique_lock<std::mutex>()
-                           : std::unique_lock<std::mutex>(singleton.state->mutex);
-    auto found = singleton.state->cache.find(tile_id);
-    if (found == singleton.state->cache.cend()) {
+    auto scoped_lock = state->lock_free.load() ? std::unique_lock<std::mutex>()
+                                               : std::unique_lock<std::mutex>(state->mutex);
+    auto found = state->cache.find(tile_id);
+    if (found == state->cache.cend()) {
       return {};
     }
     auto tile = std::atomic_load_explicit(&found->second, std::memory_order_acquire);
     return tile;
   }
+
+  /**
+   * Loads the incidents again for a graph that replaced the previous one, the incidents of the
+   * previous graph are served until the new ones are loaded and its watcher stops
+   * @param config    configures the incident loading
+   * @param tileset   the tileset of the new graph
+   */
+  static void reload(const boost::property_tree::ptree& config,
+                     const std::unordered_set<valhalla::baldr::GraphId>& tileset) {
+    bool created = false;
+    auto& singleton = instance(config, tileset, created);
+    if (created) {
+      return;
+    }
+    auto previous = std::atomic_exchange(&singleton.state, singleton.start(config, tileset));
+    previous->stop.store(true);
+  }
 };
 } // namespace
@@ -0,0 +1,136 @@
+#include "baldr/landmarkdistances.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr char kLandmarkMagic[8] = {'v', 'a', 'l', 't', 'l', 'm', 'r', 'k'};
+constexpr uint32_t kLandmarkVersion = 1;
+
+struct file_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t landmark_count;
+  uint32_t tile_count;
+  uint32_t node_count;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+LandmarkDistances::LandmarkDistances(const std::string& file_name)
+    : landmark_count_(0), tile_count_(0), landmarks_(nullptr), tiles_(nullptr),
+      node_offsets_(nullptr), distances_(nullptr) {
+  try {
+    file_.map(file_name, filesystem::directory_entry(file_name).file_size(), POSIX_MADV_RANDOM,
+              true);
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map landmark distances " + file_name + ": " + e.what());
+    return;
+  }
+
+  // check that the header and everything it counts fits in the file
+  const char* data = file_.get();
+  const uint64_t size = file_.size();
+  file_header_t header;
+  bool valid = size >= sizeof(header);
+  if (valid) {
+    std::memcpy(&header, data, sizeof(header));
+    valid = std::memcmp(header.magic, kLandmarkMagic, sizeof(header.magic)) == 0 &&
+            header.version == kLandmarkVersion && header.landmark_count > 0 &&
+            header.landmark_count <= kMaxLandmarks;
+  }
+  if (valid) {
+    const uint64_t needed =
+        sizeof(header) + (uint64_t(header.landmark_count) + header.tile_count) * sizeof(GraphId) +
+        (uint64_t(header.tile_count) + 1) * sizeof(uint32_t) +
+        uint64_t(header.node_count) * header.landmark_count * 2 * sizeof(uint32_t);
+    valid = needed == size;
+  }
+  if (valid) {
+    landmarks_ = reinterpret_cast<const GraphId*>(data + sizeof(header));
+    tiles_ = landmarks_ + header.landmark_count;
+    node_offsets_ = reinterpret_cast<const uint32_t*>(tiles_ + header.tile_count);
+    distances_ = node_offsets_ + header.tile_count + 1;
+    valid = node_offsets_[0] == 0 && node_offsets_[header.tile_count] == header.node_count;
+  }
+
+  if (!valid) {
+    LOG_WARN(file_name + " does not hold landmark distances");
+    landmarks_ = tiles_ = nullptr;
+    node_offsets_ = distances_ = nullptr;
+    file_.unmap();
+    return;
+  }
+  landmark_count_ = header.landmark_count;
+  tile_count_ = header.tile_count;
+  LOG_INFO("Mapped landmark distances " + file_name + " of " + std::to_string(landmark_count_) +
+           " landmarks to " + std::to_string(header.node_count) + " nodes");
+}
+
+void LandmarkDistances::write(const std::string& file_name,
+                              const std::vector<GraphId>& tiles,
+                              const std::vector<uint32_t>& node_offsets,
+                              const std::vector<GraphId>& landmarks,
+                              const std::vector<uint32_t>& distances) {
+  if (landmarks.empty() || landmarks.size() > kMaxLandmarks) {
+    throw std::logic_error("Landmark distances need between 1 and " +
+                           std::to_string(kMaxLandmarks) + " landmarks");
+  }
+  if (node_offsets.size() != tiles.size() + 1 || node_offsets.front() != 0 ||
+      uint64_t(node_offsets.back()) * landmarks.size() * 2 != distances.size()) {
+    throw std::logic_error("Every node of every tile needs its distances to every landmark");
+  }
+
+  file_header_t header{};
+  std::memcpy(header.magic, kLandmarkMagic, sizeof(header.magic));
+  header.version = kLandmarkVersion;
+  header.landmark_count = static_cast<uint32_t>(landmarks.size());
+  header.tile_count = static_cast<uint32_t>(tiles.size());
+  header.node_count = node_offsets.back();
+
+  const std::string tmp_name = file_name + ".tmp";
+  std::ofstream out(tmp_name, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + tmp_name);
+  }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(landmarks.data()), landmarks.size() * sizeof(GraphId));
+  out.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(GraphId));
+  out.write(reinterpret_cast<const char*>(node_offsets.data()),
+            node_offsets.size() * sizeof(uint32_t));
+  out.write(reinterpret_cast<const char*>(distances.data()), distances.size() * sizeof(uint32_t));
+  out.close();
+  if (!out || !filesystem::rename(tmp_name, file_name)) {
+    throw std::runtime_error("Could not write " + file_name);
+  }
+}
+
+const uint32_t* LandmarkDistances::distances(const GraphId& node) const {
+  if (landmark_count_ == 0) {
+    return nullptr;
+  }
+  const GraphId tile = node.Tile_Base();
+  const GraphId* end = tiles_ + tile_count_;
+  const GraphId* found = std::lower_bound(tiles_, end, tile);
+  if (found == end || *found != tile) {
+    return nullptr;
+  }
+  const uint32_t* offset = node_offsets_ + (found - tiles_);
+  if (node.id() >= offset[1] - offset[0]) {
+    return nullptr;
+  }
+  return distances_ + (uint64_t(offset[0]) + node.id()) * landmark_count_ * 2;
+}
+
+} // namespace baldr
+} // namespace valhalla
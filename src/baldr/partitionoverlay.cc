@@ -0,0 +1,151 @@
+#include "baldr/partitionoverlay.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr char kOverlayMagic[8] = {'v', 'c', 'r', 'p', 'o', 'v', 'l', 'y'};
+constexpr uint32_t kOverlayVersion = 1;
+
+struct file_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t vertex_count;
+  uint32_t level_count;
+  uint32_t spare;
+  uint32_t cell_count[PartitionOverlay::kMaxLevels];
+  uint32_t entry_count[PartitionOverlay::kMaxLevels];
+  uint32_t exit_count[PartitionOverlay::kMaxLevels];
+};
+
+// how many uint32_t a level takes up in the file
+uint64_t level_size(const file_header_t& header, const uint32_t level) {
+  return uint64_t(header.vertex_count) + 2 * (uint64_t(header.cell_count[level]) + 1) +
+         header.entry_count[level] + header.exit_count[level];
+}
+
+void write_vector(std::ofstream& out, const std::vector<uint32_t>& values) {
+  out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+PartitionOverlay::PartitionOverlay(const std::string& file_name)
+    : vertex_count_(0), level_count_(0), edges_(nullptr), levels_{} {
+  try {
+    file_.map(file_name, filesystem::directory_entry(file_name).file_size(), POSIX_MADV_RANDOM,
+              true);
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map partition overlay " + file_name + ": " + e.what());
+    return;
+  }
+
+  // check that the header and everything it counts fits in the file
+  const char* data = file_.get();
+  const uint64_t size = file_.size();
+  file_header_t header;
+  bool valid = size >= sizeof(header);
+  if (valid) {
+    std::memcpy(&header, data, sizeof(header));
+    valid = std::memcmp(header.magic, kOverlayMagic, sizeof(header.magic)) == 0 &&
+            header.version == kOverlayVersion && header.level_count > 0 &&
+            header.level_count <= kMaxLevels;
+  }
+  if (valid) {
+    uint64_t needed = sizeof(header) + uint64_t(header.vertex_count) * sizeof(GraphId);
+    for (uint32_t level = 0; level < header.level_count; ++level) {
+      needed += level_size(header, level) * sizeof(uint32_t);
+    }
+    valid = needed == size;
+  }
+  if (valid) {
+    edges_ = reinterpret_cast<const GraphId*>(data + sizeof(header));
+    const uint32_t* next = reinterpret_cast<const uint32_t*>(edges_ + header.vertex_count);
+    for (uint32_t level = 0; level < header.level_count && valid; ++level) {
+      auto& mapped = levels_[level];
+      mapped.cell_count = header.cell_count[level];
+      mapped.cells = next;
+      mapped.entry_offsets = mapped.cells + header.vertex_count;
+      mapped.entries = mapped.entry_offsets + mapped.cell_count + 1;
+      mapped.exit_offsets = mapped.entries + header.entry_count[level];
+      mapped.exits = mapped.exit_offsets + mapped.cell_count + 1;
+      next = mapped.exits + header.exit_count[level];
+      valid = mapped.entry_offsets[mapped.cell_count] == header.entry_count[level] &&
+              mapped.exit_offsets[mapped.cell_count] == header.exit_count[level];
+    }
+  }
+
+  if (!valid) {
+    LOG_WARN(file_name + " is not a partition overlay");
+    file_.unmap();
+    return;
+  }
+  vertex_count_ = header.vertex_count;
+  level_count_ = header.level_count;
+  LOG_INFO("Mapped partition overlay " + file_name + " with " + std::to_string(vertex_count_) +
+           " edges in " + std::to_string(level_count_) + " levels");
+}
+
+void PartitionOverlay::write(const std::string& file_name,
+                             const std::vector<GraphId>& edges,
+                             const std::vector<level_t>& levels) {
+  if (levels.empty() || levels.size() > kMaxLevels) {
+    throw std::logic_error("A partition overlay needs between 1 and " +
+                           std::to_string(kMaxLevels) + " levels");
+  }
+
+  file_header_t header{};
+  std::memcpy(header.magic, kOverlayMagic, sizeof(header.magic));
+  header.version = kOverlayVersion;
+  header.vertex_count = static_cast<uint32_t>(edges.size());
+  header.level_count = static_cast<uint32_t>(levels.size());
+  for (uint32_t level = 0; level < levels.size(); ++level) {
+    const auto& l = levels[level];
+    if (l.cells.size() != edges.size() || l.entry_offsets.empty() ||
+        l.entry_offsets.size() != l.exit_offsets.size() ||
+        l.entry_offsets.back() != l.entries.size() || l.exit_offsets.back() != l.exits.size()) {
+      throw std::logic_error("Every vertex of the partition overlay needs its cell and every "
+                             "cell its boundary");
+    }
+    header.cell_count[level] = static_cast<uint32_t>(l.entry_offsets.size() - 1);
+    header.entry_count[level] = static_cast<uint32_t>(l.entries.size());
+    header.exit_count[level] = static_cast<uint32_t>(l.exits.size());
+  }
+
+  const std::string tmp_name = file_name + ".tmp";
+  std::ofstream out(tmp_name, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Could not open " + tmp_name);
+  }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(GraphId));
+  for (const auto& level : levels) {
+    write_vector(out, level.cells);
+    write_vector(out, level.entry_offsets);
+    write_vector(out, level.entries);
+    write_vector(out, level.exit_offsets);
+    write_vector(out, level.exits);
+  }
+  out.close();
+  if (!out || !filesystem::rename(tmp_name, file_name)) {
+    throw std::runtime_error("Could not write " + file_name);
+  }
+}
+
+uint32_t PartitionOverlay::vertex(const GraphId& edge_id) const {
+  const GraphId* end = edges_ + vertex_count_;
+  const GraphId* found = std::lower_bound(edges_, end, edge_id);
+  return found == end || *found != edge_id ? kNoVertex : static_cast<uint32_t>(found - edges_);
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,4 +1,9 @@
 #include "baldr/predictedspeeds.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -11,6 +16,20 @@ constexpr float kSpeedNormalization = 0.031497039f; // sqrt(2.0f / 2016.0f);
 // Size of the cos table for the buckets
 constexpr uint32_t kCosBucketTableSize = kCoefficientCount * kBucketsPerWeek;
 
+// Independent partial sums of the DCT-III, lets the compiler vectorize the sum
+constexpr uint32_t kDecodeLanes = 8;
+static_assert(kCoefficientCount % kDecodeLanes == 0,
+              "Coefficient count must be a multiple of the decode lanes");
+
+// Minimum number of misses of a bucket before a tile decodes it, tiles with more profiles wait for
+// a fraction of them so that only tiles which are really in use pay for decoding all of them
+constexpr uint32_t kMinDecodedSpeedMisses = 32;
+constexpr uint32_t kDecodedSpeedMissFraction = 8;
+
+// whether tiles cache their decoded speeds, until set it is the default
+enum decoded_speed_cache_t : int { kCacheUnset = -1, kCacheOff = 0, kCacheOn = 1 };
+std::atomic<int> cache_decoded_speeds{kCacheUnset};
+
 // Precompute a cos table for each bucket of the week as a singleton.
 class BucketCosTable final {
 public:
@@ -72,17 +91,98 @@ std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speed
   return result;
 }
 
+namespace {
+
+// DCT-III with speed normalization of a single profile given the cos values of the bucket
+inline float decode(const int16_t* coefficients, const float* b) {
+  float lanes[kDecodeLanes] = {};
+  for (uint32_t c = 0; c < kCoefficientCount; c += kDecodeLanes) {
+    for (uint32_t l = 0; l < kDecodeLanes; ++l) {
+      lanes[l] += coefficients[c + l] * b[c + l];
+    }
+  }
+  // the first cos value is 1 but the first coefficient is weighted with 1 / sqrt(2)
+  float speed = coefficients[0] * (k1OverSqrt2 - 1.f);
+  for (uint32_t l = 0; l < kDecodeLanes; ++l) {
+    speed += lanes[l];
+  }
+  return speed * kSpeedNormalization;
+}
+
+} // namespace
+
 float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx) {
   // Get a pointer to the precomputed cos values for this bucket
+  return decode(coefficients, BucketCosTable::GetInstance().get(bucket_idx));
+}
+
+void decompress_speed_buckets(const int16_t* profiles,
+                              uint32_t count,
+                              uint32_t bucket_idx,
+                              float* speeds) {
   const float* b = BucketCosTable::GetInstance().get(bucket_idx);
+  for (uint32_t i = 0; i < count; ++i, profiles += kCoefficientCount) {
+    speeds[i] = decode(profiles, b);
+  }
+}
 
-  // DCT-III with speed normalization
-  float speed = *coefficients * k1OverSqrt2;
-  const auto* coef_end = coefficients + kCoefficientCount;
-  for (++b, ++coefficients; coefficients < coef_end; ++coefficients, ++b) {
-    speed += *coefficients * *b;
+bool set_decoded_speed_cache(bool enabled) {
+  int current = kCacheUnset;
+  const int wanted = enabled ? kCacheOn : kCacheOff;
+  if (cache_decoded_speeds.compare_exchange_strong(current, wanted, std::memory_order_relaxed) ||
+      current == wanted) {
+    return true;
   }
-  return speed * kSpeedNormalization;
+  LOG_WARN("Tiles already " + std::string(current == kCacheOn ? "cache" : "don't cache") +
+           " their decoded speeds for the whole process, ignoring predicted_speed_cache");
+  return false;
+}
+
+bool decoded_speed_cache() {
+  return cache_decoded_speeds.load(std::memory_order_relaxed) != kCacheOff;
+}
+
+DecodedSpeedCache::DecodedSpeedCache(const int16_t* profiles, uint32_t count)
+    : profiles_(profiles), count_(count),
+      threshold_(std::max(kMinDecodedSpeedMisses, count / kDecodedSpeedMissFraction)) {
+}
+
+void DecodedSpeedCache::miss(const uint32_t bucket) {
+  slot_t& slot = slots_[bucket % kDecodedSpeedSlots];
+  if (slot.candidate.load(std::memory_order_relaxed) != bucket) {
+    slot.candidate.store(bucket, std::memory_order_relaxed);
+    slot.misses.store(1, std::memory_order_relaxed);
+    return;
+  }
+  if (slot.misses.fetch_add(1, std::memory_order_relaxed) + 1 < threshold_) {
+    return;
+  }
+
+  // only one thread decodes at a time, the others keep decoding single speeds meanwhile
+  if (writing_.test_and_set(std::memory_order_acquire)) {
+    return;
+  }
+  if (slot.bucket.load(std::memory_order_relaxed) != bucket) {
+    std::vector<float> speeds(count_);
+    decompress_speed_buckets(profiles_, count_, bucket, speeds.data());
+    if (!slot.speeds) {
+      slot.speeds.reset(new std::atomic<float>[count_]);
+    }
+
+    // readers which see the odd version or overlap the update go decode themselves
+    const uint32_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint32_t i = 0; i < count_; ++i) {
+      slot.speeds[i].store(speeds[i], std::memory_order_relaxed);
+    }
+    // the table is allocated on first use, whoever sees the bucket sees the table as well
+    slot.bucket.store(bucket, std::memory_order_release);
+    slot.version.store(version + 2, std::memory_order_release);
+    decoded_.fetch_add(1, std::memory_order_relaxed);
+  }
+  slot.misses.store(0, std::memory_order_relaxed);
+  writing_.clear(std::memory_order_release);
 }
 
 std::string encode_compressed_speeds(const int16_t* coefficients) {
@@ -0,0 +1,930 @@
+#include "baldr/shmtilecache.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kMagic = 0x76616c68616c6c61; // "valhalla"
+constexpr uint32_t kVersion = 3;
+constexpr uint64_t kNone = ~uint64_t(0);
+constexpr uint64_t kAlign = 64;
+constexpr uint64_t kLeaseCount = 1 << 16;
+constexpr uint64_t kOwnerCount = 256;
+
+enum slot_state_t : uint32_t { kEmpty = 0, kLoading = 1, kReady = 2, kTombstone = 3 };
+
+// an entry of the hash table, tiles are only removed once nobody pins them anymore. Writers
+// change it under the lock with the version odd, readers look it up without the lock and only
+// trust what they read if the version was even and didn't change meanwhile (a seqlock)
+struct slot_t {
+  std::atomic<uint32_t> version;
+  std::atomic<uint32_t> state;
+  std::atomic<uint64_t> key;
+  std::atomic<uint64_t> block;
+  std::atomic<uint64_t> size;
+  // the owner token of the process copying the tile in while it is loading
+  std::atomic<uint64_t> loader;
+  std::atomic<uint32_t> pins;
+  std::atomic<uint32_t> referenced;
+};
+
+// a pin held by a process, so that the pins of dead processes can be found. The token is that of
+// the owner record of the process, 0 if the lease is free, pinned is the slot index + 1
+struct lease_t {
+  std::atomic<uint64_t> token;
+  std::atomic<uint64_t> pinned;
+};
+
+// every process using the segment holds the robust mutex of one of these on a thread of its own
+// for as long as it is attached. Whoever manages to lock it knows the process is gone, which
+// unlike its pid holds across pid namespaces and pid reuse
+struct owner_t {
+  pthread_mutex_t mutex;
+  std::atomic<uint64_t> token;
+};
+
+// every allocation in the arena starts with one of these, the free ones form a list by offset
+struct block_t {
+  uint64_t size;
+  uint64_t next;
+  uint64_t free;
+  uint64_t spare;
+};
+
+struct header_t {
+  std::atomic<uint64_t> ready;
+  uint32_t version;
+  std::atomic<uint32_t> poisoned;
+  pthread_mutex_t mutex;
+  uint64_t slot_count;
+  uint64_t lease_count;
+  uint64_t owner_count;
+  uint64_t slots_offset;
+  uint64_t leases_offset;
+  uint64_t owners_offset;
+  uint64_t arena_offset;
+  uint64_t arena_size;
+  uint64_t clock_hand;
+  uint64_t used;
+  uint64_t entries;
+  uint64_t tombstones;
+  uint64_t evictions;
+  uint64_t free_head;
+  uint64_t next_token;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Need lock free atomics across processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "Need lock free atomics across processes");
+
+uint64_t align(uint64_t value) {
+  return (value + kAlign - 1) & ~(kAlign - 1);
+}
+
+uint64_t hash(uint64_t key) {
+  key *= 0x9E3779B97F4A7C15ULL;
+  return key ^ (key >> 29);
+}
+
+// a copy of the contents of a slot while the table is rebuilt
+struct entry_t {
+  uint64_t key, block, size, loader;
+  uint32_t state, referenced;
+};
+
+void init_robust_mutex(pthread_mutex_t& mutex) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+struct ShmTileCache::segment_t {
+  segment_t(std::string name, char* base, size_t size, ino_t inode)
+      : name(std::move(name)), base(base), size(size), inode(inode), pid(getpid()) {
+  }
+  ~segment_t() {
+    if (keeper.joinable()) {
+      // a forked child inherits the object but not the thread
+      if (pid != getpid()) {
+        keeper.detach();
+      } else {
+        {
+          std::lock_guard<std::mutex> lock(keeper_mutex);
+          stopping = true;
+        }
+        keeper_signal.notify_one();
+        keeper.join();
+      }
+    }
+    munmap(base, size);
+  }
+
+  header_t* header() const {
+    return reinterpret_cast<header_t*>(base);
+  }
+  slot_t* slots() const {
+    return reinterpret_cast<slot_t*>(base + header()->slots_offset);
+  }
+  lease_t* leases() const {
+    return reinterpret_cast<lease_t*>(base + header()->leases_offset);
+  }
+  owner_t* owners() const {
+    return reinterpret_cast<owner_t*>(base + header()->owners_offset);
+  }
+  block_t* block(uint64_t offset) const {
+    return reinterpret_cast<block_t*>(base + header()->arena_offset + offset);
+  }
+  char* data(uint64_t offset) const {
+    return reinterpret_cast<char*>(block(offset) + 1);
+  }
+  bool poisoned() const {
+    return header()->poisoned.load(std::memory_order_acquire);
+  }
+
+  // Removes the name unless it already refers to a different segment
+  void Unlink() const {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_ino == inode) {
+      shm_unlink(name.c_str());
+    }
+    close(fd);
+  }
+
+  // Locks the segment. If the previous owner died while holding the lock the segment might be in
+  // any state, so it is given up for everyone and the next attach creates a fresh one
+  bool Lock() const {
+    auto* h = header();
+    int rc = pthread_mutex_lock(&h->mutex);
+    if (rc == EOWNERDEAD) {
+      LOG_WARN("A process died while holding the shared tile cache " + name + ", recreating it");
+      h->poisoned.store(1, std::memory_order_release);
+      Unlink();
+      pthread_mutex_consistent(&h->mutex);
+      pthread_mutex_unlock(&h->mutex);
+      return false;
+    }
+    if (rc != 0) {
+      h->poisoned.store(1, std::memory_order_release);
+      return false;
+    }
+    if (poisoned()) {
+      pthread_mutex_unlock(&h->mutex);
+      return false;
+    }
+    return true;
+  }
+
+  void Unlock() const {
+    pthread_mutex_unlock(&header()->mutex);
+  }
+
+  // These don't take the lock
+
+  // Looks up a ready tile, a slot a writer is busy with counts as a miss
+  uint64_t Probe(uint64_t key, uint32_t& version, uint64_t& offset, uint64_t& bytes) const {
+    const auto* h = header();
+    const auto mask = h->slot_count - 1;
+    auto* table = slots();
+    for (uint64_t i = hash(key) & mask, probes = 0; probes < h->slot_count;
+         i = (i + 1) & mask, ++probes) {
+      auto& slot = table[i];
+      auto v = slot.version.load(std::memory_order_acquire);
+      if (v & 1) {
+        return kNone;
+      }
+      auto state = slot.state.load(std::memory_order_relaxed);
+      auto slot_key = slot.key.load(std::memory_order_relaxed);
+      offset = slot.block.load(std::memory_order_relaxed);
+      bytes = slot.size.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.version.load(std::memory_order_relaxed) != v || state == kEmpty) {
+        return kNone;
+      }
+      if (state == kReady && slot_key == key) {
+        version = v;
+        return i;
+      }
+    }
+    return kNone;
+  }
+
+  // Takes a free lease for this process
+  uint64_t Lease() {
+    if (token == 0) {
+      return kNone;
+    }
+    const auto count = header()->lease_count;
+    const auto first = next_lease.fetch_add(1, std::memory_order_relaxed);
+    for (uint64_t probes = 0; probes < count; ++probes) {
+      auto& lease = leases()[(first + probes) % count];
+      uint64_t free = 0;
+      if (lease.token.load(std::memory_order_relaxed) == 0 &&
+          lease.token.compare_exchange_strong(free, token, std::memory_order_acq_rel)) {
+        next_lease.store(first + probes + 1, std::memory_order_relaxed);
+        return (first + probes) % count;
+      }
+    }
+    return kNone;
+  }
+
+  void ReleaseLease(uint64_t lease) {
+    leases()[lease].pinned.store(0, std::memory_order_relaxed);
+    leases()[lease].token.store(0, std::memory_order_release);
+  }
+
+  // Pins the slot found by Probe unless a writer got to it since. The pin and the version check
+  // pair up with the version bump and the pin check of the writers removing a slot, one of the
+  // two sees the other. A process dying in between leaks the pin of one tile
+  bool Pin(uint64_t index, uint32_t version, uint64_t lease) {
+    auto& slot = slots()[index];
+    slot.pins.fetch_add(1, std::memory_order_seq_cst);
+    if (slot.version.load(std::memory_order_seq_cst) != version) {
+      slot.pins.fetch_sub(1, std::memory_order_release);
+      return false;
+    }
+    leases()[lease].pinned.store(index + 1, std::memory_order_relaxed);
+    slot.referenced.store(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void Unpin(uint64_t index, uint64_t lease) {
+    slots()[index].pins.fetch_sub(1, std::memory_order_release);
+    ReleaseLease(lease);
+  }
+
+  // The rest of the methods must only be called while holding the lock
+
+  uint64_t Find(uint64_t key) const {
+    const auto* h = header();
+    const auto mask = h->slot_count - 1;
+    auto* table = slots();
+    for (uint64_t i = hash(key) & mask, probes = 0; probes < h->slot_count;
+         i = (i + 1) & mask, ++probes) {
+      auto state = table[i].state.load(std::memory_order_relaxed);
+      if (state == kEmpty) {
+        return kNone;
+      }
+      if (state != kTombstone && table[i].key.load(std::memory_order_relaxed) == key) {
+        return i;
+      }
+    }
+    return kNone;
+  }
+
+  // The readers don't trust a slot while its version is odd
+  static void Begin(slot_t& slot) {
+    slot.version.fetch_add(1, std::memory_order_seq_cst);
+  }
+  static void End(slot_t& slot) {
+    slot.version.fetch_add(1, std::memory_order_release);
+  }
+
+  // Rehash marks all slots itself, otherwise the slot is marked while it changes
+  void Insert(const entry_t& entry, bool marked = false) {
+    auto* h = header();
+    const auto mask = h->slot_count - 1;
+    auto* table = slots();
+    uint64_t i = hash(entry.key) & mask;
+    while (table[i].state.load(std::memory_order_relaxed) == kLoading ||
+           table[i].state.load(std::memory_order_relaxed) == kReady) {
+      i = (i + 1) & mask;
+    }
+    auto& slot = table[i];
+    if (!marked) {
+      Begin(slot);
+    }
+    h->tombstones -= slot.state.load(std::memory_order_relaxed) == kTombstone;
+    ++h->entries;
+    slot.key.store(entry.key, std::memory_order_relaxed);
+    slot.block.store(entry.block, std::memory_order_relaxed);
+    slot.size.store(entry.size, std::memory_order_relaxed);
+    slot.loader.store(entry.loader, std::memory_order_relaxed);
+    slot.referenced.store(entry.referenced, std::memory_order_relaxed);
+    slot.state.store(entry.state, std::memory_order_relaxed);
+    if (!marked) {
+      End(slot);
+    }
+  }
+
+  // Frees the tile of the slot unless a reader pinned it meanwhile, the tombstone stays until the
+  // next rehash
+  bool Drop(slot_t& slot) {
+    Begin(slot);
+    if (slot.pins.load(std::memory_order_seq_cst) != 0) {
+      End(slot);
+      return false;
+    }
+    auto* h = header();
+    Deallocate(slot.block.load(std::memory_order_relaxed));
+    h->used -= slot.size.load(std::memory_order_relaxed);
+    --h->entries;
+    ++h->tombstones;
+    slot.state.store(kTombstone, std::memory_order_relaxed);
+    End(slot);
+    return true;
+  }
+
+  bool Remove(slot_t& slot) {
+    if (!Drop(slot)) {
+      return false;
+    }
+    // too many tombstones make for long probes, reinsert everything to get rid of them
+    if (header()->tombstones > header()->slot_count / 4) {
+      Rehash();
+    }
+    return true;
+  }
+
+  // Rebuilds the table without the tombstones. Pinned slots can't move, the pins are released by
+  // slot index, so nothing happens while anything is pinned
+  void Rehash() {
+    auto* h = header();
+    auto* table = slots();
+    for (uint64_t i = 0; i < h->slot_count; ++i) {
+      Begin(table[i]);
+    }
+    bool pinned = false;
+    for (uint64_t i = 0; i < h->slot_count && !pinned; ++i) {
+      pinned = table[i].pins.load(std::memory_order_seq_cst) != 0;
+    }
+    if (!pinned) {
+      std::vector<entry_t> live;
+      live.reserve(h->entries);
+      for (uint64_t i = 0; i < h->slot_count; ++i) {
+        auto& slot = table[i];
+        auto state = slot.state.load(std::memory_order_relaxed);
+        if (state == kLoading || state == kReady) {
+          live.push_back({slot.key.load(std::memory_order_relaxed),
+                          slot.block.load(std::memory_order_relaxed),
+                          slot.size.load(std::memory_order_relaxed),
+                          slot.loader.load(std::memory_order_relaxed), state,
+                          slot.referenced.load(std::memory_order_relaxed)});
+        }
+        slot.state.store(kEmpty, std::memory_order_relaxed);
+      }
+      h->entries = h->tombstones = 0;
+      for (const auto& entry : live) {
+        Insert(entry, true);
+      }
+    }
+    for (uint64_t i = 0; i < h->slot_count; ++i) {
+      End(table[i]);
+    }
+  }
+
+  // Drops a tile nobody pins with a clock sweep, tiles used since the hand last passed them get
+  // another round. Two rounds without a victim means everything is pinned
+  bool Evict() {
+    auto* h = header();
+    const auto mask = h->slot_count - 1;
+    for (uint64_t steps = 0; steps < 2 * h->slot_count; ++steps) {
+      auto& slot = slots()[h->clock_hand];
+      h->clock_hand = (h->clock_hand + 1) & mask;
+      if (slot.state.load(std::memory_order_relaxed) != kReady ||
+          slot.pins.load(std::memory_order_relaxed) != 0) {
+        continue;
+      }
+      if (slot.referenced.load(std::memory_order_relaxed)) {
+        slot.referenced.store(0, std::memory_order_relaxed);
+        continue;
+      }
+      if (Remove(slot)) {
+        ++h->evictions;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // First fit from the free list, splitting off the remainder if it is worth keeping
+  uint64_t Allocate(uint64_t bytes) {
+    auto* h = header();
+    const uint64_t needed = align(bytes + sizeof(block_t));
+    uint64_t* link = &h->free_head;
+    while (*link != kNone) {
+      auto offset = *link;
+      auto* b = block(offset);
+      if (b->size >= needed) {
+        if (b->size - needed >= sizeof(block_t) + kAlign) {
+          auto* rest = block(offset + needed);
+          rest->size = b->size - needed;
+          rest->next = b->next;
+          rest->free = 1;
+          *link = offset + needed;
+          b->size = needed;
+        } else {
+          *link = b->next;
+        }
+        b->free = 0;
+        return offset;
+      }
+      link = &b->next;
+    }
+    return kNone;
+  }
+
+  // Puts the block back into the free list by offset and merges it with its free neighbours
+  void Deallocate(uint64_t offset) {
+    auto* h = header();
+    auto* b = block(offset);
+    b->free = 1;
+    uint64_t prev = kNone;
+    uint64_t next = h->free_head;
+    while (next != kNone && next < offset) {
+      prev = next;
+      next = block(next)->next;
+    }
+    b->next = next;
+    if (next != kNone && offset + b->size == next) {
+      b->size += block(next)->size;
+      b->next = block(next)->next;
+    }
+    if (prev == kNone) {
+      h->free_head = offset;
+    } else if (prev + block(prev)->size == offset) {
+      block(prev)->size += b->size;
+      block(prev)->next = b->next;
+    } else {
+      block(prev)->next = offset;
+    }
+  }
+
+  // Lets go of everything the process of the owner record left behind: its pins and the tiles
+  // it was still copying in
+  void Reclaim(owner_t& owner) {
+    const auto dead = owner.token.load(std::memory_order_relaxed);
+    if (dead != 0) {
+      auto* h = header();
+      for (uint64_t i = 0; i < h->lease_count; ++i) {
+        auto& lease = leases()[i];
+        if (lease.token.load(std::memory_order_acquire) != dead) {
+          continue;
+        }
+        if (auto pinned = lease.pinned.load(std::memory_order_relaxed)) {
+          slots()[pinned - 1].pins.fetch_sub(1, std::memory_order_release);
+        }
+        ReleaseLease(i);
+      }
+      for (uint64_t i = 0; i < h->slot_count; ++i) {
+        auto& slot = slots()[i];
+        if (slot.state.load(std::memory_order_relaxed) == kLoading &&
+            slot.loader.load(std::memory_order_relaxed) == dead) {
+          Drop(slot);
+        }
+      }
+    }
+    owner.token.store(0, std::memory_order_release);
+  }
+
+  // Reclaims what the processes which are gone left behind. Their owner records are the ones
+  // whose mutex can be locked
+  bool ReclaimDeadOwners() {
+    bool reclaimed = false;
+    for (uint64_t i = 0; i < header()->owner_count; ++i) {
+      auto& owner = owners()[i];
+      if (owner.token.load(std::memory_order_acquire) == 0) {
+        continue;
+      }
+      int rc = pthread_mutex_trylock(&owner.mutex);
+      if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&owner.mutex);
+      } else if (rc != 0) {
+        continue;
+      }
+      Reclaim(owner);
+      pthread_mutex_unlock(&owner.mutex);
+      reclaimed = true;
+    }
+    return reclaimed;
+  }
+
+  // Claims an owner record for this process on a thread which holds its mutex until the segment
+  // is unmapped, or the process dies and the kernel lets the next one to lock it know
+  void Claim() {
+    std::promise<void> claimed;
+    auto done = claimed.get_future();
+    keeper = std::thread([this, claimed = std::move(claimed)]() mutable {
+      uint64_t index = kNone;
+      if (Lock()) {
+        for (uint64_t i = 0; i < header()->owner_count && index == kNone; ++i) {
+          auto& owner = owners()[i];
+          int rc = pthread_mutex_trylock(&owner.mutex);
+          if (rc == EOWNERDEAD) {
+            pthread_mutex_consistent(&owner.mutex);
+          } else if (rc != 0) {
+            continue;
+          }
+          Reclaim(owner);
+          index = i;
+          token = ++header()->next_token;
+          owner.token.store(token, std::memory_order_release);
+        }
+        Unlock();
+      }
+      claimed.set_value();
+      if (index == kNone) {
+        LOG_WARN("No room for another process in the shared tile cache " + name +
+                 ", this one won't share tiles");
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(keeper_mutex);
+      keeper_signal.wait(lock, [this]() { return stopping; });
+      auto& owner = owners()[index];
+      if (Lock()) {
+        owner.token.store(0, std::memory_order_release);
+        Unlock();
+      }
+      pthread_mutex_unlock(&owner.mutex);
+    });
+    done.wait();
+  }
+
+  std::string name;
+  char* base;
+  size_t size;
+  ino_t inode;
+  // the process which mapped the segment
+  pid_t pid;
+  // the token of the owner record of this process, 0 if it has none
+  uint64_t token = 0;
+  std::atomic<uint64_t> next_lease{0};
+  std::thread keeper;
+  std::mutex keeper_mutex;
+  std::condition_variable keeper_signal;
+  bool stopping = false;
+};
+
+namespace {
+
+using segment_ptr = std::shared_ptr<ShmTileCache::segment_t>;
+
+void initialize(ShmTileCache::segment_t& segment, uint64_t slot_count, uint64_t arena_size) {
+  auto* h = new (segment.base) header_t();
+  h->version = kVersion;
+  h->slot_count = slot_count;
+  h->lease_count = kLeaseCount;
+  h->owner_count = kOwnerCount;
+  h->slots_offset = align(sizeof(header_t));
+  h->leases_offset = align(h->slots_offset + sizeof(slot_t) * slot_count);
+  h->owners_offset = align(h->leases_offset + sizeof(lease_t) * kLeaseCount);
+  h->arena_offset = align(h->owners_offset + sizeof(owner_t) * kOwnerCount);
+  h->arena_size = arena_size;
+  h->free_head = 0;
+
+  init_robust_mutex(h->mutex);
+  for (uint64_t i = 0; i < kOwnerCount; ++i) {
+    init_robust_mutex(segment.owners()[i].mutex);
+  }
+
+  // the whole arena is one free block, the rest of the segment is zeroed by ftruncate already
+  auto* b = segment.block(0);
+  b->size = arena_size;
+  b->next = kNone;
+  b->free = 1;
+  h->ready.store(kMagic, std::memory_order_release);
+}
+
+segment_ptr attach(const std::string& name, size_t max_size) {
+  // roughly one slot per 16kb of tiles, small tiles are common on the lower levels
+  uint64_t slot_count = 1024;
+  while (slot_count < (uint64_t(1) << 20) && slot_count * 16384 < max_size) {
+    slot_count <<= 1;
+  }
+  const uint64_t arena_size = align(std::max<uint64_t>(max_size, kAlign * 2));
+  const uint64_t size =
+      align(align(align(align(sizeof(header_t)) + sizeof(slot_t) * slot_count) +
+                  sizeof(lease_t) * kLeaseCount) +
+            sizeof(owner_t) * kOwnerCount) +
+      arena_size;
+
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    const bool creator = fd >= 0;
+    if (!creator) {
+      if (errno != EEXIST) {
+        throw std::runtime_error("Could not create shared tile cache " + name + ": " +
+                                 std::strerror(errno));
+      }
+      // someone else created it, unless it got removed in the meantime
+      if ((fd = shm_open(name.c_str(), O_RDWR, 0600)) < 0) {
+        continue;
+      }
+    }
+
+    struct stat st;
+    if ((creator && ftruncate(fd, size) != 0) || fstat(fd, &st) != 0) {
+      auto error = std::string(std::strerror(errno));
+      close(fd);
+      if (creator) {
+        shm_unlink(name.c_str());
+      }
+      throw std::runtime_error("Could not size shared tile cache " + name + ": " + error);
+    }
+    // the creator hasn't sized it yet
+    if (static_cast<size_t>(st.st_size) < sizeof(header_t)) {
+      close(fd);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      throw std::runtime_error("Could not map shared tile cache " + name + ": " +
+                               std::strerror(errno));
+    }
+    auto segment = std::make_shared<ShmTileCache::segment_t>(name, static_cast<char*>(base),
+                                                             st.st_size, st.st_ino);
+    if (creator) {
+      initialize(*segment, slot_count, arena_size);
+      LOG_INFO("Created shared tile cache " + name + " of " + std::to_string(st.st_size) +
+               " bytes");
+      segment->Claim();
+      return segment;
+    }
+
+    // wait for the creator to finish, if it never does it died on the way
+    auto* h = segment->header();
+    for (int i = 0; i < 1000 && h->ready.load(std::memory_order_acquire) != kMagic; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (h->ready.load(std::memory_order_acquire) != kMagic) {
+      LOG_WARN("Shared tile cache " + name + " was never initialized, recreating it");
+      segment->Unlink();
+      continue;
+    }
+    if (h->version != kVersion) {
+      throw std::runtime_error("Shared tile cache " + name +
+                               " was created by an incompatible version, remove it from /dev/shm");
+    }
+    // it was given up but the name wasn't removed yet
+    if (segment->poisoned()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    segment->Claim();
+    return segment;
+  }
+  throw std::runtime_error("Could not attach to shared tile cache " + name);
+}
+
+// All caches of a process share a single mapping of the segment
+segment_ptr get_segment(const std::string& name, size_t max_size) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<ShmTileCache::segment_t>> segments;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& weak = segments[name];
+  auto segment = weak.lock();
+  // a forked child needs a mapping (and an owner record) of its own
+  if (!segment || segment->poisoned() || segment->pid != getpid()) {
+    segment = attach(name, max_size);
+    weak = segment;
+  }
+  return segment;
+}
+
+// Tile memory inside the segment, keeps the segment mapped and the tile pinned while in use
+class ShmGraphMemory final : public GraphMemory {
+public:
+  ShmGraphMemory(segment_ptr segment,
+                 uint64_t index,
+                 uint64_t lease,
+                 char* tile_data,
+                 size_t tile_size)
+      : segment_(std::move(segment)), index_(index), lease_(lease) {
+    data = tile_data;
+    size = tile_size;
+  }
+  ~ShmGraphMemory() override {
+    segment_->Unpin(index_, lease_);
+  }
+
+private:
+  const segment_ptr segment_;
+  const uint64_t index_;
+  const uint64_t lease_;
+};
+
+} // namespace
+
+ShmTileCache::ShmTileCache(const std::string& name, size_t max_size, size_t local_tiles)
+    : name_(name), max_size_(max_size), local_tiles_(local_tiles),
+      segment_(get_segment(name, max_size)) {
+  // processes usually attach when they (re)start, a good time to unpin what crashed ones left
+  if (segment_->Lock()) {
+    segment_->ReclaimDeadOwners();
+    segment_->Unlock();
+  }
+}
+
+ShmTileCache::~ShmTileCache() {
+  // the local tiles pin the segment, let go of them before the segment
+  local_.clear();
+}
+
+void ShmTileCache::Reserve(size_t) {
+}
+
+const std::shared_ptr<ShmTileCache::segment_t>& ShmTileCache::Segment() const {
+  if (segment_->poisoned()) {
+    local_.clear();
+    local_order_.clear();
+    segment_ = get_segment(name_, max_size_);
+  }
+  return segment_;
+}
+
+void ShmTileCache::Remember(const GraphId& graphid, const graph_tile_ptr& tile) const {
+  if (local_tiles_ == 0 || !local_.emplace(graphid, tile).second) {
+    return;
+  }
+  local_order_.push_back(graphid);
+  while (local_order_.size() > local_tiles_) {
+    local_.erase(local_order_.front());
+    local_order_.pop_front();
+  }
+}
+
+bool ShmTileCache::Contains(const GraphId& graphid) const {
+  if (local_.count(graphid)) {
+    return true;
+  }
+  uint32_t version;
+  uint64_t offset, bytes;
+  return Segment()->Probe(graphid, version, offset, bytes) != kNone;
+}
+
+graph_tile_ptr ShmTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t) {
+  if (!tile || !tile->header()) {
+    return tile;
+  }
+  Remember(graphid, tile);
+
+  // without an owner record a tile this process dies copying in couldn't be reclaimed
+  const auto& segment = Segment();
+  auto* h = segment->header();
+  const uint64_t bytes = tile->header()->end_offset();
+  if (segment->token == 0 || align(bytes + sizeof(block_t)) > h->arena_size || !segment->Lock()) {
+    return tile;
+  }
+
+  // somebody else was faster
+  if (segment->Find(graphid) != kNone) {
+    segment->Unlock();
+    return tile;
+  }
+
+  // evict one tile at a time until there is room, if everything is pinned see if some of the
+  // pins belong to dead processes
+  uint64_t offset = kNone;
+  bool reclaimed = false;
+  while (h->entries >= h->slot_count / 4 * 3 || (offset = segment->Allocate(bytes)) == kNone) {
+    if (segment->Evict()) {
+      continue;
+    }
+    if (reclaimed || !segment->ReclaimDeadOwners()) {
+      segment->Unlock();
+      return tile;
+    }
+    reclaimed = true;
+  }
+
+  // reserve the entry and copy the tile without holding the lock, nobody uses it until its ready
+  entry_t entry{graphid, offset, bytes, segment->token, kLoading, 1};
+  segment->Insert(entry);
+  h->used += bytes;
+  char* data = segment->data(offset);
+  segment->Unlock();
+
+  std::memcpy(data, tile->header(), bytes);
+
+  // unless the table was rebuilt meanwhile the slot is still ours
+  if (segment->Lock()) {
+    auto index = segment->Find(graphid);
+    if (index != kNone) {
+      auto& loaded = segment->slots()[index];
+      if (loaded.state.load(std::memory_order_relaxed) == kLoading &&
+          loaded.loader.load(std::memory_order_relaxed) == segment->token) {
+        segment_t::Begin(loaded);
+        loaded.state.store(kReady, std::memory_order_relaxed);
+        segment_t::End(loaded);
+      }
+    }
+    segment->Unlock();
+  }
+  return tile;
+}
+
+graph_tile_ptr ShmTileCache::Get(const GraphId& graphid) const {
+  auto local = local_.find(graphid);
+  if (local != local_.end()) {
+    return local->second;
+  }
+
+  // look it up and pin it without the lock
+  const auto& segment = Segment();
+  auto lease = segment->Lease();
+  if (lease == kNone) {
+    return nullptr;
+  }
+  uint32_t version;
+  uint64_t offset, bytes;
+  auto index = segment->Probe(graphid, version, offset, bytes);
+  if (index == kNone || !segment->Pin(index, version, lease)) {
+    segment->ReleaseLease(lease);
+    return nullptr;
+  }
+  auto memory =
+      std::make_unique<ShmGraphMemory>(segment, index, lease, segment->data(offset), bytes);
+
+  auto tile = GraphTile::Create(graphid, std::move(memory),
+                                traffic_loader_ ? traffic_loader_(graphid) : nullptr);
+  Remember(graphid, tile);
+  return tile;
+}
+
+bool ShmTileCache::OverCommitted() const {
+  return false;
+}
+
+void ShmTileCache::Clear() {
+  Trim();
+  const auto& segment = Segment();
+  if (!segment->Lock()) {
+    return;
+  }
+  // tombstone everything in one pass and rehash once at the end, rehashing in between would move
+  // the slots under the loop
+  auto* h = segment->header();
+  for (uint64_t i = 0; i < h->slot_count; ++i) {
+    auto& slot = segment->slots()[i];
+    if (slot.state.load(std::memory_order_relaxed) == kReady && segment->Drop(slot)) {
+      ++h->evictions;
+    }
+  }
+  segment->Rehash();
+  segment->Unlock();
+}
+
+void ShmTileCache::Trim() {
+  local_.clear();
+  local_order_.clear();
+}
+
+uint64_t ShmTileCache::Evictions() const {
+  return Stats().evictions;
+}
+
+void ShmTileCache::SetTrafficLoader(traffic_loader_t loader) {
+  traffic_loader_ = std::move(loader);
+}
+
+ShmTileCache::stats_t ShmTileCache::Stats() const {
+  const auto& segment = Segment();
+  const auto* h = segment->header();
+  stats_t stats{0, 0, h->arena_size, 0};
+  if (segment->Lock()) {
+    stats = {h->entries, h->used, h->arena_size, h->evictions};
+    segment->Unlock();
+  }
+  return stats;
+}
+
+void ShmTileCache::Remove(const std::string& name) {
+  shm_unlink(name.c_str());
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -5,6 +5,7 @@
 #include "midgard/logging.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -40,6 +41,11 @@ protected:
         // this shouldnt fail but garbled files could cause it
         auto tile = reader->GetGraphTile(tile_id);
         assert(tile);
+        // tiles built with their shortcut edges need no recovery
+        if (!tile->shortcut_edges().empty()) {
+          ++stored;
+          continue;
+        }
         // for each edge in the tile
         for (const auto& edge : tile->GetDirectedEdges()) {
           // skip non-shortcuts or the shortcut is one we wont use
@@ -86,7 +92,8 @@ protected:
 
     LOG_INFO(std::to_string(shortcuts.size()) + " shortcuts recovered as " +
              std::to_string(superseded) + " superseded edges. " + std::to_string(unrecovered) +
-             " shortcuts could not be recovered.");
+             " shortcuts could not be recovered. " + std::to_string(stored) +
+             " tiles had their shortcut edges stored.");
   }
 
   /**
@@ -206,6 +213,18 @@ protected:
   // a place to keep some stats about the recovery
   size_t unrecovered;
   size_t superseded;
+  size_t stored;
+
+  /**
+   * the static instance, it is replaced when the graph is so only access it atomically
+   *
+   * @param reader       the reader used to initialize the cache the first time
+   */
+  static std::shared_ptr<const shortcut_recovery_t>&
+  instance(valhalla::baldr::GraphReader* reader) {
+    static std::shared_ptr<const shortcut_recovery_t> cache{new shortcut_recovery_t(reader)};
+    return cache;
+  }
 
 public:
   /**
@@ -215,9 +234,18 @@ public:
    * @param reader       the reader used to initialize the cache the first time
    * @return a filled cache mapping shortcuts to superseded edges
    */
-  static shortcut_recovery_t& get_instance(valhalla::baldr::GraphReader* reader = nullptr) {
-    static shortcut_recovery_t cache{reader};
-    return cache;
+  static std::shared_ptr<const shortcut_recovery_t>
+  get_instance(valhalla::baldr::GraphReader* reader = nullptr) {
+    return std::atomic_load(&instance(reader));
+  }
+
+  /**
+   * drops the cached shortcuts because the graph they were recovered from was replaced, from now
+   * on shortcuts are recovered on the fly
+   */
+  static void invalidate() {
+    std::atomic_store(&instance(nullptr),
+                      std::shared_ptr<const shortcut_recovery_t>(new shortcut_recovery_t(nullptr)));
   }
 
   /**
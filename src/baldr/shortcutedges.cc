@@ -0,0 +1,85 @@
+#include "baldr/shortcutedges.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// The count of shortcuts and the number of edges, ahead of the shortcuts
+constexpr size_t kShortcutEdgesHeaderSize = 2 * sizeof(uint32_t);
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+std::string
+encode_shortcut_edges(const std::vector<std::pair<uint32_t, std::vector<GraphId>>>& shortcuts) {
+  uint32_t edge_count = 0;
+  for (const auto& shortcut : shortcuts) {
+    edge_count += shortcut.second.size();
+  }
+
+  // one more shortcut marks the end of the edges of the last one
+  std::string data(kShortcutEdgesHeaderSize + (shortcuts.size() + 1) * 2 * sizeof(uint32_t) +
+                       edge_count * sizeof(GraphId),
+                   '\0');
+  char* ptr = &data[0];
+  uint32_t count = shortcuts.size();
+  std::memcpy(ptr, &count, sizeof(count));
+  std::memcpy(ptr + sizeof(count), &edge_count, sizeof(edge_count));
+  ptr += kShortcutEdgesHeaderSize;
+
+  uint32_t first_edge = 0;
+  for (const auto& shortcut : shortcuts) {
+    uint32_t entry[2] = {shortcut.first, first_edge};
+    std::memcpy(ptr, entry, sizeof(entry));
+    ptr += sizeof(entry);
+    first_edge += shortcut.second.size();
+  }
+  uint32_t end[2] = {std::numeric_limits<uint32_t>::max(), first_edge};
+  std::memcpy(ptr, end, sizeof(end));
+  ptr += sizeof(end);
+
+  for (const auto& shortcut : shortcuts) {
+    if (!shortcut.second.empty()) {
+      std::memcpy(ptr, shortcut.second.data(), shortcut.second.size() * sizeof(GraphId));
+      ptr += shortcut.second.size() * sizeof(GraphId);
+    }
+  }
+  return data;
+}
+
+void ShortcutEdges::set_data(const char* data) {
+  std::memcpy(&count_, data, sizeof(count_));
+  shortcuts_ = reinterpret_cast<const shortcut_t*>(data + kShortcutEdgesHeaderSize);
+  edges_ = reinterpret_cast<const GraphId*>(shortcuts_ + count_ + 1);
+}
+
+size_t ShortcutEdges::size(const char* data, size_t available) {
+  if (available < kShortcutEdgesHeaderSize) {
+    return 0;
+  }
+  uint32_t counts[2];
+  std::memcpy(counts, data, sizeof(counts));
+  size_t needed = kShortcutEdgesHeaderSize + (size_t(counts[0]) + 1) * sizeof(shortcut_t) +
+                  size_t(counts[1]) * sizeof(GraphId);
+  return needed <= available ? needed : 0;
+}
+
+bool ShortcutEdges::get(uint32_t idx, std::vector<GraphId>& edges) const {
+  const shortcut_t* end = shortcuts_ + count_;
+  const shortcut_t* found = std::lower_bound(shortcuts_, end, idx,
+                                             [](const shortcut_t& shortcut, uint32_t idx) {
+                                               return shortcut.index < idx;
+                                             });
+  if (found == end || found->index != idx) {
+    return false;
+  }
+  edges.assign(edges_ + found->first_edge, edges_ + (found + 1)->first_edge);
+  return true;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,266 @@
+#include "baldr/tilefetcher.h"
+#include "baldr/compression_utils.h"
+#include "baldr/curl_tilegetter.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphtileheader.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using tile_data_t = std::shared_ptr<const std::vector<char>>;
+using status_code_t = valhalla::baldr::tile_getter_t::status_code_t;
+
+// The outcome of a download, no data if it failed
+struct download_t {
+  tile_data_t data;
+  status_code_t status;
+};
+
+// Downloads in flight in this process by tile url, shared by all the fetchers
+std::mutex in_flight_lock;
+std::unordered_map<std::string, std::shared_future<download_t>> in_flight;
+
+// assume we need 3.5x the space when inflating
+constexpr float kCompressionHint = 3.5f;
+
+bool read_file(const std::string& path, std::vector<char>& data) {
+  std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  data.resize(file.tellg());
+  file.seekg(0, std::ios::beg);
+  return static_cast<bool>(file.read(data.data(), data.size()));
+}
+
+bool gunzip(const std::vector<char>& compressed, std::vector<char>& data) {
+  auto src_func = [&compressed](z_stream& s) -> void {
+    s.next_in = reinterpret_cast<Byte*>(const_cast<char*>(compressed.data()));
+    s.avail_in = static_cast<unsigned int>(compressed.size());
+  };
+  data.clear();
+  auto dst_func = [&data, &compressed](z_stream& s) -> int {
+    auto size = data.size();
+    if (s.total_out < size) {
+      data.resize(s.total_out);
+    } else {
+      size_t more = compressed.size() * kCompressionHint + 1;
+      data.resize(size + more);
+      s.next_out = reinterpret_cast<Byte*>(data.data() + size);
+      s.avail_out = static_cast<unsigned int>(more);
+    }
+    return Z_NO_FLUSH;
+  };
+  return valhalla::baldr::inflate(src_func, dst_func);
+}
+
+// the header has to name the tile and account for every byte of it
+bool is_valid_tile(const valhalla::baldr::GraphId& base, const std::vector<char>& data) {
+  if (data.size() < sizeof(valhalla::baldr::GraphTileHeader)) {
+    return false;
+  }
+  const auto* header = reinterpret_cast<const valhalla::baldr::GraphTileHeader*>(data.data());
+  return header->graphid() == base && header->end_offset() == data.size();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+url_tile_fetcher_t::url_tile_fetcher_t(tile_getter_t* tile_getter,
+                                       const std::string& tile_url,
+                                       const std::string& cache_dir,
+                                       size_t concurrency)
+    : tile_getter_(tile_getter), tile_url_(tile_url), cache_dir_(cache_dir),
+      concurrency_(std::max(concurrency, size_t(1))), downloads_(0), disk_hits_(0), joined_(0),
+      invalid_(0), failures_(0) {
+}
+
+std::vector<char> url_tile_fetcher_t::Fetch(const GraphId& base, bool* not_found) {
+  if (not_found) {
+    *not_found = false;
+  }
+  std::vector<char> data;
+  if (!cache_dir_.empty() && LoadFromDisk(base, data)) {
+    ++disk_hits_;
+    return data;
+  }
+
+  auto url = make_single_point_url(tile_url_, GraphTile::FileSuffix(base, SUFFIX_NON_COMPRESSED,
+                                                                    false));
+  while (true) {
+    // join the download of this tile if some other thread has started it already
+    std::promise<download_t> promise;
+    std::shared_future<download_t> download;
+    bool joining = false;
+    {
+      std::lock_guard<std::mutex> lock(in_flight_lock);
+      auto found = in_flight.find(url);
+      if (found != in_flight.end()) {
+        download = found->second;
+        joining = true;
+      } else {
+        in_flight.emplace(url, promise.get_future().share());
+      }
+    }
+
+    if (joining) {
+      ++joined_;
+      try {
+        const auto& result = download.get();
+        if (not_found) {
+          *not_found = result.status == status_code_t::NOT_FOUND;
+        }
+        return result.data ? *result.data : std::vector<char>{};
+      } catch (...) {
+        // the other thread was interrupted, try again on our own
+        continue;
+      }
+    }
+
+    try {
+      download_t result{nullptr, Download(base, data)};
+      if (result.status == status_code_t::SUCCESS) {
+        result.data = std::make_shared<const std::vector<char>>(data);
+      }
+      if (not_found) {
+        *not_found = result.status == status_code_t::NOT_FOUND;
+      }
+      promise.set_value(std::move(result));
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      std::lock_guard<std::mutex> lock(in_flight_lock);
+      in_flight.erase(url);
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(in_flight_lock);
+    in_flight.erase(url);
+    return data;
+  }
+}
+
+std::vector<std::vector<char>> url_tile_fetcher_t::FetchAll(const std::vector<GraphId>& bases,
+                                                            std::vector<GraphId>* not_found) {
+  std::vector<std::vector<char>> tiles(bases.size());
+  std::mutex not_found_lock;
+  auto fetch = [&](size_t i) {
+    bool missing = false;
+    tiles[i] = Fetch(bases[i], &missing);
+    if (missing && not_found) {
+      std::lock_guard<std::mutex> lock(not_found_lock);
+      not_found->push_back(bases[i]);
+    }
+  };
+
+  // only getters that allow it are used from several threads
+  size_t thread_count = tile_getter_->thread_safe() ? std::min(concurrency_, bases.size()) : 1;
+  if (thread_count <= 1) {
+    for (size_t i = 0; i < bases.size(); ++i) {
+      fetch(i);
+    }
+    return tiles;
+  }
+
+  // every thread takes the next tile nobody has taken yet
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_lock;
+  auto work = [&]() {
+    for (size_t i = next++; i < bases.size(); i = next++) {
+      try {
+        fetch(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_lock);
+        error = std::current_exception();
+        next = bases.size();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return tiles;
+}
+
+url_tile_fetcher_t::stats_t url_tile_fetcher_t::Stats() const {
+  return {downloads_.load(), disk_hits_.load(), joined_.load(), invalid_.load(), failures_.load()};
+}
+
+bool url_tile_fetcher_t::LoadFromDisk(const GraphId& base, std::vector<char>& data) {
+  auto path = cache_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(base);
+  bool gzipped = false;
+  if (!read_file(path, data)) {
+    path += ".gz";
+    std::vector<char> compressed;
+    if (!read_file(path, compressed)) {
+      return false;
+    }
+    gzipped = true;
+    if (!gunzip(compressed, data)) {
+      data.clear();
+    }
+  }
+
+  if (is_valid_tile(base, data)) {
+    return true;
+  }
+  LOG_WARN("Removing broken " + std::string(gzipped ? "compressed " : "") + "copy of tile " +
+           GraphTile::FileSuffix(base) + " from " + cache_dir_);
+  ++invalid_;
+  filesystem::remove(path);
+  data.clear();
+  return false;
+}
+
+status_code_t url_tile_fetcher_t::Download(const GraphId& base, std::vector<char>& data) {
+  auto fname = GraphTile::FileSuffix(base, SUFFIX_NON_COMPRESSED, false);
+  auto response = tile_getter_->get(make_single_point_url(tile_url_, fname));
+  if (response.status_ != status_code_t::SUCCESS) {
+    ++failures_;
+    return response.status_;
+  }
+
+  bool gzipped = tile_getter_->gzipped();
+  if (gzipped && !gunzip(response.bytes_, data)) {
+    data.clear();
+  }
+  if (!is_valid_tile(base, gzipped ? data : response.bytes_)) {
+    LOG_WARN("Downloaded a broken copy of tile " + fname);
+    ++failures_;
+    data.clear();
+    return status_code_t::FAILURE;
+  }
+  ++downloads_;
+
+  // keep it just as we got it, saving writes a temporary file and moves it into place
+  if (!cache_dir_.empty()) {
+    auto suffix = GraphTile::FileSuffix(base, gzipped ? SUFFIX_COMPRESSED : SUFFIX_NON_COMPRESSED);
+    filesystem::save(cache_dir_ + filesystem::path::preferred_separator + suffix, response.bytes_);
+  }
+  if (!gzipped) {
+    data = std::move(response.bytes_);
+  }
+  return status_code_t::SUCCESS;
+}
+
+} // namespace baldr
+} // namespace valhalla
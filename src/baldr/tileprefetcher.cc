@@ -0,0 +1,127 @@
+#include "baldr/tileprefetcher.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+
+namespace valhalla {
+namespace baldr {
+
+tile_prefetcher_t::tile_prefetcher_t(loader_t loader, size_t threads, size_t max_tiles)
+    : loader_(std::move(loader)), max_tiles_(std::max(max_tiles, size_t(1))), stop_(false),
+      generation_(0), hits_(0), misses_(0), wasted_(0) {
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&tile_prefetcher_t::Work, this);
+  }
+}
+
+tile_prefetcher_t::~tile_prefetcher_t() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  signal_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void tile_prefetcher_t::Prefetch(const GraphId& tile_base) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() + parked_.size() >= max_tiles_ || pending_.count(tile_base) ||
+        parked_.count(tile_base)) {
+      return;
+    }
+    pending_.insert(tile_base);
+    queue_.push_back(tile_base);
+  }
+  signal_.notify_one();
+}
+
+graph_tile_ptr tile_prefetcher_t::Take(const GraphId& tile_base) {
+  graph_tile_ptr tile;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto parked = parked_.find(tile_base);
+    if (parked != parked_.end()) {
+      tile = std::move(parked->second.tile);
+      parked_order_.erase(parked->second.order);
+      parked_.erase(parked);
+    }
+  }
+  ++(tile ? hits_ : misses_);
+  return tile;
+}
+
+void tile_prefetcher_t::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // whatever is being loaded right now is still pending and gets dropped when done
+  for (const auto& id : queue_) {
+    pending_.erase(id);
+  }
+  queue_.clear();
+  if (pending_.empty()) {
+    idle_.notify_all();
+  }
+  ++generation_;
+  wasted_ += parked_.size();
+  parked_.clear();
+  parked_order_.clear();
+}
+
+void tile_prefetcher_t::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this]() { return pending_.empty(); });
+}
+
+tile_prefetcher_t::stats_t tile_prefetcher_t::Stats() const {
+  return {hits_.load(), misses_.load(), wasted_.load()};
+}
+
+void tile_prefetcher_t::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    signal_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+    auto tile_base = queue_.front();
+    queue_.pop_front();
+    auto generation = generation_;
+
+    // do the expensive part (disk io and decompression) without holding the lock
+    lock.unlock();
+    graph_tile_ptr tile;
+    try {
+      tile = loader_(tile_base);
+    } catch (const std::exception& e) {
+      LOG_WARN("Failed to prefetch tile " + GraphTile::FileSuffix(tile_base) + ": " + e.what());
+    }
+    lock.lock();
+
+    pending_.erase(tile_base);
+    if (pending_.empty()) {
+      idle_.notify_all();
+    }
+    // the tile might be from before the reader was cleared, i.e. from a replaced extract
+    if (generation != generation_) {
+      wasted_ += tile != nullptr;
+      continue;
+    }
+    if (!tile) {
+      continue;
+    }
+    parked_order_.push_back(tile_base);
+    parked_.emplace(tile_base, parked_t{std::move(tile), std::prev(parked_order_.end())});
+    // drop the tiles that have been parked the longest, the reader didn't need them after all
+    while (parked_order_.size() > max_tiles_) {
+      parked_.erase(parked_order_.front());
+      parked_order_.pop_front();
+      ++wasted_;
+    }
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
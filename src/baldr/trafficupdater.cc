@@ -0,0 +1,152 @@
+#include "baldr/trafficupdater.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// every speed is written with a single store so readers never see half of it
+inline void store(valhalla::baldr::TrafficSpeed* dst, const valhalla::baldr::TrafficSpeed& src) {
+  uint64_t bits;
+  std::memcpy(&bits, &src, sizeof(bits));
+  *reinterpret_cast<volatile uint64_t*>(dst) = bits;
+}
+
+inline valhalla::baldr::TrafficSpeed load(const valhalla::baldr::TrafficSpeed* src) {
+  uint64_t bits = *reinterpret_cast<const volatile uint64_t*>(src);
+  valhalla::baldr::TrafficSpeed speed;
+  std::memcpy(&speed, &bits, sizeof(bits));
+  return speed;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+traffic_updater_t::traffic_updater_t(const std::string& traffic_extract,
+                                     std::chrono::milliseconds min_publish_interval)
+    : min_publish_interval_(min_publish_interval),
+      archive_(std::make_shared<midgard::tar>(traffic_extract, false)), pending_(0), stats_{} {
+  for (const auto& c : archive_->contents) {
+    GraphId tile_id;
+    try {
+      tile_id = GraphTile::GetTileId(c.first);
+    } catch (...) {
+      // not a tile, the index for example
+      continue;
+    }
+
+    char* data = const_cast<char*>(c.second.first);
+    size_t size = c.second.second;
+    if (size < sizeof(TrafficTileHeader)) {
+      LOG_WARN("Skipping traffic tile " + c.first + " which is too small for its header");
+      continue;
+    }
+    auto* header = reinterpret_cast<TrafficTileHeader*>(data);
+    size_t speeds_size = sizeof(TrafficSpeed) * size_t(header->directed_edge_count);
+    if (size < sizeof(TrafficTileHeader) + speeds_size) {
+      LOG_WARN("Skipping traffic tile " + c.first + " which is too small for its edges");
+      continue;
+    }
+    bool double_buffered =
+        header->speed_buffers > 1 && size >= sizeof(TrafficTileHeader) + 2 * speeds_size;
+    tiles_.emplace(tile_id,
+                   tile_t{header, reinterpret_cast<TrafficSpeed*>(data + sizeof(TrafficTileHeader)),
+                          double_buffered, std::chrono::steady_clock::time_point{}});
+  }
+  if (tiles_.empty()) {
+    throw std::runtime_error("Traffic extract " + traffic_extract + " contains no traffic tiles");
+  }
+}
+
+void traffic_updater_t::Update(const GraphId& edge, const TrafficSpeed& speed) {
+  staged_[edge.Tile_Base()].emplace_back(edge.id(), speed);
+  ++pending_;
+}
+
+size_t traffic_updater_t::Pending() const {
+  return pending_;
+}
+
+size_t traffic_updater_t::Publish(uint64_t last_update) {
+  size_t written = 0;
+  for (const auto& updates : staged_) {
+    auto tile = tiles_.find(updates.first);
+    if (tile == tiles_.cend()) {
+      stats_.dropped += updates.second.size();
+      continue;
+    }
+    written += Publish(tile->second, updates.second, last_update);
+  }
+  staged_.clear();
+  pending_ = 0;
+  ++stats_.batches;
+  stats_.edges += written;
+  return written;
+}
+
+size_t traffic_updater_t::Publish(tile_t& tile,
+                                  const std::vector<std::pair<uint32_t, TrafficSpeed>>& updates,
+                                  uint64_t last_update) {
+  const uint32_t count = tile.header->directed_edge_count;
+  auto* volatile_header = static_cast<volatile TrafficTileHeader*>(tile.header);
+
+  // single set of speeds, write them where the readers are
+  TrafficSpeed* speeds = tile.speeds;
+  uint32_t shadow = 0;
+  if (tile.double_buffered) {
+    // readers that were on the other set before the last flip get the interval to let go of it
+    const auto since = std::chrono::steady_clock::now() - tile.flipped;
+    if (since < min_publish_interval_) {
+      std::this_thread::sleep_for(min_publish_interval_ - since);
+      ++stats_.waits;
+    }
+
+    // bring the other set up to date with the one readers use and then write to that one
+    const uint32_t active = volatile_header->active_buffer & 1;
+    shadow = active ^ 1;
+    speeds = tile.speeds + size_t(shadow) * count;
+    const TrafficSpeed* current = tile.speeds + size_t(active) * count;
+    for (uint32_t i = 0; i < count; ++i) {
+      store(speeds + i, load(current + i));
+    }
+  }
+
+  size_t written = 0;
+  for (const auto& update : updates) {
+    if (update.first >= count) {
+      LOG_WARN("Dropping traffic update for edge " + std::to_string(update.first) + " of tile " +
+               std::to_string(tile.header->tile_id) + " which has " + std::to_string(count) +
+               " edges");
+      ++stats_.dropped;
+      continue;
+    }
+    store(speeds + update.first, update.second);
+    ++written;
+  }
+  volatile_header->last_update = last_update;
+
+  // the speeds have to land before readers are sent to them
+  if (tile.double_buffered) {
+    std::atomic_thread_fence(std::memory_order_release);
+    volatile_header->active_buffer = shadow;
+    tile.flipped = std::chrono::steady_clock::now();
+    ++stats_.flips;
+  }
+  return written;
+}
+
+bool traffic_updater_t::HasTile(const GraphId& tile_id) const {
+  return tiles_.find(tile_id.Tile_Base()) != tiles_.cend();
+}
+
+traffic_updater_t::stats_t traffic_updater_t::Stats() const {
+  return stats_;
+}
+
+} // namespace baldr
+} // namespace valhalla
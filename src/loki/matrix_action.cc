@@ -2,7 +2,9 @@
 #include "loki/worker.h"
 #include "tyr/actor.h"
 
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace valhalla;
 using namespace valhalla::tyr;
@@ -118,6 +120,8 @@ void loki_worker_t::matrix(Api& request) {
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  std::unordered_set<size_t> source_components, target_components;
+  const auto access = component_access(options);
   try {
     const auto searched = loki::Search(sources_targets, *reader, costing);
     for (size_t i = 0; i < sources_targets.size(); ++i) {
@@ -143,6 +147,12 @@ void loki_worker_t::matrix(Api& request) {
           ++itr->second;
         }
       }
+      if (access) {
+        auto& components =
+            i < static_cast<size_t>(options.sources_size()) ? source_components : target_components;
+        auto location_components = connectivity_map->get_components(access, projection, *reader);
+        components.insert(location_components.cbegin(), location_components.cend());
+      }
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -157,6 +167,13 @@ void loki_worker_t::matrix(Api& request) {
       break;
     }
   }
+  // unlike the colors the components only reject the matrix when no source can reach any target
+  if (connected && access) {
+    connected = std::any_of(source_components.cbegin(), source_components.cend(),
+                            [&target_components](size_t component) {
+                              return target_components.count(component) > 0;
+                            });
+  }
   if (!connected) {
     throw valhalla_exception_t{170};
   };
@@ -95,6 +95,8 @@ void loki_worker_t::route(Api& request) {
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  std::unordered_map<size_t, size_t> component_counts;
+  const auto access = component_access(options);
   try {
     auto locations = PathLocation::fromPBF(options.locations(), true);
     const auto projections = loki::Search(locations, *reader, costing);
@@ -113,6 +115,12 @@ void loki_worker_t::route(Api& request) {
           ++itr->second;
         }
       }
+      // the components of the mode tell apart tiles which are next to each other
+      if (access) {
+        for (auto component : connectivity_map->get_components(access, correlated, *reader)) {
+          ++component_counts[component];
+        }
+      }
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -120,14 +128,15 @@ void loki_worker_t::route(Api& request) {
   if (!connectivity_map) {
     return;
   }
-  bool connected = false;
-  for (const auto& c : color_counts) {
-    if (c.second == options.locations_size()) {
-      connected = true;
-      break;
+  auto all_in_one = [&options](const std::unordered_map<size_t, size_t>& counts) {
+    for (const auto& c : counts) {
+      if (c.second == static_cast<size_t>(options.locations_size())) {
+        return true;
+      }
     }
-  }
-  if (!connected) {
+    return false;
+  };
+  if (!all_in_one(color_counts) || (access && !all_in_one(component_counts))) {
     throw valhalla_exception_t{170};
   };
 }
@@ -73,6 +73,9 @@ void loki_worker_t::status(Api& request) const {
   status->set_has_timezones(tile && tile->node(0)->timezone() > 0);
   status->set_has_live_traffic(reader->HasLiveTraffic());
   status->set_osm_changeset(tile ? tile->header()->dataset_id() : 0);
+
+  // how this worker got at its tiles so far, thor adds its reader's if it has its own
+  reader->AddTileMetrics(*status->mutable_tile_metrics());
 }
 } // namespace loki
 } // namespace valhalla
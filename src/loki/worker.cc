@@ -83,6 +83,20 @@ void loki_worker_t::parse_locations(google::protobuf::RepeatedPtrField<valhalla:
   }
 }
 
+uint32_t loki_worker_t::component_access(const Options& options) const {
+  // transit and bike share change modes along the way and a costing ignoring access can use edges
+  // the components of its mode are not made of
+  if (!connectivity_map || !costing || options.costing_type() == Costing::multimodal ||
+      options.costing_type() == Costing::transit || options.costing_type() == Costing::bikeshare) {
+    return 0;
+  }
+  auto found = options.costings().find(options.costing_type());
+  if (found != options.costings().cend() && found->second.options().ignore_access()) {
+    return 0;
+  }
+  return connectivity_map->has_components(costing->access_mode()) ? costing->access_mode() : 0;
+}
+
 void loki_worker_t::parse_costing(Api& api, bool allow_none) {
   auto& options = *api.mutable_options();
   // using the costing we can determine what type of edge filtering to use
@@ -300,6 +314,11 @@ void loki_worker_t::cleanup() {
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  // the connectivity has to be worked out again for a new graph, a persisted map is only mapped
+  // again if it was built for the new tiles
+  if (reader->ReloadExtracts() && connectivity_map) {
+    connectivity_map.reset(new connectivity_map_t(config.get_child("mjolnir"), reader));
+  }
 }
 
 void loki_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
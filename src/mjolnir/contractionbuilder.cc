@@ -0,0 +1,336 @@
+#include "mjolnir/contractionbuilder.h"
+#include "baldr/contractiongraph.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "scoped_timer.h"
+#include "sif/costfactory.h"
+#include "sif/dynamiccost.h"
+#include "sif/turns.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+using arc_t = ContractionGraph::arc_t;
+using sweep_arc_t = ContractionGraph::sweep_arc_t;
+constexpr uint32_t kNoVertex = ContractionGraph::kNoVertex;
+
+// Witness searches give up after settling this many vertices, the shortcut is added then even
+// though another path might have been just as cheap
+constexpr uint32_t kMaxWitnessSettled = 500;
+
+// How often to log the progress of the contraction
+constexpr uint32_t kProgressInterval = 1000000;
+
+// The auto costing of requests without costing options. The services drop the time dependent
+// speeds for requests without a date_time, which are the only ones the hierarchy is used for.
+valhalla::Costing contraction_costing() {
+  rapidjson::Document doc;
+  doc.SetObject();
+  valhalla::Costing costing;
+  ParseCosting(doc, "/costing_options/auto", &costing, valhalla::Costing::auto_);
+  auto& options = *costing.mutable_options();
+  options.set_flow_mask(options.flow_mask() & ~(kPredictedFlowMask | kCurrentFlowMask));
+  return costing;
+}
+
+/**
+ * Contracts the vertices of a graph in the order of how many shortcuts they need, keeping the
+ * arcs each vertex has to the vertices contracted after it.
+ */
+class contractor_t {
+public:
+  explicit contractor_t(const uint32_t vertex_count)
+      : up(vertex_count), down(vertex_count), out_(vertex_count), in_(vertex_count),
+        deleted_neighbors_(vertex_count, 0),
+        cost_(vertex_count, std::numeric_limits<float>::infinity()) {
+  }
+
+  // adds an arc between two uncontracted vertices, only the cheaper of parallel arcs is kept
+  void add_arc(const uint32_t from, const arc_t& arc) {
+    const uint32_t to = arc.vertex;
+    if (from == to) {
+      return;
+    }
+    arc_t opposite = arc;
+    opposite.vertex = from;
+    for (auto& existing : out_[from]) {
+      if (existing.vertex != to) {
+        continue;
+      }
+      if (arc.cost < existing.cost) {
+        existing = arc;
+        for (auto& in : in_[to]) {
+          if (in.vertex == from) {
+            in = opposite;
+            break;
+          }
+        }
+      }
+      return;
+    }
+    out_[from].push_back(arc);
+    in_[to].push_back(opposite);
+  }
+
+  void contract() {
+    using entry_t = std::pair<int64_t, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    for (uint32_t vertex = 0; vertex < out_.size(); ++vertex) {
+      queue.emplace(priority(vertex), vertex);
+    }
+
+    // the priorities go stale as the neighbors get contracted, a vertex whose priority went up
+    // goes back in the queue until it is still the cheapest one to contract
+    uint32_t contracted = 0;
+    while (!queue.empty()) {
+      const uint32_t vertex = queue.top().second;
+      queue.pop();
+      const int64_t current = priority(vertex);
+      if (!queue.empty() && current > queue.top().first) {
+        queue.emplace(current, vertex);
+        continue;
+      }
+      contract(vertex);
+      order.push_back(vertex);
+      if (++contracted % kProgressInterval == 0) {
+        LOG_INFO("Contracted " + std::to_string(contracted) + " of " +
+                 std::to_string(out_.size()) + " edges");
+      }
+    }
+  }
+
+  std::vector<std::vector<arc_t>> up;
+  std::vector<std::vector<arc_t>> down;
+  // the vertices in the order they were contracted
+  std::vector<uint32_t> order;
+
+private:
+  // edge difference plus the neighbors already contracted, which spreads the contraction out
+  int64_t priority(const uint32_t vertex) {
+    return static_cast<int64_t>(shortcuts(vertex, false)) -
+           static_cast<int64_t>(out_[vertex].size() + in_[vertex].size()) +
+           deleted_neighbors_[vertex];
+  }
+
+  void contract(const uint32_t vertex) {
+    shortcuts(vertex, true);
+    for (const auto& arc : out_[vertex]) {
+      remove(in_[arc.vertex], vertex);
+      ++deleted_neighbors_[arc.vertex];
+    }
+    for (const auto& arc : in_[vertex]) {
+      remove(out_[arc.vertex], vertex);
+      ++deleted_neighbors_[arc.vertex];
+    }
+    // whatever is left leads to vertices contracted later on
+    up[vertex] = std::move(out_[vertex]);
+    down[vertex] = std::move(in_[vertex]);
+    out_[vertex] = {};
+    in_[vertex] = {};
+  }
+
+  static void remove(std::vector<arc_t>& arcs, const uint32_t vertex) {
+    arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                              [vertex](const arc_t& arc) { return arc.vertex == vertex; }),
+               arcs.end());
+  }
+
+  // counts the shortcuts contracting the vertex needs and adds them if asked to
+  uint32_t shortcuts(const uint32_t vertex, const bool add) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < in_[vertex].size(); ++i) {
+      const arc_t in = in_[vertex][i];
+      float max_cost = -1.f;
+      for (const auto& out : out_[vertex]) {
+        if (out.vertex != in.vertex) {
+          max_cost = std::max(max_cost, in.cost + out.cost);
+        }
+      }
+      if (max_cost < 0.f) {
+        continue;
+      }
+
+      // no shortcut is needed where going around the vertex is no more expensive
+      witness_search(in.vertex, vertex, max_cost);
+      for (const auto& out : out_[vertex]) {
+        const float via = in.cost + out.cost;
+        if (out.vertex == in.vertex || cost_[out.vertex] <= via) {
+          continue;
+        }
+        ++count;
+        if (add) {
+          add_arc(in.vertex,
+                  {out.vertex, vertex, via, in.secs + out.secs, in.length + out.length});
+        }
+      }
+    }
+    return count;
+  }
+
+  // dijkstra from the source which avoids the vertex being contracted
+  void witness_search(const uint32_t source, const uint32_t avoid, const float max_cost) {
+    for (auto vertex : reached_) {
+      cost_[vertex] = std::numeric_limits<float>::infinity();
+    }
+    reached_.clear();
+
+    using entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    cost_[source] = 0.f;
+    reached_.push_back(source);
+    queue.emplace(0.f, source);
+    uint32_t settled = 0;
+    while (!queue.empty()) {
+      const auto entry = queue.top();
+      queue.pop();
+      if (entry.first > cost_[entry.second]) {
+        continue;
+      }
+      if (entry.first > max_cost || ++settled > kMaxWitnessSettled) {
+        break;
+      }
+      for (const auto& arc : out_[entry.second]) {
+        const float cost = entry.first + arc.cost;
+        if (arc.vertex == avoid || cost >= cost_[arc.vertex]) {
+          continue;
+        }
+        if (cost_[arc.vertex] == std::numeric_limits<float>::infinity()) {
+          reached_.push_back(arc.vertex);
+        }
+        cost_[arc.vertex] = cost;
+        queue.emplace(cost, arc.vertex);
+      }
+    }
+  }
+
+  // the arcs between vertices which are not contracted yet
+  std::vector<std::vector<arc_t>> out_;
+  std::vector<std::vector<arc_t>> in_;
+  std::vector<uint32_t> deleted_neighbors_;
+  std::vector<float> cost_;
+  std::vector<uint32_t> reached_;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  const auto file_name = pt.get<std::string>("mjolnir.contraction_hierarchy");
+  const auto costing_options = contraction_costing();
+  const auto costing = CostFactory{}.Create(costing_options);
+  // no turns onto destination-only edges, which the first pass of bidirectional A* doesn't take
+  costing->set_allow_destination_only(false);
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // every edge the costing may use is a vertex, shortcuts are replaced by the hierarchy
+  std::vector<GraphId> edges;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      if (costing->Allowed(tile->directededge(i), tile, kDisallowShortcut)) {
+        edges.emplace_back(tile_id.tileid(), tile_id.level(), i);
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  auto vertex = [&edges](const GraphId& edge_id) {
+    auto found = std::lower_bound(edges.begin(), edges.end(), edge_id);
+    return found == edges.end() || *found != edge_id ? kNoVertex
+                                                     : static_cast<uint32_t>(found - edges.begin());
+  };
+
+  // the arcs are the turns the searches would take, each costs the turn and the edge turned onto
+  contractor_t contractor(edges.size());
+  size_t turns = 0;
+  for (uint32_t from = 0; from < edges.size(); ++from) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    for_each_turn(reader, *costing, edges[from],
+                  [&](const GraphId& edge_id, const DirectedEdge* edge, const Cost& cost) {
+                    const uint32_t to = vertex(edge_id);
+                    if (to != kNoVertex) {
+                      contractor.add_arc(from,
+                                         {to, kNoVertex, cost.cost, cost.secs, edge->length()});
+                      ++turns;
+                    }
+                  });
+  }
+  LOG_INFO("Contracting " + std::to_string(edges.size()) + " edges connected by " +
+           std::to_string(turns) + " turns");
+  contractor.contract();
+
+  // A vertex sits a level above every vertex with an arc to it that was contracted before it, so
+  // that going down the levels reaches the vertices after everything they have down arcs from
+  std::vector<uint32_t> level(edges.size(), 0);
+  for (auto v : contractor.order) {
+    for (const auto* arcs : {&contractor.up[v], &contractor.down[v]}) {
+      for (const auto& arc : *arcs) {
+        level[arc.vertex] = std::max(level[arc.vertex], level[v] + 1);
+      }
+    }
+  }
+  std::vector<uint32_t> sweep_order(edges.size());
+  std::iota(sweep_order.begin(), sweep_order.end(), 0);
+  std::stable_sort(sweep_order.begin(), sweep_order.end(),
+                   [&level](uint32_t a, uint32_t b) { return level[a] > level[b]; });
+  std::vector<uint32_t> sweep_position(edges.size());
+  for (uint32_t position = 0; position < sweep_order.size(); ++position) {
+    sweep_position[sweep_order[position]] = position;
+  }
+  contractor.order = {};
+  level = {};
+
+  std::vector<uint64_t> sweep_offsets{0};
+  std::vector<sweep_arc_t> sweep_arcs;
+  for (auto v : sweep_order) {
+    const auto begin = sweep_arcs.size();
+    for (const auto& arc : contractor.down[v]) {
+      sweep_arcs.push_back({sweep_position[arc.vertex], arc.cost, arc.secs, arc.length});
+    }
+    std::sort(sweep_arcs.begin() + begin, sweep_arcs.end(),
+              [](const sweep_arc_t& a, const sweep_arc_t& b) { return a.position < b.position; });
+    sweep_offsets.push_back(sweep_arcs.size());
+  }
+
+  std::vector<uint64_t> up_offsets{0}, down_offsets{0};
+  std::vector<arc_t> up_arcs, down_arcs;
+  for (uint32_t v = 0; v < edges.size(); ++v) {
+    up_arcs.insert(up_arcs.end(), contractor.up[v].begin(), contractor.up[v].end());
+    down_arcs.insert(down_arcs.end(), contractor.down[v].begin(), contractor.down[v].end());
+    up_offsets.push_back(up_arcs.size());
+    down_offsets.push_back(down_arcs.size());
+    contractor.up[v] = {};
+    contractor.down[v] = {};
+  }
+  LOG_INFO("Writing contraction hierarchy with " + std::to_string(up_arcs.size()) +
+           " upward and " + std::to_string(down_arcs.size()) + " downward arcs to " + file_name);
+  ContractionGraph::write(file_name, ContractionGraph::fingerprint(costing_options.options()),
+                          edges, up_offsets, up_arcs, down_offsets, down_arcs, sweep_order,
+                          sweep_offsets, sweep_arcs);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,189 @@
+#include "mjolnir/graphrenumberer.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Resolution of the Hilbert curve across a tile, 2^16 cells per side
+constexpr uint32_t kHilbertOrder = 16;
+
+/**
+ * Position of a cell along the Hilbert curve filling a square of 2^order cells per side.
+ * @param  x      column of the cell
+ * @param  y      row of the cell
+ * @param  order  number of bits per coordinate
+ * @return the distance of the cell along the curve
+ */
+uint64_t hilbert_index(uint32_t x, uint32_t y, uint32_t order) {
+  uint64_t d = 0;
+  for (uint32_t s = 1u << (order - 1); s > 0; s >>= 1) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+    // rotate the quadrant so the curve stays continuous
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - (x & (s - 1));
+        y = s - 1 - (y & (s - 1));
+      }
+      std::swap(x, y);
+    }
+    x &= s - 1;
+    y &= s - 1;
+  }
+  return d;
+}
+
+/**
+ * Orders the nodes of a tile along a Hilbert curve across the tile.
+ * @param  tile  the tile
+ * @return the old index of the node at each position
+ */
+std::vector<uint32_t> HilbertOrder(const graph_tile_ptr& tile) {
+  const auto bounds = tile->BoundingBox();
+  const double cells = static_cast<double>((1u << kHilbertOrder) - 1);
+  const uint32_t count = tile->header()->nodecount();
+  std::vector<uint64_t> position(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto ll = tile->node(i)->latlng(tile->header()->base_ll());
+    auto cell = [cells](double v, double min, double max) {
+      double t = std::clamp((v - min) / (max - min), 0.0, 1.0);
+      return static_cast<uint32_t>(std::round(t * cells));
+    };
+    position[i] = hilbert_index(cell(ll.lng(), bounds.minx(), bounds.maxx()),
+                                cell(ll.lat(), bounds.miny(), bounds.maxy()), kHilbertOrder);
+  }
+
+  std::vector<uint32_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&position](uint32_t a, uint32_t b) { return position[a] < position[b]; });
+  return order;
+}
+
+/**
+ * Orders the nodes of a tile breadth first along the edges within the tile. Every connected part
+ * of the tile is started from its first node along the Hilbert curve.
+ * @param  tile  the tile
+ * @return the old index of the node at each position
+ */
+std::vector<uint32_t> BreadthFirstOrder(const graph_tile_ptr& tile) {
+  const uint32_t count = tile->header()->nodecount();
+  std::vector<uint32_t> order;
+  order.reserve(count);
+  std::vector<bool> visited(count, false);
+  std::deque<uint32_t> queue;
+  for (auto seed : HilbertOrder(tile)) {
+    if (visited[seed]) {
+      continue;
+    }
+    visited[seed] = true;
+    queue.push_back(seed);
+    while (!queue.empty()) {
+      uint32_t index = queue.front();
+      queue.pop_front();
+      order.push_back(index);
+      const NodeInfo* node = tile->node(index);
+      for (const auto& edge : tile->GetDirectedEdges(node)) {
+        if (edge.endnode().Tile_Base() == tile->id() && !visited[edge.endnode().id()]) {
+          visited[edge.endnode().id()] = true;
+          queue.push_back(edge.endnode().id());
+        }
+      }
+    }
+  }
+  return order;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void GraphRenumberer::Renumber(const boost::property_tree::ptree& pt) {
+  auto node_order = pt.get<std::string>("mjolnir.node_order", "");
+  if (node_order.empty()) {
+    LOG_INFO("GraphRenumberer - keeping the ingestion order. Skipping...");
+    return;
+  }
+  if (node_order != "hilbert" && node_order != "bfs") {
+    throw std::runtime_error("Unknown mjolnir.node_order " + node_order +
+                             ", expected hilbert or bfs");
+  }
+
+  SCOPED_TIMER();
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // Reorder the nodes within each tile, remembering where every node went
+  std::unordered_map<GraphId, std::vector<uint32_t>> new_node_index;
+  auto local_tiles = reader.GetTileSet(TileHierarchy::levels().back().level);
+  for (const auto& tile_id : local_tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    auto order = node_order == "bfs" ? BreadthFirstOrder(tile) : HilbertOrder(tile);
+
+    GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, true);
+    tilebuilder.ReorderNodes(order);
+    tilebuilder.StoreTileData();
+
+    auto& new_index = new_node_index[tile_id];
+    new_index.resize(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+      new_index[order[i]] = i;
+    }
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Update the end nodes of all directed edges. Clear the GraphReader cache first.
+  reader.Clear();
+  for (const auto& tile_id : local_tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, false);
+
+    std::vector<NodeInfo> nodes(tile->node(0), tile->node(0) + tile->header()->nodecount());
+    std::vector<DirectedEdge> directededges;
+    directededges.reserve(tile->header()->directededgecount());
+    for (uint32_t j = 0; j < tile->header()->directededgecount(); ++j) {
+      directededges.push_back(*tile->directededge(j));
+      DirectedEdge& edge = directededges.back();
+      auto new_index = new_node_index.find(edge.endnode().Tile_Base());
+      if (new_index == new_node_index.end()) {
+        LOG_ERROR("GraphRenumberer - end node in a tile that was not renumbered: " +
+                  std::to_string(edge.endnode()));
+        continue;
+      }
+      GraphId endnode = edge.endnode();
+      endnode.set_id(new_index->second[endnode.id()]);
+      edge.set_endnode(endnode);
+    }
+    tilebuilder.Update(nodes, directededges);
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  LOG_INFO("Renumbered the nodes of " + std::to_string(local_tiles.size()) + " tiles in " +
+           node_order + " order");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
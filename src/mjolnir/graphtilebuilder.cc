@@ -3,6 +3,8 @@
 #include "baldr/directededge.h"
 #include "baldr/edgeinfo.h"
 #include "baldr/graphconstants.h"
+#include "baldr/hotedges.h"
+#include "baldr/shortcutedges.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
@@ -43,6 +45,30 @@ std::vector<ComplexRestrictionBuilder> DeserializeRestrictions(char* restriction
   return builders;
 };
 
+// Bytes of padding needed after offset to align to an 8-byte word
+uint32_t padding_to_word(uint32_t offset) {
+  return (8 - offset % 8) % 8;
+}
+
+// The shortcut edges of a stored tile as they are, empty if it has none. They are followed by
+// the hot edge columns if the tile has those
+std::string stored_shortcut_edges(const GraphTileHeader* header) {
+  if (!header || header->shortcut_edges_offset() == 0) {
+    return {};
+  }
+  uint32_t end = header->hot_edges_offset() ? header->hot_edges_offset() : header->end_offset();
+  const char* base = reinterpret_cast<const char*>(header);
+  return std::string(base + header->shortcut_edges_offset(), base + end);
+}
+
+// Where the optional parts at the end of a stored tile begin
+uint32_t optional_parts_offset(const GraphTileHeader* header) {
+  if (header->shortcut_edges_offset() > 0) {
+    return header->shortcut_edges_offset();
+  }
+  return header->hot_edges_offset() ? header->hot_edges_offset() : header->end_offset();
+}
+
 } // namespace
 
 // Constructor given an existing tile. This is used to read in the tile
@@ -413,6 +439,33 @@ void GraphTileBuilder::StoreTileData() {
                route_builder_.size())
                   .str());
 
+    // Keep the shortcut edges of a tile which had them as long as it has the same directed edges
+    std::string shortcut_edges;
+    if (header_builder_.shortcut_edges_offset() > 0 && header_ &&
+        header_->directededgecount() == directededges_builder_.size()) {
+      shortcut_edges = stored_shortcut_edges(header_);
+    }
+    header_builder_.set_shortcut_edges_offset(0);
+    if (!shortcut_edges.empty()) {
+      uint32_t padding = padding_to_word(header_builder_.end_offset());
+      in_mem.write("\0\0\0\0\0\0\0\0", padding);
+      in_mem.write(shortcut_edges.data(), shortcut_edges.size());
+      header_builder_.set_shortcut_edges_offset(header_builder_.end_offset() + padding);
+      header_builder_.set_end_offset(header_builder_.shortcut_edges_offset() +
+                                     shortcut_edges.size());
+    }
+
+    // Keep the hot edge columns of a tile which had them in sync with its directed edges
+    if (header_builder_.hot_edges_offset() > 0) {
+      uint32_t padding = padding_to_word(header_builder_.end_offset());
+      auto hot_edges =
+          encode_hot_edges(directededges_builder_.data(), directededges_builder_.size());
+      in_mem.write("\0\0\0\0\0\0\0\0", padding);
+      in_mem.write(hot_edges.data(), hot_edges.size());
+      header_builder_.set_hot_edges_offset(header_builder_.end_offset() + padding);
+      header_builder_.set_end_offset(header_builder_.hot_edges_offset() + hot_edges.size());
+    }
+
     // Write the header then the rest of the tile from the in memory buffer
     file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
     file << in_mem.rdbuf();
@@ -476,6 +529,73 @@ GraphTileHeader& GraphTileBuilder::header_builder() {
   return header_builder_;
 }
 
+// Reorders the nodes (and their directed edges) and remaps everything indexed by them.
+std::vector<uint32_t> GraphTileBuilder::ReorderNodes(const std::vector<uint32_t>& order) {
+  if (order.size() != nodes_builder_.size()) {
+    throw std::runtime_error("GraphTileBuilder::ReorderNodes - order does not cover all nodes");
+  }
+  if (!transitions_builder_.empty() || !departure_builder_.empty() || !stop_builder_.empty() ||
+      !complex_restriction_forward_builder_.empty() ||
+      !complex_restriction_reverse_builder_.empty()) {
+    throw std::runtime_error("GraphTileBuilder::ReorderNodes - tile " +
+                             std::to_string(header_builder_.graphid()) +
+                             " has transitions, transit or complex restrictions");
+  }
+  bool has_ext = !directededges_ext_builder_.empty();
+
+  // Move the nodes and their edges into the new order
+  std::vector<uint32_t> node_map(nodes_builder_.size());
+  std::vector<uint32_t> edge_map(directededges_builder_.size());
+  std::vector<NodeInfo> nodes;
+  std::vector<DirectedEdge> directededges;
+  std::vector<DirectedEdgeExt> directededges_ext;
+  nodes.reserve(nodes_builder_.size());
+  directededges.reserve(directededges_builder_.size());
+  directededges_ext.reserve(directededges_ext_builder_.size());
+  for (auto old_index : order) {
+    node_map[old_index] = nodes.size();
+    nodes.push_back(nodes_builder_[old_index]);
+    NodeInfo& node = nodes.back();
+    uint32_t edge_index = node.edge_index();
+    node.set_edge_index(directededges.size());
+    for (uint32_t i = edge_index; i < edge_index + node.edge_count(); ++i) {
+      edge_map[i] = directededges.size();
+      directededges.push_back(directededges_builder_[i]);
+      if (has_ext) {
+        directededges_ext.push_back(directededges_ext_builder_[i]);
+      }
+    }
+  }
+  if (directededges.size() != directededges_builder_.size()) {
+    throw std::runtime_error("GraphTileBuilder::ReorderNodes - directed edges of tile " +
+                             std::to_string(header_builder_.graphid()) +
+                             " are not all reachable from its nodes");
+  }
+  nodes_builder_ = std::move(nodes);
+  directededges_builder_ = std::move(directededges);
+  directededges_ext_builder_ = std::move(directededges_ext);
+
+  // Remap everything indexed by node or directed edge, lists which are looked up by binary
+  // search are sorted again when the tile is stored
+  for (auto& sign : signs_builder_) {
+    bool on_node = sign.type() == Sign::Type::kJunctionName ||
+                   sign.type() == Sign::Type::kTollName ||
+                   (sign.type() == Sign::Type::kLinguistic && sign.is_route_num_type());
+    sign.set_index(on_node ? node_map[sign.index()] : edge_map[sign.index()]);
+  }
+  for (auto& turnlanes : turnlanes_builder_) {
+    turnlanes.set_edgeindex(edge_map[turnlanes.edgeindex()]);
+  }
+  std::sort(turnlanes_builder_.begin(), turnlanes_builder_.end());
+  for (auto& restriction : access_restriction_builder_) {
+    restriction.set_edgeindex(edge_map[restriction.edgeindex()]);
+  }
+  for (auto& lc : lane_connectivity_builder_) {
+    lc.set_to(edge_map[lc.to()]);
+  }
+  return edge_map;
+}
+
 // Get the current list of node builders.
 std::vector<NodeInfo>& GraphTileBuilder::nodes() {
   return nodes_builder_;
@@ -1164,6 +1284,12 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
   header.set_textlist_offset(header.textlist_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
+  if (header.shortcut_edges_offset() > 0) {
+    header.set_shortcut_edges_offset(header.shortcut_edges_offset() + shift);
+  }
+  if (header.hot_edges_offset() > 0) {
+    header.set_hot_edges_offset(header.hot_edges_offset() + shift);
+  }
   header.set_end_offset(header.end_offset() + shift);
   // rewrite the tile
   filesystem::path filename =
@@ -1236,13 +1362,32 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write a new header - add the offset to predicted speed data and the profile count.
-    // Update the end offset (shift by the amount of predicted speed data added).
-    size_t offset = header_->end_offset();
-    header_builder_.set_end_offset(header_->end_offset() +
+    // Update the end offset (shift by the amount of predicted speed data added). The shortcut
+    // edges (if any) follow the speeds as they are and the hot edge columns (if any) are rebuilt
+    // from the updated directed edges after them.
+    size_t offset = optional_parts_offset(header_);
+    header_builder_.set_end_offset(offset +
                                    (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
                                    (speed_profile_builder_.size() * sizeof(int16_t)));
     header_builder_.set_predictedspeeds_offset(offset);
     header_builder_.set_predictedspeeds_count(speed_profile_builder_.size() / kCoefficientCount);
+    auto shortcut_edges = stored_shortcut_edges(header_);
+    uint32_t shortcut_edges_padding = 0;
+    if (!shortcut_edges.empty()) {
+      shortcut_edges_padding = padding_to_word(header_builder_.end_offset());
+      header_builder_.set_shortcut_edges_offset(header_builder_.end_offset() +
+                                                shortcut_edges_padding);
+      header_builder_.set_end_offset(header_builder_.shortcut_edges_offset() +
+                                     shortcut_edges.size());
+    }
+    std::string hot_edges;
+    uint32_t padding = 0;
+    if (header_->hot_edges_offset() > 0) {
+      hot_edges = encode_hot_edges(directededges.data(), directededges.size());
+      padding = padding_to_word(header_builder_.end_offset());
+      header_builder_.set_hot_edges_offset(header_builder_.end_offset() + padding);
+      header_builder_.set_end_offset(header_builder_.hot_edges_offset() + hot_edges.size());
+    }
     file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
 
     // Copy the nodes (they are unchanged when adding predicted speeds).
@@ -1270,14 +1415,91 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
     file.write(reinterpret_cast<const char*>(speed_profile_builder_.data()),
                speed_profile_builder_.size() * sizeof(int16_t));
 
-    // Write the rest of the tiles. TBD (if anything is added after the speed profiles
-    // then this will need to be updated)
+    // Write the shortcut edges (if the tile had them)
+    if (!shortcut_edges.empty()) {
+      file.write("\0\0\0\0\0\0\0\0", shortcut_edges_padding);
+      file.write(shortcut_edges.data(), shortcut_edges.size());
+    }
+
+    // Write the hot edge columns (if the tile had them)
+    if (!hot_edges.empty()) {
+      file.write("\0\0\0\0\0\0\0\0", padding);
+      file.write(hot_edges.data(), hot_edges.size());
+    }
 
     // Close the file
     file.close();
   }
 }
 
+// Appends the hot edge columns to the stored tile, replacing the ones it already has.
+void GraphTileBuilder::AddHotEdges() {
+  if (!header_) {
+    throw std::runtime_error("GraphTileBuilder::AddHotEdges - tile has not been stored yet");
+  }
+
+  filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
+                              GraphTile::FileSuffix(header_builder_.graphid());
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + filename.string());
+  }
+
+  // Everything up to the columns stays as it is
+  uint32_t offset =
+      header_->hot_edges_offset() ? header_->hot_edges_offset() : header_->end_offset();
+  uint32_t padding = padding_to_word(offset);
+  auto hot_edges = encode_hot_edges(directededges_, header_->directededgecount());
+  header_builder_.set_hot_edges_offset(offset + padding);
+  header_builder_.set_end_offset(header_builder_.hot_edges_offset() + hot_edges.size());
+
+  file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+  auto begin = reinterpret_cast<const char*>(header_) + sizeof(GraphTileHeader);
+  auto end = reinterpret_cast<const char*>(header_) + offset;
+  file.write(begin, end - begin);
+  file.write("\0\0\0\0\0\0\0\0", padding);
+  file.write(hot_edges.data(), hot_edges.size());
+  file.close();
+}
+
+// Inserts the shortcut edges ahead of the hot edge columns of the stored tile, replacing the
+// shortcut edges it already has.
+void GraphTileBuilder::AddShortcutEdges(
+    const std::vector<std::pair<uint32_t, std::vector<GraphId>>>& shortcuts) {
+  if (!header_) {
+    throw std::runtime_error("GraphTileBuilder::AddShortcutEdges - tile has not been stored yet");
+  }
+
+  filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
+                              GraphTile::FileSuffix(header_builder_.graphid());
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + filename.string());
+  }
+
+  // Everything up to the optional parts stays as it is, the hot edge columns move back
+  uint32_t offset = optional_parts_offset(header_);
+  uint32_t padding = padding_to_word(offset);
+  auto shortcut_edges = encode_shortcut_edges(shortcuts);
+  header_builder_.set_shortcut_edges_offset(offset + padding);
+  header_builder_.set_end_offset(header_builder_.shortcut_edges_offset() + shortcut_edges.size());
+  std::string hot_edges;
+  if (header_->hot_edges_offset() > 0) {
+    hot_edges = encode_hot_edges(directededges_, header_->directededgecount());
+    header_builder_.set_hot_edges_offset(header_builder_.end_offset());
+    header_builder_.set_end_offset(header_builder_.hot_edges_offset() + hot_edges.size());
+  }
+
+  file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+  auto begin = reinterpret_cast<const char*>(header_) + sizeof(GraphTileHeader);
+  auto end = reinterpret_cast<const char*>(header_) + offset;
+  file.write(begin, end - begin);
+  file.write("\0\0\0\0\0\0\0\0", padding);
+  file.write(shortcut_edges.data(), shortcut_edges.size());
+  file.write(hot_edges.data(), hot_edges.size());
+  file.close();
+}
+
 void GraphTileBuilder::AddLandmark(const GraphId& edge_id, const Landmark& landmark) {
   // check the edge id makes sense
   if (header_builder_.graphid().Tile_Base() != edge_id.Tile_Base()) {
@@ -0,0 +1,76 @@
+#include "mjolnir/hotedgebuilder.h"
+#include "baldr/graphreader.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+void add_hot_edges(const std::string& tile_dir,
+                   std::deque<GraphId>& tilequeue,
+                   std::mutex& lock,
+                   std::atomic<size_t>& bytes) {
+  while (true) {
+    lock.lock();
+    if (tilequeue.empty()) {
+      lock.unlock();
+      break;
+    }
+    GraphId tile_id = tilequeue.front();
+    tilequeue.pop_front();
+    lock.unlock();
+
+    GraphTileBuilder tilebuilder(tile_dir, tile_id, false);
+    tilebuilder.AddHotEdges();
+    bytes += hot_edges_size(tilebuilder.header()->directededgecount());
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void HotEdgeBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  std::uint32_t nthreads =
+      std::max(static_cast<std::uint32_t>(1),
+               pt.get<std::uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+
+  std::deque<GraphId> tilequeue;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    for (const auto& id : reader.GetTileSet()) {
+      tilequeue.emplace_back(id);
+    }
+  }
+
+  LOG_INFO("Adding hot edge columns to " + std::to_string(tilequeue.size()) + " tiles with " +
+           std::to_string(nthreads) + " threads...");
+  std::mutex lock;
+  std::atomic<size_t> bytes{0};
+  std::vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < nthreads; ++i) {
+    threads.emplace_back(add_hot_edges, std::cref(tile_dir), std::ref(tilequeue), std::ref(lock),
+                         std::ref(bytes));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  LOG_INFO("Finished adding " + std::to_string(bytes.load()) + " bytes of hot edge columns");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,236 @@
+#include "mjolnir/landmarkdistancebuilder.h"
+#include "baldr/graphreader.h"
+#include "baldr/landmarkdistances.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint32_t kUnreached = LandmarkDistances::kUnreached;
+
+// The nodes and the arcs out of each, the node an arc leads to and its length
+struct graph_t {
+  std::vector<uint32_t> offsets;
+  std::vector<std::pair<uint32_t, uint32_t>> arcs;
+
+  uint32_t node_count() const {
+    return static_cast<uint32_t>(offsets.size() - 1);
+  }
+};
+
+// The same graph with every arc turned around
+graph_t reverse(const graph_t& graph) {
+  graph_t reversed;
+  reversed.offsets.assign(graph.offsets.size(), 0);
+  for (const auto& arc : graph.arcs) {
+    ++reversed.offsets[arc.first + 1];
+  }
+  std::partial_sum(reversed.offsets.begin(), reversed.offsets.end(), reversed.offsets.begin());
+  reversed.arcs.resize(graph.arcs.size());
+  std::vector<uint32_t> next(reversed.offsets.begin(), reversed.offsets.end() - 1);
+  for (uint32_t node = 0; node < graph.node_count(); ++node) {
+    for (uint32_t a = graph.offsets[node]; a < graph.offsets[node + 1]; ++a) {
+      const auto& arc = graph.arcs[a];
+      reversed.arcs[next[arc.first]++] = {node, arc.second};
+    }
+  }
+  return reversed;
+}
+
+// Dijkstra from a node over the whole graph
+void distances_from(const graph_t& graph, const uint32_t from, std::vector<uint32_t>& distances) {
+  using entry_t = std::pair<uint32_t, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  distances.assign(graph.node_count(), kUnreached);
+  distances[from] = 0;
+  queue.emplace(0, from);
+  while (!queue.empty()) {
+    const auto entry = queue.top();
+    queue.pop();
+    if (entry.first > distances[entry.second]) {
+      continue;
+    }
+    for (uint32_t a = graph.offsets[entry.second]; a < graph.offsets[entry.second + 1]; ++a) {
+      const auto& arc = graph.arcs[a];
+      const uint32_t distance = entry.first + arc.second;
+      if (distance < distances[arc.first]) {
+        distances[arc.first] = distance;
+        queue.emplace(distance, arc.first);
+      }
+    }
+  }
+}
+
+// A node of the largest weakly connected component, for the landmarks not to end up on an island
+uint32_t largest_component_node(const graph_t& graph) {
+  std::vector<uint32_t> parent(graph.node_count());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](uint32_t node) {
+    while (parent[node] != node) {
+      node = parent[node] = parent[parent[node]];
+    }
+    return node;
+  };
+  for (uint32_t node = 0; node < graph.node_count(); ++node) {
+    for (uint32_t a = graph.offsets[node]; a < graph.offsets[node + 1]; ++a) {
+      parent[find(graph.arcs[a].first)] = find(node);
+    }
+  }
+  std::vector<uint32_t> sizes(graph.node_count(), 0);
+  uint32_t largest = 0;
+  for (uint32_t node = 0; node < graph.node_count(); ++node) {
+    const uint32_t root = find(node);
+    if (++sizes[root] > sizes[find(largest)]) {
+      largest = node;
+    }
+  }
+  return largest;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void LandmarkDistanceBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  const auto file_name = pt.get<std::string>("mjolnir.landmark_distances");
+  const uint32_t landmark_count = pt.get<uint32_t>("mjolnir.landmark_count", 16);
+  if (landmark_count == 0 || landmark_count > LandmarkDistances::kMaxLandmarks) {
+    throw std::runtime_error("Landmark distances need between 1 and " +
+                             std::to_string(LandmarkDistances::kMaxLandmarks) + " landmarks");
+  }
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // the nodes of all the tiles but the transit ones, numbered in the order of their tiles
+  std::vector<GraphId> tiles;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() != transit_level) {
+      tiles.push_back(tile_id);
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+  std::vector<uint32_t> node_offsets{0};
+  node_offsets.reserve(tiles.size() + 1);
+  for (const auto& tile_id : tiles) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    node_offsets.push_back(node_offsets.back() +
+                           reader.GetGraphTile(tile_id)->header()->nodecount());
+  }
+  auto node_index = [&](const GraphId& node) {
+    auto found = std::lower_bound(tiles.begin(), tiles.end(), node.Tile_Base());
+    if (found == tiles.end() || *found != node.Tile_Base()) {
+      return kUnreached;
+    }
+    const auto t = found - tiles.begin();
+    return node.id() < node_offsets[t + 1] - node_offsets[t] ? node_offsets[t] + node.id()
+                                                             : kUnreached;
+  };
+  auto node_id = [&](const uint32_t index) {
+    const auto t = std::upper_bound(node_offsets.begin(), node_offsets.end(), index) -
+                   node_offsets.begin() - 1;
+    return GraphId(tiles[t].tileid(), tiles[t].level(), index - node_offsets[t]);
+  };
+
+  // Arcs are the edges some mode may take in their direction, whatever the costing options other
+  // than ignoring oneways, and the transitions between the levels. Shortcuts add nothing to that.
+  graph_t forward;
+  forward.offsets.reserve(node_offsets.back() + 1);
+  forward.offsets.push_back(0);
+  for (const auto& tile_id : tiles) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const NodeInfo* node = tile->node(n);
+      for (uint32_t i = 0; i < node->edge_count(); ++i) {
+        const DirectedEdge* edge = tile->directededge(node->edge_index() + i);
+        const uint32_t to = node_index(edge->endnode());
+        if (!edge->is_shortcut() && (edge->forwardaccess() & kAllAccess) && to != kUnreached) {
+          forward.arcs.emplace_back(to, edge->length());
+        }
+      }
+      for (uint32_t i = 0; i < node->transition_count(); ++i) {
+        const uint32_t to = node_index(tile->transition(node->transition_index() + i)->endnode());
+        if (to != kUnreached) {
+          forward.arcs.emplace_back(to, 0);
+        }
+      }
+      forward.offsets.push_back(static_cast<uint32_t>(forward.arcs.size()));
+    }
+  }
+  const graph_t backward = reverse(forward);
+  const uint32_t node_count = forward.node_count();
+  if (node_count == 0) {
+    throw std::runtime_error("There are no nodes to measure landmark distances to");
+  }
+  LOG_INFO("Measuring landmark distances over " + std::to_string(node_count) + " nodes and " +
+           std::to_string(forward.arcs.size()) + " arcs");
+
+  // Each landmark is the node with the longest round trip to the closest of those before it, the
+  // first the one with the longest round trip to a node of the largest component. Nodes which
+  // can't get to and back from that node are never landmarks.
+  std::vector<uint32_t> from, to;
+  std::vector<uint64_t> separation(node_count, std::numeric_limits<uint64_t>::max());
+  auto separate = [&]() {
+    uint32_t farthest = 0;
+    for (uint32_t node = 0; node < node_count; ++node) {
+      separation[node] = from[node] == kUnreached || to[node] == kUnreached
+                             ? 0
+                             : std::min(separation[node], uint64_t(from[node]) + to[node]);
+      if (separation[node] > separation[farthest]) {
+        farthest = node;
+      }
+    }
+    return separation[farthest] > 0 ? farthest : kUnreached;
+  };
+  const uint32_t start = largest_component_node(forward);
+  distances_from(forward, start, from);
+  distances_from(backward, start, to);
+  uint32_t next = separate();
+
+  std::vector<GraphId> landmarks;
+  std::vector<uint32_t> distances(uint64_t(node_count) * landmark_count * 2, kUnreached);
+  while (landmarks.size() < landmark_count && next != kUnreached) {
+    const uint64_t l = landmarks.size();
+    landmarks.push_back(node_id(next));
+    distances_from(forward, next, from);
+    distances_from(backward, next, to);
+    for (uint64_t node = 0; node < node_count; ++node) {
+      distances[(node * landmark_count + l) * 2] = from[node];
+      distances[(node * landmark_count + l) * 2 + 1] = to[node];
+    }
+    LOG_INFO("Landmark " + std::to_string(l) + " is node " + std::to_string(landmarks.back()));
+    next = separate();
+  }
+
+  // a graph with fewer nodes far enough apart gets fewer landmarks
+  if (landmarks.size() < landmark_count) {
+    const uint64_t stride = landmarks.size() * 2;
+    for (uint64_t node = 0; node < node_count; ++node) {
+      std::copy_n(distances.begin() + node * landmark_count * 2, stride,
+                  distances.begin() + node * stride);
+    }
+    distances.resize(node_count * stride);
+  }
+  LOG_INFO("Writing the distances of " + std::to_string(landmarks.size()) + " landmarks to " +
+           file_name);
+  LandmarkDistances::write(file_name, tiles, node_offsets, landmarks, distances);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
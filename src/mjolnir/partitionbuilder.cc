@@ -0,0 +1,193 @@
+#include "mjolnir/partitionbuilder.h"
+#include "baldr/graphreader.h"
+#include "baldr/partitionoverlay.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint32_t kNoVertex = PartitionOverlay::kNoVertex;
+
+// every level groups 4x4 cells of the level below
+constexpr uint32_t kCellsPerSide = 4;
+
+// Turns the grid cells of the vertices of one level into dense cell ids
+std::vector<uint32_t> number_cells(const std::vector<uint64_t>& grid_cells, uint32_t& cell_count) {
+  std::unordered_map<uint64_t, uint32_t> ids;
+  std::vector<uint32_t> cells;
+  cells.reserve(grid_cells.size());
+  for (auto grid_cell : grid_cells) {
+    cells.push_back(ids.emplace(grid_cell, static_cast<uint32_t>(ids.size())).first->second);
+  }
+  cell_count = static_cast<uint32_t>(ids.size());
+  return cells;
+}
+
+// Groups the vertices which are on the boundary of each cell by cell, sorted in each
+void group_by_cell(const std::vector<uint32_t>& cells,
+                   const uint32_t cell_count,
+                   const std::vector<bool>& on_boundary,
+                   std::vector<uint32_t>& offsets,
+                   std::vector<uint32_t>& vertices) {
+  offsets.assign(cell_count + 1, 0);
+  for (uint32_t v = 0; v < cells.size(); ++v) {
+    if (on_boundary[v]) {
+      ++offsets[cells[v] + 1];
+    }
+  }
+  for (uint32_t c = 0; c < cell_count; ++c) {
+    offsets[c + 1] += offsets[c];
+  }
+  vertices.resize(offsets.back());
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (uint32_t v = 0; v < cells.size(); ++v) {
+    if (on_boundary[v]) {
+      vertices[next[cells[v]]++] = v;
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void PartitionBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  const auto file_name = pt.get<std::string>("mjolnir.partition_overlay");
+  const double cell_size = pt.get<double>("mjolnir.partition_cell_size", 0.0625);
+  const uint32_t level_count = pt.get<uint32_t>("mjolnir.partition_levels", 4);
+  if (cell_size <= 0. || level_count == 0 || level_count > PartitionOverlay::kMaxLevels) {
+    throw std::runtime_error("The partition needs a positive cell size and between 1 and " +
+                             std::to_string(PartitionOverlay::kMaxLevels) + " levels");
+  }
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // every edge but the shortcuts is a vertex, in the cells of the grid its end node is in
+  std::vector<GraphId> edges;
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    if (tile_id.level() == transit_level) {
+      continue;
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      if (!tile->directededge(i)->is_shortcut()) {
+        edges.emplace_back(tile_id.tileid(), tile_id.level(), i);
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  auto vertex = [&edges](const GraphId& edge_id) {
+    auto found = std::lower_bound(edges.begin(), edges.end(), edge_id);
+    return found == edges.end() || *found != edge_id ? kNoVertex
+                                                     : static_cast<uint32_t>(found - edges.begin());
+  };
+
+  std::vector<uint64_t> grid_cells;
+  grid_cells.reserve(edges.size());
+  for (const auto& edge_id : edges) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    graph_tile_ptr tile;
+    const DirectedEdge* edge = reader.directededge(edge_id, tile);
+    graph_tile_ptr node_tile;
+    const NodeInfo* node = reader.nodeinfo(edge->endnode(), node_tile);
+    if (node == nullptr) {
+      // an edge ending in a tile which isn't there has no turns, any cell does
+      grid_cells.push_back(0);
+      continue;
+    }
+    const auto ll = node->latlng(node_tile->header()->base_ll());
+    const uint64_t row = static_cast<uint64_t>(std::floor((ll.lat() + 90.) / cell_size));
+    const uint64_t column = static_cast<uint64_t>(std::floor((ll.lng() + 180.) / cell_size));
+    grid_cells.push_back((row << 32) | column);
+  }
+
+  std::vector<PartitionOverlay::level_t> levels(level_count);
+  std::vector<uint32_t> cell_counts(level_count);
+  for (uint32_t level = 0; level < level_count; ++level) {
+    levels[level].cells = number_cells(grid_cells, cell_counts[level]);
+    for (auto& grid_cell : grid_cells) {
+      grid_cell = ((grid_cell >> 32) / kCellsPerSide << 32) |
+                  ((grid_cell & 0xffffffff) / kCellsPerSide);
+    }
+    LOG_INFO("Partition level " + std::to_string(level) + " has " +
+             std::to_string(cell_counts[level]) + " cells");
+  }
+  grid_cells = {};
+
+  // Any turn, allowed by some costing or not, between cells makes the boundary of both. Cells are
+  // nested, whichever level a turn is between cells at it also is at all levels below.
+  std::vector<std::vector<bool>> entries(level_count, std::vector<bool>(edges.size(), false));
+  std::vector<std::vector<bool>> exits(level_count, std::vector<bool>(edges.size(), false));
+  auto turn = [&](const uint32_t from, const GraphId& edge_id) {
+    const uint32_t to = vertex(edge_id);
+    if (to == kNoVertex) {
+      return;
+    }
+    for (uint32_t level = 0;
+         level < level_count && levels[level].cells[from] != levels[level].cells[to]; ++level) {
+      exits[level][from] = true;
+      entries[level][to] = true;
+    }
+  };
+  for (uint32_t from = 0; from < edges.size(); ++from) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    graph_tile_ptr tile;
+    const DirectedEdge* edge = reader.directededge(edges[from], tile);
+    graph_tile_ptr node_tile;
+    const NodeInfo* node = reader.nodeinfo(edge->endnode(), node_tile);
+    if (node == nullptr) {
+      continue;
+    }
+    GraphId edge_id(edge->endnode().tileid(), edge->endnode().level(), node->edge_index());
+    for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge_id) {
+      turn(from, edge_id);
+    }
+    const NodeTransition* trans = node_tile->transition(node->transition_index());
+    for (uint32_t t = 0; t < node->transition_count(); ++t, ++trans) {
+      graph_tile_ptr trans_tile;
+      const NodeInfo* trans_node = reader.nodeinfo(trans->endnode(), trans_tile);
+      if (trans_node == nullptr) {
+        continue;
+      }
+      GraphId trans_edge_id(trans->endnode().tileid(), trans->endnode().level(),
+                            trans_node->edge_index());
+      for (uint32_t i = 0; i < trans_node->edge_count(); ++i, ++trans_edge_id) {
+        turn(from, trans_edge_id);
+      }
+    }
+  }
+
+  for (uint32_t level = 0; level < level_count; ++level) {
+    auto& l = levels[level];
+    group_by_cell(l.cells, cell_counts[level], entries[level], l.entry_offsets, l.entries);
+    group_by_cell(l.cells, cell_counts[level], exits[level], l.exit_offsets, l.exits);
+    entries[level] = {};
+    exits[level] = {};
+    LOG_INFO("Partition level " + std::to_string(level) + " has " +
+             std::to_string(l.entries.size()) + " entries and " + std::to_string(l.exits.size()) +
+             " exits");
+  }
+  LOG_INFO("Writing partition overlay of " + std::to_string(edges.size()) + " edges to " +
+           file_name);
+  PartitionOverlay::write(file_name, edges, levels);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,121 @@
+#include "mjolnir/shortcutedgebuilder.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "scoped_timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+using shortcut_edges_t = std::vector<std::pair<uint32_t, std::vector<GraphId>>>;
+
+// recovers the shortcuts of the tiles nobody has taken yet
+void recover_shortcuts(const boost::property_tree::ptree& pt,
+                       const std::vector<GraphId>& tile_ids,
+                       std::vector<shortcut_edges_t>& tiles,
+                       std::atomic<size_t>& next,
+                       std::atomic<size_t>& shortcuts,
+                       std::atomic<size_t>& unrecovered) {
+  GraphReader reader(pt);
+  for (size_t i = next++; i < tile_ids.size(); i = next++) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_ids[i]);
+    if (!tile) {
+      continue;
+    }
+
+    auto shortcut_id = tile_ids[i];
+    for (uint32_t idx = 0; idx < tile->header()->directededgecount(); ++idx) {
+      if (!tile->directededge(idx)->is_shortcut()) {
+        continue;
+      }
+      shortcut_id.set_id(idx);
+      auto edges = reader.RecoverShortcut(shortcut_id);
+      // keep the ones which failed too, there is no point in trying again later
+      if (edges.size() == 1 && edges.front() == shortcut_id) {
+        edges.clear();
+        ++unrecovered;
+      }
+      tiles[i].emplace_back(idx, std::move(edges));
+      ++shortcuts;
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ShortcutEdgeBuilder::Build(const boost::property_tree::ptree& pt) {
+  SCOPED_TIMER();
+  auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  std::uint32_t nthreads =
+      std::max(static_cast<std::uint32_t>(1),
+               pt.get<std::uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+
+  // only the levels with shortcuts
+  std::vector<GraphId> tile_ids;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    for (const auto& level : TileHierarchy::levels()) {
+      if (level.level > 1) {
+        continue;
+      }
+      for (const auto& id : reader.GetTileSet(level.level)) {
+        tile_ids.emplace_back(id);
+      }
+    }
+  }
+
+  // recover everything before touching any tile, the readers would see half written tiles
+  LOG_INFO("Recovering the shortcuts of " + std::to_string(tile_ids.size()) + " tiles with " +
+           std::to_string(nthreads) + " threads...");
+  std::vector<shortcut_edges_t> tiles(tile_ids.size());
+  std::atomic<size_t> next{0}, shortcuts{0}, unrecovered{0};
+  std::vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < nthreads; ++i) {
+    threads.emplace_back(recover_shortcuts, std::cref(pt.get_child("mjolnir")), std::cref(tile_ids),
+                         std::ref(tiles), std::ref(next), std::ref(shortcuts),
+                         std::ref(unrecovered));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // then store them in the tiles
+  next = 0;
+  threads.clear();
+  for (std::uint32_t i = 0; i < nthreads; ++i) {
+    threads.emplace_back([&]() {
+      for (size_t t = next++; t < tile_ids.size(); t = next++) {
+        if (tiles[t].empty()) {
+          continue;
+        }
+        GraphTileBuilder tilebuilder(tile_dir, tile_ids[t], false);
+        tilebuilder.AddShortcutEdges(tiles[t]);
+        shortcut_edges_t().swap(tiles[t]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  LOG_INFO("Finished adding the edges of " + std::to_string(shortcuts.load()) + " shortcuts, " +
+           std::to_string(unrecovered.load()) + " could not be recovered");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -4,15 +4,21 @@
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/contractionbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
+#include "mjolnir/graphrenumberer.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/hotedgebuilder.h"
+#include "mjolnir/landmarkdistancebuilder.h"
+#include "mjolnir/partitionbuilder.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
 #include "mjolnir/shortcutbuilder.h"
+#include "mjolnir/shortcutedgebuilder.h"
 #include "mjolnir/transitbuilder.h"
 #include "scoped_timer.h"
 
@@ -349,6 +355,11 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     GraphFilter::Filter(config);
   }
 
+  // Optionally renumber the nodes and edges within each tile for better memory locality
+  if (start_stage <= BuildStage::kRenumber && BuildStage::kRenumber <= end_stage) {
+    GraphRenumberer::Renumber(config);
+  }
+
   // Add transit
   if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
     TransitBuilder::Build(config);
@@ -400,6 +411,45 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // Validate the graph and add information that cannot be added until full graph is formed.
   if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
     GraphValidator::Validate(config);
+
+    // Shortcut recovery walks opposing edges, so the shortcut edges go in after the validator
+    if (build_hierarchy && config.get<bool>("mjolnir.shortcuts", true) &&
+        config.get<bool>("mjolnir.shortcut_edges", true)) {
+      ShortcutEdgeBuilder::Build(config);
+    }
+
+    // The hot edge columns copy directed edge attributes, so they go in after the last change
+    if (config.get<bool>("mjolnir.hot_edges", false)) {
+      HotEdgeBuilder::Build(config);
+    }
+  }
+
+  // Contract the graph for the default auto costing, from the finished tiles
+  if (start_stage <= BuildStage::kContraction && BuildStage::kContraction <= end_stage) {
+    if (!config.get<std::string>("mjolnir.contraction_hierarchy", "").empty()) {
+      ContractionBuilder::Build(config);
+    } else {
+      LOG_INFO("Skipping contraction hierarchy builder");
+    }
+  }
+
+  // Partition the finished tiles into the cells the overlay metrics are customized for
+  if (start_stage <= BuildStage::kPartition && BuildStage::kPartition <= end_stage) {
+    if (!config.get<std::string>("mjolnir.partition_overlay", "").empty()) {
+      PartitionBuilder::Build(config);
+    } else {
+      LOG_INFO("Skipping partition overlay builder");
+    }
+  }
+
+  // Measure the distances to the landmarks of the A* heuristics over the finished tiles
+  if (start_stage <= BuildStage::kLandmarkDistances &&
+      BuildStage::kLandmarkDistances <= end_stage) {
+    if (!config.get<std::string>("mjolnir.landmark_distances", "").empty()) {
+      LandmarkDistanceBuilder::Build(config);
+    } else {
+      LOG_INFO("Skipping landmark distance builder");
+    }
   }
 
   // Cleanup bin files
@@ -2,6 +2,7 @@
 #include "baldr/connectivity_map.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "midgard/logging.h"
 
 #include <boost/property_tree/ptree.hpp>
 #include <cxxopts.hpp>
@@ -44,6 +45,7 @@ int main(int argc, char** argv) {
   const auto program = filesystem::path(__FILE__).stem().string();
   // args
   boost::property_tree::ptree config;
+  std::string output;
 
   try {
     // clang-format off
@@ -51,18 +53,23 @@ int main(int argc, char** argv) {
       program,
       program + " " + VALHALLA_PRINT_VERSION + "\n\n"
       "valhalla_build_connectivity is a program that creates a PPM image file representing\n"
-      "the connectivity between tiles.\n\n");
+      "the connectivity between tiles. It also writes the connectivity map, with the components\n"
+      "the edges of each mode form, to the output or 'mjolnir.connectivity_map' for loki to\n"
+      "map on startup instead of working out the connectivity itself.\n\n");
 
     options.add_options()
       ("h,help", "Print this help message.")
       ("v,version", "Print the version of this software.")
       ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
-      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>());
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
+      ("o,output", "Connectivity map to write, defaults to mjolnir.connectivity_map.", cxxopts::value<std::string>(output));
     // clang-format on
 
     auto result = options.parse(argc, argv);
     if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
       return EXIT_SUCCESS;
+    if (output.empty())
+      output = config.get<std::string>("mjolnir.connectivity_map", "");
   } catch (cxxopts::exceptions::exception& e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -73,7 +80,16 @@ int main(int argc, char** argv) {
   }
 
   // Get something we can use to fetch tiles
-  valhalla::baldr::connectivity_map_t connectivity_map(config.get_child("mjolnir"));
+  valhalla::baldr::connectivity_map_t connectivity_map(config.get_child("mjolnir"), {}, true);
+  if (!output.empty()) {
+    try {
+      connectivity_map.save(output);
+      LOG_INFO("Wrote connectivity map " + output);
+    } catch (const std::exception& e) {
+      LOG_ERROR(e.what());
+      return EXIT_FAILURE;
+    }
+  }
 
   uint32_t transit_level = TileHierarchy::levels().back().level + 1;
   for (uint32_t level = 0; level <= transit_level; level++) {
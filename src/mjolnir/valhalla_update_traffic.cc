@@ -0,0 +1,187 @@
+#include "argparse_utils.h"
+#include "baldr/graphid.h"
+#include "baldr/trafficupdater.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// speeds are kept in 2kph steps, anything faster than the max is clamped to it
+uint32_t encode_speed(double kph) {
+  if (kph < 0)
+    return UNKNOWN_TRAFFIC_SPEED_RAW;
+  return static_cast<uint32_t>(std::min<double>(kph, MAX_TRAFFIC_SPEED_KPH)) >> 1;
+}
+
+// congestion comes as 0 (free flow) to 1 (jammed), 0 is kept for unknown
+uint32_t encode_congestion(double congestion) {
+  if (congestion < 0)
+    return UNKNOWN_CONGESTION_VAL;
+  return 1 + static_cast<uint32_t>(std::min(congestion, 1.0) * (MAX_CONGESTION_VAL - 1) + 0.5);
+}
+
+/**
+ * Parses a line of edge_id,speed_kph[,congestion] where the edge id is either the numeric graph
+ * id or level/tile/id. A negative speed or congestion means it is unknown.
+ */
+bool parse_line(const std::string& line, GraphId& edge, TrafficSpeed& speed) {
+  std::stringstream ss(line);
+  std::string edge_str, speed_str, congestion_str;
+  if (!std::getline(ss, edge_str, ',') || !std::getline(ss, speed_str, ','))
+    return false;
+  std::getline(ss, congestion_str, ',');
+
+  try {
+    edge = edge_str.find('/') == std::string::npos ? GraphId(std::stoull(edge_str))
+                                                   : GraphId(edge_str);
+    auto encoded = encode_speed(std::stod(speed_str));
+    auto congestion = congestion_str.empty() ? UNKNOWN_CONGESTION_VAL
+                                             : encode_congestion(std::stod(congestion_str));
+    // a single speed along the whole edge
+    speed = TrafficSpeed(encoded, encoded, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW,
+                         255, 0, congestion, 0, 0, false);
+  } catch (...) {
+    return false;
+  }
+  return edge.Is_Valid();
+}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void publish(traffic_updater_t& updater) {
+  if (!updater.Pending())
+    return;
+  auto start = std::chrono::steady_clock::now();
+  auto written = updater.Publish(now());
+  auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  LOG_INFO("Published " + std::to_string(written) + " live speeds in " + std::to_string(msecs) +
+           " ms");
+}
+
+void read(std::istream& input, traffic_updater_t& updater, size_t batch_size, size_t& bad_lines) {
+  std::string line;
+  GraphId edge;
+  TrafficSpeed speed;
+  while (std::getline(input, line)) {
+    // an empty line ends a batch, lets a feed publish whenever it has a complete picture
+    if (line.empty() || line == "\r") {
+      publish(updater);
+      continue;
+    }
+    if (!parse_line(line, edge, speed)) {
+      ++bad_lines;
+      continue;
+    }
+    updater.Update(edge, speed);
+    if (updater.Pending() >= batch_size)
+      publish(updater);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  std::vector<std::string> input_files;
+  size_t batch_size = 100000;
+  size_t min_publish_interval = traffic_updater_t::kDefaultMinPublishInterval.count();
+  boost::property_tree::ptree config;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "valhalla_update_traffic is a program that writes live speeds into the traffic extract\n"
+      "at 'mjolnir.traffic_extract' while services keep using it. It reads lines of\n"
+      "edge_id,speed_kph[,congestion] from the input files or stdin, where edge_id is the\n"
+      "numeric graph id or level/tile/id and congestion goes from 0 to 1. Updates are published\n"
+      "in batches, at the end of the input and whenever an empty line is read. Build the extract\n"
+      "with valhalla_build_extract --double-buffer-traffic for readers to only ever see complete\n"
+      "batches of a tile. A tile isn't flipped again before the minimum publish interval has\n"
+      "passed, readers have that long to let go of the speeds the last flip retired."
+      "\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
+      ("b,batch-size", "Number of updates after which they are published.", cxxopts::value<size_t>(batch_size)->default_value("100000"))
+      ("m,min-publish-interval", "Milliseconds between two flips of the same tile.", cxxopts::value<size_t>(min_publish_interval)->default_value("1000"))
+      ("input_files", "positional arguments", cxxopts::value<std::vector<std::string>>(input_files));
+    // clang-format on
+
+    options.parse_positional({"input_files"});
+    options.positional_help("CSV file(s), stdin if none");
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!config.get_optional<std::string>("mjolnir.traffic_extract")) {
+      throw cxxopts::exceptions::exception("mjolnir.traffic_extract is required\n\n" +
+                                           options.help());
+    }
+    batch_size = std::max<size_t>(batch_size, 1);
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<traffic_updater_t> updater;
+  try {
+    updater.reset(new traffic_updater_t(config.get<std::string>("mjolnir.traffic_extract"),
+                                        std::chrono::milliseconds(min_publish_interval)));
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return EXIT_FAILURE;
+  }
+
+  size_t bad_lines = 0;
+  if (input_files.empty()) {
+    read(std::cin, *updater, batch_size, bad_lines);
+  }
+  for (const auto& input_file : input_files) {
+    std::ifstream input(input_file);
+    if (!input.is_open()) {
+      LOG_ERROR("Could not open " + input_file);
+      return EXIT_FAILURE;
+    }
+    read(input, *updater, batch_size, bad_lines);
+  }
+  publish(*updater);
+
+  auto stats = updater->Stats();
+  LOG_INFO("Published " + std::to_string(stats.edges) + " live speeds in " +
+           std::to_string(stats.batches) + " batches");
+  if (stats.waits)
+    LOG_INFO("Waited " + std::to_string(stats.waits) +
+             " times for readers to let go of the speeds of a tile");
+  if (stats.dropped)
+    LOG_WARN("Dropped " + std::to_string(stats.dropped) + " updates for unknown tiles or edges");
+  if (bad_lines)
+    LOG_WARN("Skipped " + std::to_string(bad_lines) + " lines which could not be parsed");
+
+  return EXIT_SUCCESS;
+}
@@ -11,6 +11,7 @@ const std::string& MatrixAlgoToString(const valhalla::Matrix::Algorithm algo) {
       {valhalla::Matrix::CostMatrix, "costmatrix"},
       {valhalla::Matrix::TimeDistanceMatrix, "timedistancematrix"},
       {valhalla::Matrix::TimeDistanceBSSMatrix, "timedistancebssmatrix"},
+      {valhalla::Matrix::BucketMatrix, "bucketmatrix"},
   };
   auto i = algos.find(algo);
   return i == algos.cend() ? empty_str : i->second;
@@ -0,0 +1,77 @@
+#include "sif/turns.h"
+#include "baldr/time_info.h"
+#include "sif/edgelabel.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace sif {
+
+void for_each_turn(GraphReader& reader,
+                   const DynamicCost& costing,
+                   const GraphId& edge_id,
+                   const TurnCallback& turn_cb) {
+  graph_tile_ptr tile;
+  const DirectedEdge* edge = reader.directededge(edge_id, tile);
+  if (edge == nullptr) {
+    return;
+  }
+  graph_tile_ptr node_tile;
+  const NodeInfo* node = reader.nodeinfo(edge->endnode(), node_tile);
+  if (node == nullptr) {
+    return;
+  }
+  PathEdgeLabel pred(kInvalidLabel, edge_id, edge, {}, 0.f, costing.travel_mode(), 0, {},
+                     kInvalidRestriction, false, false, InternalTurn::kNoTurn, 0, edge->destonly(),
+                     edge->forwardaccess() & kTruckAccess);
+  const auto reader_getter = [&reader]() { return LimitedGraphReader(reader); };
+
+  auto turn = [&](const GraphId& next_id, const NodeInfo* at, const graph_tile_ptr& at_tile) {
+    const DirectedEdge* next = at_tile->directededge(next_id);
+    uint8_t restriction_idx = kInvalidRestriction;
+    if (next->is_shortcut() ||
+        !costing.Allowed(next, false, pred, at_tile, next_id, 0, 0, restriction_idx)) {
+      return false;
+    }
+    uint8_t flow_sources;
+    turn_cb(next_id, next,
+            costing.TransitionCost(next, at, pred, at_tile, reader_getter) +
+                costing.EdgeCost(next, at_tile, TimeInfo::invalid(), flow_sources));
+    return true;
+  };
+
+  bool turned = false;
+  GraphId uturn;
+  if (costing.Allowed(node)) {
+    GraphId next_id(edge->endnode().tileid(), edge->endnode().level(), node->edge_index());
+    for (uint32_t i = 0; i < node->edge_count(); ++i, ++next_id) {
+      if (pred.opp_local_idx() == node_tile->directededge(next_id)->localedgeidx()) {
+        uturn = next_id;
+        continue;
+      }
+      turned = turn(next_id, node, node_tile) || turned;
+    }
+    const NodeTransition* trans = node_tile->transition(node->transition_index());
+    for (uint32_t t = 0; t < node->transition_count(); ++t, ++trans) {
+      graph_tile_ptr trans_tile;
+      const NodeInfo* trans_node = reader.nodeinfo(trans->endnode(), trans_tile);
+      if (trans_node == nullptr) {
+        continue;
+      }
+      GraphId next_id(trans->endnode().tileid(), trans->endnode().level(),
+                      trans_node->edge_index());
+      for (uint32_t i = 0; i < trans_node->edge_count(); ++i, ++next_id) {
+        turned = turn(next_id, trans_node, trans_tile) || turned;
+      }
+    }
+  } else {
+    uturn = reader.GetOpposingEdgeId(edge_id);
+  }
+  if (!turned && uturn.Is_Valid()) {
+    pred.set_deadend(true);
+    turn(uturn, node, node_tile);
+  }
+}
+
+} // namespace sif
+} // namespace valhalla
@@ -28,8 +28,12 @@ constexpr uint32_t kMaxIterationsWithoutConvergence = 200000;
 AStarBSSAlgorithm::AStarBSSAlgorithm(const boost::property_tree::ptree& config)
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_astar",
                                          kInitialEdgeLabelCountAstar),
-                    config.get<bool>("clear_reserved_memory", false)) {
+                    config.get<bool>("clear_reserved_memory", false),
+                    config.get<size_t>("max_reserved_edge_status_count",
+                                       kMaxReservedEdgeStatusCount)) {
   mode_ = travel_mode_t::kDrive;
+  pedestrian_edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
+  bicycle_edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 // Destructor
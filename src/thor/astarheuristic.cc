@@ -0,0 +1,56 @@
+#include "thor/astarheuristic.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+void AStarHeuristic::InitLandmarks(const LandmarkDistances* landmarks,
+                                   GraphReader& graphreader,
+                                   const valhalla::Location& location,
+                                   const bool to_location) {
+  landmarks_ = nullptr;
+  bounds_.clear();
+  if (landmarks == nullptr || landmarks->empty()) {
+    return;
+  }
+
+  // Both nodes of every edge of the location, the path gets to (or leaves) the location through
+  // one of them unless it stays on the edge. That also makes the bound 0 at those nodes, which
+  // keeps the labels of the location edges from being pushed back.
+  std::vector<const uint32_t*> nodes;
+  for (const auto& edge : location.correlation().edges()) {
+    const GraphId edge_id(edge.graph_id());
+    graph_tile_ptr tile;
+    const DirectedEdge* directededge = graphreader.directededge(edge_id, tile);
+    if (directededge == nullptr) {
+      return;
+    }
+    const GraphId end_node = directededge->endnode();
+    for (const auto& node : {graphreader.edge_startnode(edge_id, tile), end_node}) {
+      const uint32_t* distances = node.Is_Valid() ? landmarks->distances(node) : nullptr;
+      if (distances == nullptr) {
+        // without the distances of all of them there are no bounds
+        return;
+      }
+      nodes.push_back(distances);
+    }
+  }
+  if (nodes.empty()) {
+    return;
+  }
+
+  to_location_ = to_location;
+  for (uint32_t l = 0; l < landmarks->landmark_count(); ++l) {
+    uint32_t min_x = kUnreached, max_y = 0;
+    for (const auto* distances : nodes) {
+      min_x = std::min(min_x, distances[2 * l + !to_location]);
+      max_y = std::max(max_y, distances[2 * l + to_location]);
+    }
+    bounds_.emplace_back(2 * l, std::make_pair(min_x, max_y));
+  }
+  landmarks_ = landmarks;
+}
+
+} // namespace thor
+} // namespace valhalla
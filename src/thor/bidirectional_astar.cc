@@ -52,8 +52,13 @@ namespace thor {
 BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config)
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_bidir_astar",
                                          kInitialEdgeLabelCountBidirAstar),
-                    config.get<bool>("clear_reserved_memory", false)),
+                    config.get<bool>("clear_reserved_memory", false),
+                    config.get<size_t>("max_reserved_edge_status_count",
+                                       kMaxReservedEdgeStatusCount)),
+      radix_heap_(config.get<bool>("bidirectional_astar.radix_heap", false)),
       extended_search_(config.get<bool>("extended_search", false)) {
+  edgestatus_forward_.set_max_reserved(max_reserved_edge_status_count_);
+  edgestatus_reverse_.set_max_reserved(max_reserved_edge_status_count_);
   cost_threshold_ = 0;
   iterations_threshold_ = 0;
   desired_paths_count_ = 1;
@@ -72,22 +77,32 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-  if (edgelabels_forward_.size() > reservation) {
-    edgelabels_forward_.resize(reservation);
-    edgelabels_forward_.shrink_to_fit();
-  }
-  if (edgelabels_reverse_.size() > reservation) {
-    edgelabels_reverse_.resize(reservation);
-    edgelabels_reverse_.shrink_to_fit();
-  }
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
+  if (search_arena_) {
+    // the arena keeps the memory for whichever search of the thread comes next
+    search_arena_->give_back(edgelabels_forward_);
+    search_arena_->give_back(edgelabels_reverse_);
+    search_arena_->give_back(adjacencylist_forward_);
+    search_arena_->give_back(adjacencylist_reverse_);
+    search_arena_->give_back(edgestatus_forward_);
+    search_arena_->give_back(edgestatus_reverse_);
+  } else {
+    auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
+    if (edgelabels_forward_.size() > reservation) {
+      edgelabels_forward_.resize(reservation);
+      edgelabels_forward_.shrink_to_fit();
+    }
+    if (edgelabels_reverse_.size() > reservation) {
+      edgelabels_reverse_.resize(reservation);
+      edgelabels_reverse_.shrink_to_fit();
+    }
+    edgelabels_forward_.clear();
+    edgelabels_reverse_.clear();
 
-  adjacencylist_forward_.clear();
-  adjacencylist_reverse_.clear();
-  edgestatus_forward_.clear();
-  edgestatus_reverse_.clear();
+    adjacencylist_forward_.clear();
+    adjacencylist_reverse_.clear();
+    edgestatus_forward_.clear();
+    edgestatus_reverse_.clear();
+  }
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -107,6 +122,18 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   astarheuristic_forward_.Init(destll, factor);
   astarheuristic_reverse_.Init(origll, factor);
 
+  // Take over the memory an earlier search of the thread gave back
+  if (search_arena_) {
+    search_arena_->borrow(edgelabels_forward_);
+    search_arena_->borrow(edgelabels_reverse_);
+    search_arena_->borrow(adjacencylist_forward_);
+    search_arena_->borrow(adjacencylist_reverse_);
+    search_arena_->borrow(edgestatus_forward_);
+    search_arena_->borrow(edgestatus_reverse_);
+    edgestatus_forward_.set_max_reserved(max_reserved_edge_status_count_);
+    edgestatus_reverse_.set_max_reserved(max_reserved_edge_status_count_);
+  }
+
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
   edgelabels_forward_.reserve(max_reserved_labels_count_);
@@ -117,6 +144,8 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   const uint32_t bucketsize = costing_->UnitSize();
   const float range = kBucketCount * bucketsize;
 
+  adjacencylist_forward_.use_radix_heap(radix_heap_);
+  adjacencylist_reverse_.use_radix_heap(radix_heap_);
   const float mincostf = astarheuristic_forward_.Get(origll);
   adjacencylist_forward_.reuse(mincostf, range, bucketsize, &edgelabels_forward_);
   const float mincostr = astarheuristic_reverse_.Get(destll);
@@ -168,16 +197,24 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
                                             uint32_t& shortcuts,
                                             const graph_tile_ptr& tile,
                                             const baldr::TimeInfo& time_info) {
+  // The hot edge columns (if the tile has them) answer the checks that skip most edges without
+  // pulling the whole directed edge into the cache
+  const auto& hot_edges = tile->hot_edges();
+  const uint32_t edge_idx = meta.edge_id.id();
+
   // Skip if this is a regular edge superseded by a shortcut.
-  if (shortcuts & meta.edge->superseded()) {
+  if (shortcuts & (hot_edges.empty() ? meta.edge->superseded() : hot_edges.superseded(edge_idx))) {
     return false;
   }
 
   graph_tile_ptr t2 = nullptr;
   baldr::GraphId opp_edge_id;
-  const auto get_opp_edge_data = [&t2, &opp_edge_id, &graphreader, &meta, &tile]() {
+  const auto get_opp_edge_data = [&]() {
     // Get end node tile, opposing edge Id, and opposing directed edge.
-    t2 = meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
+    t2 = (hot_edges.empty() ? meta.edge->leaves_tile() : hot_edges.leaves_tile(edge_idx))
+             ? graphreader.GetGraphTile(hot_edges.empty() ? meta.edge->endnode()
+                                                          : hot_edges.endnode(edge_idx))
+             : tile;
     if (t2 == nullptr) {
       return false;
     }
@@ -191,7 +228,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
   // Skip shortcut edges until we have stopped expanding on the next level. Use regular
   // edges while still expanding on the next level since we can still transition down to
   // that level. If using a shortcut, set the shortcuts mask.
-  if (meta.edge->is_shortcut()) {
+  if (hot_edges.empty() ? meta.edge->is_shortcut() : hot_edges.is_shortcut(edge_idx)) {
     // Skip shortcuts if hierarchy limits are disabled
     if (ignore_hierarchy_limits_ || !get_opp_edge_data())
       return false;
@@ -203,7 +240,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if ((opp_edge_set != EdgeSet::kSkipped &&
          StopExpanding(hierarchy_limits[meta.edge_id.level() + 1], pred.distance())) ||
         opp_edge_set == EdgeSet::kPermanent || opp_edge_set == EdgeSet::kTemporary) {
-      shortcuts |= meta.edge->shortcut();
+      shortcuts |= hot_edges.empty() ? meta.edge->shortcut() : hot_edges.shortcut(edge_idx);
     } else {
       // Mark this edge as "skipped".
       *meta.edge_status = {EdgeSet::kSkipped, 0};
@@ -224,7 +261,8 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     // Check the access mode and skip this edge if access is not allowed in the reverse
     // direction. This avoids the (somewhat expensive) retrieval of the opposing directed
     // edge when no access is allowed in the reverse direction.
-    if (!(meta.edge->reverseaccess() & access_mode_)) {
+    if (!((hot_edges.empty() ? meta.edge->reverseaccess() : hot_edges.reverseaccess(edge_idx)) &
+          access_mode_)) {
       return false;
     }
 
@@ -306,10 +344,10 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
   // Find the sort cost (with A* heuristic) using the lat,lng at the
   // end node of the directed edge.
   float dist = 0.0f;
+  const PointLL endll = t2->get_node_ll(meta.edge->endnode());
   float sortcost =
-      newcost.cost + (FORWARD
-                          ? astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist)
-                          : astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist));
+      newcost.cost + (FORWARD ? astarheuristic_forward_.Get(endll, meta.edge->endnode(), dist)
+                              : astarheuristic_reverse_.Get(endll, meta.edge->endnode(), dist));
 
   // not_thru_pruning_ is only set to false on the 2nd pass in route_action.
   // We allow settling not_thru edges so we can connect both trees on them.
@@ -393,6 +431,9 @@ void BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
   }
   const NodeInfo* nodeinfo = tile->node(node);
 
+  // Let the reader load the tiles our frontier is heading into in the background
+  graphreader.PrefetchNeighbors(node);
+
   // Keep track of superseded edges
   uint32_t shortcuts = 0;
 
@@ -424,6 +465,8 @@ void BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
   bool disable_uturn = false;
   EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus);
   EdgeMetadata uturn_meta{};
+  // the u-turn is found in the hot edge columns (if the tile has them) without touching the edges
+  const auto& hot_edges = tile->hot_edges();
 
   // Expand from end node in <expansion_direction> direction.
   for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++meta) {
@@ -432,7 +475,9 @@ void BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    bool is_uturn = pred.opp_local_idx() == meta.edge->localedgeidx();
+    const uint32_t local_idx = hot_edges.empty() ? meta.edge->localedgeidx()
+                                                 : hot_edges.localedgeidx(meta.edge_id.id());
+    bool is_uturn = pred.opp_local_idx() == local_idx;
     uturn_meta = is_uturn ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
@@ -517,6 +562,12 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
                           destination.correlation().edges(0).ll().lat());
   Init(origin_new, destination_new);
 
+  // Tighten the heuristics with the landmark distances of the graph, if there are any
+  if (const auto* landmarks = landmark_distances(*costing_)) {
+    astarheuristic_forward_.InitLandmarks(landmarks, graphreader, destination, true);
+    astarheuristic_reverse_.InitLandmarks(landmarks, graphreader, origin, false);
+  }
+
   // we use a non varying time for all time dependent routes until we can figure out how to vary the
   // time during the path computation in the bidirectional algorithm
   bool invariant = options.date_time_type() != Options::no_time;
@@ -735,7 +786,8 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           float route_lower_bound =
               edgelabels_forward_[fwd_pred.predecessor()].cost().cost +
               fwd_pred.transition_cost().cost + rev_pred.sortcost() -
-              astarheuristic_reverse_.Get(tile->get_node_ll(fwd_pred.endnode()));
+              astarheuristic_reverse_.Get(tile->get_node_ll(fwd_pred.endnode()),
+                                          fwd_pred.endnode());
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -791,7 +843,8 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           float route_lower_bound =
               edgelabels_reverse_[rev_pred.predecessor()].cost().cost +
               rev_pred.transition_cost().cost + fwd_pred.sortcost() -
-              astarheuristic_forward_.Get(tile->get_node_ll(rev_pred.endnode()));
+              astarheuristic_forward_.Get(tile->get_node_ll(rev_pred.endnode()),
+                                          rev_pred.endnode());
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -1012,8 +1065,10 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_forward_.GetDistance(nodeinfo->latlng(endtile->header()->base_ll()));
-    float sortcost = cost.cost + astarheuristic_forward_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_forward_.Get(nodeinfo->latlng(endtile->header()->base_ll()),
+                                                directededge->endnode(), dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path.
@@ -1109,8 +1164,10 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_reverse_.GetDistance(tile->get_node_ll(opp_dir_edge->endnode()));
-    float sortcost = cost.cost + astarheuristic_reverse_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_reverse_.Get(tile->get_node_ll(opp_dir_edge->endnode()),
+                                                opp_dir_edge->endnode(), dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path. Make sure the opposing
@@ -0,0 +1,890 @@
+#include "thor/bucketmatrix.h"
+#include "baldr/datetime.h"
+#include "midgard/logging.h"
+#include "thor/astarheuristic.h"
+#include "worker.h"
+
+#include <robin_hood.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr uint32_t kMaxLocationReservation = 25; // the default config for max matrix locations
+
+// How many edges a forward search settles before it checks again how far it still has to go
+constexpr uint32_t kBoundCheckInterval = 64;
+
+bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
+  return a.has_lat_case() == b.has_lat_case() && a.has_lng_case() == b.has_lng_case() &&
+         (!a.has_lat_case() || a.lat() == b.lat()) && (!a.has_lng_case() || a.lng() == b.lng());
+}
+
+inline const valhalla::PathEdge& find_correlated_edge(const valhalla::Location& location,
+                                                      const GraphId& edge_id) {
+  for (const auto& e : location.correlation().edges()) {
+    if (e.graph_id() == edge_id)
+      return e;
+  }
+
+  throw std::logic_error("Could not find candidate edge used for label");
+}
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+class BucketMatrix::BucketMap
+    : public robin_hood::unordered_map<uint64_t, std::vector<BucketEntry>> {};
+
+BucketMatrix::BucketMatrix(const boost::property_tree::ptree& config)
+    : MatrixAlgorithm(config),
+      max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_bidir_dijkstras",
+                                                      kInitialEdgeLabelCountBidirDijkstra)),
+      access_mode_(kAutoAccess), mode_(travel_mode_t::kDrive), backward_pathdist_threshold_(0),
+      forward_pathdist_threshold_(0), ignore_hierarchy_limits_(false), buckets_{new BucketMap} {
+  // the searches run one after the other, so they all share the reserved edge status
+  edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
+}
+
+BucketMatrix::~BucketMatrix() {
+}
+
+// Clear the temporary information generated during time + distance matrix
+// construction.
+void BucketMatrix::Clear() {
+  buckets_->clear();
+
+  auto label_reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
+  if (edgelabels_.size() > label_reservation) {
+    edgelabels_.resize(label_reservation);
+    edgelabels_.shrink_to_fit();
+  }
+  edgelabels_.clear();
+  adjacency_.clear();
+  edgestatus_.clear();
+
+  auto locs_reservation = clear_reserved_memory_ ? 0 : kMaxLocationReservation;
+  if (target_labels_.size() > locs_reservation) {
+    target_labels_.resize(locs_reservation);
+    target_labels_.shrink_to_fit();
+  }
+  for (auto& labels : target_labels_) {
+    labels.clear();
+  }
+  target_radius_.clear();
+  best_connection_.clear();
+  found_.clear();
+  hierarchy_limits_.clear();
+  set_not_thru_pruning(true);
+  ignore_hierarchy_limits_ = false;
+}
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+bool BucketMatrix::SourceToTarget(Api& request,
+                                  baldr::GraphReader& graphreader,
+                                  const sif::mode_costing_t& mode_costing,
+                                  const sif::travel_mode_t mode,
+                                  const float max_matrix_distance) {
+  request.mutable_matrix()->set_algorithm(Matrix::BucketMatrix);
+
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  auto& source_location_list = *request.mutable_options()->mutable_sources();
+  auto& target_location_list = *request.mutable_options()->mutable_targets();
+  const uint32_t source_count = source_location_list.size();
+  const uint32_t target_count = target_location_list.size();
+
+  // the backward searches cover at most half the distance like the searches of CostMatrix, the
+  // forward searches run until they meet them
+  backward_pathdist_threshold_ = max_matrix_distance / 2;
+  forward_pathdist_threshold_ = max_matrix_distance;
+
+  // the searches are time independent, the times only date the results
+  std::vector<TimeInfo> time_infos;
+  time_infos.reserve(source_count);
+  for (auto& source : source_location_list) {
+    time_infos.emplace_back(TimeInfo::make(source, graphreader, &tz_cache_));
+  }
+
+  Initialize(source_location_list, target_location_list, request.matrix());
+
+  // Search backward from every target which still has connections to find. Each search covers
+  // the lower bound of the cost to the farthest of those sources, the forward searches from the
+  // sources make up for what that falls short of.
+  for (uint32_t target = 0; target < target_count; ++target) {
+    float radius = -1.f;
+    AStarHeuristic heuristic;
+    const auto& ll = target_location_list[target].ll();
+    heuristic.Init({ll.lng(), ll.lat()}, costing_->AStarCostFactor());
+    for (uint32_t source = 0; source < source_count; ++source) {
+      if (!found_[source * target_count + target]) {
+        const auto& source_ll = source_location_list[source].ll();
+        radius = std::max(radius, heuristic.Get({source_ll.lng(), source_ll.lat()}));
+      }
+    }
+    if (radius >= 0.f) {
+      BackwardSearch(target, radius, graphreader, request.options());
+    }
+  }
+
+  // Search forward from every source which still has connections to find
+  for (uint32_t source = 0; source < source_count; ++source) {
+    const auto first = found_.begin() + source * target_count;
+    if (std::find(first, first + target_count, false) != first + target_count) {
+      ForwardSearch(source, graphreader, request.options());
+    }
+  }
+
+  // resize/reserve all properties of Matrix on first pass only
+  valhalla::Matrix& matrix = *request.mutable_matrix();
+  reserve_pbf_arrays(matrix, best_connection_.size(), request.options().verbose(),
+                     costing_->pass());
+
+  // Form the matrix PBF output
+  graph_tile_ptr tile;
+  bool connection_failed = false;
+  for (uint32_t connection_idx = 0; connection_idx < best_connection_.size(); connection_idx++) {
+    // if this is the second pass we don't have to process previously found ones again
+    if (costing_->pass() > 0 && !(matrix.second_pass(connection_idx))) {
+      continue;
+    }
+    const auto& best_connection = best_connection_[connection_idx];
+    uint32_t target_idx = connection_idx % target_count;
+    uint32_t source_idx = connection_idx / target_count;
+
+    float time = best_connection.first.secs;
+    if (time < kMaxCost && request.options().verbose()) {
+      const auto& target_labels = target_labels_[target_idx];
+      const auto target_timezone =
+          target_labels.empty()
+              ? 0
+              : graphreader.GetTimezoneFromEdge(target_labels.front().edgeid(), tile);
+      auto dt_info = DateTime::offset_date(source_location_list[source_idx].date_time(),
+                                           time_infos[source_idx].timezone_index, target_timezone,
+                                           time);
+      *matrix.mutable_date_times(connection_idx) = dt_info.date_time;
+      *matrix.mutable_time_zone_offsets(connection_idx) = dt_info.time_zone_offset;
+      *matrix.mutable_time_zone_names(connection_idx) = dt_info.time_zone_name;
+    } else if (time == kMaxCost) {
+      // let's try a second pass for this connection
+      matrix.mutable_second_pass()->Set(connection_idx, true);
+      connection_failed = true;
+    }
+
+    matrix.mutable_from_indices()->Set(connection_idx, source_idx);
+    matrix.mutable_to_indices()->Set(connection_idx, target_idx);
+    matrix.mutable_distances()->Set(connection_idx, best_connection.second);
+    matrix.mutable_times()->Set(connection_idx, time);
+  }
+
+  return !connection_failed;
+}
+
+// Initialize all time distance to "not found". Any locations that
+// are the same get set to 0 time, distance.
+void BucketMatrix::Initialize(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_locations,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_locations,
+    const valhalla::Matrix& matrix) {
+  // if costing has no hierarchy limits set, fall back to the defaults passed via the config
+  const auto& hlimits = costing_->GetHierarchyLimits();
+  ignore_hierarchy_limits_ =
+      std::all_of(hlimits.begin(), hlimits.end(), [](const HierarchyLimits& limits) {
+        return limits.max_up_transitions() == kUnlimitedTransitions;
+      });
+
+  const uint32_t target_count = target_locations.size();
+  target_labels_.resize(target_count);
+  target_radius_.assign(target_count, 0.f);
+
+  const uint32_t count = source_locations.size() * target_count;
+  best_connection_.assign(count, {Cost(kMaxCost, kMaxCost), static_cast<uint32_t>(kMaxCost)});
+  found_.assign(count, false);
+  for (uint32_t i = 0; i < static_cast<uint32_t>(source_locations.size()); i++) {
+    for (uint32_t j = 0; j < target_count; j++) {
+      const auto connection_idx = i * target_count + j;
+      if (equals(source_locations.Get(i).ll(), target_locations.Get(j).ll())) {
+        best_connection_[connection_idx] = {Cost(0.0f, 0.0f), 0};
+        found_[connection_idx] = true;
+      } else if (costing_->pass() > 0 && !matrix.second_pass(connection_idx)) {
+        // we've found this connection in a previous pass, we only need the time & distance
+        best_connection_[connection_idx] = {Cost{0.0f, matrix.times(connection_idx)},
+                                            matrix.distances(connection_idx)};
+        found_[connection_idx] = true;
+      }
+    }
+  }
+}
+
+// Reset the state of the previous search
+void BucketMatrix::ResetSearch() {
+  edgelabels_.clear();
+  edgestatus_.clear();
+  adjacency_.clear();
+  const uint32_t bucketsize = costing_->UnitSize();
+  adjacency_.reuse(0.f, kBucketCount * bucketsize, bucketsize, &edgelabels_);
+  const auto& hlimits = costing_->GetHierarchyLimits();
+  hierarchy_limits_.assign(hlimits.begin(), hlimits.end());
+}
+
+// Search backward from a target and put the edges it reaches into their buckets
+void BucketMatrix::BackwardSearch(const uint32_t target,
+                                  const float radius,
+                                  GraphReader& graphreader,
+                                  const valhalla::Options& options) {
+  ResetSearch();
+  target_labels_[target].clear();
+  SetTarget(graphreader, options.targets(target), target);
+
+  // unless the search is stopped, it reached all edges it could
+  float covered = std::numeric_limits<float>::max();
+  uint32_t interrupt_n = 0;
+  while (true) {
+    const uint32_t pred_idx = adjacency_.pop();
+    if (pred_idx == kInvalidLabel) {
+      break;
+    }
+
+    // everything cheaper than the first label past the radius has been settled
+    const BDEdgeLabel& pred = edgelabels_[pred_idx];
+    if (pred.cost().cost > radius || pred.path_distance() > backward_pathdist_threshold_) {
+      covered = pred.cost().cost;
+      break;
+    }
+
+    // Settle this edge and log it if requested
+    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    if (expansion_callback_) {
+      auto prev_pred = pred.predecessor() == kInvalidLabel
+                           ? GraphId{}
+                           : edgelabels_[pred.predecessor()].edgeid();
+      expansion_callback_(graphreader, pred.edgeid(), prev_pred, "bucketmatrix",
+                          Expansion_EdgeStatus_settled, pred.cost().secs, pred.path_distance(),
+                          pred.cost().cost, Expansion_ExpansionType_reverse);
+    }
+
+    Expand<MatrixExpansionType::reverse>(pred_idx, graphreader);
+
+    // Allow this process to be aborted
+    if (interrupt_ && (interrupt_n++ % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+  }
+  target_radius_[target] = covered;
+
+  // Every edge the search reached goes into the bucket, the ones it didn't settle yet may still
+  // connect at a cost which is not the lowest
+  for (const auto& label : edgelabels_) {
+    auto& bucket = (*buckets_)[label.edgeid()];
+    if (label.predecessor() == kInvalidLabel) {
+      bucket.push_back({target, 1, label.path_distance(), label.cost()});
+    } else {
+      const auto& opp_label = edgelabels_[label.predecessor()];
+      bucket.push_back(
+          {target, 0, opp_label.path_distance(), opp_label.cost() + label.transition_cost()});
+    }
+  }
+}
+
+// Search forward from a source and connect to the targets through the buckets
+void BucketMatrix::ForwardSearch(const uint32_t source,
+                                 GraphReader& graphreader,
+                                 const valhalla::Options& options) {
+  ResetSearch();
+  SetSource(graphreader, options.sources(source));
+
+  float bound = 0.f;
+  uint32_t n = 0;
+  while (true) {
+    const uint32_t pred_idx = adjacency_.pop();
+    if (pred_idx == kInvalidLabel) {
+      break;
+    }
+
+    // A better connection to a target has to meet its backward search on an edge the search
+    // reaches before its cost exceeds the best one's cost less what the backward search covered
+    const BDEdgeLabel& pred = edgelabels_[pred_idx];
+    if ((n % kBoundCheckInterval) == 0) {
+      bound = CostBound(source);
+    }
+    if (pred.cost().cost > bound || pred.path_distance() > forward_pathdist_threshold_) {
+      break;
+    }
+
+    // Settle this edge and log it if requested
+    edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    if (expansion_callback_) {
+      auto prev_pred = pred.predecessor() == kInvalidLabel
+                           ? GraphId{}
+                           : edgelabels_[pred.predecessor()].edgeid();
+      expansion_callback_(graphreader, pred.edgeid(), prev_pred, "bucketmatrix",
+                          Expansion_EdgeStatus_settled, pred.cost().secs, pred.path_distance(),
+                          pred.cost().cost, Expansion_ExpansionType_forward);
+    }
+
+    CheckConnections(source, pred, graphreader, options);
+    Expand<MatrixExpansionType::forward>(pred_idx, graphreader);
+
+    // Allow this process to be aborted
+    if (interrupt_ && (n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+    ++n;
+  }
+
+  // The edges the search reached but didn't settle lead on from settled ones, their connections
+  // complete those the settled edges were one edge short of
+  for (uint32_t idx = 0; idx < edgelabels_.size(); ++idx) {
+    if (edgestatus_.Get(edgelabels_[idx].edgeid()).set() == EdgeSet::kTemporary) {
+      CheckConnections(source, edgelabels_[idx], graphreader, options);
+    }
+  }
+}
+
+// The highest cost at which any of the unfound connections of a source could still get better
+float BucketMatrix::CostBound(const uint32_t source) const {
+  const uint32_t target_count = target_radius_.size();
+  float bound = 0.f;
+  for (uint32_t target = 0; target < target_count; ++target) {
+    const uint32_t idx = source * target_count + target;
+    if (!found_[idx]) {
+      bound = std::max(bound, best_connection_[idx].first.cost - target_radius_[target]);
+    }
+  }
+  return bound;
+}
+
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+bool BucketMatrix::ExpandInner(baldr::GraphReader& graphreader,
+                               const sif::BDEdgeLabel& pred,
+                               const baldr::DirectedEdge* opp_pred_edge,
+                               const baldr::NodeInfo* nodeinfo,
+                               const uint32_t pred_idx,
+                               const EdgeMetadata& meta,
+                               uint32_t& shortcuts,
+                               const graph_tile_ptr& tile,
+                               const baldr::TimeInfo& time_info) {
+  // Use the hot edge columns for the first checks if the tile has them
+  const auto& hot_edges = tile->hot_edges();
+  const uint32_t edge_idx = meta.edge_id.id();
+
+  // Skip if this is a regular edge superseded by a shortcut.
+  if (shortcuts & (hot_edges.empty() ? meta.edge->superseded() : hot_edges.superseded(edge_idx))) {
+    return false;
+  }
+
+  graph_tile_ptr t2 = nullptr;
+  baldr::GraphId opp_edge_id;
+  const auto get_opp_edge_data = [&]() {
+    t2 = (hot_edges.empty() ? meta.edge->leaves_tile() : hot_edges.leaves_tile(edge_idx))
+             ? graphreader.GetGraphTile(hot_edges.empty() ? meta.edge->endnode()
+                                                          : hot_edges.endnode(edge_idx))
+             : tile;
+    if (t2 == nullptr) {
+      return false;
+    }
+
+    opp_edge_id = t2->GetOpposingEdgeId(meta.edge);
+    return true;
+  };
+
+  if (hot_edges.empty() ? meta.edge->is_shortcut() : hot_edges.is_shortcut(edge_idx)) {
+    // Skip shortcuts if hierarchy limits are disabled or the opposing tile doesn't exist
+    if (ignore_hierarchy_limits_ || !get_opp_edge_data())
+      return false;
+
+    // Skip shortcut edges until we have stopped expanding on the next level. Use regular
+    // edges while still expanding on the next level since we can still transition down to
+    // that level. If using a shortcut, set the shortcuts mask.
+    if (StopExpanding(hierarchy_limits_[meta.edge_id.level() + 1])) {
+      shortcuts |= hot_edges.empty() ? meta.edge->shortcut() : hot_edges.shortcut(edge_idx);
+    } else {
+      return false;
+    }
+  }
+
+  // Skip this edge if permanently labeled (best path already found to this
+  // directed edge)
+  if (meta.edge_status->set() == EdgeSet::kPermanent) {
+    return true;
+  }
+
+  const baldr::DirectedEdge* opp_edge = nullptr;
+  if (!FORWARD) {
+    // Check the access mode and skip this edge if access is not allowed in the reverse
+    // direction. This avoids the (somewhat expensive) retrieval of the opposing directed
+    // edge when no access is allowed in the reverse direction.
+    if (!((hot_edges.empty() ? meta.edge->reverseaccess() : hot_edges.reverseaccess(edge_idx)) &
+          access_mode_)) {
+      return false;
+    }
+
+    if (t2 == nullptr && !get_opp_edge_data()) {
+      return false;
+    }
+
+    opp_edge = t2->directededge(opp_edge_id);
+  }
+
+  // Skip this edge if no access is allowed (based on costing method)
+  // or if a complex restriction prevents transition onto this edge.
+  uint8_t restriction_idx = kInvalidRestriction;
+  if (FORWARD) {
+    if (!costing_->Allowed(meta.edge, false, pred, tile, meta.edge_id, time_info.local_time,
+                           time_info.timezone_index, restriction_idx) ||
+        costing_->Restricted(meta.edge, pred, edgelabels_, tile, meta.edge_id, true, &edgestatus_,
+                             time_info.local_time, time_info.timezone_index)) {
+      return false;
+    }
+  } else {
+    if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, time_info.local_time,
+                                  time_info.timezone_index, restriction_idx) ||
+        costing_->Restricted(meta.edge, pred, edgelabels_, tile, meta.edge_id, false, &edgestatus_,
+                             time_info.local_time, time_info.timezone_index)) {
+      return false;
+    }
+  }
+
+  // Get cost. Separate out transition cost.
+  uint8_t flow_sources;
+  Cost newcost =
+      pred.cost() + (FORWARD ? costing_->EdgeCost(meta.edge, tile, time_info, flow_sources)
+                             : costing_->EdgeCost(opp_edge, t2, time_info, flow_sources));
+  auto reader_getter = [&graphreader]() { return baldr::LimitedGraphReader(graphreader); };
+  sif::Cost tc =
+      FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred, tile, reader_getter)
+              : costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge,
+                                                opp_pred_edge, t2, pred.edgeid(), reader_getter,
+                                                static_cast<bool>(flow_sources & kDefaultFlowMask),
+                                                pred.internal_turn());
+  newcost += tc;
+
+  const auto pred_dist = pred.path_distance() + meta.edge->length();
+  // Check if edge is temporarily labeled and this path has less cost. If
+  // less cost the predecessor is updated and the sort cost is decremented
+  // by the difference in real cost
+  if (meta.edge_status->set() == EdgeSet::kTemporary) {
+    BDEdgeLabel& lab = edgelabels_[meta.edge_status->index()];
+    if (newcost.cost < lab.cost().cost) {
+      adjacency_.decrease(meta.edge_status->index(), newcost.cost);
+      lab.Update(pred_idx, newcost, newcost.cost, tc, pred_dist, restriction_idx);
+    }
+    // Returning true since this means we approved the edge
+    return true;
+  }
+
+  // Get end node tile (skip if tile is not found) and opposing edge Id
+  if (t2 == nullptr && !get_opp_edge_data()) {
+    return false;
+  }
+
+  // not_thru_pruning_ is only set to false on the 2nd pass in matrix_action.
+  // We allow settling not_thru edges so we can connect both searches on them.
+  bool not_thru_pruning =
+      not_thru_pruning_ ? (pred.not_thru_pruning() || !meta.edge->not_thru()) : false;
+
+  // Add edge label, add to the adjacency list and set edge status
+  uint32_t idx = edgelabels_.size();
+  *meta.edge_status = {EdgeSet::kTemporary, idx};
+  if (FORWARD) {
+    edgelabels_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost, mode_, tc,
+                             pred_dist, not_thru_pruning,
+                             (pred.closure_pruning() || !costing_->IsClosed(meta.edge, tile)),
+                             static_cast<bool>(flow_sources & kDefaultFlowMask),
+                             costing_->TurnType(pred.opp_local_idx(), nodeinfo, meta.edge),
+                             restriction_idx, 0,
+                             meta.edge->destonly() ||
+                                 (costing_->is_hgv() && meta.edge->destonly_hgv()),
+                             meta.edge->forwardaccess() & kTruckAccess);
+  } else {
+    edgelabels_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost, mode_, tc,
+                             pred_dist, not_thru_pruning,
+                             (pred.closure_pruning() || !costing_->IsClosed(opp_edge, t2)),
+                             static_cast<bool>(flow_sources & kDefaultFlowMask),
+                             costing_->TurnType(meta.edge->localedgeidx(), nodeinfo, opp_edge,
+                                                opp_pred_edge),
+                             restriction_idx, 0,
+                             opp_edge->destonly() ||
+                                 (costing_->is_hgv() && opp_edge->destonly_hgv()),
+                             opp_edge->forwardaccess() & kTruckAccess);
+  }
+  edgelabels_.back().SetSortCost(newcost.cost);
+  adjacency_.add(idx);
+
+  // setting this edge as reached
+  if (expansion_callback_) {
+    expansion_callback_(graphreader, meta.edge_id, pred.edgeid(), "bucketmatrix",
+                        Expansion_EdgeStatus_reached, newcost.secs, pred_dist, newcost.cost,
+                        static_cast<Expansion_ExpansionType>(
+                            !static_cast<bool>(expansion_direction)));
+  }
+
+  return !(pred.not_thru_pruning() && meta.edge->not_thru());
+}
+
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void BucketMatrix::Expand(const uint32_t pred_idx, baldr::GraphReader& graphreader) {
+  // a copy, adding labels may move the others
+  auto pred = edgelabels_[pred_idx];
+  GraphId node = pred.endnode();
+  // Prune path if predecessor is not a through edge or if the maximum
+  // number of upward transitions has been exceeded on this hierarchy level.
+  if ((pred.not_thru() && pred.not_thru_pruning()) ||
+      (!ignore_hierarchy_limits_ && StopExpanding(hierarchy_limits_[node.level()]))) {
+    return;
+  }
+
+  // Get the tile and the node info. Skip if tile is null (can happen
+  // with regional data sets) or if no access at the node.
+  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+
+  // Let the reader load the tiles our frontier is heading into in the background
+  graphreader.PrefetchNeighbors(node);
+
+  // the searches don't depend on the time
+  const auto time_info = TimeInfo::invalid();
+
+  // Get the opposing predecessor directed edge if this is reverse.
+  const DirectedEdge* opp_pred_edge = nullptr;
+  if (!FORWARD) {
+    const auto rev_pred_tile = graphreader.GetGraphTile(pred.opp_edgeid(), tile);
+    if (rev_pred_tile == nullptr) {
+      return;
+    }
+    opp_pred_edge = rev_pred_tile->directededge(pred.opp_edgeid());
+  }
+
+  // keep track of shortcuts
+  uint32_t shortcuts = 0;
+  // If we encounter a node with an access restriction like a barrier we allow a uturn
+  if (!costing_->Allowed(nodeinfo)) {
+    const DirectedEdge* opp_edge = nullptr;
+    const GraphId opp_edge_id = graphreader.GetOpposingEdgeId(pred.edgeid(), opp_edge, tile);
+    // Mark the predecessor as a deadend to be consistent with how the
+    // edgelabels are set when an *actual* deadend (i.e. some dangling OSM geometry)
+    // is labelled
+    pred.set_deadend(true);
+    // Check if edge is null before using it (can happen with regional data sets)
+    if (opp_edge) {
+      ExpandInner<expansion_direction>(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx,
+                                       {opp_edge, opp_edge_id,
+                                        edgestatus_.GetPtr(opp_edge_id, tile)},
+                                       shortcuts, tile, time_info);
+    }
+    return;
+  }
+
+  // catch u-turn attempts
+  bool disable_uturn = false;
+  EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus_);
+  EdgeMetadata uturn_meta{};
+  // the u-turn is found in the hot edge columns (if the tile has them) without touching the edges
+  const auto& hot_edges = tile->hot_edges();
+
+  // Expand from end node in <expansion_direction> direction.
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++meta) {
+    // Begin by checking if this is the opposing edge to pred. If so, it means we are attempting
+    // a u-turn. In that case, lets wait with evaluating this edge until last.
+    const uint32_t local_idx = hot_edges.empty() ? meta.edge->localedgeidx()
+                                                 : hot_edges.localedgeidx(meta.edge_id.id());
+    const bool is_uturn = pred.opp_local_idx() == local_idx;
+    uturn_meta = is_uturn ? meta : uturn_meta;
+
+    // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
+    disable_uturn = (!is_uturn && ExpandInner<expansion_direction>(graphreader, pred, opp_pred_edge,
+                                                                   nodeinfo, pred_idx, meta,
+                                                                   shortcuts, tile, time_info)) ||
+                    disable_uturn;
+  }
+
+  // Handle transitions - expand from the end node of each transition
+  if (nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      // if this is a downward transition (ups are always allowed) AND we are no longer allowed OR
+      // we cant get the tile at that level (local extracts could have this problem) THEN bail
+      graph_tile_ptr trans_tile = nullptr;
+      if ((!trans->up() && !ignore_hierarchy_limits_ &&
+           StopExpanding(hierarchy_limits_[trans->endnode().level()])) ||
+          !(trans_tile = graphreader.GetGraphTile(trans->endnode()))) {
+        continue;
+      }
+
+      // setup for expansion at this level
+      hierarchy_limits_[node.level()].set_up_transition_count(
+          hierarchy_limits_[node.level()].up_transition_count() + trans->up());
+      const auto* trans_node = trans_tile->node(trans->endnode());
+      EdgeMetadata trans_meta =
+          EdgeMetadata::make(trans->endnode(), trans_node, trans_tile, edgestatus_);
+      uint32_t trans_shortcuts = 0;
+      // expand the edges from this node at this level
+      for (uint32_t i = 0; i < trans_node->edge_count(); ++i, ++trans_meta) {
+        disable_uturn =
+            ExpandInner<expansion_direction>(graphreader, pred, opp_pred_edge, trans_node, pred_idx,
+                                             trans_meta, trans_shortcuts, trans_tile, time_info) ||
+            disable_uturn;
+      }
+    }
+  }
+
+  // Now, after having looked at all the edges, including edges on other levels,
+  // we can say if this is a deadend or not, and if so, evaluate the uturn-edge (if it exists)
+  if (!disable_uturn && uturn_meta) {
+    // If we found no suitable edge to add, it means we're at a deadend
+    // so lets go back and re-evaluate a potential u-turn
+    pred.set_deadend(true);
+    ExpandInner<expansion_direction>(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx,
+                                     uturn_meta, shortcuts, tile, time_info);
+  }
+}
+
+// Check if the edge of the forward search connects to the backward search of any target
+void BucketMatrix::CheckConnections(const uint32_t source,
+                                    const BDEdgeLabel& fwd_pred,
+                                    GraphReader& graphreader,
+                                    const valhalla::Options& options) {
+  // Disallow connections that are part of an uturn on an internal edge
+  if (fwd_pred.internal_turn() != InternalTurn::kNoTurn) {
+    return;
+  }
+  // Disallow connections that are part of a complex restriction.
+  if (fwd_pred.on_complex_rest()) {
+    return;
+  }
+
+  // Get the opposing edge. Get the targets whose backward search has reached it.
+  GraphId rev_edgeid = fwd_pred.opp_edgeid();
+  auto bucket = buckets_->find(rev_edgeid);
+  if (bucket == buckets_->end()) {
+    return;
+  }
+
+  const uint32_t target_count = target_radius_.size();
+  for (const auto& entry : bucket->second) {
+    const uint32_t idx = source * target_count + entry.target;
+    if (found_[idx]) {
+      continue;
+    }
+
+    auto& best_connection = best_connection_[idx];
+    if (!entry.initial) {
+      // the rest of the path from the end of this edge to the target
+      Cost total_cost = fwd_pred.cost() + entry.cost;
+      if (total_cost < best_connection.first) {
+        best_connection = {total_cost, fwd_pred.path_distance() + entry.distance};
+      }
+    } else if (fwd_pred.predecessor() == kInvalidLabel) {
+      // Special case - common edge for source and target are both initial edges
+      // bail if forward edge wasn't allowed (see notes in SetSource/SetTarget)
+      if (!fwd_pred.path_id()) {
+        return;
+      }
+
+      // if source percent along edge is larger than target percent along,
+      // can't connect on this edge
+      if (find_correlated_edge(options.sources(source), fwd_pred.edgeid()).percent_along() >
+          find_correlated_edge(options.targets(entry.target), fwd_pred.edgeid()).percent_along()) {
+        continue;
+      }
+
+      const auto& target_labels = target_labels_[entry.target];
+      const auto rev_label =
+          std::find_if(target_labels.begin(), target_labels.end(),
+                       [&rev_edgeid](const BDEdgeLabel& l) { return l.edgeid() == rev_edgeid; });
+      if (rev_label == target_labels.end()) {
+        continue;
+      }
+
+      // remember: transition_cost is abused in SetSource/SetTarget: cost is secs, secs is length
+      float s = std::abs(fwd_pred.cost().secs + rev_label->cost().secs -
+                         rev_label->transition_cost().cost);
+
+      // distance computation only works with the casts.
+      uint32_t d = std::abs(static_cast<int>(fwd_pred.path_distance()) +
+                            static_cast<int>(rev_label->path_distance()) -
+                            static_cast<int>(rev_label->transition_cost().secs));
+      best_connection = {Cost(s, s), d};
+      found_[idx] = true;
+    } else {
+      // the connecting edge is one of the target's own, only its part up to the target counts
+      const auto& label = edgelabels_[fwd_pred.predecessor()];
+      Cost total_cost = label.cost() + entry.cost + fwd_pred.transition_cost();
+      if (total_cost < best_connection.first) {
+        best_connection = {total_cost, label.path_distance() + entry.distance};
+      }
+    }
+
+    // setting this edge as connected
+    if (expansion_callback_) {
+      auto prev_pred = fwd_pred.predecessor() == kInvalidLabel
+                           ? GraphId{}
+                           : edgelabels_[fwd_pred.predecessor()].edgeid();
+      expansion_callback_(graphreader, fwd_pred.edgeid(), prev_pred, "bucketmatrix",
+                          Expansion_EdgeStatus_connected, fwd_pred.cost().secs,
+                          fwd_pred.path_distance(), fwd_pred.cost().cost,
+                          Expansion_ExpansionType_forward);
+    }
+  }
+}
+
+// Add the edges of a source to the forward search
+void BucketMatrix::SetSource(GraphReader& graphreader, const valhalla::Location& origin) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(origin.correlation().edges().begin(), origin.correlation().edges().end(),
+                [&has_other_edges](const valhalla::PathEdge& e) {
+                  has_other_edges = has_other_edges || !e.end_node();
+                });
+
+  // Iterate through edges and add to adjacency list
+  for (const auto& edge : origin.correlation().edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    if (has_other_edges && edge.end_node()) {
+      continue;
+    }
+
+    // Disallow any user avoid edges if the avoid location is ahead of the origin along the edge
+    GraphId edgeid(edge.graph_id());
+    if (costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Get the directed edge and the opposing edge Id
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    graph_tile_ptr opp_tile = tile;
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    GraphId oppedgeid = graphreader.GetOpposingEdgeId(edgeid, opp_tile);
+
+    // Get cost. Get distance along the remainder of this edge.
+    uint8_t flow_sources;
+    Cost edgecost = costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources);
+    Cost cost = edgecost * (1.0f - edge.percent_along());
+    uint32_t d = std::round(directededge->length() * (1.0f - edge.percent_along()));
+
+    // We need to penalize this location based on its score (distance in meters from input)
+    // We assume the slowest speed you could travel to cover that distance to start/end the route
+    // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
+    cost.cost += edge.distance();
+
+    // 2 adjustments related only to properly handle trivial routes:
+    //   - "transition_cost" is used to store the traversed secs & length
+    //   - "path_id" is used to store whether the edge is even allowed (e.g. no oneway)
+    Cost ec(std::round(edgecost.secs), static_cast<uint32_t>(directededge->length()));
+    BDEdgeLabel edge_label(kInvalidLabel, edgeid, oppedgeid, directededge, cost, mode_, ec, d,
+                           !directededge->not_thru(), !(costing_->IsClosed(directededge, tile)),
+                           static_cast<bool>(flow_sources & kDefaultFlowMask),
+                           InternalTurn::kNoTurn, kInvalidRestriction,
+                           static_cast<uint8_t>(costing_->Allowed(directededge, tile)),
+                           directededge->destonly() ||
+                               (costing_->is_hgv() && directededge->destonly_hgv()),
+                           directededge->forwardaccess() & kTruckAccess);
+    edge_label.SetSortCost(cost.cost);
+
+    // Set the initial not_thru flag to false. There is an issue with not_thru
+    // flags on small loops. Set this to false here to override this for now.
+    edge_label.set_not_thru(false);
+
+    // Add EdgeLabel to the adjacency list. Set the predecessor edge index to invalid to indicate
+    // the origin of the path.
+    uint32_t idx = edgelabels_.size();
+    edgelabels_.push_back(std::move(edge_label));
+    adjacency_.add(idx);
+    edgestatus_.Set(edgeid, EdgeSet::kTemporary, idx, tile);
+  }
+}
+
+// Add the edges of a target to the backward search
+void BucketMatrix::SetTarget(GraphReader& graphreader,
+                             const valhalla::Location& dest,
+                             const uint32_t target) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(dest.correlation().edges().begin(), dest.correlation().edges().end(),
+                [&has_other_edges](const valhalla::PathEdge& e) {
+                  has_other_edges = has_other_edges || !e.begin_node();
+                });
+
+  // Iterate through edges and add to adjacency list
+  for (const auto& edge : dest.correlation().edges()) {
+    // If the destination is at a node, skip any outbound edges (so any
+    // opposing inbound edges are not considered)
+    if (has_other_edges && edge.begin_node()) {
+      continue;
+    }
+
+    // Disallow any user avoided edges if the avoid location is behind the destination along the
+    // edge
+    GraphId edgeid(edge.graph_id());
+    if (costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Get the directed edge
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+
+    // Get the opposing directed edge, continue if we cannot get it
+    graph_tile_ptr opp_tile = tile;
+    GraphId opp_edge_id = graphreader.GetOpposingEdgeId(edgeid, opp_tile);
+    if (!opp_edge_id.Is_Valid()) {
+      continue;
+    }
+    const DirectedEdge* opp_dir_edge = graphreader.GetOpposingEdge(edgeid, opp_tile);
+
+    // Get cost. Get distance along the remainder of this edge.
+    // Use the directed edge for costing, as this is the forward direction
+    // along the destination edge.
+    uint8_t flow_sources;
+    Cost edgecost = costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources);
+    Cost cost = edgecost * edge.percent_along();
+    uint32_t d = std::round(directededge->length() * edge.percent_along());
+
+    // We need to penalize this location based on its score (distance in meters from input)
+    // We assume the slowest speed you could travel to cover that distance to start/end the route
+    // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
+    cost.cost += edge.distance();
+
+    // 2 adjustments related only to properly handle trivial routes:
+    //   - "transition_cost" is used to store the traversed secs & length
+    //   - "path_id" is used to store whether the opp edge is even allowed (e.g. no oneway)
+    Cost ec(std::round(edgecost.secs), static_cast<uint32_t>(directededge->length()));
+    BDEdgeLabel edge_label(kInvalidLabel, opp_edge_id, edgeid, opp_dir_edge, cost, mode_, ec, d,
+                           !opp_dir_edge->not_thru(), !(costing_->IsClosed(directededge, tile)),
+                           static_cast<bool>(flow_sources & kDefaultFlowMask),
+                           InternalTurn::kNoTurn, kInvalidRestriction,
+                           static_cast<uint8_t>(costing_->Allowed(directededge, tile)),
+                           directededge->destonly() ||
+                               (costing_->is_hgv() && directededge->destonly_hgv()),
+                           directededge->forwardaccess() & kTruckAccess);
+    edge_label.SetSortCost(cost.cost);
+
+    // Set the initial not_thru flag to false. There is an issue with not_thru
+    // flags on small loops. Set this to false here to override this for now.
+    edge_label.set_not_thru(false);
+
+    // Add EdgeLabel to the adjacency list, the forward searches need it again for the trivial
+    // connections on the edge
+    uint32_t idx = edgelabels_.size();
+    target_labels_[target].push_back(edge_label);
+    edgelabels_.push_back(std::move(edge_label));
+    adjacency_.add(idx);
+    edgestatus_.Set(opp_edge_id, EdgeSet::kTemporary, idx, opp_tile);
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
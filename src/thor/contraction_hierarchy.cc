@@ -0,0 +1,307 @@
+#include "thor/contraction_hierarchy.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "sif/edgelabel.h"
+#include "sif/recost.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+inline float find_percent_along(const valhalla::Location& location, const GraphId& edge_id) {
+  for (const auto& e : location.correlation().edges()) {
+    if (e.graph_id() == edge_id)
+      return e.percent_along();
+  }
+  throw std::logic_error("Could not find candidate edge for the location");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionHierarchy::ContractionHierarchy(const boost::property_tree::ptree& config,
+                                           const std::string& file_name)
+    : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_bidir_astar",
+                                         kInitialEdgeLabelCountBidirAstar),
+                    config.get<bool>("clear_reserved_memory", false)) {
+  if (!file_name.empty()) {
+    graph_.reset(new ContractionGraph(file_name));
+    if (graph_->empty()) {
+      graph_.reset();
+    }
+  }
+}
+
+void ContractionHierarchy::search_t::add(const uint32_t vertex,
+                                         const uint32_t predecessor,
+                                         const float cost) {
+  auto inserted = reached.emplace(vertex, static_cast<uint32_t>(labels.size()));
+  if (inserted.second) {
+    labels.push_back({vertex, predecessor, cost});
+  } else {
+    auto& label = labels[inserted.first->second];
+    if (cost >= label.cost) {
+      return;
+    }
+    label.predecessor = predecessor;
+    label.cost = cost;
+  }
+  queue.emplace(cost, inserted.first->second);
+}
+
+uint32_t ContractionHierarchy::search_t::find(const uint32_t vertex) const {
+  auto found = reached.find(vertex);
+  return found == reached.end() ? kInvalidLabel : found->second;
+}
+
+float ContractionHierarchy::search_t::min_cost() const {
+  return queue.empty() ? std::numeric_limits<float>::infinity() : queue.top().first;
+}
+
+void ContractionHierarchy::search_t::clear() {
+  labels.clear();
+  reached.clear();
+  queue = {};
+}
+
+void ContractionHierarchy::Clear() {
+  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
+  for (auto* search : {&forward_, &reverse_}) {
+    if (search->labels.size() > reservation) {
+      search->labels.resize(reservation);
+      search->labels.shrink_to_fit();
+    }
+    search->clear();
+  }
+  has_ferry_ = false;
+}
+
+bool ContractionHierarchy::CanRoute(const valhalla::Location& origin,
+                                    const valhalla::Location& destination,
+                                    const Options& options) const {
+  if (!graph_ || options.costing_type() != Costing::auto_ || options.alternates() > 0 ||
+      !origin.date_time().empty() || !destination.date_time().empty()) {
+    return false;
+  }
+  auto costing = options.costings().find(Costing::auto_);
+  return costing != options.costings().end() &&
+         ContractionGraph::fingerprint(costing->second.options()) == graph_->costing();
+}
+
+template <const ExpansionType expansion_direction> uint32_t ContractionHierarchy::Settle() {
+  constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
+  auto& search = FORWARD ? forward_ : reverse_;
+  const auto entry = search.queue.top();
+  search.queue.pop();
+  const label_t label = search.labels[entry.second];
+  if (entry.first > label.cost) {
+    return kInvalidLabel;
+  }
+
+  // a vertex the search reached cheaper through a vertex above it isn't on the best path,
+  // there is no use going on from it
+  const auto* arc = FORWARD ? graph_->down_begin(label.vertex) : graph_->up_begin(label.vertex);
+  const auto* end = FORWARD ? graph_->down_end(label.vertex) : graph_->up_end(label.vertex);
+  for (; arc != end; ++arc) {
+    const uint32_t above = search.find(arc->vertex);
+    if (above != kInvalidLabel && search.labels[above].cost + arc->cost < label.cost) {
+      return entry.second;
+    }
+  }
+
+  arc = FORWARD ? graph_->up_begin(label.vertex) : graph_->down_begin(label.vertex);
+  end = FORWARD ? graph_->up_end(label.vertex) : graph_->down_end(label.vertex);
+  for (; arc != end; ++arc) {
+    search.add(arc->vertex, entry.second, label.cost + arc->cost);
+  }
+  return entry.second;
+}
+
+bool ContractionHierarchy::Unpack(uint32_t forward_idx,
+                                  uint32_t reverse_idx,
+                                  std::vector<GraphId>& edges) const {
+  // the forward search is walked back to the origin
+  std::vector<uint32_t> up;
+  for (; forward_idx != kInvalidLabel; forward_idx = forward_.labels[forward_idx].predecessor) {
+    up.push_back(forward_.labels[forward_idx].vertex);
+  }
+  std::vector<uint32_t> vertices{up.back()};
+  for (size_t i = up.size() - 1; i > 0; --i) {
+    if (!graph_->unpack(up[i], up[i - 1], vertices)) {
+      return false;
+    }
+  }
+
+  // and the reverse search on to the destination
+  for (uint32_t next = reverse_.labels[reverse_idx].predecessor; next != kInvalidLabel;
+       reverse_idx = next, next = reverse_.labels[next].predecessor) {
+    if (!graph_->unpack(reverse_.labels[reverse_idx].vertex, reverse_.labels[next].vertex,
+                        vertices)) {
+      return false;
+    }
+  }
+
+  edges.reserve(vertices.size());
+  for (auto vertex : vertices) {
+    edges.push_back(graph_->edge(vertex));
+  }
+  return true;
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionHierarchy::GetBestPath(valhalla::Location& origin,
+                                  valhalla::Location& destination,
+                                  GraphReader& graphreader,
+                                  const sif::mode_costing_t& mode_costing,
+                                  const sif::TravelMode mode,
+                                  const Options& /*options*/) {
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+  if (!graph_) {
+    return {};
+  }
+
+  // The hierarchy has no turns onto destination-only edges from other edges, like the first pass
+  // of bidirectional A*. Routes from or to such an area are left to bidirectional A*, which allows
+  // them around the locations.
+  auto destonly = [&graphreader](const valhalla::Location& location) {
+    return std::any_of(location.correlation().edges().begin(),
+                       location.correlation().edges().end(), [&](const valhalla::PathEdge& edge) {
+                         graph_tile_ptr tile;
+                         const auto* directededge =
+                             graphreader.directededge(GraphId(edge.graph_id()), tile);
+                         return directededge != nullptr && directededge->destonly();
+                       });
+  };
+  if (destonly(origin) || destonly(destination)) {
+    return {};
+  }
+
+  // The searches start from the part of the location edges the path uses. The reverse search
+  // takes off the part of the destination edge the arcs onto it include but the path doesn't.
+  // That can make its seeds negative, while the searches below can only stop once their cheapest
+  // label can't beat the best connection if no label is. So the seeds of a search are all shifted
+  // by the same amount to be non-negative, which doesn't change which connection is the best.
+  auto seed = [&](const valhalla::Location& location, search_t& search, bool forward) {
+    std::vector<std::pair<uint32_t, float>> seeds;
+    bool has_other_edges = std::any_of(location.correlation().edges().begin(),
+                                       location.correlation().edges().end(),
+                                       [forward](const valhalla::PathEdge& e) {
+                                         return forward ? !e.end_node() : !e.begin_node();
+                                       });
+    for (const auto& edge : location.correlation().edges()) {
+      if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+        continue;
+      }
+      const GraphId edge_id(edge.graph_id());
+      const uint32_t vertex = graph_->vertex(edge_id);
+      graph_tile_ptr tile;
+      const DirectedEdge* directededge = graphreader.directededge(edge_id, tile);
+      if (vertex == ContractionGraph::kNoVertex || directededge == nullptr) {
+        continue;
+      }
+      uint8_t flow_sources;
+      const float remaining =
+          costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources).cost *
+          (1.0f - edge.percent_along());
+      seeds.emplace_back(vertex, edge.distance() + (forward ? remaining : -remaining));
+    }
+    float shift = 0.f;
+    for (const auto& seed : seeds) {
+      shift = std::max(shift, -seed.second);
+    }
+    for (const auto& seed : seeds) {
+      search.add(seed.first, kInvalidLabel, seed.second + shift);
+    }
+  };
+  seed(origin, forward_, true);
+  seed(destination, reverse_, false);
+
+  // Settle the cheaper of the two searches until neither can beat the best connection
+  float best_cost = std::numeric_limits<float>::infinity();
+  uint32_t best_forward = kInvalidLabel;
+  uint32_t best_reverse = kInvalidLabel;
+  size_t n = 0;
+  while (std::min(forward_.min_cost(), reverse_.min_cost()) < best_cost) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    const bool forward = forward_.min_cost() <= reverse_.min_cost();
+    const uint32_t idx =
+        forward ? Settle<ExpansionType::forward>() : Settle<ExpansionType::reverse>();
+    if (idx == kInvalidLabel) {
+      continue;
+    }
+    const auto& search = forward ? forward_ : reverse_;
+    const auto& other = forward ? reverse_ : forward_;
+    const uint32_t other_idx = other.find(search.labels[idx].vertex);
+    // an edge of both locations is a trivial route, which is not up to this algorithm
+    if (other_idx == kInvalidLabel || (search.labels[idx].predecessor == kInvalidLabel &&
+                                       other.labels[other_idx].predecessor == kInvalidLabel)) {
+      continue;
+    }
+    const float cost = search.labels[idx].cost + other.labels[other_idx].cost;
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_forward = forward ? idx : other_idx;
+      best_reverse = forward ? other_idx : idx;
+    }
+  }
+
+  std::vector<GraphId> path_edges;
+  if (best_forward == kInvalidLabel) {
+    return {};
+  }
+  if (!Unpack(best_forward, best_reverse, path_edges)) {
+    LOG_ERROR("Could not unpack the contraction hierarchy path");
+    return {};
+  }
+
+  // recost the edges like the other algorithms do, keeping the labels to check the restrictions
+  std::vector<PathInfo> path;
+  std::vector<PathEdgeLabel> labels;
+  path.reserve(path_edges.size());
+  labels.reserve(path_edges.size());
+  auto edge_itr = path_edges.begin();
+  const auto edge_cb = [&edge_itr, &path_edges]() {
+    return (edge_itr == path_edges.end()) ? GraphId{} : (*edge_itr++);
+  };
+  const auto label_cb = [&path, &labels](const PathEdgeLabel& label) {
+    path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost());
+    labels.push_back(label);
+  };
+  try {
+    sif::recost_forward(graphreader, *costing_, edge_cb, label_cb,
+                        find_percent_along(origin, path_edges.front()),
+                        find_percent_along(destination, path_edges.back()), TimeInfo::invalid(),
+                        false, true);
+  } catch (const std::exception& e) {
+    LOG_ERROR(std::string("Contraction hierarchy failed to recost final path: ") + e.what());
+    return {};
+  }
+
+  // complex restrictions span several edges, the arcs of the hierarchy don't know about them
+  for (size_t i = 0; i < labels.size(); ++i) {
+    has_ferry_ = has_ferry_ || labels[i].use() == Use::kFerry;
+    graph_tile_ptr tile;
+    const DirectedEdge* edge = graphreader.directededge(labels[i].edgeid(), tile);
+    if (i > 0 &&
+        costing_->Restricted(edge, labels[i - 1], labels, tile, labels[i].edgeid(), true)) {
+      LOG_DEBUG("Contraction hierarchy path breaks a complex restriction");
+      return {};
+    }
+  }
+  return {std::move(path)};
+}
+
+} // namespace thor
+} // namespace valhalla
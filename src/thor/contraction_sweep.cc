@@ -0,0 +1,209 @@
+#include "thor/contraction_sweep.h"
+#include "baldr/time_info.h"
+#include "sif/turns.h"
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// By default a matrix from a single source needs this many targets to be swept
+constexpr uint32_t kDefaultMinTargets = 100;
+
+// The sweep checks whether it should be aborted whenever it went over this many positions
+constexpr uint32_t kInterruptPositionsInterval = 65536;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionSweep::ContractionSweep(const boost::property_tree::ptree& config,
+                                   std::shared_ptr<const ContractionGraph> graph)
+    : graph_(std::move(graph)),
+      matrices_(config.get<bool>("contraction_sweep.matrices", false)),
+      min_targets_(config.get<uint32_t>("contraction_sweep.min_targets", kDefaultMinTargets)),
+      isochrones_(config.get<bool>("contraction_sweep.isochrones", false)),
+      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+      interrupt_(nullptr) {
+}
+
+bool ContractionSweep::CanSweep(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& origins,
+    const Options& options) const {
+  if (!graph_ || options.costing_type() != Costing::auto_ ||
+      std::any_of(origins.begin(), origins.end(),
+                  [](const valhalla::Location& origin) { return !origin.date_time().empty(); })) {
+    return false;
+  }
+  auto costing = options.costings().find(Costing::auto_);
+  return costing != options.costings().end() &&
+         ContractionGraph::fingerprint(costing->second.options()) == graph_->costing();
+}
+
+void ContractionSweep::Sweep(const google::protobuf::RepeatedPtrField<valhalla::Location>& origins,
+                             GraphReader& graphreader,
+                             const std::shared_ptr<DynamicCost>& costing) {
+  costing_ = costing;
+  reached_.assign(graph_->vertex_count(), kUnreached);
+  seeds_.clear();
+  origins_.clear();
+  for (const auto& origin : origins) {
+    Seed(origin, graphreader);
+  }
+  Run();
+}
+
+void ContractionSweep::Sweep(const valhalla::Location& origin,
+                             GraphReader& graphreader,
+                             const std::shared_ptr<DynamicCost>& costing) {
+  costing_ = costing;
+  reached_.assign(graph_->vertex_count(), kUnreached);
+  seeds_.clear();
+  origins_.clear();
+  Seed(origin, graphreader);
+  Run();
+}
+
+void ContractionSweep::Seed(const valhalla::Location& origin, GraphReader& graphreader) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges =
+      std::any_of(origin.correlation().edges().begin(), origin.correlation().edges().end(),
+                  [](const valhalla::PathEdge& e) { return !e.end_node(); });
+
+  for (const auto& edge : origin.correlation().edges()) {
+    GraphId edge_id(edge.graph_id());
+    if ((edge.end_node() && has_other_edges) ||
+        costing_->AvoidAsOriginEdge(edge_id, edge.percent_along())) {
+      continue;
+    }
+    graph_tile_ptr tile;
+    const DirectedEdge* directededge = graphreader.directededge(edge_id, tile);
+    if (directededge == nullptr) {
+      continue;
+    }
+
+    // the rest of the edge, penalized by the distance of the location from it like the other
+    // algorithms do
+    uint8_t flow_sources;
+    const float remaining = 1.0f - edge.percent_along();
+    const Cost cost =
+        costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources) * remaining;
+    const reached_t at_end{cost.cost + edge.distance(), cost.secs,
+                           static_cast<uint32_t>(directededge->length() * remaining)};
+    origins_.push_back({edge_id, edge.percent_along(), at_end});
+
+    // the vertices of the hierarchy are whole edges, the search starts on the ones turned onto
+    // so that the origin edge itself is only reached again by going around
+    for_each_turn(graphreader, *costing_, edge_id,
+                  [&](const GraphId& next_id, const DirectedEdge* next, const Cost& turn) {
+                    const uint32_t vertex = graph_->vertex(next_id);
+                    if (vertex == ContractionGraph::kNoVertex) {
+                      return;
+                    }
+                    const uint32_t position = graph_->sweep_position(vertex);
+                    const reached_t seed{at_end.cost + turn.cost, at_end.secs + turn.secs,
+                                         at_end.length + next->length()};
+                    if (seed.cost < reached_[position].cost) {
+                      reached_[position] = seed;
+                      seeds_.push_back(position);
+                    }
+                  });
+  }
+}
+
+void ContractionSweep::Run() {
+  // go up the hierarchy from the seeds, which only ever reaches a few hundred vertices
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  for (auto position : seeds_) {
+    queue.emplace(reached_[position].cost, position);
+  }
+  while (!queue.empty()) {
+    const auto entry = queue.top();
+    queue.pop();
+    const reached_t from = reached_[entry.second];
+    if (entry.first > from.cost) {
+      continue;
+    }
+    const uint32_t vertex = graph_->sweep_vertex(entry.second);
+    for (const auto* arc = graph_->up_begin(vertex); arc != graph_->up_end(vertex); ++arc) {
+      const uint32_t position = graph_->sweep_position(arc->vertex);
+      auto& to = reached_[position];
+      const float cost = from.cost + arc->cost;
+      if (cost < to.cost) {
+        to = {cost, from.secs + arc->secs, from.length + arc->length};
+        queue.emplace(cost, position);
+      }
+    }
+  }
+
+  // then down all of it, every vertex comes after those it has down arcs from so that they are
+  // final by the time it gets its turn
+  const uint32_t positions = size();
+  for (uint32_t position = 0; position < positions; ++position) {
+    if (interrupt_ && position % kInterruptPositionsInterval == 0) {
+      (*interrupt_)();
+    }
+    auto& to = reached_[position];
+    for (const auto* arc = graph_->sweep_begin(position); arc != graph_->sweep_end(position);
+         ++arc) {
+      const auto& from = reached_[arc->position];
+      const float cost = from.cost + arc->cost;
+      if (cost < to.cost) {
+        to = {cost, from.secs + arc->secs, from.length + arc->length};
+      }
+    }
+  }
+}
+
+ContractionSweep::reached_t ContractionSweep::Reach(const valhalla::PathEdge& edge,
+                                                    GraphReader& graphreader) const {
+  const GraphId edge_id(edge.graph_id());
+  graph_tile_ptr tile;
+  const DirectedEdge* directededge = graphreader.directededge(edge_id, tile);
+  if (directededge == nullptr) {
+    return kUnreached;
+  }
+
+  // over the whole edge or from an origin behind the point on the same edge
+  reached_t best = kUnreached;
+  const uint32_t vertex = graph_->vertex(edge_id);
+  if (vertex != ContractionGraph::kNoVertex) {
+    best = reached_[graph_->sweep_position(vertex)];
+  }
+  for (const auto& origin : origins_) {
+    if (origin.edge_id == edge_id && origin.percent_along <= edge.percent_along() &&
+        origin.reached.cost < best.cost) {
+      best = origin.reached;
+    }
+  }
+  if (best.cost == kUnreached.cost) {
+    return best;
+  }
+
+  // take off the part of the edge beyond the point
+  uint8_t flow_sources;
+  const float remaining = 1.0f - edge.percent_along();
+  const Cost cost =
+      costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources) * remaining;
+  const float length = static_cast<float>(best.length) - directededge->length() * remaining;
+  return {best.cost - cost.cost, best.secs - cost.secs,
+          static_cast<uint32_t>(std::max(length, 0.f))};
+}
+
+void ContractionSweep::Clear() {
+  if (clear_reserved_memory_) {
+    reached_ = {};
+  }
+  seeds_.clear();
+  origins_.clear();
+  costing_.reset();
+}
+
+} // namespace thor
+} // namespace valhalla
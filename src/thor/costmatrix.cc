@@ -8,7 +8,13 @@
 #include <robin_hood.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace valhalla::baldr;
@@ -21,6 +27,10 @@ constexpr uint32_t kMaxThreshold = std::numeric_limits<int>::max();
 constexpr uint32_t kMaxLocationReservation = 25; // the default config for max matrix locations
 constexpr uint32_t kMinIterations = 100;
 constexpr uint32_t kDefaultIterations = 2800;
+// Fewer locations per thread aren't worth handing around between the threads every iteration
+constexpr uint32_t kMinLocationsPerThread = 8;
+// How many labels a location settles in a row when its expansion runs on several threads
+constexpr uint32_t kDefaultExpansionBatch = 16;
 
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
@@ -53,19 +63,124 @@ namespace thor {
 
 class CostMatrix::ReachedMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
+// Threads expanding the locations of one direction along with the calling thread, which is
+// worker 0. The locations are handed out one at a time so the workers finish about together even
+// though some searches are much further along than others.
+class CostMatrix::WorkerPool {
+public:
+  explicit WorkerPool(const uint32_t thread_count) {
+    for (uint32_t worker = 1; worker < thread_count; ++worker) {
+      threads_.emplace_back(&WorkerPool::Work, this, worker);
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Calls the task with the worker and each index up to count and waits for all of them, the
+  // first exception a task throws is rethrown afterwards
+  void Run(const uint32_t count, const std::function<void(uint32_t, uint32_t)>& task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_ = 0;
+      error_ = nullptr;
+      busy_ = threads_.size();
+      ++round_;
+    }
+    start_.notify_all();
+    Drain(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+private:
+  void Work(const uint32_t worker) {
+    uint64_t round = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [this, round]() { return stop_ || round_ != round; });
+        if (stop_) {
+          return;
+        }
+        round = round_;
+      }
+      Drain(worker);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  void Drain(const uint32_t worker) {
+    for (uint32_t i = next_++; i < count_; i = next_++) {
+      try {
+        (*task_)(worker, i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(uint32_t, uint32_t)>* task_ = nullptr;
+  uint32_t count_ = 0;
+  std::atomic<uint32_t> next_{0};
+  size_t busy_ = 0;
+  uint64_t round_ = 0;
+  bool stop_ = false;
+  std::exception_ptr error_;
+};
+
 // Constructor with cost threshold.
-CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
+CostMatrix::CostMatrix(const boost::property_tree::ptree& config,
+                       const boost::property_tree::ptree& reader_config)
     : MatrixAlgorithm(config),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_bidir_dijkstras",
                                                       kInitialEdgeLabelCountBidirDijkstra)),
       max_reserved_locations_count_(
           config.get<uint32_t>("costmatrix.max_reserved_locations", kMaxLocationReservation)),
       check_reverse_connection_(config.get<bool>("costmatrix.check_reverse_connection", false)),
+      radix_heap_(config.get<bool>("costmatrix.radix_heap", false)),
       max_iterations_(std::max(config.get<uint32_t>("costmatrix.max_iterations", kDefaultIterations),
                                static_cast<uint32_t>(1))),
       access_mode_(kAutoAccess),
       mode_(travel_mode_t::kDrive), locs_count_{0, 0}, locs_remaining_{0, 0},
-      current_pathdist_threshold_(0), targets_{new ReachedMap}, sources_{new ReachedMap} {
+      current_pathdist_threshold_(0),
+      // without a config for their readers the locations are all expanded on the calling thread
+      thread_count_(reader_config.empty()
+                        ? 1
+                        : std::max(config.get<uint32_t>("costmatrix.threads", 1), 1u)),
+      // one label at a time on a single thread, on several the batch applies whether or not a
+      // request has enough locations for them so the result doesn't depend on it
+      expansion_batch_(
+          thread_count_ == 1
+              ? 1
+              : std::max(config.get<uint32_t>("costmatrix.expansion_batch", kDefaultExpansionBatch),
+                         1u)),
+      reader_config_(reader_config), deferring_(false), targets_{new ReachedMap},
+      sources_{new ReachedMap} {
 }
 
 CostMatrix::~CostMatrix() {
@@ -83,7 +198,19 @@ void CostMatrix::Clear() {
   // Resize and shrink_to_fit so all capacity is reduced.
   auto label_reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
   auto locs_reservation = clear_reserved_memory_ ? 0 : max_reserved_locations_count_;
+  // the locations of both directions share one budget for the edge status kept between requests,
+  // unless the arena keeps it for them. Splitting it evenly would leave each location less than a
+  // dense tile, so the locations keep all of theirs for as long as the budget lasts
+  size_t edge_status_budget = clear_reserved_memory_ ? 0 : max_reserved_edge_status_count_;
   for (const auto is_fwd : {MATRIX_FORW, MATRIX_REV}) {
+    // the arena keeps the memory of all locations for whichever search of the thread comes next
+    if (search_arena_) {
+      for (size_t i = 0; i < edgelabel_[is_fwd].size(); ++i) {
+        search_arena_->give_back(edgelabel_[is_fwd][i]);
+        search_arena_->give_back(adjacency_[is_fwd][i]);
+        search_arena_->give_back(edgestatus_[is_fwd][i]);
+      }
+    }
     // resize all relevant structures down to configured amount of locations (25 default)
     if (locs_count_[is_fwd] > locs_reservation) {
       edgelabel_[is_fwd].resize(locs_reservation);
@@ -103,6 +230,9 @@ void CostMatrix::Clear() {
       iter.clear();
     }
     for (auto& iter : edgestatus_[is_fwd]) {
+      const bool keep = iter.reserved() <= edge_status_budget;
+      edge_status_budget -= keep ? iter.reserved() : 0;
+      iter.set_max_reserved(keep ? iter.reserved() : 0);
       iter.clear();
     }
     for (auto& iter : adjacency_[is_fwd]) {
@@ -115,6 +245,26 @@ void CostMatrix::Clear() {
   best_connection_.clear();
   set_not_thru_pruning(true);
   ignore_hierarchy_limits_ = false;
+
+  // a request which failed half way may have left some deferred updates behind
+  deferring_ = false;
+  for (auto& deferred : deferred_) {
+    if (deferred.size() > locs_reservation) {
+      deferred.resize(locs_reservation);
+      deferred.shrink_to_fit();
+    }
+    for (auto& updates : deferred) {
+      updates = {};
+    }
+  }
+
+  // keep the readers of the worker threads in check just like the one of the thor worker
+  for (auto& reader : readers_) {
+    if (reader->OverCommitted()) {
+      reader->Trim();
+    }
+    reader->ReloadExtracts();
+  }
 }
 
 // Form a time distance matrix from the set of source locations
@@ -149,6 +299,17 @@ bool CostMatrix::SourceToTarget(Api& request,
   SetSources(graphreader, source_location_list, time_infos);
   SetTargets(graphreader, target_location_list);
 
+  // Start the worker threads and their graph readers the first time there are enough locations
+  // to go around
+  if (thread_count_ > 1 && !pool_ &&
+      std::max(locs_count_[MATRIX_FORW], locs_count_[MATRIX_REV]) >=
+          kMinLocationsPerThread * thread_count_) {
+    for (uint32_t worker = 1; worker < thread_count_; ++worker) {
+      readers_.emplace_back(new GraphReader(reader_config_));
+    }
+    pool_.reset(new WorkerPool(thread_count_));
+  }
+
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
@@ -158,76 +319,10 @@ bool CostMatrix::SourceToTarget(Api& request,
     // First iterate over all targets, then over all sources: we only for sure
     // check the connection between both trees on the forward search, so reverse
     // has to come first
-    for (uint32_t i = 0; i < locs_count_[MATRIX_REV]; i++) {
-      if (locs_status_[MATRIX_REV][i].threshold > 0) {
-        locs_status_[MATRIX_REV][i].threshold--;
-        Expand<MatrixExpansionType::reverse>(i, n, graphreader, request.options());
-        // if we exhausted this search
-        if (locs_status_[MATRIX_REV][i].threshold == 0) {
-          for (uint32_t source = 0; source < locs_count_[MATRIX_FORW]; source++) {
-            // update the target for each source's remaining targets, if it still exists
-            auto& targets = locs_status_[MATRIX_FORW][source].unfound_connections;
-            auto it = targets.find(i);
-            if (it != targets.end()) {
-              // remove the target so we don't come here again
-              targets.erase(it);
-              // if there's no more target and the current source has not exhausted
-              // we update the source's threshold so that it doesn't enter its outer "if" statement
-              // anymore
-              if (targets.empty() && locs_status_[MATRIX_FORW][source].threshold > 0) {
-                // TODO(nils): shouldn't we extend the search here similar to bidir A*
-                //   i.e. if pruning was disabled we extend the search in the other direction
-                locs_status_[MATRIX_FORW][source].threshold = -1;
-                if (locs_remaining_[MATRIX_FORW] > 0) {
-                  locs_remaining_[MATRIX_FORW]--;
-                }
-              }
-            }
-          }
-          // in any case make sure this was the last time we looked at this target
-          locs_status_[MATRIX_REV][i].threshold = -1;
-          if (locs_remaining_[MATRIX_REV] > 0) {
-            locs_remaining_[MATRIX_REV]--;
-          }
-        }
-      }
-    }
-
-    for (uint32_t i = 0; i < locs_count_[MATRIX_FORW]; i++) {
-      if (locs_status_[MATRIX_FORW][i].threshold > 0) {
-        locs_status_[MATRIX_FORW][i].threshold--;
-        Expand<MatrixExpansionType::forward>(i, n, graphreader, request.options(), time_infos[i],
-                                             invariant);
-        // if we exhausted this search
-        if (locs_status_[MATRIX_FORW][i].threshold == 0) {
-          for (uint32_t target = 0; target < locs_count_[MATRIX_REV]; target++) {
-            // if we still didn't find the connection between this pair
-            auto& sources = locs_status_[MATRIX_REV][target].unfound_connections;
-            auto it = sources.find(i);
-            if (it != sources.end()) {
-              // remove the source so we don't come here again
-              sources.erase(it);
-              // if there's no more sources and the current target has not exhausted
-              // we update the target's threshold so that it doesn't enter this outer "if" statement
-              // anymore
-              if (sources.empty() && locs_status_[MATRIX_REV][target].threshold > 0) {
-                // TODO(nils): shouldn't we extend the search here similar to bidir A*
-                //   i.e. if pruning was disabled we extend the search in the other direction
-                locs_status_[MATRIX_REV][target].threshold = -1;
-                if (locs_remaining_[MATRIX_REV] > 0) {
-                  locs_remaining_[MATRIX_REV]--;
-                }
-              }
-            }
-          }
-          // in any case make sure this was the last time we looked at this source
-          locs_status_[MATRIX_FORW][i].threshold = -1;
-          if (locs_remaining_[MATRIX_FORW] > 0) {
-            locs_remaining_[MATRIX_FORW]--;
-          }
-        }
-      }
-    }
+    ExpandLocations<MatrixExpansionType::reverse>(n, graphreader, request.options(), time_infos,
+                                                  invariant);
+    ExpandLocations<MatrixExpansionType::forward>(n, graphreader, request.options(), time_infos,
+                                                  invariant);
 
     // Break out when remaining sources and targets to expand are both 0
     if (locs_remaining_[MATRIX_FORW] == 0 && locs_remaining_[MATRIX_REV] == 0) {
@@ -337,7 +432,13 @@ void CostMatrix::Initialize(
     for (uint32_t i = 0; i < count; i++) {
       // Allocate the adjacency list and hierarchy limits for this source.
       // Use the cost threshold to size the adjacency list.
+      if (search_arena_) {
+        search_arena_->borrow(edgelabel_[is_fwd][i]);
+        search_arena_->borrow(adjacency_[is_fwd][i]);
+        search_arena_->borrow(edgestatus_[is_fwd][i]);
+      }
       edgelabel_[is_fwd][i].reserve(max_reserved_labels_count_);
+      edgestatus_[is_fwd][i].set_max_reserved(max_reserved_edge_status_count_);
       locs_status_[is_fwd].emplace_back(kMaxThreshold);
       hierarchy_limits_[is_fwd][i] = hlimits;
       // for each source/target init the other direction's astar heuristic
@@ -354,6 +455,7 @@ void CostMatrix::Initialize(
       // TODO(nils): previously we'd estimate the bucket range by the max matrix distance,
       // which would lead to tons of RAM if a high value was chosen in the config; ideally
       // this would be chosen based on the request (e.g. some factor to the A* distance)
+      adjacency_[is_fwd][i].use_radix_heap(radix_heap_);
       adjacency_[is_fwd][i].reuse(min_heuristic, range, bucketsize, &edgelabel_[is_fwd][i]);
     }
   }
@@ -405,6 +507,79 @@ void CostMatrix::Initialize(
   }
 }
 
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
+void CostMatrix::ExpandLocations(const uint32_t n,
+                                 baldr::GraphReader& graphreader,
+                                 const valhalla::Options& options,
+                                 const std::vector<baldr::TimeInfo>& time_infos,
+                                 const bool invariant) {
+  auto& locs_status = locs_status_[FORWARD];
+  // Each location settles a batch of labels in a row, which the other direction only gets to see
+  // in its next turn. The threads thus synchronize once per batch rather than once per label.
+  const auto expand = [&](const uint32_t i, baldr::GraphReader& reader) {
+    for (uint32_t k = 0; k < expansion_batch_ && locs_status[i].threshold > 0; ++k) {
+      locs_status[i].threshold--;
+      if (FORWARD) {
+        Expand<expansion_direction>(i, n, reader, options, time_infos[i], invariant);
+      } else {
+        Expand<expansion_direction>(i, n, reader, options);
+      }
+    }
+  };
+
+  // One location after the other if there aren't enough of them for the threads or if the
+  // expansion is tracked, its callback expects them in order
+  if (!pool_ || expansion_callback_ ||
+      locs_count_[FORWARD] < kMinLocationsPerThread * thread_count_) {
+    for (uint32_t i = 0; i < locs_count_[FORWARD]; i++) {
+      if (locs_status[i].threshold > 0) {
+        expand(i, graphreader);
+        // if we exhausted this search
+        if (locs_status[i].threshold == 0) {
+          ExhaustLocation(FORWARD, i);
+        }
+      }
+    }
+    return;
+  }
+
+  // Otherwise the threads expand them, each location only touches its own search and its own
+  // row/column of the best connections. Everything it changes for the other direction waits
+  // until all of them are done.
+  auto& deferred = deferred_[FORWARD];
+  deferred.resize(locs_count_[FORWARD]);
+  deferring_ = true;
+  pool_->Run(locs_count_[FORWARD], [&](const uint32_t worker, const uint32_t i) {
+    if (locs_status[i].threshold > 0) {
+      deferred[i].expanded = true;
+      expand(i, worker == 0 ? graphreader : *readers_[worker - 1]);
+    }
+  });
+  deferring_ = false;
+
+  // Then it's applied in the order of the locations, just like they'd have been expanded one
+  // after the other
+  auto& reached = FORWARD ? *sources_ : *targets_;
+  for (uint32_t i = 0; i < locs_count_[FORWARD]; i++) {
+    auto& updates = deferred[i];
+    if (!updates.expanded) {
+      continue;
+    }
+    for (const auto& connection : updates.connections) {
+      RemoveConnection(!FORWARD, connection.first, i, connection.second);
+    }
+    for (const auto& edgeid : updates.reached) {
+      reached[edgeid].push_back(i);
+    }
+    if (locs_status[i].threshold == 0) {
+      ExhaustLocation(FORWARD, i);
+    }
+    updates.expanded = false;
+    updates.connections.clear();
+    updates.reached.clear();
+  }
+}
+
 template <const MatrixExpansionType expansion_direction, const bool FORWARD>
 bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
                              const uint32_t index,
@@ -416,15 +591,22 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
                              uint32_t& shortcuts,
                              const graph_tile_ptr& tile,
                              const baldr::TimeInfo& time_info) {
+  // Use the hot edge columns for the first checks if the tile has them
+  const auto& hot_edges = tile->hot_edges();
+  const uint32_t edge_idx = meta.edge_id.id();
+
   // Skip if this is a regular edge superseded by a shortcut.
-  if (shortcuts & meta.edge->superseded()) {
+  if (shortcuts & (hot_edges.empty() ? meta.edge->superseded() : hot_edges.superseded(edge_idx))) {
     return false;
   }
 
   graph_tile_ptr t2 = nullptr;
   baldr::GraphId opp_edge_id;
-  const auto get_opp_edge_data = [&t2, &opp_edge_id, &graphreader, &meta, &tile]() {
-    t2 = meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
+  const auto get_opp_edge_data = [&]() {
+    t2 = (hot_edges.empty() ? meta.edge->leaves_tile() : hot_edges.leaves_tile(edge_idx))
+             ? graphreader.GetGraphTile(hot_edges.empty() ? meta.edge->endnode()
+                                                          : hot_edges.endnode(edge_idx))
+             : tile;
     if (t2 == nullptr) {
       return false;
     }
@@ -433,7 +615,7 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
     return true;
   };
 
-  if (meta.edge->is_shortcut()) {
+  if (hot_edges.empty() ? meta.edge->is_shortcut() : hot_edges.is_shortcut(edge_idx)) {
     // Skip shortcuts if hierarchy limits are disabled or the opposing tile doesn't exist
     if (ignore_hierarchy_limits_ || !get_opp_edge_data())
       return false;
@@ -443,7 +625,7 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
     // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
     // edge superseded by a shortcut.
     if (StopExpanding(hierarchy_limits_[FORWARD][index][meta.edge_id.level() + 1])) {
-      shortcuts |= meta.edge->shortcut();
+      shortcuts |= hot_edges.empty() ? meta.edge->shortcut() : hot_edges.shortcut(edge_idx);
     } else {
       return false;
     }
@@ -462,7 +644,8 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
     // Check the access mode and skip this edge if access is not allowed in the reverse
     // direction. This avoids the (somewhat expensive) retrieval of the opposing directed
     // edge when no access is allowed in the reverse direction.
-    if (!(meta.edge->reverseaccess() & access_mode_)) {
+    if (!((hot_edges.empty() ? meta.edge->reverseaccess() : hot_edges.reverseaccess(edge_idx)) &
+          access_mode_)) {
       return false;
     }
 
@@ -569,7 +752,9 @@ bool CostMatrix::ExpandInner(baldr::GraphReader& graphreader,
   adj.add(idx);
 
   // mark the edge as settled for the connection check
-  if (!FORWARD) {
+  if (deferring_ && (!FORWARD || check_reverse_connection_)) {
+    deferred_[FORWARD][index].reached.push_back(meta.edge_id);
+  } else if (!FORWARD) {
     (*targets_)[meta.edge_id].push_back(index);
   } else if (check_reverse_connection_) {
     (*sources_)[meta.edge_id].push_back(index);
@@ -602,9 +787,9 @@ bool CostMatrix::Expand(const uint32_t index,
     // extend searches more than we need to
     for (uint32_t st = 0; st < locs_count_[!FORWARD]; st++) {
       if (FORWARD) {
-        UpdateStatus(index, st);
+        UpdateStatus<expansion_direction>(index, st);
       } else {
-        UpdateStatus(st, index);
+        UpdateStatus<expansion_direction>(st, index);
       }
     }
     locs_status_[FORWARD][index].threshold = 0;
@@ -653,6 +838,9 @@ bool CostMatrix::Expand(const uint32_t index,
   }
   const NodeInfo* nodeinfo = tile->node(node);
 
+  // Let the reader load the tiles our frontier is heading into in the background
+  graphreader.PrefetchNeighbors(node);
+
   // set the time info
   auto seconds_offset = invariant ? 0.f : pred.cost().secs;
   auto offset_time = FORWARD
@@ -691,6 +879,8 @@ bool CostMatrix::Expand(const uint32_t index,
   bool disable_uturn = false;
   EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus);
   EdgeMetadata uturn_meta{};
+  // the u-turn is found in the hot edge columns (if the tile has them) without touching the edges
+  const auto& hot_edges = tile->hot_edges();
 
   // Expand from end node in <expansion_direction> direction.
   for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++meta) {
@@ -699,7 +889,9 @@ bool CostMatrix::Expand(const uint32_t index,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    const bool is_uturn = pred.opp_local_idx() == meta.edge->localedgeidx();
+    const uint32_t local_idx = hot_edges.empty() ? meta.edge->localedgeidx()
+                                                 : hot_edges.localedgeidx(meta.edge_id.id());
+    const bool is_uturn = pred.opp_local_idx() == local_idx;
     uturn_meta = is_uturn ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
@@ -804,8 +996,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
     // If we came down here, we know this opposing edge is either settled, or it's a
     // target correlated edge which hasn't been pulled out of the queue yet, so a path
     // has been found to the end node of this directed edge
+    // The targets' edge status is shared with the other sources, don't touch it
     const auto& rev_edgestate = edgestatus_[MATRIX_REV][target];
-    EdgeStatusInfo rev_edgestatus = rev_edgestate.Get(rev_edgeid);
+    EdgeStatusInfo rev_edgestatus = rev_edgestate.GetShared(rev_edgeid);
     const auto& fwd_edgelabels = edgelabel_[MATRIX_FORW][source];
     const auto& rev_edgelabels = edgelabel_[MATRIX_REV][target];
     uint32_t rev_predidx = rev_edgelabels[rev_edgestatus.index()].predecessor();
@@ -839,7 +1032,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
       // Update status and update threshold if this is the last location
       // to find for this source or target
-      UpdateStatus(source, target);
+      UpdateStatus<MatrixExpansionType::forward>(source, target);
     } else {
       // at this point, the found connection might still be somewhat trivial:
       // the connecting edge might be an initial edge for either the given source or target
@@ -868,7 +1061,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus<MatrixExpansionType::forward>(source, target);
       }
     }
     // setting this edge as connected
@@ -927,7 +1120,8 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 
     // If this edge has been reached then a shortest path has been found
     // to the end node of this directed edge.
-    EdgeStatusInfo fwd_edgestatus = edgestatus_[MATRIX_FORW][source].Get(fwd_edgeid);
+    // The sources' edge status is shared with the other targets, don't touch it
+    EdgeStatusInfo fwd_edgestatus = edgestatus_[MATRIX_FORW][source].GetShared(fwd_edgeid);
     if (fwd_edgestatus.set() != EdgeSet::kUnreachedOrReset) {
       const auto& fwd_edgelabels = edgelabel_[MATRIX_FORW][source];
       const auto& rev_edgelabels = edgelabel_[MATRIX_REV][target];
@@ -960,7 +1154,7 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 
         // Update status and update threshold if this is the last location
         // to find for this source or target
-        UpdateStatus(source, target);
+        UpdateStatus<MatrixExpansionType::reverse>(source, target);
       } else {
         // at this point, the found connection might still be somewhat trivial:
         // the connecting edge might be an initial edge for either the given source or target
@@ -991,7 +1185,7 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 
           // Update status and update threshold if this is the last location
           // to find for this source or target
-          UpdateStatus(source, target);
+          UpdateStatus<MatrixExpansionType::reverse>(source, target);
         }
       }
       // setting this edge as connected
@@ -1011,36 +1205,64 @@ void CostMatrix::CheckReverseConnections(const uint32_t target,
 }
 
 // Update status when a connection is found.
+template <const MatrixExpansionType expansion_direction, const bool FORWARD>
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
-  auto& s = locs_status_[MATRIX_FORW][source].unfound_connections;
-  auto it = s.find(target);
-  if (it != s.end()) {
-    s.erase(it);
-    if (s.empty() && locs_status_[MATRIX_FORW][source].threshold > 0) {
-      // At least 1 connection has been found to each target for this source.
-      // Set a threshold to continue search for a limited number of times.
-      locs_status_[MATRIX_FORW][source].threshold =
-          GetThreshold(mode_,
-                       edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size(),
-                       max_iterations_);
+  const uint32_t label_count =
+      edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size();
+  const uint32_t index = FORWARD ? source : target;
+  const uint32_t other_index = FORWARD ? target : source;
+
+  // Remove the other location from the status of the expanding one and vice versa, unless the
+  // other one's status is shared with the locations expanding in parallel
+  RemoveConnection(FORWARD, index, other_index, label_count);
+  if (deferring_) {
+    deferred_[FORWARD][index].connections.emplace_back(other_index, label_count);
+  } else {
+    RemoveConnection(!FORWARD, other_index, index, label_count);
+  }
+}
+
+void CostMatrix::RemoveConnection(const bool is_fwd,
+                                  const uint32_t index,
+                                  const uint32_t other_index,
+                                  const uint32_t label_count) {
+  auto& status = locs_status_[is_fwd][index];
+  auto it = status.unfound_connections.find(other_index);
+  if (it != status.unfound_connections.end()) {
+    status.unfound_connections.erase(it);
+    if (status.unfound_connections.empty() && status.threshold > 0) {
+      // At least 1 connection has been found to each location of the other direction for this
+      // location. Set a threshold to continue search for a limited number of times.
+      status.threshold = GetThreshold(mode_, label_count, max_iterations_);
     }
   }
+}
 
-  // Remove the source from the target status
-  auto& t = locs_status_[MATRIX_REV][target].unfound_connections;
-  it = t.find(source);
-  if (it != t.end()) {
-    t.erase(it);
-    if (t.empty() && locs_status_[MATRIX_REV][target].threshold > 0) {
-      // At least 1 connection has been found to each source for this target.
-      // Set a threshold to continue search for a limited number of times.
-      locs_status_[MATRIX_REV][target].threshold =
-          GetThreshold(mode_,
-                       edgelabel_[MATRIX_FORW][source].size() + edgelabel_[MATRIX_REV][target].size(),
-                       max_iterations_);
+void CostMatrix::ExhaustLocation(const bool is_fwd, const uint32_t index) {
+  for (uint32_t other_index = 0; other_index < locs_count_[!is_fwd]; other_index++) {
+    // if we still didn't find the connection between this pair
+    auto& other = locs_status_[!is_fwd][other_index];
+    auto it = other.unfound_connections.find(index);
+    if (it != other.unfound_connections.end()) {
+      // remove the location so we don't come here again
+      other.unfound_connections.erase(it);
+      // if there's no more locations and the other location has not exhausted we update
+      // its threshold so that it isn't expanded anymore
+      if (other.unfound_connections.empty() && other.threshold > 0) {
+        // TODO(nils): shouldn't we extend the search here similar to bidir A*
+        //   i.e. if pruning was disabled we extend the search in the other direction
+        other.threshold = -1;
+        if (locs_remaining_[!is_fwd] > 0) {
+          locs_remaining_[!is_fwd]--;
+        }
+      }
     }
   }
+  // in any case make sure this was the last time we looked at this location
+  locs_status_[is_fwd][index].threshold = -1;
+  if (locs_remaining_[is_fwd] > 0) {
+    locs_remaining_[is_fwd]--;
+  }
 }
 
 // Sets the source/origin locations. Search expands forward from these
@@ -44,11 +44,27 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
     : mode_(travel_mode_t::kDrive), access_mode_(kAutoAccess),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
-      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)), multipath_(false) {
+      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+      max_reserved_edge_status_count_(clear_reserved_memory_
+                                          ? 0
+                                          : config.get<size_t>("max_reserved_edge_status_count",
+                                                               kMaxReservedEdgeStatusCount)),
+      radix_heap_(config.get<bool>("dijkstras.radix_heap", false)), multipath_(false) {
+  edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
+  // the arena keeps the memory for whichever search of the thread comes next
+  if (search_arena_) {
+    search_arena_->give_back(bdedgelabels_);
+    search_arena_->give_back(mmedgelabels_);
+    search_arena_->give_back(adjacencylist_);
+    search_arena_->give_back(mmadjacencylist_);
+    search_arena_->give_back(edgestatus_);
+    return;
+  }
+
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
   auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
@@ -72,25 +88,34 @@ void Dijkstras::Clear() {
 // edgelabels
 template <typename label_container_t>
 void Dijkstras::Initialize(label_container_t& labels,
-                           baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                           baldr::AdjacencyList<typename label_container_t::value_type>& queue,
                            const uint32_t bucket_size) {
   // Set aside some space for edge labels
   uint32_t edge_label_reservation;
   uint32_t bucket_count;
   GetExpansionHints(bucket_count, edge_label_reservation);
+
+  // Take over the memory an earlier search of the thread gave back
+  if (search_arena_) {
+    search_arena_->borrow(labels);
+    search_arena_->borrow(queue);
+    search_arena_->borrow(edgestatus_);
+    edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
+  }
   labels.reserve(max_reserved_labels_count_);
 
   // Set up lambda to get sort costs
   float range = bucket_count * bucket_size;
+  queue.use_radix_heap(radix_heap_);
   queue.reuse(0.0f, range, bucket_size, &labels);
 }
 template void
 Dijkstras::Initialize<decltype(Dijkstras::bdedgelabels_)>(decltype(Dijkstras::bdedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::BDEdgeLabel>&,
+                                                          baldr::AdjacencyList<sif::BDEdgeLabel>&,
                                                           const uint32_t);
 template void
 Dijkstras::Initialize<decltype(Dijkstras::mmedgelabels_)>(decltype(Dijkstras::mmedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::MMEdgeLabel>&,
+                                                          baldr::AdjacencyList<sif::MMEdgeLabel>&,
                                                           const uint32_t);
 
 // Initializes the time of the expansion if there is one
@@ -124,6 +149,9 @@ void Dijkstras::ExpandInner(baldr::GraphReader& graphreader,
     return;
   }
 
+  // Let the reader load the tiles our frontier is heading into in the background
+  graphreader.PrefetchNeighbors(node);
+
   // Get the nodeinfo
   const NodeInfo* nodeinfo = tile->node(node);
 
@@ -426,6 +454,9 @@ void Dijkstras::ExpandForwardMultiModal(GraphReader& graphreader,
     return;
   }
 
+  // Let the reader load the tiles our frontier is heading into in the background
+  graphreader.PrefetchNeighbors(node);
+
   // Get the nodeinfo
   const NodeInfo* nodeinfo = tile->node(node);
 
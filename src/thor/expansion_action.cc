@@ -168,7 +168,7 @@ std::string thor_worker_t::expansion(Api& request) {
     alg->set_track_expansion(track_expansion);
   }
   for (auto* alg : std::vector<MatrixAlgorithm*>{&costmatrix_, &time_distance_matrix_,
-                                                 &time_distance_bss_matrix_}) {
+                                                 &time_distance_bss_matrix_, &bucket_matrix_}) {
     alg->set_track_expansion(track_expansion);
   }
   isochrone_gen.SetInnerExpansionCallback(track_expansion);
@@ -202,6 +202,7 @@ std::string thor_worker_t::expansion(Api& request) {
     alg->set_track_expansion(nullptr);
   }
   costmatrix_.set_track_expansion(nullptr);
+  bucket_matrix_.set_track_expansion(nullptr);
   isochrone_gen.SetInnerExpansionCallback(nullptr);
 
   // serialize it
@@ -1,5 +1,6 @@
 #include "thor/isochrone.h"
 #include "baldr/datetime.h"
+#include "baldr/time_info.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 
@@ -48,7 +49,7 @@ namespace thor {
 
 // Default constructor
 Isochrone::Isochrone(const boost::property_tree::ptree& config)
-    : Dijkstras(config), shape_interval_(50.0f) {
+    : Dijkstras(config), shape_interval_(50.0f), contraction_sweep_(nullptr) {
 }
 
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
@@ -177,8 +178,15 @@ std::shared_ptr<const GriddedData<2>> Isochrone::Expand(const ExpansionType& exp
                                                         const travel_mode_t mode) {
   // Initialize and create the isotile
   ConstructIsoTile(expansion_type == ExpansionType::multimodal, api, mode);
-  // Compute the expansion
-  Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+  // Sweep the contraction hierarchy if there is one for the request, otherwise compute the
+  // expansion
+  if (contraction_sweep_ && contraction_sweep_->isochrones() &&
+      expansion_type == ExpansionType::forward && !inner_expansion_callback_ &&
+      contraction_sweep_->CanSweep(api.options().locations(), api.options())) {
+    SweepIsoTile(api, reader, mode_costing[static_cast<uint32_t>(mode)]);
+  } else {
+    Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+  }
   return isotile_;
 }
 
@@ -226,32 +234,44 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
   // Get the DirectedEdge because we'll need its shape
   graph_tile_ptr tile = graphreader.GetGraphTile(pred.edgeid().Tile_Base());
   const DirectedEdge* edge = tile->directededge(pred.edgeid());
+  PointLL ll0 = t2 ? tile->get_node_ll(t2->directededge(opp)->endnode()) : ll;
+
+  // Get the time and distance at the end node of the predecessor
+  UpdateIsoTile(tile, edge, ll0, ll, pred.origin(), secs0, dist0, pred.cost().secs,
+                static_cast<float>(pred.path_distance()));
+}
 
+void Isochrone::UpdateIsoTile(const graph_tile_ptr& tile,
+                              const DirectedEdge* edge,
+                              const PointLL& ll0,
+                              const PointLL& ll1,
+                              const bool origin,
+                              const float secs0,
+                              const float dist0,
+                              const float secs1,
+                              const float dist1) {
   // Transit lines and ferries can't really be "reached" you really just
   // pass through those cells.
   if (edge->IsTransitLine() || edge->use() == Use::kFerry) {
     return;
   }
 
-  // Get the time and distance at the end node of the predecessor
-  float secs1 = pred.cost().secs;
-  float dist1 = static_cast<float>(pred.path_distance());
-
   // For short edges just mark the segment between the 2 nodes of the edge. This
   // avoid getting the shape for short edges.
-  auto len = pred.origin() ? pred.path_distance() : edge->length();
+  const float origin_length = dist1 - dist0;
+  auto len = origin ? origin_length : edge->length();
   if (len < shape_interval_ * 1.5f) {
-    PointLL ll0 = tile->get_node_ll(t2->directededge(opp)->endnode());
-    if (pred.origin()) {
-      // interpolate ll0 for origin edge using edge_label.path_distance()
+    PointLL from = ll0;
+    if (origin) {
+      // interpolate the start for origin edge using the length ahead of the origin
       auto edge_info = tile->edgeinfo(edge);
       const auto& shape = edge_info.shape();
       const auto& ordered_shape =
           edge->forward() ? shape : std::vector<midgard::PointLL>(shape.rbegin(), shape.rend());
-      auto origin_edge_shape = OriginEdgeShape(ordered_shape, pred.path_distance());
-      ll0 = origin_edge_shape.front();
+      auto origin_edge_shape = OriginEdgeShape(ordered_shape, origin_length);
+      from = origin_edge_shape.front();
     }
-    UpdateIsoTileAlongSegment(ll0, ll, secs1, dist1);
+    UpdateIsoTileAlongSegment(from, ll1, secs1, dist1);
     return;
   }
 
@@ -265,8 +285,8 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
   if (!edge->forward()) {
     std::reverse(resampled.begin(), resampled.end());
   }
-  if (pred.origin()) {
-    resampled = OriginEdgeShape(resampled, pred.path_distance());
+  if (origin) {
+    resampled = OriginEdgeShape(resampled, origin_length);
   }
 
   // Mark grid cells along the shape if time is less than what is
@@ -285,6 +305,54 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
   }
 }
 
+void Isochrone::SweepIsoTile(Api& api,
+                             GraphReader& graphreader,
+                             const std::shared_ptr<DynamicCost>& costing) {
+  contraction_sweep_->Sweep(api.options().locations(), graphreader, costing);
+
+  // the part of the origin edges ahead of the locations
+  graph_tile_ptr tile;
+  for (const auto& origin : contraction_sweep_->origins()) {
+    const DirectedEdge* edge = graphreader.directededge(origin.edge_id, tile);
+    graph_tile_ptr end_tile = graphreader.GetGraphTile(edge->endnode());
+    if (end_tile == nullptr) {
+      continue;
+    }
+    const PointLL ll1 = end_tile->get_node_ll(edge->endnode());
+    UpdateIsoTile(tile, edge, ll1, ll1, true, 0.f, 0.f, origin.reached.secs,
+                  static_cast<float>(origin.reached.length));
+  }
+
+  // and every edge whose start is within the contours, like the expansion would prune them
+  for (uint32_t position = 0; position < contraction_sweep_->size(); ++position) {
+    const auto& reached = contraction_sweep_->reached(position);
+    if (reached.cost == std::numeric_limits<float>::infinity()) {
+      continue;
+    }
+    const GraphId edge_id = contraction_sweep_->edge(position);
+    const DirectedEdge* edge = graphreader.directededge(edge_id, tile);
+    if (edge == nullptr) {
+      continue;
+    }
+    uint8_t flow_sources;
+    const float secs0 =
+        reached.secs - costing->EdgeCost(edge, tile, TimeInfo::invalid(), flow_sources).secs;
+    const float dist0 = static_cast<float>(reached.length) - edge->length();
+    if (secs0 > max_seconds_ && dist0 > max_meters_) {
+      continue;
+    }
+    graph_tile_ptr t2;
+    const GraphId opp = graphreader.GetOpposingEdgeId(edge_id, t2);
+    graph_tile_ptr end_tile = graphreader.GetGraphTile(edge->endnode());
+    if (t2 == nullptr || end_tile == nullptr) {
+      continue;
+    }
+    UpdateIsoTile(tile, edge, tile->get_node_ll(t2->directededge(opp)->endnode()),
+                  end_tile->get_node_ll(edge->endnode()), false, secs0, dist0, reached.secs,
+                  static_cast<float>(reached.length));
+  }
+}
+
 // here we mark the cells of the isochrone along the edge we just reached up to its end node
 void Isochrone::ExpandingNode(baldr::GraphReader& graphreader,
                               graph_tile_ptr tile,
@@ -1,6 +1,7 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancebssmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -28,6 +29,20 @@ const std::string get_unfound_indices(const google::protobuf::RepeatedField<bool
 }
 
 constexpr uint32_t kCostMatrixThreshold = 5;
+// from about this many sources and targets on the bucket matrix beats searching all of them at once
+constexpr uint32_t kBucketMatrixThreshold = 100;
+
+// the bounding box around all sources and targets
+AABB2<PointLL> locations_bbox(const valhalla::Options& options) {
+  std::vector<PointLL> points;
+  points.reserve(options.sources_size() + options.targets_size());
+  for (const auto& locations : {&options.sources(), &options.targets()}) {
+    for (const auto& location : *locations) {
+      points.emplace_back(location.ll().lng(), location.ll().lat());
+    }
+  }
+  return AABB2<PointLL>(points);
+}
 } // namespace
 
 namespace valhalla {
@@ -57,6 +72,20 @@ thor_worker_t::get_matrix_algorithm(Api& request, const bool has_time, const std
           config_algo = Matrix::TimeDistanceMatrix;
           break;
         default:
+          // A single source with many targets sweeps the contraction hierarchy, which the time
+          // distance matrix does for it. Use the bucket matrix if number of sources and number
+          // of targets are both large
+          if (contraction_sweep.matrices() && request.options().sources().size() == 1 &&
+              static_cast<uint32_t>(request.options().targets().size()) >=
+                  contraction_sweep.min_targets() &&
+              contraction_sweep.CanSweep(request.options().sources(), request.options())) {
+            config_algo = Matrix::TimeDistanceMatrix;
+          } else if (static_cast<uint32_t>(request.options().sources().size()) >=
+                         kBucketMatrixThreshold &&
+                     static_cast<uint32_t>(request.options().targets().size()) >=
+                         kBucketMatrixThreshold) {
+            config_algo = Matrix::BucketMatrix;
+          }
           break;
       }
       break;
@@ -65,6 +94,9 @@ thor_worker_t::get_matrix_algorithm(Api& request, const bool has_time, const std
     case TIME_DISTANCE_MATRIX:
       config_algo = Matrix::TimeDistanceMatrix;
       break;
+    case BUCKET_MATRIX:
+      config_algo = Matrix::BucketMatrix;
+      break;
   }
 
   // similar to routing: prefer the exact unidirectional algo if not requested otherwise
@@ -80,6 +112,9 @@ thor_worker_t::get_matrix_algorithm(Api& request, const bool has_time, const std
       add_warning(request, 301);
     }
     return &costmatrix_;
+  } else if (config_algo == Matrix::BucketMatrix) {
+    // the bucket matrix is time independent, requests with a time never get here
+    return &bucket_matrix_;
   } else {
     // if this happens, the server config only allows for timedist matrix
     if (has_time && request.options().prioritize_bidirectional()) {
@@ -106,6 +141,7 @@ std::string thor_worker_t::matrix(Api& request) {
            &costmatrix_,
            &time_distance_matrix_,
            &time_distance_bss_matrix_,
+           &bucket_matrix_,
        }) {
     alg->set_interrupt(interrupt);
     alg->set_has_time(has_time);
@@ -121,14 +157,18 @@ std::string thor_worker_t::matrix(Api& request) {
   }
   LOG_INFO("matrix::" + std::string(algo->name()));
 
+  // with a cold cache its much faster to read all the tiles we'll likely need in one batch than
+  // to read them one by one as the expansion reaches them. this is a noop unless configured
+  reader->LoadTiles(locations_bbox(options));
+
   // TODO(nils): TDMatrix doesn't care about either destonly or no_thru
-  if (algo->name() != "costmatrix") {
+  if (algo->name() != "costmatrix" && algo->name() != "bucketmatrix") {
     algo->SourceToTarget(request, *reader, mode_costing, mode,
                          max_matrix_distance.find(costing)->second);
     return tyr::serializeMatrix(request);
   }
 
-  // for costmatrix try a second pass if the first didn't work out
+  // for costmatrix and bucketmatrix try a second pass if the first didn't work out
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
   cost->set_allow_destination_only(false);
   cost->set_pass(0);
@@ -0,0 +1,301 @@
+#include "thor/multilevel_dijkstra.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "sif/edgelabel.h"
+#include "sif/recost.h"
+#include "sif/turns.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr uint32_t kNoVertex = PartitionOverlay::kNoVertex;
+
+inline float find_percent_along(const valhalla::Location& location, const GraphId& edge_id) {
+  for (const auto& e : location.correlation().edges()) {
+    if (e.graph_id() == edge_id)
+      return e.percent_along();
+  }
+  throw std::logic_error("Could not find candidate edge for the location");
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+MultiLevelDijkstra::MultiLevelDijkstra(const boost::property_tree::ptree& config,
+                                       const std::string& file_name,
+                                       const boost::property_tree::ptree& reader_config)
+    : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
+                                         kInitialEdgeLabelCountDijkstras),
+                    config.get<bool>("clear_reserved_memory", false)),
+      customizer_(OverlayCustomizer::get(file_name, config, reader_config)),
+      metric_wait_(config.get<uint32_t>("overlay_metric_wait", 0)) {
+  if (customizer_) {
+    overlay_ = customizer_->overlay();
+  }
+}
+
+void MultiLevelDijkstra::Clear() {
+  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
+  if (labels_.size() > reservation) {
+    labels_.resize(reservation);
+    labels_.shrink_to_fit();
+  }
+  labels_.clear();
+  reached_.clear();
+  queue_ = {};
+  location_cells_.clear();
+  has_ferry_ = false;
+}
+
+bool MultiLevelDijkstra::CanRoute(const valhalla::Location& origin,
+                                  const valhalla::Location& destination,
+                                  const Options& options) const {
+  if (!overlay_ || options.alternates() > 0 || !origin.date_time().empty() ||
+      !destination.date_time().empty()) {
+    return false;
+  }
+  switch (options.costing_type()) {
+    case Costing::none_:
+    case Costing::multimodal:
+    case Costing::transit:
+    case Costing::bikeshare:
+      return false;
+    default:
+      break;
+  }
+  auto costing = options.costings().find(options.costing_type());
+  return costing != options.costings().end() && costing->second.options().exclude_edges().empty() &&
+         customizer_->Get(costing->second, metric_wait_) != nullptr;
+}
+
+uint8_t MultiLevelDijkstra::QueryLevel(const uint32_t vertex) const {
+  for (uint8_t level = 0; level < location_cells_.size(); ++level) {
+    const auto& cells = location_cells_[level];
+    if (std::find(cells.begin(), cells.end(), overlay_->cell(level, vertex)) != cells.end()) {
+      return level;
+    }
+  }
+  return static_cast<uint8_t>(location_cells_.size());
+}
+
+void MultiLevelDijkstra::Add(const uint32_t vertex,
+                             const uint32_t predecessor,
+                             const float cost,
+                             const uint8_t clique) {
+  auto inserted = reached_.emplace(vertex, static_cast<uint32_t>(labels_.size()));
+  if (inserted.second) {
+    labels_.push_back({vertex, predecessor, cost, clique});
+  } else {
+    auto& label = labels_[inserted.first->second];
+    if (cost >= label.cost) {
+      return;
+    }
+    label.predecessor = predecessor;
+    label.cost = cost;
+    label.clique = clique;
+  }
+  queue_.emplace(cost, inserted.first->second);
+}
+
+std::vector<std::vector<PathInfo>>
+MultiLevelDijkstra::GetBestPath(valhalla::Location& origin,
+                                valhalla::Location& destination,
+                                GraphReader& graphreader,
+                                const sif::mode_costing_t& mode_costing,
+                                const sif::TravelMode mode,
+                                const Options& options) {
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+  auto costing_options = options.costings().find(options.costing_type());
+  if (!overlay_ || costing_options == options.costings().end()) {
+    return {};
+  }
+
+  // the metric might have made room for others since CanRoute(), then the other algorithms take
+  // over
+  const auto metric = customizer_->Get(costing_options->second);
+  if (!metric) {
+    return {};
+  }
+
+  // The metrics have no turns onto destination-only edges from other edges, like the first pass of
+  // bidirectional A*. Routes from or to such an area are left to bidirectional A*, which allows
+  // them around the locations.
+  auto destonly = [&](const valhalla::Location& location) {
+    return std::any_of(location.correlation().edges().begin(),
+                       location.correlation().edges().end(), [&](const valhalla::PathEdge& edge) {
+                         graph_tile_ptr tile;
+                         const auto* directededge =
+                             graphreader.directededge(GraphId(edge.graph_id()), tile);
+                         return directededge != nullptr &&
+                                (directededge->destonly() ||
+                                 (costing_->is_hgv() && directededge->destonly_hgv()));
+                       });
+  };
+  if (destonly(origin) || destonly(destination)) {
+    return {};
+  }
+
+  // the turns the costing allows between the edges of the overlay
+  size_t n = 0;
+  const OverlayMetric::turns_t turns = [&](const uint32_t vertex,
+                                           const OverlayMetric::turn_cb_t& turn_cb) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+    for_each_turn(graphreader, *costing_, overlay_->edge(vertex),
+                  [&](const GraphId& edge_id, const DirectedEdge*, const Cost& cost) {
+                    const uint32_t to = overlay_->vertex(edge_id);
+                    if (to != kNoVertex) {
+                      turn_cb(to, cost.cost);
+                    }
+                  });
+  };
+  // The search starts from the part of the origin edges the path uses and ends on the part of the
+  // destination edges it uses, which the labels of the destination edges include all of
+  location_cells_.assign(overlay_->level_count(), {});
+  auto add_cells = [this](const uint32_t vertex) {
+    for (uint8_t level = 0; level < location_cells_.size(); ++level) {
+      location_cells_[level].push_back(overlay_->cell(level, vertex));
+    }
+  };
+  auto remaining = [&](const valhalla::PathEdge& edge, uint32_t& vertex) -> float {
+    const GraphId edge_id(edge.graph_id());
+    vertex = overlay_->vertex(edge_id);
+    graph_tile_ptr tile;
+    const DirectedEdge* directededge = graphreader.directededge(edge_id, tile);
+    if (vertex == kNoVertex || directededge == nullptr ||
+        !costing_->Allowed(directededge, tile, kDisallowShortcut)) {
+      vertex = kNoVertex;
+      return 0.f;
+    }
+    uint8_t flow_sources;
+    return costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources).cost *
+           (1.0f - edge.percent_along());
+  };
+  bool has_other_edges =
+      std::any_of(origin.correlation().edges().begin(), origin.correlation().edges().end(),
+                  [](const valhalla::PathEdge& e) { return !e.end_node(); });
+  for (const auto& edge : origin.correlation().edges()) {
+    uint32_t vertex;
+    const float cost = remaining(edge, vertex);
+    if ((has_other_edges && edge.end_node()) || vertex == kNoVertex) {
+      continue;
+    }
+    Add(vertex, kInvalidLabel, edge.distance() + cost, 0);
+    add_cells(vertex);
+  }
+  std::unordered_map<uint32_t, float> destinations;
+  float min_offset = std::numeric_limits<float>::infinity();
+  has_other_edges =
+      std::any_of(destination.correlation().edges().begin(),
+                  destination.correlation().edges().end(),
+                  [](const valhalla::PathEdge& e) { return !e.begin_node(); });
+  for (const auto& edge : destination.correlation().edges()) {
+    uint32_t vertex;
+    const float cost = remaining(edge, vertex);
+    if ((has_other_edges && edge.begin_node()) || vertex == kNoVertex) {
+      continue;
+    }
+    const float offset = edge.distance() - cost;
+    destinations[vertex] = offset;
+    min_offset = std::min(min_offset, offset);
+    add_cells(vertex);
+  }
+
+  // Settle the labels in order of cost until none can beat the best path to a destination
+  float best_cost = std::numeric_limits<float>::infinity();
+  uint32_t best_label = kInvalidLabel;
+  while (!queue_.empty() && queue_.top().first + min_offset < best_cost) {
+    const auto entry = queue_.top();
+    queue_.pop();
+    const label_t label = labels_[entry.second];
+    if (entry.first > label.cost) {
+      continue;
+    }
+
+    // an edge of both locations is a trivial route, which is not up to this algorithm
+    auto destination_offset = destinations.find(label.vertex);
+    if (destination_offset != destinations.end() && label.predecessor != kInvalidLabel &&
+        label.cost + destination_offset->second < best_cost) {
+      best_cost = label.cost + destination_offset->second;
+      best_label = entry.second;
+    }
+
+    metric->arcs(turns, QueryLevel(label.vertex), label.vertex,
+                 [&](const uint32_t vertex, const float cost, const uint8_t clique) {
+                   Add(vertex, entry.second, label.cost + cost, clique);
+                 });
+  }
+  if (best_label == kInvalidLabel) {
+    return {};
+  }
+
+  // unpack the cliques along the path into the edges they stand for
+  std::vector<uint32_t> steps;
+  for (uint32_t idx = best_label; idx != kInvalidLabel; idx = labels_[idx].predecessor) {
+    steps.push_back(idx);
+  }
+  std::vector<uint32_t> vertices{labels_[steps.back()].vertex};
+  for (size_t i = steps.size() - 1; i > 0; --i) {
+    const auto& label = labels_[steps[i - 1]];
+    if (label.clique == 0) {
+      vertices.push_back(label.vertex);
+    } else if (!metric->unpack(turns, label.clique, labels_[steps[i]].vertex, label.vertex,
+                               vertices)) {
+      LOG_ERROR("Could not unpack the overlay path");
+      return {};
+    }
+  }
+  std::vector<GraphId> path_edges;
+  path_edges.reserve(vertices.size());
+  for (auto vertex : vertices) {
+    path_edges.push_back(overlay_->edge(vertex));
+  }
+
+  // recost the edges like the other algorithms do, keeping the labels to check the restrictions
+  std::vector<PathInfo> path;
+  std::vector<PathEdgeLabel> labels;
+  path.reserve(path_edges.size());
+  labels.reserve(path_edges.size());
+  auto edge_itr = path_edges.begin();
+  const auto edge_cb = [&edge_itr, &path_edges]() {
+    return (edge_itr == path_edges.end()) ? GraphId{} : (*edge_itr++);
+  };
+  const auto label_cb = [&path, &labels](const PathEdgeLabel& label) {
+    path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost());
+    labels.push_back(label);
+  };
+  try {
+    sif::recost_forward(graphreader, *costing_, edge_cb, label_cb,
+                        find_percent_along(origin, path_edges.front()),
+                        find_percent_along(destination, path_edges.back()), TimeInfo::invalid(),
+                        false, true);
+  } catch (const std::exception& e) {
+    LOG_ERROR(std::string("Multi-level dijkstra failed to recost final path: ") + e.what());
+    return {};
+  }
+
+  // complex restrictions span several edges, the turns of the overlay don't know about them
+  for (size_t i = 0; i < labels.size(); ++i) {
+    has_ferry_ = has_ferry_ || labels[i].use() == Use::kFerry;
+    graph_tile_ptr tile;
+    const DirectedEdge* edge = graphreader.directededge(labels[i].edgeid(), tile);
+    if (i > 0 &&
+        costing_->Restricted(edge, labels[i - 1], labels, tile, labels[i].edgeid(), true)) {
+      LOG_DEBUG("Overlay path breaks a complex restriction");
+      return {};
+    }
+  }
+  return {std::move(path)};
+}
+
+} // namespace thor
+} // namespace valhalla
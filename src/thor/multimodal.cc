@@ -42,8 +42,11 @@ namespace thor {
 MultiModalPathAlgorithm::MultiModalPathAlgorithm(const boost::property_tree::ptree& config)
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_astar",
                                          kInitialEdgeLabelCountAstar),
-                    config.get<bool>("clear_reserved_memory", false)),
+                    config.get<bool>("clear_reserved_memory", false),
+                    config.get<size_t>("max_reserved_edge_status_count",
+                                       kMaxReservedEdgeStatusCount)),
       max_walking_dist_(0), mode_(travel_mode_t::kPedestrian), travel_type_(0) {
+  edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 // Destructor
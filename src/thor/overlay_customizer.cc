@@ -0,0 +1,225 @@
+#include "thor/overlay_customizer.h"
+#include "baldr/contractiongraph.h"
+#include "baldr/graphreader.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "sif/turns.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// The background thread checks whether to stop and trims its cache after this many vertices
+constexpr size_t kCheckVerticesInterval = 65536;
+
+// Thrown to abandon a customization when the customizer goes away
+struct stopped_t {};
+
+// The costing options asked for and those which failed are forgotten once there are this many
+constexpr size_t kMaxRemembered = 1024;
+
+// Costing options which could not be customized are tried again after this long
+constexpr auto kRetryFailed = std::chrono::minutes(10);
+
+std::string metric_key(const valhalla::Costing& costing) {
+  return std::to_string(costing.type()) + ":" + ContractionGraph::fingerprint(costing.options());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::shared_ptr<OverlayCustomizer>
+OverlayCustomizer::get(const std::string& file_name,
+                       const boost::property_tree::ptree& config,
+                       const boost::property_tree::ptree& reader_config) {
+  if (file_name.empty()) {
+    return nullptr;
+  }
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<OverlayCustomizer>> customizers;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& weak = customizers[file_name];
+  auto customizer = weak.lock();
+  if (!customizer) {
+    auto overlay = std::make_shared<const PartitionOverlay>(file_name);
+    if (overlay->empty()) {
+      return nullptr;
+    }
+    customizer = std::make_shared<OverlayCustomizer>(std::move(overlay), config, reader_config);
+    weak = customizer;
+  }
+  return customizer;
+}
+
+OverlayCustomizer::OverlayCustomizer(std::shared_ptr<const PartitionOverlay> overlay,
+                                     const boost::property_tree::ptree& config,
+                                     const boost::property_tree::ptree& reader_config)
+    : overlay_(std::move(overlay)), reader_config_(reader_config),
+      max_metrics_(std::max<size_t>(config.get<size_t>("max_overlay_metrics", 4), 1)),
+      max_queued_(std::max<size_t>(config.get<size_t>("max_overlay_queue", 4), 1)),
+      min_requests_(std::max<size_t>(config.get<size_t>("overlay_metric_min_requests", 2), 1)),
+      stop_(false) {
+  thread_ = std::thread(&OverlayCustomizer::Work, this);
+}
+
+OverlayCustomizer::~OverlayCustomizer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  signal_.notify_all();
+  thread_.join();
+}
+
+std::shared_ptr<const OverlayMetric> OverlayCustomizer::Find(const std::string& key) {
+  for (auto metric = metrics_.begin(); metric != metrics_.end(); ++metric) {
+    if (metric->first == key) {
+      metrics_.splice(metrics_.begin(), metrics_, metric);
+      return metrics_.front().second;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<const OverlayMetric> OverlayCustomizer::Get(const Costing& costing,
+                                                            const std::chrono::milliseconds wait) {
+  const auto key = metric_key(costing);
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto metric = Find(key);
+  if (metric) {
+    return metric;
+  }
+
+  // options which could not be customized are only tried again after a while
+  auto failed = failed_.find(key);
+  if (failed != failed_.end()) {
+    if (std::chrono::steady_clock::now() - failed->second < kRetryFailed) {
+      return nullptr;
+    }
+    failed_.erase(failed);
+  }
+
+  // every metric takes a pass over the whole overlay, options seen only once aren't worth it
+  if (!queued_.count(key)) {
+    if (requests_.size() >= kMaxRemembered) {
+      requests_.clear();
+    }
+    if (++requests_[key] < min_requests_ || !Queue(key, costing)) {
+      return nullptr;
+    }
+  }
+
+  if (wait.count() > 0) {
+    ++waiting_[key];
+    signal_.wait_for(lock, wait, [&]() { return !queued_.count(key); });
+    if (--waiting_[key] == 0) {
+      waiting_.erase(key);
+    }
+    metric = Find(key);
+  }
+  return metric;
+}
+
+bool OverlayCustomizer::Queue(const std::string& key, const Costing& costing) {
+  // make room by dropping the longest queued options nobody waits for anymore
+  if (queue_.size() >= max_queued_) {
+    auto dropped = std::find_if(queue_.begin(), queue_.end(),
+                                [this](const auto& job) { return !waiting_.count(job.first); });
+    if (dropped == queue_.end()) {
+      return false;
+    }
+    queued_.erase(dropped->first);
+    requests_.erase(dropped->first);
+    queue_.erase(dropped);
+  }
+  requests_.erase(key);
+  queued_.insert(key);
+  queue_.emplace_back(key, costing);
+  signal_.notify_all();
+  return true;
+}
+
+void OverlayCustomizer::Work() {
+  // the thread has the graph to itself, the workers' readers aren't thread-safe
+  std::unique_ptr<GraphReader> reader;
+  CostFactory factory;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    signal_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+    auto job = std::move(queue_.front());
+    queue_.pop_front();
+
+    // customize without holding the lock so the workers can still use the other metrics
+    lock.unlock();
+    std::shared_ptr<const OverlayMetric> metric;
+    try {
+      if (!reader) {
+        reader.reset(new GraphReader(reader_config_));
+      }
+      // the same turns the workers search the metric with, see thor_worker_t::get_path, without
+      // destination-only edges like the first pass of bidirectional A*
+      auto costing = factory.Create(job.second);
+      costing->set_allow_destination_only(false);
+      costing->set_pass(0);
+      size_t n = 0;
+      const OverlayMetric::turns_t turns = [&](const uint32_t vertex,
+                                               const OverlayMetric::turn_cb_t& turn_cb) {
+        if ((++n % kCheckVerticesInterval) == 0) {
+          if (stop_) {
+            throw stopped_t{};
+          }
+          if (reader->OverCommitted()) {
+            reader->Trim();
+          }
+        }
+        for_each_turn(*reader, *costing, overlay_->edge(vertex),
+                      [&](const GraphId& edge_id, const DirectedEdge*, const Cost& cost) {
+                        const uint32_t to = overlay_->vertex(edge_id);
+                        if (to != PartitionOverlay::kNoVertex) {
+                          turn_cb(to, cost.cost);
+                        }
+                      });
+      };
+      const auto start = std::chrono::steady_clock::now();
+      metric = std::make_shared<const OverlayMetric>(*overlay_, turns);
+      const auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+      LOG_INFO("Customized an overlay metric with " + std::to_string(metric->size()) +
+               " clique costs in " + std::to_string(msecs) + " ms");
+    } catch (const stopped_t&) {
+      return;
+    } catch (const std::exception& e) {
+      LOG_ERROR("Could not customize an overlay metric: " + std::string(e.what()));
+    }
+    lock.lock();
+
+    queued_.erase(job.first);
+    if (metric) {
+      metrics_.emplace_front(job.first, std::move(metric));
+      if (metrics_.size() > max_metrics_) {
+        metrics_.pop_back();
+      }
+    } else {
+      if (failed_.size() >= kMaxRemembered) {
+        failed_.clear();
+      }
+      failed_[job.first] = std::chrono::steady_clock::now();
+    }
+    signal_.notify_all();
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,214 @@
+#include "thor/overlay_metric.h"
+#include "midgard/logging.h"
+
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint32_t kNoVertex = PartitionOverlay::kNoVertex;
+constexpr float kNoCost = std::numeric_limits<float>::infinity();
+
+struct arc_t {
+  uint32_t vertex;
+  float cost;
+  uint8_t clique;
+};
+
+struct label_t {
+  float cost;
+  uint32_t predecessor;
+  uint8_t clique; // how the label was reached, see OverlayMetric::arc_cb_t
+};
+
+/**
+ * The arcs between the vertices of one cell at one level, found once for all the searches in it.
+ */
+class cell_t {
+public:
+  cell_t(const valhalla::thor::OverlayMetric& metric,
+         const valhalla::thor::OverlayMetric::turns_t& turns,
+         const PartitionOverlay& overlay,
+         const uint8_t level,
+         const uint32_t cell)
+      : metric_(metric), turns_(turns), overlay_(overlay), level_(level), cell_(cell) {
+  }
+
+  /**
+   * Dijkstra from a vertex of the cell, staying in it.
+   * @param from  the vertex to start from
+   * @param to    the vertex to stop at, kNoVertex to search the whole cell
+   * @return the labels of the vertices reached
+   */
+  const std::unordered_map<uint32_t, label_t>& search(const uint32_t from, const uint32_t to) {
+    using entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    labels_.clear();
+    labels_.emplace(from, label_t{0.f, kNoVertex, 0});
+    queue.emplace(0.f, from);
+    while (!queue.empty()) {
+      const auto entry = queue.top();
+      queue.pop();
+      if (entry.second == to) {
+        break;
+      }
+      if (entry.first > labels_[entry.second].cost) {
+        continue;
+      }
+      for (const auto& arc : arcs(entry.second)) {
+        const float cost = entry.first + arc.cost;
+        auto inserted = labels_.emplace(arc.vertex, label_t{cost, entry.second, arc.clique});
+        if (!inserted.second) {
+          if (cost >= inserted.first->second.cost) {
+            continue;
+          }
+          inserted.first->second = label_t{cost, entry.second, arc.clique};
+        }
+        queue.emplace(cost, arc.vertex);
+      }
+    }
+    return labels_;
+  }
+
+private:
+  const std::vector<arc_t>& arcs(const uint32_t vertex) {
+    auto inserted = arcs_.emplace(vertex, std::vector<arc_t>{});
+    if (inserted.second) {
+      auto& arcs = inserted.first->second;
+      metric_.arcs(turns_, level_, vertex,
+                   [&](const uint32_t to, const float cost, const uint8_t clique) {
+                     if (overlay_.cell(level_, to) == cell_) {
+                       arcs.push_back({to, cost, clique});
+                     }
+                   });
+    }
+    return inserted.first->second;
+  }
+
+  const valhalla::thor::OverlayMetric& metric_;
+  const valhalla::thor::OverlayMetric::turns_t& turns_;
+  const PartitionOverlay& overlay_;
+  const uint8_t level_;
+  const uint32_t cell_;
+  std::unordered_map<uint32_t, std::vector<arc_t>> arcs_;
+  std::unordered_map<uint32_t, label_t> labels_;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+OverlayMetric::OverlayMetric(const PartitionOverlay& overlay, const turns_t& turns)
+    : overlay_(overlay) {
+  // the searches in the cells of a level only go through the cliques of the levels below, which
+  // are customized before it
+  for (uint8_t level = 0; level < overlay_.level_count(); ++level) {
+    const uint32_t cell_count = overlay_.cell_count(level);
+    auto& offsets = offsets_.emplace_back();
+    offsets.reserve(cell_count + 1);
+    offsets.push_back(0);
+    for (uint32_t c = 0; c < cell_count; ++c) {
+      offsets.push_back(offsets.back() + uint64_t(overlay_.entries_end(level, c) -
+                                                  overlay_.entries_begin(level, c)) *
+                                             (overlay_.exits_end(level, c) -
+                                              overlay_.exits_begin(level, c)));
+    }
+    auto& costs = costs_.emplace_back(offsets.back(), kNoCost);
+
+    for (uint32_t c = 0; c < cell_count; ++c) {
+      cell_t cell(*this, turns, overlay_, level, c);
+      float* clique = costs.data() + offsets[c];
+      for (const auto* entry = overlay_.entries_begin(level, c);
+           entry != overlay_.entries_end(level, c); ++entry) {
+        const auto& labels = cell.search(*entry, kNoVertex);
+        for (const auto* exit = overlay_.exits_begin(level, c);
+             exit != overlay_.exits_end(level, c); ++exit, ++clique) {
+          auto found = labels.find(*exit);
+          if (found != labels.end()) {
+            *clique = found->second.cost;
+          }
+        }
+      }
+    }
+    LOG_DEBUG("Customized " + std::to_string(costs.size()) + " clique costs of overlay level " +
+              std::to_string(level));
+  }
+}
+
+void OverlayMetric::arcs(const turns_t& turns,
+                         const uint8_t query_level,
+                         const uint32_t vertex,
+                         const arc_cb_t& arc_cb) const {
+  if (query_level == 0) {
+    turns(vertex, [&arc_cb](const uint32_t to, const float cost) { arc_cb(to, cost, 0); });
+    return;
+  }
+
+  const uint8_t level = query_level - 1;
+  const uint32_t cell = overlay_.cell(level, vertex);
+  const uint32_t entry = overlay_.entry_index(level, vertex);
+  if (entry != kNoVertex) {
+    const auto* exits = overlay_.exits_begin(level, cell);
+    const uint64_t exit_count = overlay_.exits_end(level, cell) - exits;
+    const float* clique = costs_[level].data() + offsets_[level][cell] + entry * exit_count;
+    for (uint64_t i = 0; i < exit_count; ++i) {
+      if (clique[i] != kNoCost && exits[i] != vertex) {
+        arc_cb(exits[i], clique[i], query_level);
+      }
+    }
+  }
+  if (overlay_.exit_index(level, vertex) != kNoVertex) {
+    turns(vertex, [&](const uint32_t to, const float cost) {
+      if (overlay_.cell(level, to) != cell) {
+        arc_cb(to, cost, 0);
+      }
+    });
+  }
+}
+
+bool OverlayMetric::unpack(const turns_t& turns,
+                           const uint8_t clique,
+                           const uint32_t from,
+                           const uint32_t to,
+                           std::vector<uint32_t>& vertices) const {
+  // the clique is the cheapest path through its cell at the query level below, which the same
+  // search as the one customizing it finds again
+  const uint8_t level = clique - 1;
+  cell_t cell(*this, turns, overlay_, level, overlay_.cell(level, from));
+  const auto& labels = cell.search(from, to);
+  std::vector<std::pair<uint32_t, uint8_t>> path;
+  for (auto found = labels.find(to); found != labels.end() && found->first != from;
+       found = labels.find(found->second.predecessor)) {
+    path.emplace_back(found->first, found->second.clique);
+  }
+  if (path.empty() || labels.at(path.back().first).predecessor != from) {
+    return false;
+  }
+
+  uint32_t previous = from;
+  for (auto step = path.rbegin(); step != path.rend(); ++step) {
+    if (step->second == 0) {
+      vertices.push_back(step->first);
+    } else if (!unpack(turns, step->second, previous, step->first, vertices)) {
+      return false;
+    }
+    previous = step->first;
+  }
+  return true;
+}
+
+size_t OverlayMetric::size() const {
+  size_t size = 0;
+  for (const auto& costs : costs_) {
+    size += costs.size();
+  }
+  return size;
+}
+
+} // namespace thor
+} // namespace valhalla
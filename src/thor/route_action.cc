@@ -234,6 +234,8 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &contraction_hierarchy,
+           &multilevel_dijkstra,
        }) {
     alg->set_interrupt(interrupt);
   }
@@ -284,15 +286,42 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Routes with the costing the contraction hierarchy was built for go up and down it
+  if (contraction_hierarchy.CanRoute(origin, destination, options)) {
+    return &contraction_hierarchy;
+  }
+
+  // Any other route not depending on time crosses the cells of the partition overlay
+  if (multilevel_dijkstra.CanRoute(origin, destination, options)) {
+    return &multilevel_dijkstra;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
 
-std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm* path_algorithm,
+std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*& path_algorithm,
                                                                  valhalla::Location& origin,
                                                                  valhalla::Location& destination,
                                                                  const std::string& costing,
                                                                  const Options& options) {
+  // The contraction hierarchy and the overlay have no second pass. Without a path from them, or
+  // with one breaking a complex restriction, the graph is searched instead.
+  if (path_algorithm == &contraction_hierarchy || path_algorithm == &multilevel_dijkstra) {
+    // the turns the hierarchy was built and the overlay metrics customized with, which don't go
+    // onto destination-only edges like the first pass of bidirectional A*. They must not depend on
+    // an earlier leg's pass.
+    mode_costing[static_cast<uint32_t>(mode)]->set_allow_destination_only(false);
+    mode_costing[static_cast<uint32_t>(mode)]->set_pass(0);
+    auto paths =
+        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    if (!paths.empty()) {
+      return paths;
+    }
+    path_algorithm = &bidir_astar;
+    path_algorithm->Clear();
+  }
+
   // Find the path.
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
 
@@ -380,7 +409,9 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     path_algorithm->Clear();
 
     // once we know which algorithm will be used, set the hierarchy limits accordingly
-    bool is_bidir = path_algorithm == &bidir_astar;
+    // (the contraction hierarchy and the overlay fall back to bidirectional a*)
+    bool is_bidir = path_algorithm == &bidir_astar || path_algorithm == &contraction_hierarchy ||
+                    path_algorithm == &multilevel_dijkstra;
     auto& hierarchy_limits = is_bidir ? hierarchy_limits_bidir : hierarchy_limits_unidir;
 
     // only check hierarchy limits if not already done for the current algorithm
@@ -388,9 +419,8 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
         (!(is_bidir ? used_bidir : used_unidir) &&
          check_hierarchy_limits(hierarchy_limits, mode_costing[static_cast<uint32_t>(mode)],
                                 costing_options,
-                                path_algorithm == &bidir_astar
-                                    ? hierarchy_limits_config_bidirectional_astar
-                                    : hierarchy_limits_config_astar,
+                                is_bidir ? hierarchy_limits_config_bidirectional_astar
+                                         : hierarchy_limits_config_astar,
                                 allow_hierarchy_limits_modifications,
                                 mode_costing[int(mode)]->UseHierarchyLimits())) ||
         add_hierarchy_limits_warning;
@@ -399,9 +429,6 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     is_bidir ? (used_bidir = true) : (used_unidir = true);
     mode_costing[static_cast<uint32_t>(mode)]->SetHierarchyLimits(hierarchy_limits);
 
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
-
     // If we are continuing through a location we need to make sure we
     // only allow the edge that was used previously (avoid u-turns)
     if (is_through_point(*destination) && first_edge.Is_Valid()) {
@@ -413,6 +440,11 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     auto temp_paths = this->get_path(path_algorithm, *origin, *destination, costing, options);
     if (temp_paths.empty())
       return false;
+
+    // only now is it known which algorithm found the path
+    algorithms.push_back(path_algorithm->name());
+    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+
     for (auto& temp_path : temp_paths) {
       auto out_tz = reader->GetTimezoneFromEdge(temp_path.back().edgeid, tile);
       auto in_tz = reader->GetTimezoneFromEdge(temp_path.front().edgeid, tile);
@@ -601,11 +633,11 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
     thor::PathAlgorithm* path_algorithm =
         this->get_path_algorithm(costing, *origin, *destination, options);
     path_algorithm->Clear();
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
 
     // once we know which algorithm will be used, set the hierarchy limits accordingly
-    bool is_bidir = path_algorithm == &bidir_astar;
+    // (the contraction hierarchy and the overlay fall back to bidirectional a*)
+    bool is_bidir = path_algorithm == &bidir_astar || path_algorithm == &contraction_hierarchy ||
+                    path_algorithm == &multilevel_dijkstra;
     auto& hierarchy_limits = is_bidir ? hierarchy_limits_bidir : hierarchy_limits_unidir;
 
     // only check hierarchy limits if not already done for the current algorithm
@@ -613,9 +645,8 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
         (!(is_bidir ? used_bidir : used_unidir) &&
          check_hierarchy_limits(hierarchy_limits, mode_costing[static_cast<uint32_t>(mode)],
                                 costing_options,
-                                path_algorithm == &bidir_astar
-                                    ? hierarchy_limits_config_bidirectional_astar
-                                    : hierarchy_limits_config_astar,
+                                is_bidir ? hierarchy_limits_config_bidirectional_astar
+                                         : hierarchy_limits_config_astar,
                                 allow_hierarchy_limits_modifications,
                                 mode_costing[static_cast<uint32_t>(mode)]->UseHierarchyLimits())) ||
         add_hierarchy_limits_warning;
@@ -634,6 +665,10 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
     if (temp_paths.empty())
       return false;
 
+    // only now is it known which algorithm found the path
+    algorithms.push_back(path_algorithm->name());
+    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+
     for (auto& temp_path : temp_paths) {
 
       auto in_tz = reader->GetTimezoneFromEdge(temp_path.front().edgeid, tile);
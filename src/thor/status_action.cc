@@ -1,8 +1,9 @@
+#include "proto/status.pb.h"
 #include "thor/worker.h"
 
 namespace valhalla {
 namespace thor {
-void thor_worker_t::status(Api&) const {
+void thor_worker_t::status(Api& request) const {
 #ifdef ENABLE_SERVICES
   // if we are in the process of shutting down we signal that here
   // should react by draining traffic (though they are likely doing this as they are usually the ones
@@ -11,6 +12,11 @@ void thor_worker_t::status(Api&) const {
     throw valhalla_exception_t{402};
   }
 #endif
+
+  // loki only asks for the tile metrics of a verbose status, add those of this worker's reader
+  if (request.status().has_tile_metrics()) {
+    reader->AddTileMetrics(*request.mutable_status()->mutable_tile_metrics());
+  }
 }
 } // namespace thor
 } // namespace valhalla
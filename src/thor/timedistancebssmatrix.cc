@@ -24,6 +24,8 @@ TimeDistanceBSSMatrix::TimeDistanceBSSMatrix(const boost::property_tree::ptree&
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
       clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)) {
+  pedestrian_edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
+  bicycle_edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 float TimeDistanceBSSMatrix::GetCostThreshold(const float max_matrix_distance) const {
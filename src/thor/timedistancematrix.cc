@@ -16,7 +16,8 @@ TimeDistanceMatrix::TimeDistanceMatrix(const boost::property_tree::ptree& config
     : MatrixAlgorithm(config), settled_count_(0), current_cost_threshold_(0),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
-      mode_(travel_mode_t::kDrive) {
+      mode_(travel_mode_t::kDrive), contraction_sweep_(nullptr) {
+  edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 // Compute a cost threshold in seconds based on average speed for the travel mode.
@@ -208,7 +209,20 @@ bool TimeDistanceMatrix::ComputeMatrix(Api& request,
   reserve_pbf_arrays(*request.mutable_matrix(), num_elements, request.options().verbose(),
                      costing_->pass());
 
+  // with enough targets one sweep over the contraction hierarchy beats a dijkstra from a source
+  const bool sweep =
+      FORWARD && contraction_sweep_ && contraction_sweep_->matrices() && !expansion_callback_ &&
+      static_cast<uint32_t>(destinations.size()) >= contraction_sweep_->min_targets() &&
+      matrix_locations >= static_cast<uint32_t>(destinations.size()) &&
+      contraction_sweep_->CanSweep(origins, request.options());
+
   for (int origin_index = 0; origin_index < origins.size(); ++origin_index) {
+    if (sweep) {
+      SweepOrigin(request, graphreader, origin_index, time_infos[origin_index],
+                  max_matrix_distance);
+      continue;
+    }
+
     // reserve some space for the next dijkstras (will be cleared at the end of the loop)
     edgelabels_.reserve(max_reserved_labels_count_);
     auto& origin = origins.Get(origin_index);
@@ -305,6 +319,45 @@ TimeDistanceMatrix::ComputeMatrix<ExpansionType::reverse, false>(Api& request,
                                                                  baldr::GraphReader& graphreader,
                                                                  const float max_matrix_distance);
 
+void TimeDistanceMatrix::SweepOrigin(Api& request,
+                                     GraphReader& graphreader,
+                                     const uint32_t origin_index,
+                                     const TimeInfo& time_info,
+                                     const float max_matrix_distance) {
+  const auto& origin = request.options().sources(origin_index);
+  const auto& targets = request.options().targets();
+  contraction_sweep_->Sweep(origin, graphreader, costing_);
+
+  // the targets the dijkstra would have reached before giving up
+  const float cost_threshold = GetCostThreshold(max_matrix_distance);
+  std::unordered_map<uint32_t, GraphId> dest_edge_ids;
+  for (uint32_t i = 0; i < destinations_.size(); ++i) {
+    auto& dest = destinations_[i];
+    const auto& dest_loc = targets.Get(i);
+    if (origin.ll().lat() == dest_loc.ll().lat() && origin.ll().lng() == dest_loc.ll().lng()) {
+      dest.best_cost = Cost{0.f, 0.f};
+      dest.distance = 0;
+      continue;
+    }
+    for (const auto& edge : dest_loc.correlation().edges()) {
+      GraphId edgeid(edge.graph_id());
+      if (costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+        continue;
+      }
+      const auto reached = contraction_sweep_->Reach(edge, graphreader);
+      if (reached.cost <= cost_threshold && reached.cost < dest.best_cost.cost) {
+        dest.best_cost = Cost{reached.cost, reached.secs};
+        dest.distance = reached.length;
+        dest_edge_ids[i] = edgeid;
+      }
+    }
+  }
+
+  FormTimeDistanceMatrix(request, graphreader, true, origin_index, origin.date_time(),
+                         time_info.timezone_index, dest_edge_ids);
+  reset();
+}
+
 // Add edges at the origin to the adjacency list
 template <const ExpansionType expansion_direction, const bool FORWARD>
 void TimeDistanceMatrix::SetOrigin(GraphReader& graphreader,
@@ -19,8 +19,11 @@ UnidirectionalAStar<expansion_direction, FORWARD>::UnidirectionalAStar(
     const boost::property_tree::ptree& config)
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_astar",
                                          kInitialEdgeLabelCountAstar),
-                    config.get<bool>("clear_reserved_memory", false)),
+                    config.get<bool>("clear_reserved_memory", false),
+                    config.get<size_t>("max_reserved_edge_status_count",
+                                       kMaxReservedEdgeStatusCount)),
       mode_(travel_mode_t::kDrive), travel_type_(0), access_mode_(kAutoAccess) {
+  edgestatus_.set_max_reserved(max_reserved_edge_status_count_);
 }
 
 // Default constructor
@@ -254,8 +257,9 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
     cost.cost += dest_path_edge ? dest_path_edge->distance() : 0.0f;
 
     auto dist = 0.0f;
-    auto sortcost =
-        cost.cost + (dest_path_edge ? astarheuristic_.Get(0) : astarheuristic_.Get(endpoint, dist));
+    auto sortcost = cost.cost + (dest_path_edge
+                                     ? astarheuristic_.Get(0)
+                                     : astarheuristic_.Get(endpoint, meta.edge->endnode(), dist));
 
     auto path_distance =
         static_cast<uint32_t>(pred.path_distance() + meta.edge->length() * percent_traversed + .5f);
@@ -472,6 +476,10 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
   midgard::PointLL destination_new(destination.correlation().edges(0).ll().lng(),
                                    destination.correlation().edges(0).ll().lat());
   Init(origin_new, destination_new);
+  // Tighten the heuristic with the landmark distances of the graph, if there are any
+  if (const auto* landmarks = landmark_distances(*costing_)) {
+    astarheuristic_.InitLandmarks(landmarks, graphreader, FORWARD ? destination : origin, FORWARD);
+  }
   float mindist = astarheuristic_.GetDistance(FORWARD ? origin_new : destination_new);
 
   auto& startpoint = FORWARD ? origin : destination;
@@ -718,12 +726,14 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
     GraphId opp_edge_id;
     const DirectedEdge* opp_dir_edge;
     midgard::PointLL endpoint;
+    GraphId endnode;
     if (FORWARD) {
       const auto endtile = graphreader.GetGraphTile(directededge->endnode());
       if (endtile == nullptr) {
         continue;
       }
-      endpoint = endtile->get_node_ll(directededge->endnode());
+      endnode = directededge->endnode();
+      endpoint = endtile->get_node_ll(endnode);
     } else {
       // Get the opposing directed edge, continue if we cannot get it
       opp_edge_id = graphreader.GetOpposingEdgeId(edgeid);
@@ -731,7 +741,8 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
         continue;
       }
       opp_dir_edge = graphreader.GetOpposingEdge(edgeid);
-      endpoint = tile->get_node_ll(opp_dir_edge->endnode());
+      endnode = opp_dir_edge->endnode();
+      endpoint = tile->get_node_ll(endnode);
     }
 
     uint8_t flow_sources;
@@ -753,8 +764,8 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::SetOrigin(
       cost.cost += edge.distance() + (dest_path_edge ? dest_path_edge->distance() : 0.0f);
 
       auto dist = 0.0f;
-      auto sortcost =
-          cost.cost + (dest_path_edge ? astarheuristic_.Get(0) : astarheuristic_.Get(endpoint, dist));
+      auto sortcost = cost.cost + (dest_path_edge ? astarheuristic_.Get(0)
+                                                  : astarheuristic_.Get(endpoint, endnode, dist));
 
       auto path_distance = static_cast<uint32_t>(directededge->length() * percent_traversed + .5f);
 
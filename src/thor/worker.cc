@@ -64,11 +64,23 @@ namespace thor {
 thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
     : service_worker_t(config), mode(valhalla::sif::TravelMode::kPedestrian),
+      search_arena(config.get<size_t>("thor.max_reserved_labels_count_arena",
+                                      kMaxReservedArenaLabelCount),
+                   config.get<size_t>("thor.max_reserved_edge_status_count",
+                                      kMaxReservedEdgeStatusCount)),
       bidir_astar(config.get_child("thor")), bss_astar(config.get_child("thor")),
       multi_modal_astar(config.get_child("thor")), timedep_forward(config.get_child("thor")),
-      timedep_reverse(config.get_child("thor")), costmatrix_(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")),
+      contraction_hierarchy(config.get_child("thor"),
+                            config.get<std::string>("mjolnir.contraction_hierarchy", "")),
+      contraction_sweep(config.get_child("thor"), contraction_hierarchy.graph()),
+      multilevel_dijkstra(config.get_child("thor"),
+                          config.get<std::string>("mjolnir.partition_overlay", ""),
+                          config.get_child("mjolnir")),
+      costmatrix_(config.get_child("thor"), config.get_child("mjolnir")),
       time_distance_matrix_(config.get_child("thor")),
-      time_distance_bss_matrix_(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
+      time_distance_bss_matrix_(config.get_child("thor")), bucket_matrix_(config.get_child("thor")),
+      isochrone_gen(config.get_child("thor")),
       reader(graph_reader ? graph_reader
                           : std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
       matcher_factory(config, reader), controller{},
@@ -97,6 +109,8 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucketmatrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
@@ -113,6 +127,30 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
   hierarchy_limits_config_bidirectional_astar =
       parse_hierarchy_limits_from_config(config, "bidirectional_astar", true);
 
+  // the landmark distances, if the tiles have them, tighten the heuristics of the A* algorithms
+  const auto landmarks_file = config.get<std::string>("mjolnir.landmark_distances", "");
+  if (!landmarks_file.empty()) {
+    auto landmarks = std::make_shared<const baldr::LandmarkDistances>(landmarks_file);
+    if (!landmarks->empty()) {
+      bidir_astar.set_landmark_distances(landmarks);
+      timedep_forward.set_landmark_distances(landmarks);
+      timedep_reverse.set_landmark_distances(landmarks);
+    }
+  }
+
+  // large one-to-many matrices and isochrones can sweep the contraction hierarchy
+  time_distance_matrix_.set_contraction_sweep(&contraction_sweep);
+  isochrone_gen.set_contraction_sweep(&contraction_sweep);
+
+  // the searches hand their memory on to each other rather than each shrinking its own, unless
+  // all of it should be freed after every request
+  if (!config.get<bool>("thor.clear_reserved_memory", false)) {
+    bidir_astar.set_search_arena(&search_arena);
+    costmatrix_.set_search_arena(&search_arena);
+    isochrone_gen.set_search_arena(&search_arena);
+    centroid_gen.set_search_arena(&search_arena);
+  }
+
   // signal that the worker started successfully
   started();
 }
@@ -320,23 +358,32 @@ void thor_worker_t::cleanup() {
   bidir_astar.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
+  contraction_hierarchy.Clear();
+  contraction_sweep.Clear();
+  multilevel_dijkstra.Clear();
   multi_modal_astar.Clear();
   bss_astar.Clear();
   trace.clear();
   costmatrix_.Clear();
   time_distance_matrix_.Clear();
   time_distance_bss_matrix_.Clear();
+  bucket_matrix_.Clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  // candidates cached by the matcher refer to the previous graph
+  if (reader->ReloadExtracts()) {
+    matcher_factory.ClearCache();
+  }
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
   interrupt = interrupt_function;
   reader->SetInterrupt(interrupt);
+  contraction_sweep.set_interrupt(interrupt);
 }
 } // namespace thor
 } // namespace valhalla
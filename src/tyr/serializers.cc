@@ -131,6 +131,44 @@ std::string serializeStatus(Api& request) {
     rapidjson::SetValueByPointer(status_doc, "/bbox", bbox_doc, alloc);
   }
 
+  if (request.status().has_tile_metrics()) {
+    const auto& metrics = request.status().tile_metrics();
+    rapidjson::Value metrics_doc(rapidjson::kObjectType);
+    metrics_doc.AddMember("hits", rapidjson::Value().SetUint64(metrics.hits()), alloc);
+    metrics_doc.AddMember("misses", rapidjson::Value().SetUint64(metrics.misses()), alloc);
+    metrics_doc.AddMember("evictions", rapidjson::Value().SetUint64(metrics.evictions()), alloc);
+    metrics_doc.AddMember("tiles_loaded", rapidjson::Value().SetUint64(metrics.tiles_loaded()),
+                          alloc);
+    metrics_doc.AddMember("bytes_loaded", rapidjson::Value().SetUint64(metrics.bytes_loaded()),
+                          alloc);
+    // only the buckets anything fell into, the last one has no upper bound
+    rapidjson::Value latency(rapidjson::kArrayType);
+    for (int i = 0; i < metrics.load_latency_size(); ++i) {
+      if (!metrics.load_latency(i))
+        continue;
+      rapidjson::Value bucket(rapidjson::kObjectType);
+      if (i + 1 < metrics.load_latency_size())
+        bucket.AddMember("max_us", rapidjson::Value().SetUint64(uint64_t(1) << i), alloc);
+      bucket.AddMember("count", rapidjson::Value().SetUint64(metrics.load_latency(i)), alloc);
+      latency.PushBack(bucket, alloc);
+    }
+    metrics_doc.AddMember("load_latency", latency, alloc);
+    rapidjson::Value levels(rapidjson::kArrayType);
+    for (auto count : metrics.level_touches()) {
+      levels.PushBack(rapidjson::Value().SetUint64(count), alloc);
+    }
+    metrics_doc.AddMember("level_touches", levels, alloc);
+    metrics_doc.AddMember("prefetch_hits", rapidjson::Value().SetUint64(metrics.prefetch_hits()),
+                          alloc);
+    metrics_doc.AddMember("prefetch_misses",
+                          rapidjson::Value().SetUint64(metrics.prefetch_misses()), alloc);
+    metrics_doc.AddMember("prefetch_wasted",
+                          rapidjson::Value().SetUint64(metrics.prefetch_wasted()), alloc);
+    // how many graph readers the counters are summed over
+    metrics_doc.AddMember("readers", rapidjson::Value().SetUint64(metrics.readers_size()), alloc);
+    status_doc.AddMember("tile_metrics", metrics_doc, alloc);
+  }
+
   return rapidjson::to_string(status_doc);
 }
 
@@ -1,12 +1,15 @@
 #include "argparse_utils.h"
 #include "baldr/double_bucket_queue.h"
+#include "baldr/radix_heap.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "sif/edgelabel.h"
 
 #include <cxxopts.hpp>
 
+#include <algorithm>
 #include <cstdint>
+#include <ctime>
 #include <iostream>
 #include <queue>
 #include <random>
@@ -17,14 +20,129 @@ using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 
+namespace {
+
+// Bucket range the path algorithms use per unit of bucket size, see thor::kBucketCount
+constexpr uint32_t kBucketCount = 20000;
+
+/**
+ * Pops all labels from the queue. Copies each edge label like the path algorithms do.
+ * @return the number of labels popped
+ */
+template <typename queue_t>
+uint32_t Drain(queue_t& adjlist, const std::vector<EdgeLabel>& edgelabels, uint32_t& out_of_order) {
+  uint32_t count = 0;
+  float previous = 0.f;
+  while (true) {
+    uint32_t idx = adjlist.pop();
+    if (idx == kInvalidLabel) {
+      break;
+    }
+    EdgeLabel el = edgelabels[idx];
+    out_of_order += el.sortcost() < previous;
+    previous = el.sortcost();
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Adds labels with all the costs to the queue, then removes them.
+ */
+template <typename queue_t>
+void AddRemove(const std::string& name,
+               queue_t& adjlist,
+               const std::vector<uint32_t>& costs,
+               const float range,
+               const uint32_t bucketsize) {
+  std::vector<EdgeLabel> edgelabels;
+  std::clock_t start = std::clock();
+  adjlist.reuse(0, range, bucketsize, &edgelabels);
+  for (uint32_t i = 0; i < costs.size(); i++) {
+    EdgeLabel el;
+    el.SetSortCost(costs[i]);
+    edgelabels.push_back(std::move(el));
+    adjlist.add(i);
+  }
+  uint32_t out_of_order = 0;
+  const uint32_t count = Drain(adjlist, edgelabels, out_of_order);
+  adjlist.clear();
+  uint32_t ms = (std::clock() - start) / static_cast<double>(CLOCKS_PER_SEC / 1000);
+  LOG_INFO(name + ": Added and removed " + std::to_string(count) + " edgelabels in " +
+           std::to_string(ms) + " ms, " + std::to_string(out_of_order) + " out of order");
+}
+
+/**
+ * Expands like a path algorithm does. Every label popped adds labels costing up to maxedgecost
+ * more and lowers the cost of one added shortly before if that's cheaper, until n labels were
+ * added. Then the rest is removed.
+ */
+template <typename queue_t>
+void Expand(const std::string& name,
+            queue_t& adjlist,
+            const uint32_t n,
+            const uint32_t expansion,
+            const float maxedgecost,
+            const float range,
+            const uint32_t bucketsize) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<float> dis(0, 1);
+  std::vector<EdgeLabel> edgelabels;
+  edgelabels.reserve(n);
+  std::vector<bool> queued;
+  queued.reserve(n);
+
+  std::clock_t start = std::clock();
+  adjlist.reuse(0, range, bucketsize, &edgelabels);
+  edgelabels.emplace_back();
+  queued.push_back(true);
+  adjlist.add(0);
+  uint32_t count = 0, decreased = 0;
+  while (edgelabels.size() < n) {
+    uint32_t idx = adjlist.pop();
+    if (idx == kInvalidLabel) {
+      break;
+    }
+    const float cost = edgelabels[idx].sortcost();
+    queued[idx] = false;
+    count++;
+
+    // a cheaper way to one of the recently reached edges
+    const uint32_t recent = edgelabels.size() - 1 - gen() % std::min<size_t>(edgelabels.size(), 16);
+    const float lower = cost + dis(gen) * maxedgecost;
+    if (queued[recent] && lower < edgelabels[recent].sortcost()) {
+      adjlist.decrease(recent, lower);
+      edgelabels[recent].SetSortCost(lower);
+      decreased++;
+    }
+    for (uint32_t i = 0; i < expansion; i++) {
+      EdgeLabel el;
+      el.SetSortCost(cost + dis(gen) * maxedgecost);
+      edgelabels.push_back(std::move(el));
+      queued.push_back(true);
+      adjlist.add(edgelabels.size() - 1);
+    }
+  }
+  uint32_t out_of_order = 0;
+  count += Drain(adjlist, edgelabels, out_of_order);
+  adjlist.clear();
+  uint32_t ms = (std::clock() - start) / static_cast<double>(CLOCKS_PER_SEC / 1000);
+  LOG_INFO(name + ": Expanded " + std::to_string(count) + " edgelabels, decreased " +
+           std::to_string(decreased) + ", in " + std::to_string(ms) + " ms, " +
+           std::to_string(out_of_order) + " out of order");
+}
+
 /**
  * Benchmark of adjacency list. Constructs a large number of random numbers,
  * adds EdgeLabels to the AdjacencyList with those as the sortcost. Then
  * removes them from the list. This compares performance of an STL
  * priority_queue with the custom approximate double bucket sorting used
- * in adjacencylist.cc.
+ * in adjacencylist.cc and with the radix heap.
+ *
+ * Then both queues expand like the path algorithms do, once with buckets as the path algorithms
+ * size them and once with a range so small that most labels go through the overflow bucket.
  */
-int Benchmark(const uint32_t n, const float maxcost, const float bucketsize) {
+int Benchmark(const uint32_t n, const float maxcost, const std::vector<uint32_t>& bucketsizes) {
   // Create a set of random costs
   std::random_device rd;
   std::mt19937 gen(rd());
@@ -45,10 +163,8 @@ int Benchmark(const uint32_t n, const float maxcost, const float bucketsize) {
   }
 
   uint32_t count = 0;
-  std::vector<uint32_t> ordered_cost1;
   while (!pqueue.empty()) {
     EdgeLabel el = pqueue.top();
-    ordered_cost1.push_back(el.sortcost());
     pqueue.pop();
     count++;
   }
@@ -56,57 +172,39 @@ int Benchmark(const uint32_t n, const float maxcost, const float bucketsize) {
   LOG_INFO("Priority Queue: Added and removed " + std::to_string(count) + " edgelabels in " +
            std::to_string(ms) + " ms");
 
-  // Didn't alter the sort order of priority queue, so reverse the vector
-  std::reverse(ordered_cost1.begin(), ordered_cost1.end());
-
   // Test performance of double bucket adjacency list. Set the bucket maxcost
   // such that EmptyOverflow is called once
-  std::vector<EdgeLabel> edgelabels;
-  // Set up lambda to get sort costs
-  start = std::clock();
-  DoubleBucketQueue<EdgeLabel> adjlist(0, maxcost / 2, bucketsize, &edgelabels);
-
-  // Construct EdgeLabels and add to adjacency list
-
-  for (uint32_t i = 0; i < n; i++) {
-    EdgeLabel el;
-    el.SetSortCost(costs[i]);
-    edgelabels.push_back(std::move(el));
-    adjlist.add(i);
-  }
-
-  // Get edge label indexes from the adj list. Accumulate total cost to make
-  // sure compiler doesn't optimize too much.
-  count = 0;
-  std::vector<uint32_t> ordered_cost2;
-  while (true) {
-    uint32_t idx = adjlist.pop();
-    if (idx == kInvalidLabel) {
-      break;
-    }
-
-    // Copy the edge label - simulates what is done in PathAlgorithm
-    EdgeLabel el = edgelabels[idx];
-    ordered_cost2.push_back(el.sortcost());
-    count++;
+  DoubleBucketQueue<EdgeLabel> adjlist;
+  RadixHeap<EdgeLabel> heap;
+  for (const auto bucketsize : bucketsizes) {
+    AddRemove("Bucketed Adj. List, bucket size " + std::to_string(bucketsize), adjlist, costs,
+              maxcost / 2, bucketsize);
   }
-  ms = (std::clock() - start) / static_cast<double>(CLOCKS_PER_SEC / 1000);
-  LOG_INFO("Bucketed Adj. List: Added and removed " + std::to_string(count) + " edgelabels in " +
-           std::to_string(ms) + " ms");
-
-  // Verify order
-  for (uint32_t i = 0; i < count; i++) {
-    if (ordered_cost1[i] != ordered_cost2[i]) {
-      LOG_INFO("Costs: " + std::to_string(ordered_cost1[i]) + "," + std::to_string(ordered_cost2[i]));
+  AddRemove("Radix Heap", heap, costs, maxcost / 2, 1);
+
+  // Expand with edges costing up to a hundredth of the maximum cost, in the range the path
+  // algorithms have and in one that overflows all the time
+  const float maxedgecost = maxcost / 100;
+  for (const auto bucketsize : bucketsizes) {
+    for (const float range : {static_cast<float>(kBucketCount * bucketsize), maxedgecost}) {
+      Expand("Bucketed Adj. List, bucket size " + std::to_string(bucketsize) + ", range " +
+                 std::to_string(static_cast<uint32_t>(range)),
+             adjlist, n, 3, maxedgecost, range, bucketsize);
     }
   }
+  Expand("Radix Heap", heap, n, 3, maxedgecost, maxedgecost, 1);
   return 0;
 }
 
+} // namespace
+
 int main(int argc, char* argv[]) {
   const auto program = filesystem::path(__FILE__).stem().string();
   // args
   boost::property_tree::ptree config;
+  uint32_t count;
+  float maxcost;
+  std::vector<uint32_t> bucketsizes;
 
   try {
     // clang-format off
@@ -114,15 +212,26 @@ int main(int argc, char* argv[]) {
       program,
       program + " " + VALHALLA_PRINT_VERSION + "\n\n"
       "a program which is benchmark comparing performance of an STL priority_queue\n"
-      "to the approximate double bucket adjacency list class supplied with Valhalla.\n\n");
+      "to the approximate double bucket adjacency list class supplied with Valhalla\n"
+      "and to its radix heap, on random costs and on expansions like the path\n"
+      "algorithms do. To compare them on real routes, matrices and isochrones run\n"
+      "valhalla_run_route, valhalla_run_matrix or valhalla_run_isochrone with\n"
+      "thor.bidirectional_astar.radix_heap, thor.costmatrix.radix_heap or\n"
+      "thor.dijkstras.radix_heap turned on and off.\n\n");
 
     options.add_options()
       ("h,help", "Print this help message.")
-      ("v,version", "Print the version of this software.");
+      ("v,version", "Print the version of this software.")
+      ("n,count", "Number of edge labels.", cxxopts::value<uint32_t>()->default_value("1000000"))
+      ("m,maxcost", "Maximum cost of the random labels.", cxxopts::value<float>()->default_value("50000"))
+      ("b,bucketsize", "Bucket sizes of the double bucket queue.", cxxopts::value<std::vector<uint32_t>>()->default_value("1,10,50"));
 
     auto result = options.parse(argc, argv);
     if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
       return EXIT_SUCCESS;
+    count = result["count"].as<uint32_t>();
+    maxcost = result["maxcost"].as<float>();
+    bucketsizes = result["bucketsize"].as<std::vector<uint32_t>>();
   } catch (cxxopts::exceptions::exception& e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -132,8 +241,8 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  // Benchmark with count, maxcost, and bucketsize
-  Benchmark(1000000, 50000, 1);
+  // Benchmark with count, maxcost, and bucketsizes
+  Benchmark(count, maxcost, bucketsizes);
   LOG_INFO("Done Benchmark!");
 
   return EXIT_SUCCESS;
@@ -0,0 +1,148 @@
+#include "argparse_utils.h"
+#include "baldr/graphreader.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// prints the latency distribution of one pass over the tiles
+void report(const std::string& extract, const std::string& pass, std::vector<double>& latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+  };
+  double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+  std::cout << std::fixed << std::setprecision(2) << extract << " " << pass << ": mean " << mean
+            << "us p50 " << percentile(.5) << "us p90 " << percentile(.9) << "us p99 "
+            << percentile(.99) << "us max " << latencies.back() << "us" << std::endl;
+}
+
+// looks up the tiles in the given order and records how long each one took in microseconds
+std::vector<double>
+run(GraphReader& reader, const std::vector<GraphId>& order, uint64_t& checksum) {
+  std::vector<double> latencies;
+  latencies.reserve(order.size());
+  for (const auto& id : order) {
+    auto start = std::chrono::steady_clock::now();
+    auto tile = reader.GetGraphTile(id);
+    // touch the tile so that the mmap'd path has to fault it in too
+    checksum += tile ? tile->header()->directededgecount() : 0;
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    latencies.push_back(elapsed.count());
+  }
+  return latencies;
+}
+
+} // namespace
+
+/**
+ * Benchmark of tile access from tile extracts. Looks up a random sequence of the extract's tiles
+ * through a GraphReader, first with an empty tile cache and then again with whatever the cache
+ * kept, and reports the latencies. Running it with a plain and a compressed extract of the same
+ * tiles compares the memory mapped path with the decompress-into-the-cache path.
+ */
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  size_t lookups;
+  uint32_t seed;
+  std::vector<std::string> extracts;
+  boost::property_tree::ptree config;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "a program that measures how fast tiles can be read from tile extracts.\n"
+      "Pass the extracts to compare, e.g. one built with and one without\n"
+      "valhalla_build_extract --compress, or none to use mjolnir.tile_extract.\n"
+      "The tile cache is configured by the mjolnir section of the config.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("n,lookups", "Number of random tile lookups per pass.", cxxopts::value<size_t>(lookups)->default_value("10000"))
+      ("s,seed", "Seed of the random lookup order, the same for all extracts.", cxxopts::value<uint32_t>(seed)->default_value("42"))
+      ("extracts", "positional arguments", cxxopts::value<std::vector<std::string>>(extracts));
+    // clang-format on
+
+    options.parse_positional({"extracts"});
+    options.positional_help("[TILES.TAR ...]");
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (lookups == 0) {
+      throw cxxopts::exceptions::exception("Need at least one lookup\n\n" + options.help());
+    }
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (extracts.empty()) {
+    extracts.push_back(config.get<std::string>("mjolnir.tile_extract", ""));
+  }
+  for (const auto& extract : extracts) {
+    if (!filesystem::is_regular_file(extract)) {
+      LOG_ERROR("Tile extract " + extract + " not found");
+      return EXIT_FAILURE;
+    }
+  }
+
+  uint64_t checksum = 0;
+  for (const auto& extract : extracts) {
+    auto mjolnir = config.get_child("mjolnir");
+    mjolnir.put("tile_extract", extract);
+    GraphReader reader(mjolnir);
+
+    auto tile_set = reader.GetTileSet();
+    if (tile_set.empty()) {
+      LOG_ERROR("No tiles found in " + extract);
+      return EXIT_FAILURE;
+    }
+    std::vector<GraphId> tiles(tile_set.begin(), tile_set.end());
+    std::sort(tiles.begin(), tiles.end());
+
+    // the same sequence of lookups for every extract
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> pick(0, tiles.size() - 1);
+    std::vector<GraphId> order(lookups);
+    for (auto& id : order) {
+      id = tiles[pick(gen)];
+    }
+
+    std::cout << extract << ": " << tiles.size() << " tiles, "
+              << filesystem::directory_entry(extract).file_size() << " bytes" << std::endl;
+    reader.Clear();
+    auto cold = run(reader, order, checksum);
+    report(extract, "cold cache", cold);
+    auto warm = run(reader, order, checksum);
+    report(extract, "warm cache", warm);
+  }
+  LOG_INFO("Checksum " + std::to_string(checksum));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#include "argparse_utils.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// a node of a tile kept in memory, expanded in a random order like a path search would
+struct node_t {
+  const GraphTile* tile;
+  uint32_t edge_index;
+  uint32_t edge_count;
+};
+
+// the checks bidirectional A* and CostMatrix make on every edge before they look any further, read
+// from the directed edges. The u-turn is taken to be the first edge of the node.
+inline bool skip(const DirectedEdge* edge) {
+  return edge->localedgeidx() == 0 || edge->superseded() || edge->is_shortcut() ||
+         !(edge->reverseaccess() & kAutoAccess);
+}
+
+// the same checks read from the hot edge columns
+inline bool skip(const HotEdges& hot_edges, uint32_t idx) {
+  return hot_edges.localedgeidx(idx) == 0 || hot_edges.superseded(idx) ||
+         hot_edges.is_shortcut(idx) || !(hot_edges.reverseaccess(idx) & kAutoAccess);
+}
+
+// makes one pass over the nodes in the given order and returns the nanoseconds per edge
+template <typename check_t>
+double run(const std::vector<node_t>& nodes, uint64_t edges, uint64_t& checksum, check_t check) {
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& node : nodes) {
+    for (uint32_t i = node.edge_index, n = node.edge_index + node.edge_count; i < n; ++i) {
+      checksum += check(*node.tile, i);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / edges;
+}
+
+} // namespace
+
+/**
+ * Benchmark of the hot edge columns (mjolnir.hot_edges). Loads tiles which have the columns and
+ * visits their nodes in a random order, making the checks path finding uses to skip edges once
+ * by reading the directed edges and once by reading the columns, and reports the time per edge.
+ */
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  size_t max_tiles;
+  uint32_t passes;
+  uint32_t seed;
+  boost::property_tree::ptree config;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_PRINT_VERSION + "\n\n"
+      "a program that measures how fast path finding can check which edges to skip\n"
+      "when it reads the hot edge columns instead of the directed edges. The tiles\n"
+      "have to be built with mjolnir.hot_edges enabled.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("t,tiles", "Maximum number of tiles to load.", cxxopts::value<size_t>(max_tiles)->default_value("64"))
+      ("p,passes", "Number of passes over the nodes per layout.", cxxopts::value<uint32_t>(passes)->default_value("10"))
+      ("s,seed", "Seed of the random node order.", cxxopts::value<uint32_t>(seed)->default_value("42"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (max_tiles == 0 || passes == 0) {
+      throw cxxopts::exceptions::exception("Need at least one tile and one pass\n\n" +
+                                           options.help());
+    }
+  } catch (cxxopts::exceptions::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  GraphReader reader(config.get_child("mjolnir"));
+  auto tile_set = reader.GetTileSet();
+  std::vector<GraphId> tile_ids(tile_set.begin(), tile_set.end());
+  std::sort(tile_ids.begin(), tile_ids.end());
+
+  // keep the tiles with the columns, the cache might not hold on to them
+  std::vector<graph_tile_ptr> tiles;
+  std::vector<node_t> nodes;
+  uint64_t edges = 0;
+  for (const auto& id : tile_ids) {
+    if (tiles.size() == max_tiles) {
+      break;
+    }
+    auto tile = reader.GetGraphTile(id);
+    if (!tile || tile->hot_edges().empty()) {
+      continue;
+    }
+    for (const auto& node : tile->GetNodes()) {
+      nodes.push_back({tile.get(), node.edge_index(), node.edge_count()});
+      edges += node.edge_count();
+    }
+    tiles.push_back(std::move(tile));
+  }
+  if (edges == 0) {
+    LOG_ERROR("No tiles with hot edge columns found, build them with mjolnir.hot_edges enabled");
+    return EXIT_FAILURE;
+  }
+  std::shuffle(nodes.begin(), nodes.end(), std::mt19937(seed));
+  std::cout << tiles.size() << " tiles, " << nodes.size() << " nodes, " << edges << " edges"
+            << std::endl;
+
+  // alternate the layouts so that neither always runs with the caches warmed up by the other
+  uint64_t checksum = 0;
+  std::vector<double> directed, hot;
+  for (uint32_t pass = 0; pass < passes; ++pass) {
+    directed.push_back(run(nodes, edges, checksum, [](const GraphTile& tile, uint32_t idx) {
+      return skip(tile.directededge(idx));
+    }));
+    hot.push_back(run(nodes, edges, checksum, [](const GraphTile& tile, uint32_t idx) {
+      return skip(tile.hot_edges(), idx);
+    }));
+  }
+  std::sort(directed.begin(), directed.end());
+  std::sort(hot.begin(), hot.end());
+  std::cout << std::fixed << std::setprecision(2) << "directed edges: best " << directed.front()
+            << "ns/edge median " << directed[passes / 2] << "ns/edge" << std::endl;
+  std::cout << "hot edge columns: best " << hot.front() << "ns/edge median " << hot[passes / 2]
+            << "ns/edge" << std::endl;
+  LOG_INFO("Checksum " + std::to_string(checksum));
+
+  return EXIT_SUCCESS;
+}
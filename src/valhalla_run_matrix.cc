@@ -213,7 +213,7 @@ int main(int argc, char* argv[]) {
   }
 
   // Timing with CostMatrix
-  CostMatrix matrix(config.get_child("thor"));
+  CostMatrix matrix(config.get_child("thor"), config.get_child("mjolnir"));
   hierarchy_limits_config_t hl_config =
       parse_hierarchy_limits_from_config(config, "costmatrix", false);
   check_hierarchy_limits(mode_costing[int(mode)]->GetHierarchyLimits(), mode_costing[int(mode)],
@@ -123,3 +123,20 @@ class TestBindings(unittest.TestCase):
         with self.assertRaises(RuntimeError) as e:
             actor.route(json.dumps({"locations":[{"lat":52.08813,"lon":5.03231},{"lat":52.09987,"lon":5.14913}],"costing":"bicycle","directions_options":{"language":"ru-RU"}}))
         self.assertIn('exceeds the max distance limit', str(e.exception))
+
+    def test_tile_metrics(self):
+        config = get_config(self.tiles_path, self.extract_path)
+        config['service_limits']['status']['allow_verbose'] = True
+        with open(self.config_path, 'w') as f:
+            json.dump(config, f, indent=2)
+
+        actor = Actor(str(self.config_path))
+        actor.route({"locations": [{"lat": 52.08813, "lon": 5.03231}, {"lat": 52.09987, "lon": 5.14913}],
+                     "costing": "bicycle"})
+
+        status = actor.status({"verbose": True})
+        self.assertIn('tile_metrics', status)
+        self.assertGreater(status['tile_metrics']['misses'], 0)
+        self.assertGreater(status['tile_metrics']['bytes_loaded'], 0)
+        # loki and thor share the actor's reader, it is only counted once
+        self.assertEqual(status['tile_metrics']['readers'], 1)
@@ -137,6 +137,35 @@ TEST(Compression, fail_inflate) {
   EXPECT_FALSE(inflate_result);
 }
 
+TEST(Compression, lz4_roundtrip) {
+  std::string message;
+  for (int i = 0; i < 10000; ++i)
+    message += "message in an lz4 bottle " + std::to_string(i % 17);
+
+  std::vector<char> compressed;
+  ASSERT_TRUE(valhalla::baldr::lz4_compress(message.data(), message.size(), compressed));
+  EXPECT_LT(compressed.size(), message.size());
+  EXPECT_TRUE(valhalla::baldr::is_lz4_frame(compressed.data(), compressed.size()));
+  EXPECT_FALSE(valhalla::baldr::is_lz4_frame(message.data(), message.size()));
+
+  std::vector<char> decompressed;
+  ASSERT_TRUE(
+      valhalla::baldr::lz4_decompress(compressed.data(), compressed.size(), decompressed));
+  EXPECT_EQ(std::string(decompressed.begin(), decompressed.end()), message);
+}
+
+TEST(Compression, fail_lz4) {
+  std::string message = "message in an lz4 bottle";
+  std::vector<char> compressed, decompressed;
+  ASSERT_TRUE(valhalla::baldr::lz4_compress(message.data(), message.size(), compressed, 9));
+
+  // truncated and garbage frames
+  EXPECT_FALSE(
+      valhalla::baldr::lz4_decompress(compressed.data(), compressed.size() - 4, decompressed));
+  EXPECT_FALSE(valhalla::baldr::lz4_decompress(message.data(), message.size(), decompressed));
+  EXPECT_FALSE(valhalla::baldr::is_lz4_frame(compressed.data(), 3));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -178,7 +178,8 @@ void TryTestDST(const uint64_t origin_seconds,
 
 void TryIsRestricted(const TimeDomain td, const std::string& date, const bool expected_value) {
 
-  auto tz = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/New_York"));
+  auto tz_index = DateTime::get_tz_db().to_index("America/New_York");
+  auto tz = DateTime::get_tz_db().from_index(tz_index);
 
   EXPECT_EQ(DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(), td.end_hrs(),
                                             td.end_mins(), td.dow(), td.begin_week(),
@@ -187,6 +188,16 @@ void TryIsRestricted(const TimeDomain td, const std::string& date, const bool ex
                                             DateTime::seconds_since_epoch(date, tz), tz),
             expected_value)
       << "Is Restricted " + date + " test failed.  Expected: " + std::to_string(expected_value);
+
+  // same answer when the local time comes from the timezone offsets
+  EXPECT_EQ(DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(), td.end_hrs(),
+                                            td.end_mins(), td.dow(), td.begin_week(),
+                                            td.begin_month(), td.begin_day_dow(), td.end_week(),
+                                            td.end_month(), td.end_day_dow(),
+                                            DateTime::seconds_since_epoch(date, tz), tz_index),
+            expected_value)
+      << "Is Restricted by tz index " + date +
+             " test failed.  Expected: " + std::to_string(expected_value);
 }
 
 void TryTestTimezoneDiff(const uint64_t date_time,
@@ -748,6 +759,51 @@ TEST(DateTime, DiffCaching) {
   EXPECT_GE(cache.size(), unique_tzs.size());
 }
 
+TEST(DateTime, TimezoneOffsets) {
+  const auto& tzdb = DateTime::get_tz_db();
+  const auto& offsets = DateTime::get_tz_offsets();
+  ASSERT_LT(offsets.begin(), offsets.end());
+
+  // every zone agrees with the tz db over the whole span
+  int32_t offset;
+  for (size_t index = 0; index < 700; ++index) {
+    const auto* tz = tzdb.from_index(index);
+    if (!tz) {
+      EXPECT_FALSE(offsets.offset(index, offsets.begin(), offset));
+      continue;
+    }
+    for (int64_t t = offsets.begin(); t < offsets.end(); t += 3 * 86400 + 3607) {
+      ASSERT_TRUE(offsets.offset(index, t, offset));
+      auto info = tz->get_info(date::sys_seconds(std::chrono::seconds(t)));
+      ASSERT_EQ(offset, info.offset.count()) << tz->name() << " at " << t;
+    }
+  }
+
+  // the second before and the second of a transition
+  auto ny_index = tzdb.to_index("America/New_York");
+  ASSERT_TRUE(offsets.offset(ny_index, 1710054000 - 1, offset));
+  EXPECT_EQ(offset, -5 * 3600);
+  ASSERT_TRUE(offsets.offset(ny_index, 1710054000, offset));
+  EXPECT_EQ(offset, -4 * 3600);
+
+  // outside of the span it's up to the tz db
+  EXPECT_FALSE(offsets.offset(ny_index, offsets.begin() - 1, offset));
+  EXPECT_FALSE(offsets.offset(ny_index, offsets.end(), offset));
+  const uint64_t later = offsets.end() + 100;
+  EXPECT_EQ(DateTime::timezone_diff(later, 110, 94),
+            DateTime::timezone_diff(later, tzdb.from_index(110), tzdb.from_index(94)));
+
+  // diffs by tz index match those by time zone
+  for (int64_t t = offsets.begin(); t < offsets.end(); t += 86400 * 5 + 3599) {
+    for (size_t origin : {110, 94, 335, 162, 308, 134 | (1 << 9)}) {
+      for (size_t dest : {110, 94, 19, 297, 0}) {
+        ASSERT_EQ(DateTime::timezone_diff(t, origin, dest),
+                  DateTime::timezone_diff(t, tzdb.from_index(origin), tzdb.from_index(dest)));
+      }
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
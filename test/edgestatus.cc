@@ -13,6 +13,9 @@ namespace {
 void TryGet(const EdgeStatus& edgestatus, const GraphId& edgeid, const EdgeSet expected) {
   EdgeStatusInfo r = edgestatus.Get(edgeid);
   EXPECT_EQ(r.set(), expected);
+  // looking up without remembering the tile finds the same
+  EXPECT_EQ(edgestatus.GetShared(edgeid).set(), expected);
+  EXPECT_EQ(edgestatus.GetShared(edgeid).index(), r.index());
 }
 
 struct test_tile : public GraphTile {
@@ -65,6 +68,49 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, TestReuse) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // the arrays of the tiles are reused after clearing, with every status reset
+  GraphId edge(555, 1, 10);
+  EdgeStatusInfo* first = edgestatus.GetPtr(edge, tile);
+  edgestatus.Set(edge, EdgeSet::kPermanent, 7, tile);
+  edgestatus.Set(edge, EdgeSet::kTemporary, 8, tile, 3);
+  TryGet(edgestatus, edge, EdgeSet::kPermanent);
+  EXPECT_EQ(edgestatus.Get(edge, 3).index(), 8);
+  edgestatus.clear();
+  TryGet(edgestatus, edge, EdgeSet::kUnreachedOrReset);
+  EXPECT_EQ(edgestatus.Get(edge, 3).set(), EdgeSet::kUnreachedOrReset);
+  EXPECT_THROW(edgestatus.Update(edge, EdgeSet::kPermanent), std::runtime_error);
+  EXPECT_EQ(edgestatus.GetPtr(edge, tile), first);
+  EXPECT_EQ(first->set(), EdgeSet::kUnreachedOrReset);
+  edgestatus.Update(edge, EdgeSet::kSkipped);
+  TryGet(edgestatus, edge, EdgeSet::kSkipped);
+
+  // the tile may have changed in between, the array follows its edge count
+  edgestatus.clear();
+  header.set_directededgecount(5000);
+  edgestatus.Set(GraphId(555, 1, 4999), EdgeSet::kTemporary, 1, tile);
+  TryGet(edgestatus, GraphId(555, 1, 4999), EdgeSet::kTemporary);
+  TryGet(edgestatus, edge, EdgeSet::kUnreachedOrReset);
+
+  // arrays beyond what is to be kept are freed when clearing
+  edgestatus.set_max_reserved(0);
+  edgestatus.clear();
+  for (uint32_t i = 0; i < 3; ++i) {
+    TryGet(edgestatus, GraphId(555, 1, 4999), EdgeSet::kUnreachedOrReset);
+    edgestatus.Set(GraphId(555, 1, 4999), EdgeSet::kPermanent, i, tile);
+    EXPECT_EQ(edgestatus.Get(GraphId(555, 1, 4999)).index(), i);
+    edgestatus.clear();
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,12 +1,23 @@
 #include "baldr/graphreader.h"
+#include "baldr/batchreader.h"
 #include "baldr/connectivity_map.h"
+#ifdef __linux__
+#include "baldr/shmtilecache.h"
+#endif
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "test.h"
 
 #include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <fstream>
+#include <future>
+#include <thread>
 
 using namespace valhalla::baldr;
 
@@ -129,6 +140,29 @@ TEST(ConnectivityMap, Basic) {
     EXPECT_NE(conn.get_color({a2, level.level, 0}), conn.get_color({d0, level.level, 0}))
         << "a is disjoint from d";
 
+    // the map written to a file and mapped back colors the tiles the same way
+    const std::string map_file = "test/gphrdr_test_connectivity.bin";
+    conn.save(map_file);
+    boost::property_tree::ptree mapped_pt = pt;
+    mapped_pt.put("connectivity_map", map_file);
+    connectivity_map_t mapped(mapped_pt);
+    for (auto tile_id : {a0, a1, a2, b0, c0, d0, d1}) {
+      EXPECT_EQ(conn.get_color({tile_id, level.level, 0}),
+                mapped.get_color({tile_id, level.level, 0}));
+    }
+    EXPECT_TRUE(mapped.has_data(level.level));
+    EXPECT_FALSE(mapped.has_components(kAutoAccess)) << "no components without building them";
+
+    // the map doesn't know about tiles added since, so they are colored again instead
+    uint32_t e0 = level.tiles.TopNeighbor(d1);
+    touch_tile(e0, tile_dir, level.level);
+    connectivity_map_t stale(mapped_pt);
+    EXPECT_EQ(mapped.get_color({e0, level.level, 0}), 0);
+    EXPECT_NE(stale.get_color({e0, level.level, 0}), 0);
+    EXPECT_EQ(stale.get_color({e0, level.level, 0}), stale.get_color({d1, level.level, 0}))
+        << "e is connected to d";
+    filesystem::remove(map_file);
+
     filesystem::remove_all(tile_dir);
   }
 }
@@ -887,6 +921,448 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(ShardedCache, PutGetClear) {
+  ShardedTileCache cache(1000, 4);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 300)}, 300);
+  CheckGraphTile(tile1, id1, 300);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  EXPECT_TRUE(cache.Contains(id1));
+
+  // the first tile put into the cache wins
+  auto again = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 300)}, 300);
+  EXPECT_EQ(again, tile1);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // lookups go by tile base
+  EXPECT_EQ(cache.Get(GraphId(100, 2, 1234)), tile1);
+  EXPECT_EQ(cache.Get(GraphId(101, 2, 0)), nullptr);
+  EXPECT_FALSE(cache.Contains(GraphId(100, 1, 0)));
+
+  // force the shard tables to grow a few times
+  for (uint32_t i = 0; i < 500; ++i) {
+    GraphId id(1000 + i, 1, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 2)}, 2);
+  }
+  EXPECT_TRUE(cache.OverCommitted());
+  for (uint32_t i = 0; i < 500; ++i) {
+    CheckGraphTile(cache.Get(GraphId(1000 + i, 1, 0)), GraphId(1000 + i, 1, 0), 2);
+  }
+  CheckGraphTile(cache.Get(id1), id1, 300);
+
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_EQ(cache.Get(GraphId(1000, 1, 0)), nullptr);
+}
+
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(ShardedCache, ConcurrentReadersAndWriters) {
+  ShardedTileCache cache(1 << 20, 8);
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache, &failed, t]() {
+      for (uint32_t i = 0; i < 2000; ++i) {
+        GraphId id((i * 7 + t) % 1500, 2, 0);
+        auto tile = cache.Get(id);
+        if (!tile) {
+          tile = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 10)}, 10);
+        }
+        if (!tile || tile->header()->graphid() != id) {
+          failed = true;
+        }
+        // every now and then clear it from under the readers
+        if (t == 0 && i % 500 == 0) {
+          cache.Clear();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(failed);
+}
+#endif
+
+TEST(TilePrefetcher, LoadsInBackground) {
+  std::atomic<size_t> loads{0};
+  tile_prefetcher_t prefetcher(
+      [&loads](const GraphId& id) -> graph_tile_ptr {
+        ++loads;
+        // pretend the odd tiles aren't on disk
+        return id.tileid() % 2 ? nullptr : graph_tile_ptr{new TestGraphTile(id, 100)};
+      },
+      2, 8);
+
+  GraphId id1(100, 2, 0), id2(101, 2, 0);
+  prefetcher.Prefetch(id1);
+  prefetcher.Prefetch(id1);
+  prefetcher.Prefetch(id2);
+  prefetcher.Wait();
+  EXPECT_EQ(loads.load(), 2) << "the duplicate hint is loaded only once";
+  CheckGraphTile(prefetcher.Take(id1), id1, 100);
+
+  // its handed over only once and missing tiles are never parked
+  EXPECT_EQ(prefetcher.Take(id1), nullptr);
+  EXPECT_EQ(prefetcher.Take(id2), nullptr);
+
+  auto stats = prefetcher.Stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.wasted, 0);
+}
+
+TEST(TilePrefetcher, ParkedAgainAfterTake) {
+  tile_prefetcher_t prefetcher(
+      [](const GraphId& id) -> graph_tile_ptr {
+        return graph_tile_ptr{new TestGraphTile(id, 100)};
+      },
+      1, 2);
+
+  GraphId id1(100, 2, 0), id2(102, 2, 0);
+  prefetcher.Prefetch(id1);
+  prefetcher.Wait();
+  CheckGraphTile(prefetcher.Take(id1), id1, 100);
+
+  // once both are parked taking the first one must not get the fresh copy dropped to make room
+  prefetcher.Prefetch(id1);
+  prefetcher.Prefetch(id2);
+  prefetcher.Wait();
+  CheckGraphTile(prefetcher.Take(id2), id2, 100);
+  CheckGraphTile(prefetcher.Take(id1), id1, 100);
+  EXPECT_EQ(prefetcher.Stats().wasted, 0);
+
+  // clearing drops a parked tile
+  prefetcher.Prefetch(id2);
+  prefetcher.Wait();
+  prefetcher.Clear();
+  EXPECT_EQ(prefetcher.Take(id2), nullptr);
+  EXPECT_EQ(prefetcher.Stats().wasted, 1);
+}
+
+TEST(TilePrefetcher, ClearDropsLoadsInFlight) {
+  // the loader holds on to the first tile until the test lets it go
+  std::promise<void> started, resume;
+  auto resumed = resume.get_future().share();
+  std::atomic<size_t> loads{0};
+  tile_prefetcher_t prefetcher(
+      [&](const GraphId& id) -> graph_tile_ptr {
+        if (loads++ == 0) {
+          started.set_value();
+          resumed.wait();
+        }
+        return graph_tile_ptr{new TestGraphTile(id, 100)};
+      },
+      1, 4);
+
+  GraphId in_flight(100, 2, 0), queued(102, 2, 0);
+  prefetcher.Prefetch(in_flight);
+  started.get_future().wait();
+  prefetcher.Prefetch(queued);
+
+  // the queued tile is never loaded, the one being loaded is dropped once it is
+  prefetcher.Clear();
+  resume.set_value();
+  prefetcher.Wait();
+  EXPECT_EQ(loads.load(), 1);
+  EXPECT_EQ(prefetcher.Take(in_flight), nullptr);
+  EXPECT_EQ(prefetcher.Take(queued), nullptr);
+  EXPECT_EQ(prefetcher.Stats().wasted, 1);
+
+  // hints after the clear are loaded as usual
+  prefetcher.Prefetch(in_flight);
+  prefetcher.Wait();
+  CheckGraphTile(prefetcher.Take(in_flight), in_flight, 100);
+}
+
+TEST(TileMetrics, LatencyBuckets) {
+  tile_metrics_t metrics;
+  metrics.loaded(100, std::chrono::nanoseconds(500));
+  metrics.loaded(200, std::chrono::microseconds(3));
+  metrics.loaded(300, std::chrono::hours(1));
+  metrics.access(2, true);
+  metrics.access(7, false);
+  auto snapshot = metrics.snapshot();
+  EXPECT_EQ(snapshot.tiles_loaded, 3);
+  EXPECT_EQ(snapshot.bytes_loaded, 600);
+  // under 1us, under 4us and off the scale
+  EXPECT_EQ(snapshot.load_latency[0], 1);
+  EXPECT_EQ(snapshot.load_latency[2], 1);
+  EXPECT_EQ(snapshot.load_latency.back(), 1);
+  EXPECT_EQ(snapshot.hits, 1);
+  EXPECT_EQ(snapshot.misses, 1);
+  EXPECT_EQ(snapshot.level_touches[2], 1);
+  EXPECT_EQ(snapshot.level_touches.back(), 1);
+}
+
+TEST(TilePrefetcher, DisabledByDefault) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/gphrdr_test");
+  GraphReader reader(pt);
+  reader.PrefetchNeighbors(GraphId(100, 2, 0));
+  auto stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.hits + stats.misses + stats.wasted, 0);
+}
+
+TEST(BatchReader, ReadsFiles) {
+  std::string dir = "test/batch_read_test";
+  filesystem::remove_all(dir);
+  filesystem::create_directories(dir);
+
+  // one file that needs several reads, an empty one and one that isn't there
+  std::vector<char> big(1 << 20);
+  for (size_t i = 0; i < big.size(); ++i)
+    big[i] = static_cast<char>(i * 31);
+  std::ofstream(dir + "/big", std::ios::binary).write(big.data(), big.size());
+  std::ofstream(dir + "/empty", std::ios::binary);
+
+  auto buffers = read_files({dir + "/big", dir + "/missing", dir + "/empty", dir + "/big"}, 2);
+  ASSERT_EQ(buffers.size(), 4);
+  ASSERT_TRUE(buffers[0]);
+  EXPECT_EQ(*buffers[0], big);
+  EXPECT_FALSE(buffers[1]);
+  ASSERT_TRUE(buffers[2]);
+  EXPECT_TRUE(buffers[2]->empty());
+  ASSERT_TRUE(buffers[3]);
+  EXPECT_EQ(*buffers[3], big);
+  EXPECT_TRUE(read_files({}).empty());
+
+  filesystem::remove_all(dir);
+}
+
+TEST(BatchReader, LoadTiles) {
+  std::string dir = "test/batch_load_test";
+  filesystem::remove_all(dir);
+  filesystem::create_directories(dir);
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", dir);
+  GraphReader reader(pt);
+
+  // nothing on disk, nothing loaded
+  EXPECT_EQ(reader.LoadTiles({GraphId(100, 2, 0), GraphId(5, 0, 0), GraphId()}), 0);
+  // nor for a bounding box
+  const valhalla::midgard::AABB2<valhalla::midgard::PointLL> bbox(5.0, 52.0, 5.2, 52.2);
+  EXPECT_EQ(reader.LoadTiles(bbox), 0);
+
+  // once the cache is full the rest of the batch is left to load on demand
+  for (auto id : {GraphId(100, 2, 0), GraphId(101, 2, 0), GraphId(102, 2, 0)}) {
+    auto path = dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(id);
+    filesystem::create_directories(filesystem::path(path).parent_path());
+    std::ofstream file(path, std::ios::binary);
+    GraphTileHeader header;
+    header.set_graphid(id);
+    header.set_end_offset(sizeof(header));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  pt.put("max_cache_size", 1);
+  GraphReader small(pt);
+  EXPECT_EQ(small.LoadTiles({GraphId(100, 2, 0), GraphId(101, 2, 0), GraphId(102, 2, 0)}), 1);
+
+  filesystem::remove_all(dir);
+}
+
+#ifdef __linux__
+// a tile whose memory is as big as it claims to be, the shared cache copies all of it
+graph_tile_ptr MakeTile(const GraphId& id, size_t size) {
+  std::vector<char> memory(size);
+  auto* header = reinterpret_cast<GraphTileHeader*>(memory.data());
+  *header = GraphTileHeader();
+  header->set_graphid(id);
+  header->set_end_offset(size);
+  return GraphTile::Create(id, std::move(memory));
+}
+
+TEST(ShmCache, PutGetClear) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    ShmTileCache cache(name, 1 << 20, 0);
+    GraphId id1(100, 2, 0);
+    auto tile1 = MakeTile(id1, 4096);
+    EXPECT_EQ(cache.Put(id1, tile1, 4096), tile1);
+    EXPECT_TRUE(cache.Contains(id1));
+    EXPECT_FALSE(cache.Contains(GraphId(101, 2, 0)));
+    EXPECT_FALSE(cache.OverCommitted());
+
+    // another cache on the same segment sees the tile, served from the shared memory
+    ShmTileCache other(name, 1 << 20, 0);
+    auto shared = other.Get(id1);
+    CheckGraphTile(shared, id1, 4096);
+    EXPECT_NE(shared, tile1);
+    EXPECT_EQ(other.Get(GraphId(101, 2, 0)), nullptr);
+
+    auto stats = cache.Stats();
+    EXPECT_EQ(stats.tiles, 1);
+    EXPECT_EQ(stats.used, 4096);
+
+    // tiles in use survive clearing
+    cache.Clear();
+    EXPECT_TRUE(cache.Contains(id1));
+    shared.reset();
+    cache.Clear();
+    EXPECT_FALSE(other.Contains(id1));
+    EXPECT_EQ(cache.Stats().used, 0);
+  }
+  ShmTileCache::Remove(name);
+}
+
+TEST(ShmCache, EvictsLeastRecentlyUsed) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    ShmTileCache cache(name, 64 * 1024, 0);
+    // the pinned first tile has to stay while the others take turns
+    auto pinned = cache.Put(GraphId(0, 2, 0), MakeTile(GraphId(0, 2, 0), 16000), 16000);
+    pinned = cache.Get(GraphId(0, 2, 0));
+    ASSERT_NE(pinned, nullptr);
+    for (uint32_t i = 1; i < 20; ++i) {
+      GraphId id(i, 2, 0);
+      cache.Put(id, MakeTile(id, 16000), 16000);
+      EXPECT_TRUE(cache.Contains(id));
+    }
+    EXPECT_TRUE(cache.Contains(GraphId(0, 2, 0)));
+    EXPECT_FALSE(cache.Contains(GraphId(1, 2, 0)));
+    EXPECT_TRUE(cache.Contains(GraphId(19, 2, 0)));
+    EXPECT_GT(cache.Stats().evictions, 0);
+    EXPECT_LE(cache.Stats().used, cache.Stats().capacity);
+
+    // tiles bigger than the cache are handed back but not shared
+    GraphId big(100, 2, 0);
+    CheckGraphTile(cache.Put(big, MakeTile(big, 128 * 1024), 128 * 1024), big, 128 * 1024);
+    EXPECT_FALSE(cache.Contains(big));
+  }
+  ShmTileCache::Remove(name);
+}
+
+TEST(ShmCache, EvictsOnlyWhatIsNeeded) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    // four tiles fill the cache, each further one takes the place of exactly one of them
+    ShmTileCache cache(name, 64 * 1024, 0);
+    for (uint32_t i = 0; i < 4; ++i) {
+      GraphId id(i, 2, 0);
+      cache.Put(id, MakeTile(id, 16000), 16000);
+    }
+    ASSERT_EQ(cache.Stats().tiles, 4);
+    ASSERT_EQ(cache.Stats().evictions, 0);
+    for (uint32_t i = 4; i < 8; ++i) {
+      GraphId id(i, 2, 0);
+      cache.Put(id, MakeTile(id, 16000), 16000);
+      EXPECT_EQ(cache.Stats().tiles, 4);
+      EXPECT_EQ(cache.Stats().evictions, i - 3);
+    }
+  }
+  ShmTileCache::Remove(name);
+}
+
+TEST(ShmCache, LooksUpWhileOthersWrite) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    // readers without the lock must only ever get the tile they asked for, whole, while the
+    // table is filled, cleared and rehashed under them
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> hits{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+      readers.emplace_back([&name, &done, &hits]() {
+        ShmTileCache cache(name, 1 << 20, 0);
+        for (uint32_t i = 0; !done.load(); i = (i + 1) % 300) {
+          GraphId id(i, 2, 0);
+          auto tile = cache.Get(id);
+          if (tile) {
+            EXPECT_EQ(tile->header()->graphid(), id);
+            EXPECT_EQ(tile->header()->end_offset(), 1024 + i);
+            ++hits;
+          }
+        }
+      });
+    }
+    ShmTileCache cache(name, 1 << 20, 0);
+    // keep at it until the readers had their share of hits
+    for (int round = 0; round < 20 || (hits.load() < 1000 && round < 10000); ++round) {
+      for (uint32_t i = 0; i < 300; ++i) {
+        GraphId id(i, 2, 0);
+        cache.Put(id, MakeTile(id, 1024 + i), 1024 + i);
+      }
+      cache.Clear();
+    }
+    done = true;
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    EXPECT_GE(hits.load(), 1000);
+
+    // nothing was left pinned
+    cache.Clear();
+    EXPECT_EQ(cache.Stats().tiles, 0);
+  }
+  ShmTileCache::Remove(name);
+}
+
+TEST(ShmCache, ClearManyTiles) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    // more tiles than it takes tombstones to rehash the table, clearing must still get all of them
+    ShmTileCache cache(name, 1 << 20, 0);
+    for (uint32_t i = 0; i < 400; ++i) {
+      GraphId id(i, 2, 0);
+      cache.Put(id, MakeTile(id, 1024), 1024);
+    }
+    ASSERT_EQ(cache.Stats().tiles, 400);
+    auto pinned = cache.Get(GraphId(7, 2, 0));
+    ASSERT_NE(pinned, nullptr);
+
+    cache.Clear();
+    EXPECT_EQ(cache.Stats().tiles, 1);
+    EXPECT_EQ(cache.Stats().used, 1024);
+    EXPECT_EQ(cache.Stats().evictions, 399);
+    EXPECT_TRUE(cache.Contains(GraphId(7, 2, 0)));
+    for (uint32_t i = 0; i < 400; ++i) {
+      EXPECT_EQ(cache.Contains(GraphId(i, 2, 0)), i == 7);
+    }
+  }
+  ShmTileCache::Remove(name);
+}
+
+TEST(ShmCache, SharedAcrossProcesses) {
+  const std::string name = "/valhalla_test_" + std::to_string(getpid());
+  ShmTileCache::Remove(name);
+  {
+    ShmTileCache cache(name, 1 << 20, 0);
+    GraphId id(5, 1, 0);
+    // the child loads the tile and dies without letting go of it
+    pid_t child = fork();
+    if (child == 0) {
+      ShmTileCache child_cache(name, 1 << 20, 0);
+      child_cache.Put(id, MakeTile(id, 8192), 8192);
+      auto pinned = child_cache.Get(id);
+      _exit(pinned ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+    CheckGraphTile(cache.Get(id), id, 8192);
+
+    cache.Clear();
+    EXPECT_TRUE(cache.Contains(id));
+
+    // the pin of the dead child is reclaimed when the next process attaches
+    ShmTileCache restarted(name, 1 << 20, 0);
+    restarted.Clear();
+    EXPECT_FALSE(cache.Contains(id));
+  }
+  ShmTileCache::Remove(name);
+}
+#endif
+
 } // namespace
 
 int main(int argc, char* argv[]) {
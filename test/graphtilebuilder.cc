@@ -5,6 +5,7 @@
 #include "midgard/pointll.h"
 #include "test.h"
 
+#include <filesystem>
 #include <fstream>
 #include <streambuf>
 #include <string>
@@ -276,6 +277,184 @@ TEST(GraphTileBuilder, TestAddBins) {
   }
 }
 
+TEST(GraphTileBuilder, TestHotEdges) {
+  std::string test_dir = "test/data/builder_tiles";
+  GraphId tile_id(1, 2, 0);
+  std::filesystem::remove(test_dir + "/" + GraphTile::FileSuffix(tile_id));
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, false);
+    bool added = false;
+    auto edgeinfo_offset =
+        builder.AddEdgeInfo(0, GraphId(1, 2, 0), GraphId(1, 2, 1), 1234, 555, 0, 120,
+                            std::list<PointLL>{{0, 0}, {1, 1}}, {"einzelweg"}, {}, {}, 0, added);
+    for (uint32_t i = 0; i < 3; ++i) {
+      DirectedEdge edge;
+      edge.set_edgeinfo_offset(edgeinfo_offset);
+      edge.set_endnode(GraphId(i == 2 ? 2 : 1, 2, i));
+      edge.set_leaves_tile(i == 2);
+      edge.set_length(100 * (i + 1));
+      edge.set_localedgeidx(i);
+      edge.set_speed(30 + i);
+      edge.set_classification(RoadClass::kSecondary);
+      edge.set_use(Use::kRoad);
+      edge.set_forwardaccess(kAutoAccess | kPedestrianAccess);
+      edge.set_reverseaccess(i == 1 ? kPedestrianAccess : kAutoAccess);
+      if (i == 0) {
+        edge.set_shortcut(2);
+      } else {
+        edge.set_superseded(2);
+      }
+      builder.directededges().emplace_back(std::move(edge));
+    }
+    builder.StoreTileData();
+  }
+
+  // a tile without the columns doesn't have them
+  EXPECT_TRUE(GraphTile::Create(test_dir, tile_id)->hot_edges().empty());
+
+  // add them and check they match the directed edges
+  test_graph_tile_builder(test_dir, tile_id, false).AddHotEdges();
+  auto check_columns = [&](uint32_t first_speed) {
+    auto tile = GraphTile::Create(test_dir, tile_id);
+    const auto& hot_edges = tile->hot_edges();
+    ASSERT_FALSE(hot_edges.empty());
+    EXPECT_EQ(tile->header()->hot_edges_offset() % 8, 0);
+    EXPECT_EQ(tile->header()->end_offset(), tile->header()->hot_edges_offset() + hot_edges_size(3));
+    for (uint32_t i = 0; i < 3; ++i) {
+      const auto* edge = tile->directededge(i);
+      EXPECT_EQ(hot_edges.endnode(i), edge->endnode());
+      EXPECT_EQ(hot_edges.length(i), edge->length());
+      EXPECT_EQ(hot_edges.speed(i), i == 0 ? first_speed : edge->speed());
+      EXPECT_EQ(hot_edges.speed(i), edge->speed());
+      EXPECT_EQ(hot_edges.classification(i), edge->classification());
+      EXPECT_EQ(hot_edges.use(i), edge->use());
+      EXPECT_EQ(hot_edges.forwardaccess(i), edge->forwardaccess());
+      EXPECT_EQ(hot_edges.reverseaccess(i), edge->reverseaccess());
+      EXPECT_EQ(hot_edges.superseded(i), edge->superseded());
+      EXPECT_EQ(hot_edges.shortcut(i), edge->shortcut());
+      EXPECT_EQ(hot_edges.is_shortcut(i), edge->is_shortcut());
+      EXPECT_EQ(hot_edges.leaves_tile(i), edge->leaves_tile());
+      EXPECT_EQ(hot_edges.localedgeidx(i), edge->localedgeidx());
+    }
+  };
+  check_columns(30);
+
+  // adding them again replaces them
+  test_graph_tile_builder(test_dir, tile_id, false).AddHotEdges();
+  check_columns(30);
+
+  // storing the tile again keeps them in sync
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, true);
+    builder.directededges()[0].set_speed(40);
+    builder.StoreTileData();
+  }
+  check_columns(40);
+
+  // and so does adding predicted speeds, which go in before them
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, false);
+    auto tile = GraphTile::Create(test_dir, tile_id);
+    std::vector<DirectedEdge> edges(tile->directededge(0), tile->directededge(0) + 3);
+    edges[0].set_speed(50);
+    edges[0].set_has_predicted_speed(true);
+    builder.AddPredictedSpeed(0, std::array<int16_t, kCoefficientCount>{});
+    builder.UpdatePredictedSpeeds(edges);
+  }
+  check_columns(50);
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  EXPECT_EQ(tile->header()->predictedspeeds_count(), 1);
+  EXPECT_TRUE(tile->hot_edges().flags(0) & kHotEdgePredictedSpeed);
+}
+
+TEST(GraphTileBuilder, TestShortcutEdges) {
+  std::string test_dir = "test/data/builder_tiles";
+  GraphId tile_id(3, 1, 0);
+  std::filesystem::remove(test_dir + "/" + GraphTile::FileSuffix(tile_id));
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, false);
+    bool added = false;
+    auto edgeinfo_offset =
+        builder.AddEdgeInfo(0, GraphId(3, 1, 0), GraphId(3, 1, 1), 1234, 555, 0, 120,
+                            std::list<PointLL>{{0, 0}, {1, 1}}, {"abkuerzung"}, {}, {}, 0, added);
+    for (uint32_t i = 0; i < 4; ++i) {
+      DirectedEdge edge;
+      edge.set_edgeinfo_offset(edgeinfo_offset);
+      edge.set_endnode(GraphId(3, 1, i));
+      edge.set_length(100 * (i + 1));
+      edge.set_speed(30);
+      if (i < 2) {
+        edge.set_shortcut(i + 1);
+      } else {
+        edge.set_superseded(1);
+      }
+      builder.directededges().emplace_back(std::move(edge));
+    }
+    builder.StoreTileData();
+  }
+
+  // a tile without them doesn't have them
+  std::vector<GraphId> edges;
+  EXPECT_TRUE(GraphTile::Create(test_dir, tile_id)->shortcut_edges().empty());
+  EXPECT_FALSE(GraphTile::Create(test_dir, tile_id)->shortcut_edges().get(0, edges));
+
+  // the first shortcut supersedes two edges, one of them in another tile, the second one failed
+  std::vector<std::pair<uint32_t, std::vector<GraphId>>> shortcuts{
+      {0, {GraphId(3, 1, 2), GraphId(4, 1, 7)}},
+      {1, {}},
+  };
+  auto check_shortcut_edges = [&]() {
+    auto tile = GraphTile::Create(test_dir, tile_id);
+    const auto& shortcut_edges = tile->shortcut_edges();
+    ASSERT_FALSE(shortcut_edges.empty());
+    EXPECT_EQ(shortcut_edges.count(), 2);
+    EXPECT_EQ(tile->header()->shortcut_edges_offset() % 8, 0);
+    ASSERT_TRUE(shortcut_edges.get(0, edges));
+    EXPECT_EQ(edges, shortcuts[0].second);
+    ASSERT_TRUE(shortcut_edges.get(1, edges));
+    EXPECT_TRUE(edges.empty());
+    EXPECT_FALSE(shortcut_edges.get(2, edges));
+    EXPECT_FALSE(shortcut_edges.get(7, edges));
+  };
+  test_graph_tile_builder(test_dir, tile_id, false).AddShortcutEdges(shortcuts);
+  check_shortcut_edges();
+
+  // the hot edge columns go after them and move back when they are added again
+  test_graph_tile_builder(test_dir, tile_id, false).AddHotEdges();
+  test_graph_tile_builder(test_dir, tile_id, false).AddShortcutEdges(shortcuts);
+  check_shortcut_edges();
+  {
+    auto tile = GraphTile::Create(test_dir, tile_id);
+    EXPECT_GT(tile->header()->hot_edges_offset(), tile->header()->shortcut_edges_offset());
+    EXPECT_EQ(tile->header()->end_offset(), tile->header()->hot_edges_offset() + hot_edges_size(4));
+    EXPECT_EQ(tile->hot_edges().speed(0), 30);
+  }
+
+  // storing the tile again keeps them
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, true);
+    builder.directededges()[0].set_speed(40);
+    builder.StoreTileData();
+  }
+  check_shortcut_edges();
+  EXPECT_EQ(GraphTile::Create(test_dir, tile_id)->hot_edges().speed(0), 40);
+
+  // and so does adding predicted speeds, which go in before them
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, false);
+    auto tile = GraphTile::Create(test_dir, tile_id);
+    std::vector<DirectedEdge> edges(tile->directededge(0), tile->directededge(0) + 4);
+    edges[0].set_has_predicted_speed(true);
+    builder.AddPredictedSpeed(0, std::array<int16_t, kCoefficientCount>{});
+    builder.UpdatePredictedSpeeds(edges);
+  }
+  check_shortcut_edges();
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  EXPECT_EQ(tile->header()->predictedspeeds_count(), 1);
+  EXPECT_LT(tile->header()->predictedspeeds_offset(), tile->header()->shortcut_edges_offset());
+  EXPECT_EQ(tile->hot_edges().speed(0), 40);
+}
+
 struct fake_tile : public GraphTile {
 public:
   fake_tile(const std::string& plyenc_shape) {
@@ -335,6 +514,67 @@ TEST(GraphTileBuilder, TestBinEdges) {
 
 } // namespace
 
+TEST(GraphTileBuilder, TestReorderNodes) {
+  std::string test_dir = "test/data/builder_tiles";
+  GraphId tile_id(2, 2, 0);
+  std::filesystem::remove(test_dir + "/" + GraphTile::FileSuffix(tile_id));
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, false);
+    bool added = false;
+    auto edgeinfo_offset =
+        builder.AddEdgeInfo(0, GraphId(1, 2, 0), GraphId(1, 2, 1), 1234, 555, 0, 120,
+                            std::list<PointLL>{{0, 0}, {1, 1}}, {"einzelweg"}, {}, {}, 0, added);
+    // node 0 has edges 0 and 1, node 1 has edge 2 and node 2 has edge 3
+    const std::vector<uint32_t> edge_counts{2, 1, 1};
+    for (uint32_t n = 0, e = 0; n < edge_counts.size(); ++n) {
+      NodeInfo node;
+      node.set_edge_index(e);
+      node.set_edge_count(edge_counts[n]);
+      builder.nodes().emplace_back(std::move(node));
+      for (uint32_t i = 0; i < edge_counts[n]; ++i, ++e) {
+        DirectedEdge edge;
+        edge.set_edgeinfo_offset(edgeinfo_offset);
+        edge.set_endnode(GraphId(1, 2, (n + 1) % 3));
+        edge.set_length(100 * (e + 1));
+        builder.directededges().emplace_back(std::move(edge));
+      }
+    }
+    builder.AddSigns(2, {SignInfo(Sign::Type::kExitNumber, false, false, false, 0, 0, "12")});
+    builder.AddSigns(1, {SignInfo(Sign::Type::kJunctionName, false, false, false, 0, 0, "Kreuz")});
+    builder.AddAccessRestriction(AccessRestriction(3, AccessType::kMaxWeight, kAllAccess, 7));
+    builder.StoreTileData();
+  }
+
+  {
+    test_graph_tile_builder builder(test_dir, tile_id, true);
+    EXPECT_THROW(builder.ReorderNodes({0, 1}), std::runtime_error);
+    auto edge_map = builder.ReorderNodes({2, 0, 1});
+    EXPECT_EQ(edge_map, (std::vector<uint32_t>{1, 2, 3, 0}));
+    builder.StoreTileData();
+  }
+
+  // the nodes moved along with their edges and everything indexed by them
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  ASSERT_EQ(tile->header()->nodecount(), 3);
+  const std::vector<std::pair<uint32_t, uint32_t>> expected_nodes{{0, 1}, {1, 2}, {3, 1}};
+  for (uint32_t n = 0; n < expected_nodes.size(); ++n) {
+    EXPECT_EQ(tile->node(n)->edge_index(), expected_nodes[n].first);
+    EXPECT_EQ(tile->node(n)->edge_count(), expected_nodes[n].second);
+  }
+  const std::vector<uint32_t> expected_lengths{400, 100, 200, 300};
+  for (uint32_t e = 0; e < expected_lengths.size(); ++e) {
+    EXPECT_EQ(tile->directededge(e)->length(), expected_lengths[e]);
+  }
+  auto exit_signs = tile->GetSigns(3);
+  ASSERT_EQ(exit_signs.size(), 1);
+  EXPECT_EQ(exit_signs[0].text(), "12");
+  auto node_signs = tile->GetSigns(2, true);
+  ASSERT_EQ(node_signs.size(), 1);
+  EXPECT_EQ(node_signs[0].text(), "Kreuz");
+  EXPECT_EQ(tile->GetAccessRestrictions(0, kAllAccess).size(), 1);
+  EXPECT_TRUE(tile->GetAccessRestrictions(3, kAllAccess).empty());
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -240,6 +240,40 @@ rapidjson::Document convert_to_json(valhalla::Api& raw_result, valhalla::Options
  */
 std::string dump_geojson_graph(const map& graph);
 
+namespace fixtures {
+
+/**
+ * A 3x4 grid with oneways in both directions and a primary road across its middle, the matrix
+ * tests compare their algorithms and threads on it. Every node is a location to route between.
+ */
+inline const std::string grid_map = R"(
+      A---1---B-------C---2---D
+      |       |       |       |
+      3       |       4       |
+      |       |       |       |
+      E-------F---5---G-------H
+      |       |       |       |
+      |       6       |       7
+      |       |       |       |
+      I---8---J-------K-------L
+    )";
+
+inline const ways grid_ways = {
+    {"AB", {{"highway", "residential"}}},
+    {"BC", {{"highway", "residential"}, {"oneway", "yes"}}},
+    {"CD", {{"highway", "residential"}}},
+    {"EFGH", {{"highway", "primary"}}},
+    {"IJ", {{"highway", "residential"}}},
+    {"JK", {{"highway", "residential"}, {"oneway", "-1"}}},
+    {"KL", {{"highway", "residential"}}},
+    {"AEI", {{"highway", "residential"}}},
+    {"BFJ", {{"highway", "tertiary"}}},
+    {"CGK", {{"highway", "residential"}, {"oneway", "yes"}}},
+    {"DHL", {{"highway", "residential"}}},
+};
+
+} // namespace fixtures
+
 namespace assert {
 namespace osrm {
 
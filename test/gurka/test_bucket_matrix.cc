@@ -0,0 +1,73 @@
+#include "gurka.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::vector<std::string> locations = {"A", "D", "F", "K", "L", "1", "2",
+                                            "3", "4", "5", "6", "7", "8"};
+
+} // namespace
+
+class BucketMatrix : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map costmatrix_map;
+
+  static void SetUpTestSuite() {
+    const auto layout = gurka::detail::map_to_coordinates(gurka::fixtures::grid_map, 100);
+    map = gurka::buildtiles(layout, gurka::fixtures::grid_ways, {}, {}, "test/data/bucket_matrix",
+                            {{"thor.source_to_target_algorithm", "bucketmatrix"}});
+    costmatrix_map = map;
+    costmatrix_map.config.put("thor.source_to_target_algorithm", "costmatrix");
+  }
+};
+
+gurka::map BucketMatrix::map = {};
+gurka::map BucketMatrix::costmatrix_map = {};
+
+TEST_F(BucketMatrix, SameAsCostMatrix) {
+  for (const auto& costing : {"auto", "pedestrian", "bicycle"}) {
+    auto buckets =
+        gurka::do_action(Options::sources_to_targets, map, locations, locations, costing);
+    auto costmatrix = gurka::do_action(Options::sources_to_targets, costmatrix_map, locations,
+                                       locations, costing);
+    ASSERT_EQ(buckets.matrix().algorithm(), Matrix::BucketMatrix);
+    ASSERT_EQ(costmatrix.matrix().algorithm(), Matrix::CostMatrix);
+
+    const auto& expected = costmatrix.matrix();
+    const auto& matrix = buckets.matrix();
+    ASSERT_EQ(matrix.times_size(), locations.size() * locations.size());
+    for (int i = 0; i < matrix.times_size(); ++i) {
+      const auto& from = locations[i / locations.size()];
+      const auto& to = locations[i % locations.size()];
+      EXPECT_EQ(matrix.from_indices(i), expected.from_indices(i));
+      EXPECT_EQ(matrix.to_indices(i), expected.to_indices(i));
+      EXPECT_EQ(matrix.distances(i), expected.distances(i)) << costing << " " << from << to;
+      EXPECT_NEAR(matrix.times(i), expected.times(i), 1.f) << costing << " " << from << to;
+    }
+  }
+}
+
+TEST_F(BucketMatrix, TrivialRoutes) {
+  // against and along the oneway between B and C and from one edge onto the next
+  auto result =
+      gurka::do_action(Options::sources_to_targets, map, {"2", "1", "5"}, {"1", "2", "6"}, "auto");
+  const auto& matrix = result.matrix();
+  EXPECT_EQ(matrix.distances(0), 2400);
+  EXPECT_EQ(matrix.distances(1), 0);
+  EXPECT_EQ(matrix.distances(3), 0);
+  EXPECT_EQ(matrix.distances(4), 1600);
+  EXPECT_EQ(matrix.distances(8), 600);
+}
+
+TEST_F(BucketMatrix, TimeDependentFallsBack) {
+  // the searches don't depend on the time, requests with one take the other algorithms
+  auto result =
+      gurka::do_action(Options::sources_to_targets, map, {"A", "L"}, {"A", "L"}, "auto",
+                       {{"/date_time/type", "1"}, {"/date_time/value", "2024-10-10T08:00"}});
+  EXPECT_NE(result.matrix().algorithm(), Matrix::BucketMatrix);
+  EXPECT_GT(result.matrix().times(1), 0.f);
+}
@@ -0,0 +1,88 @@
+#include "baldr/connectivity_map.h"
+#include "gurka.h"
+#include "loki/search.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+class ConnectivityMap : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static std::string map_file;
+
+  static void SetUpTestSuite() {
+    // 10km between the nodes puts A and B into one local tile and C and D into the next one, the
+    // footway is the only way from one to the other
+    constexpr double gridsize_metres = 5000;
+    const std::string ascii_map = R"(
+      A-B-C-D
+    )";
+    const gurka::ways ways = {{"AB", {{"highway", "residential"}}},
+                              {"BC", {{"highway", "footway"}}},
+                              {"CD", {{"highway", "residential"}}}};
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize_metres, {0.11, 0.1});
+
+    const std::string workdir = VALHALLA_BUILD_DIR "test/data/gurka_connectivity_map";
+    map_file = workdir + "/connectivity.bin";
+    map = gurka::buildtiles(layout, ways, {}, {}, workdir,
+                            {{"mjolnir.concurrency", "1"}, {"mjolnir.connectivity_map", map_file}});
+
+    // what valhalla_build_connectivity does
+    connectivity_map_t built(map.config.get_child("mjolnir"), {}, true);
+    built.save(map_file);
+  }
+};
+
+gurka::map ConnectivityMap::map = {};
+std::string ConnectivityMap::map_file = {};
+
+TEST_F(ConnectivityMap, Components) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  connectivity_map_t mapped(map.config.get_child("mjolnir"), reader);
+  ASSERT_TRUE(mapped.has_components(kAutoAccess));
+  ASSERT_TRUE(mapped.has_components(kPedestrianAccess));
+  EXPECT_FALSE(mapped.has_components(kAutoAccess | kTruckAccess));
+
+  auto components = [&](const std::string& node, uint32_t access) {
+    auto costing = sif::CostFactory().Create(access == kAutoAccess ? Costing::auto_
+                                                                   : Costing::pedestrian);
+    baldr::Location location(map.nodes.at(node));
+    auto found = loki::Search({location}, *reader, costing);
+    return mapped.get_components(access, found.at(location), *reader);
+  };
+
+  auto a_auto = components("A", kAutoAccess);
+  auto d_auto = components("D", kAutoAccess);
+  ASSERT_FALSE(a_auto.empty());
+  ASSERT_FALSE(d_auto.empty());
+  for (auto component : a_auto) {
+    EXPECT_EQ(d_auto.count(component), 0) << "cars can't get across the footway";
+  }
+
+  auto a_pedestrian = components("A", kPedestrianAccess);
+  auto d_pedestrian = components("D", kPedestrianAccess);
+  EXPECT_EQ(a_pedestrian, d_pedestrian);
+}
+
+TEST_F(ConnectivityMap, RejectsRoute) {
+  try {
+    gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+    FAIL() << "Expected the route to be rejected";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 170); }
+
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "pedestrian");
+  gurka::assert::raw::expect_path(result, {"AB", "BC", "CD"});
+}
+
+TEST_F(ConnectivityMap, RejectsMatrix) {
+  try {
+    gurka::do_action(Options::sources_to_targets, map, {"A"}, {"D"}, "auto");
+    FAIL() << "Expected the matrix to be rejected";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 170); }
+
+  // one of the targets can be reached so there is something to compute
+  auto result = gurka::do_action(Options::sources_to_targets, map, {"A"}, {"B", "D"}, "auto");
+  EXPECT_EQ(result.matrix().distances_size(), 2);
+}
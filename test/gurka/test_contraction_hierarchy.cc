@@ -0,0 +1,269 @@
+#include "gurka.h"
+#include "mjolnir/contractionbuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+using namespace valhalla;
+
+namespace {
+
+// the ways run straight from node to node, which keeps the best routes from tying
+const std::string ascii_map = R"(
+      A--B-1--C--D
+
+         E-F
+
+          G-2--H
+    )";
+
+const gurka::ways ways = {
+    {"AB", {{"highway", "residential"}}}, {"BC", {{"highway", "residential"}}},
+    {"CD", {{"highway", "residential"}}}, {"BE", {{"highway", "residential"}}},
+    {"CF", {{"highway", "residential"}}}, {"EF", {{"highway", "residential"}}},
+    {"EG", {{"highway", "residential"}}}, {"FH", {{"highway", "residential"}}},
+    {"GH", {{"highway", "residential"}}},
+};
+
+// builds the tiles and what the contraction stage of valhalla_build_tiles would
+gurka::map build_map(const gurka::relations& relations,
+                     const std::string& name,
+                     const std::string& map_ascii = ascii_map,
+                     const gurka::ways& map_ways = ways) {
+  const auto layout = gurka::detail::map_to_coordinates(map_ascii, 100);
+  const std::string workdir = VALHALLA_BUILD_DIR "test/data/gurka_contraction_hierarchy_" + name;
+  auto map = gurka::buildtiles(layout, map_ways, {}, relations, workdir,
+                               {{"mjolnir.contraction_hierarchy", workdir + "/hierarchy.bin"}});
+  mjolnir::ContractionBuilder::Build(map.config);
+  return map;
+}
+
+const std::string& algorithm(const valhalla::Api& result) {
+  return result.trip().routes(0).legs(0).algorithms(0);
+}
+
+// the bounding box around every point of the contours of an isochrone
+std::vector<double> contour_bbox(const std::string& json) {
+  rapidjson::Document doc;
+  doc.Parse(json.c_str());
+  std::vector<double> bbox{std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                           std::numeric_limits<double>::lowest(),
+                           std::numeric_limits<double>::lowest()};
+  std::function<void(const rapidjson::Value&)> expand = [&](const rapidjson::Value& value) {
+    if (value.Size() == 2 && value[0].IsNumber()) {
+      bbox[0] = std::min(bbox[0], value[0].GetDouble());
+      bbox[1] = std::min(bbox[1], value[1].GetDouble());
+      bbox[2] = std::max(bbox[2], value[0].GetDouble());
+      bbox[3] = std::max(bbox[3], value[1].GetDouble());
+      return;
+    }
+    for (const auto& child : value.GetArray()) {
+      expand(child);
+    }
+  };
+  for (const auto& feature : doc["features"].GetArray()) {
+    if (feature["properties"].HasMember("contour")) {
+      expand(feature["geometry"]["coordinates"]);
+    }
+  }
+  return bbox;
+}
+
+} // namespace
+
+class ContractionHierarchy : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    // going straight on at B is not allowed
+    const gurka::relations relations = {{{
+                                             {gurka::way_member, "AB", "from"},
+                                             {gurka::way_member, "BC", "to"},
+                                             {gurka::node_member, "B", "via"},
+                                         },
+                                         {{"type", "restriction"},
+                                          {"restriction", "no_straight_on"}}}};
+    map = build_map(relations, "simple");
+  }
+};
+
+gurka::map ContractionHierarchy::map = {};
+
+TEST_F(ContractionHierarchy, Route) {
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+
+  result = gurka::do_action(Options::route, map, {"G", "A"}, "auto");
+  EXPECT_EQ(algorithm(result), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"EG", "BE", "AB"});
+}
+
+TEST_F(ContractionHierarchy, SameAsBidirectional) {
+  // without the hierarchy the same route comes from bidirectional a*
+  auto without = map;
+  without.config.put("mjolnir.contraction_hierarchy", "");
+  for (const auto& locations : std::vector<std::vector<std::string>>{{"A", "H"},
+                                                                     {"D", "G"},
+                                                                     {"H", "A"},
+                                                                     {"E", "D"}}) {
+    auto ch = gurka::do_action(Options::route, map, locations, "auto");
+    auto bidir = gurka::do_action(Options::route, without, locations, "auto");
+    EXPECT_EQ(algorithm(ch), "contraction_hierarchy");
+    EXPECT_EQ(algorithm(bidir), "bidirectional_a*");
+    EXPECT_EQ(gurka::detail::get_paths(ch), gurka::detail::get_paths(bidir));
+  }
+}
+
+TEST_F(ContractionHierarchy, PartwayAlongEdges) {
+  // 1 and 2 sit in the middle of their edges, so the searches start partway along them
+  auto without = map;
+  without.config.put("mjolnir.contraction_hierarchy", "");
+  for (const auto& locations : std::vector<std::vector<std::string>>{{"E", "1"},
+                                                                     {"D", "2"},
+                                                                     {"1", "2"},
+                                                                     {"2", "1"},
+                                                                     {"H", "1"}}) {
+    auto ch = gurka::do_action(Options::route, map, locations, "auto");
+    auto bidir = gurka::do_action(Options::route, without, locations, "auto");
+    EXPECT_EQ(algorithm(ch), "contraction_hierarchy");
+    EXPECT_EQ(gurka::detail::get_paths(ch), gurka::detail::get_paths(bidir));
+    EXPECT_NEAR(ch.directions().routes(0).legs(0).summary().time(),
+                bidir.directions().routes(0).legs(0).summary().time(), 0.1);
+  }
+}
+
+TEST_F(ContractionHierarchy, OtherRequests) {
+  // the hierarchy only knows the default auto costing without time
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto",
+                                 {{"/costing_options/auto/use_highways", "0.2"}});
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+
+  result = gurka::do_action(Options::route, map, {"A", "D"}, "auto",
+                            {{"/date_time/type", "0"}, {"/date_time/value", "current"}});
+  EXPECT_NE(algorithm(result), "contraction_hierarchy");
+
+  result = gurka::do_action(Options::route, map, {"A", "D"}, "pedestrian");
+  EXPECT_NE(algorithm(result), "contraction_hierarchy");
+}
+
+TEST(ContractionHierarchyRestrictions, FallsBackOnComplexRestriction) {
+  // on top of the turn at B, going on to F after coming from A to E is not allowed
+  const gurka::relations relations = {
+      {{
+           {gurka::way_member, "AB", "from"},
+           {gurka::way_member, "BC", "to"},
+           {gurka::node_member, "B", "via"},
+       },
+       {{"type", "restriction"}, {"restriction", "no_straight_on"}}},
+      {{
+           {gurka::way_member, "AB", "from"},
+           {gurka::way_member, "BE", "via"},
+           {gurka::way_member, "EF", "to"},
+       },
+       {{"type", "restriction"}, {"restriction", "no_left_turn"}}},
+  };
+  auto map = build_map(relations, "complex");
+
+  // the hierarchy finds the path through E and F, which breaks the restriction
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EG", "GH", "FH", "CF", "CD"});
+
+  // routes the restriction doesn't apply to still use it
+  result = gurka::do_action(Options::route, map, {"E", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"EF", "CF", "CD"});
+}
+
+TEST(ContractionHierarchyDestinationOnly, AvoidsDestinationOnlyShortcut) {
+  // going through the destination-only street is shorter than going around it
+  const std::string destonly_map = R"(
+      A----B-1--C----D
+           |    |
+           E----F
+    )";
+  const gurka::ways destonly_ways = {
+      {"AB", {{"highway", "residential"}}},
+      {"BC", {{"highway", "residential"}, {"motor_vehicle", "destination"}}},
+      {"CD", {{"highway", "residential"}}},
+      {"BE", {{"highway", "residential"}}},
+      {"EF", {{"highway", "residential"}}},
+      {"CF", {{"highway", "residential"}}},
+  };
+  auto map = build_map({}, "destonly", destonly_map, destonly_ways);
+  auto without = map;
+  without.config.put("mjolnir.contraction_hierarchy", "");
+
+  // bidirectional a* goes around it on its first pass and so does the hierarchy
+  auto bidir = gurka::do_action(Options::route, without, {"A", "D"}, "auto");
+  gurka::assert::raw::expect_path(bidir, {"AB", "BE", "EF", "CF", "CD"});
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+
+  // routes into or out of it are left to bidirectional a*
+  for (const auto& locations : std::vector<std::vector<std::string>>{{"A", "1"}, {"1", "D"}}) {
+    result = gurka::do_action(Options::route, map, locations, "auto");
+    bidir = gurka::do_action(Options::route, without, locations, "auto");
+    EXPECT_EQ(algorithm(result), "bidirectional_a*");
+    EXPECT_EQ(gurka::detail::get_paths(result), gurka::detail::get_paths(bidir));
+  }
+}
+
+TEST_F(ContractionHierarchy, SweepMatrixSameAsDijkstra) {
+  // from a single source to enough targets the time distance matrix sweeps the hierarchy
+  auto sweep = map;
+  sweep.config.put("thor.contraction_sweep.matrices", true);
+  sweep.config.put("thor.contraction_sweep.min_targets", 3);
+  auto dijkstra = map;
+  dijkstra.config.put("mjolnir.contraction_hierarchy", "");
+  dijkstra.config.put("thor.source_to_target_algorithm", "timedistancematrix");
+
+  const std::vector<std::string> targets = {"A", "D", "1", "2", "E", "H", "C"};
+  for (const auto& source : {"A", "1", "2", "F"}) {
+    auto swept = gurka::do_action(Options::sources_to_targets, sweep, {source}, targets, "auto");
+    auto expected =
+        gurka::do_action(Options::sources_to_targets, dijkstra, {source}, targets, "auto");
+    ASSERT_EQ(swept.matrix().algorithm(), Matrix::TimeDistanceMatrix);
+    ASSERT_EQ(swept.matrix().times_size(), targets.size());
+    for (int i = 0; i < swept.matrix().times_size(); ++i) {
+      EXPECT_EQ(swept.matrix().distances(i), expected.matrix().distances(i))
+          << source << targets[i];
+      EXPECT_NEAR(swept.matrix().times(i), expected.matrix().times(i), 1.f) << source << targets[i];
+    }
+  }
+
+  // with fewer targets the default algorithm is picked
+  auto result = gurka::do_action(Options::sources_to_targets, sweep, {"A"}, {"D", "H"}, "auto");
+  EXPECT_EQ(result.matrix().algorithm(), Matrix::CostMatrix);
+
+  // matrices aren't swept unless asked to, the sweep costs the same no matter the targets
+  auto off = map;
+  off.config.put("thor.contraction_sweep.min_targets", 3);
+  result = gurka::do_action(Options::sources_to_targets, off, {"A"}, targets, "auto");
+  EXPECT_EQ(result.matrix().algorithm(), Matrix::CostMatrix);
+}
+
+TEST_F(ContractionHierarchy, SweepIsochroneSameAsDijkstra) {
+  auto sweep = map;
+  sweep.config.put("thor.contraction_sweep.isochrones", true);
+  for (const auto& minutes : {"0.5", "1"}) {
+    std::string swept, expected;
+    gurka::do_action(Options::isochrone, sweep, {"1"}, "auto", {{"/contours/0/time", minutes}}, {},
+                     &swept);
+    gurka::do_action(Options::isochrone, map, {"1"}, "auto", {{"/contours/0/time", minutes}}, {},
+                     &expected);
+    // the turns count towards the edge after them rather than the one before, which moves the
+    // contours by less than a cell of the grid
+    const auto swept_bbox = contour_bbox(swept);
+    const auto expected_bbox = contour_bbox(expected);
+    for (size_t i = 0; i < 4; ++i) {
+      EXPECT_NEAR(swept_bbox[i], expected_bbox[i], 0.002) << minutes;
+    }
+  }
+}
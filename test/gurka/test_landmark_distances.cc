@@ -0,0 +1,115 @@
+#include "baldr/landmarkdistances.h"
+#include "gurka.h"
+#include "mjolnir/landmarkdistancebuilder.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string ascii_map = R"(
+      A----B----C
+      |    |    |
+      D----E----F
+      |         |
+      G----H----I
+    )";
+
+const gurka::ways ways = {
+    {"ABC", {{"highway", "residential"}}},
+    {"DEF", {{"highway", "residential"}}},
+    {"GHI", {{"highway", "primary"}}},
+    {"ADG", {{"highway", "residential"}}},
+    {"EB", {{"highway", "residential"}, {"oneway", "yes"}}},
+    {"CFI", {{"highway", "residential"}}},
+};
+
+const std::vector<std::string> nodes = {"A", "B", "C", "D", "E", "F", "G", "H", "I"};
+
+} // namespace
+
+class LandmarkDistances : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  // builds the tiles and what the landmark distances stage of valhalla_build_tiles would
+  static void SetUpTestSuite() {
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    const std::string workdir = VALHALLA_BUILD_DIR "test/data/gurka_landmark_distances";
+    map = gurka::buildtiles(layout, ways, {}, {}, workdir,
+                            {{"mjolnir.landmark_distances", workdir + "/landmarks.bin"},
+                             {"mjolnir.landmark_count", "4"}});
+    mjolnir::LandmarkDistanceBuilder::Build(map.config);
+  }
+};
+
+gurka::map LandmarkDistances::map = {};
+
+TEST_F(LandmarkDistances, Tables) {
+  baldr::LandmarkDistances landmarks(map.config.get<std::string>("mjolnir.landmark_distances"));
+  ASSERT_FALSE(landmarks.empty());
+  ASSERT_LE(landmarks.landmark_count(), 4);
+  for (uint32_t l = 0; l < landmarks.landmark_count(); ++l) {
+    const uint32_t* distances = landmarks.distances(landmarks.landmark(l));
+    ASSERT_NE(distances, nullptr);
+    EXPECT_EQ(distances[2 * l], 0);
+    EXPECT_EQ(distances[2 * l + 1], 0);
+  }
+
+  // the triangle inequality with any landmark bounds the length of the shortest path
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  for (const auto& from : nodes) {
+    const uint32_t* v = landmarks.distances(gurka::findNode(reader, map.nodes, from));
+    ASSERT_NE(v, nullptr) << from;
+    for (const auto& to : nodes) {
+      if (from == to) {
+        continue;
+      }
+      const uint32_t* t = landmarks.distances(gurka::findNode(reader, map.nodes, to));
+      ASSERT_NE(t, nullptr) << to;
+      auto result = gurka::do_action(Options::route, map, {from, to}, "auto",
+                                     {{"/costing_options/auto/shortest", "1"}});
+      const double length = result.directions().routes(0).legs(0).summary().length() * 1000.;
+      for (uint32_t l = 0; l < landmarks.landmark_count(); ++l) {
+        EXPECT_LE(double(t[2 * l]) - v[2 * l], length + 1.) << from << " to " << to;
+        EXPECT_LE(double(v[2 * l + 1]) - t[2 * l + 1], length + 1.) << from << " to " << to;
+      }
+    }
+  }
+}
+
+TEST_F(LandmarkDistances, SameRoutes) {
+  // the heuristics only change how far the searches expand, not the routes they find
+  auto without = map;
+  without.config.put("mjolnir.landmark_distances", "");
+  const std::vector<std::pair<std::string, std::unordered_map<std::string, std::string>>>
+      requests = {
+          {"auto", {}},
+          {"auto", {{"/costing_options/auto/ignore_oneways", "1"}}},
+          {"auto", {{"/date_time/type", "1"}, {"/date_time/value", "2024-10-10T08:00"}}},
+          {"auto", {{"/date_time/type", "2"}, {"/date_time/value", "2024-10-10T08:00"}}},
+          {"pedestrian", {}},
+          {"bicycle", {}},
+      };
+  for (const auto& request : requests) {
+    for (const auto& from : nodes) {
+      for (const auto& to : nodes) {
+        if (from == to) {
+          continue;
+        }
+        auto with = gurka::do_action(Options::route, map, {from, to}, request.first,
+                                     request.second);
+        auto plain = gurka::do_action(Options::route, without, {from, to}, request.first,
+                                      request.second);
+        EXPECT_EQ(gurka::detail::get_paths(with), gurka::detail::get_paths(plain))
+            << request.first << " from " << from << " to " << to;
+        const auto& with_nodes = with.trip().routes(0).legs(0).node();
+        const auto& plain_nodes = plain.trip().routes(0).legs(0).node();
+        EXPECT_FLOAT_EQ(with_nodes.rbegin()->cost().elapsed_cost().cost(),
+                        plain_nodes.rbegin()->cost().elapsed_cost().cost())
+            << request.first << " from " << from << " to " << to;
+      }
+    }
+  }
+}
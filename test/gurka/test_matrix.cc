@@ -1138,4 +1138,49 @@ TEST_P(TestConnectionCheck, MultipleTrivialRoutes) {
   check_trivial_matrix(map, layout);
 }
 
+TEST_P(TestConnectionCheck, ThreadedExpansion) {
+  const auto layout = gurka::detail::map_to_coordinates(gurka::fixtures::grid_map, 100);
+  auto map = gurka::buildtiles(layout, gurka::fixtures::grid_ways, {}, {},
+                               VALHALLA_BUILD_DIR "test/data/costmatrix_threads",
+                               {{"thor.costmatrix.check_reverse_connection", GetParam()},
+                                {"thor.source_to_target_algorithm", "costmatrix"},
+                                {"thor.costmatrix.expansion_batch", "4"}});
+  // every node twice, enough locations for 3 threads
+  std::vector<std::string> locations;
+  for (int i = 0; i < 2; ++i) {
+    for (const auto& node : layout) {
+      locations.push_back(node.first);
+    }
+  }
+
+  // with too few locations for 8 threads the batches are expanded one location after the other,
+  // when the threads expand them instead the result doesn't change
+  const std::unordered_map<std::string, std::string> options = {{"/shape_format", "polyline6"}};
+  map.config.put("thor.costmatrix.threads", "8");
+  const auto expected =
+      gurka::do_action(Options::sources_to_targets, map, locations, locations, "auto", options);
+  for (const auto* threads : {"2", "3"}) {
+    map.config.put("thor.costmatrix.threads", threads);
+    const auto result =
+        gurka::do_action(Options::sources_to_targets, map, locations, locations, "auto", options);
+    ASSERT_EQ(result.matrix().algorithm(), Matrix::CostMatrix);
+    ASSERT_EQ(result.matrix().times_size(), expected.matrix().times_size());
+    for (int i = 0; i < result.matrix().times_size(); ++i) {
+      const auto pair = locations[i / locations.size()] + locations[i % locations.size()];
+      EXPECT_EQ(result.matrix().distances(i), expected.matrix().distances(i)) << threads << pair;
+      EXPECT_EQ(result.matrix().times(i), expected.matrix().times(i)) << threads << pair;
+      EXPECT_EQ(result.matrix().shapes(i), expected.matrix().shapes(i)) << threads << pair;
+    }
+  }
+
+  // and the batches find the same routes as one label at a time on a single thread
+  map.config.put("thor.costmatrix.threads", "1");
+  const auto single =
+      gurka::do_action(Options::sources_to_targets, map, locations, locations, "auto", options);
+  for (int i = 0; i < single.matrix().times_size(); ++i) {
+    const auto pair = locations[i / locations.size()] + locations[i % locations.size()];
+    EXPECT_EQ(single.matrix().distances(i), expected.matrix().distances(i)) << pair;
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(connection_check, TestConnectionCheck, ::testing::Values("1", "0"));
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "gurka.h"
+#include "mjolnir/partitionbuilder.h"
+#include "thor/overlay_customizer.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+// the ways run straight from node to node, which keeps the best routes from tying
+const std::string ascii_map = R"(
+      A--B----C--D---I
+
+         E-F       J
+
+          G----H---K
+    )";
+
+const gurka::ways ways = {
+    {"AB", {{"highway", "residential"}}}, {"BC", {{"highway", "residential"}}},
+    {"CD", {{"highway", "residential"}}}, {"BE", {{"highway", "residential"}}},
+    {"CF", {{"highway", "residential"}}}, {"EF", {{"highway", "residential"}}},
+    {"EG", {{"highway", "residential"}}}, {"FH", {{"highway", "residential"}}},
+    {"GH", {{"highway", "residential"}}}, {"DI", {{"highway", "primary"}}},
+    {"IJ", {{"highway", "primary"}}},     {"JK", {{"highway", "primary"}}},
+    {"HK", {{"highway", "residential"}}},
+};
+
+// builds the tiles and what the partition stage of valhalla_build_tiles would, with cells small
+// enough for the map to span several of them at either level
+gurka::map build_map(const gurka::relations& relations,
+                     const std::string& name,
+                     const std::string& map_ascii = ascii_map,
+                     const gurka::ways& map_ways = ways) {
+  const auto layout = gurka::detail::map_to_coordinates(map_ascii, 100);
+  const std::string workdir = VALHALLA_BUILD_DIR "test/data/gurka_multilevel_dijkstra_" + name;
+  auto map = gurka::buildtiles(layout, map_ways, {}, relations, workdir,
+                               {{"mjolnir.partition_overlay", workdir + "/overlay.bin"},
+                                {"mjolnir.partition_cell_size", "0.001"},
+                                {"mjolnir.partition_levels", "2"},
+                                {"thor.overlay_metric_wait", "60000"},
+                                {"thor.overlay_metric_min_requests", "1"}});
+  mjolnir::PartitionBuilder::Build(map.config);
+  return map;
+}
+
+const std::string& algorithm(const valhalla::Api& result) {
+  return result.trip().routes(0).legs(0).algorithms(0);
+}
+
+} // namespace
+
+class MultiLevelDijkstra : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    // going straight on at B is not allowed
+    const gurka::relations relations = {{{
+                                             {gurka::way_member, "AB", "from"},
+                                             {gurka::way_member, "BC", "to"},
+                                             {gurka::node_member, "B", "via"},
+                                         },
+                                         {{"type", "restriction"},
+                                          {"restriction", "no_straight_on"}}}};
+    map = build_map(relations, "simple");
+  }
+};
+
+gurka::map MultiLevelDijkstra::map = {};
+
+TEST_F(MultiLevelDijkstra, Route) {
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "multilevel_dijkstra");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+
+  result = gurka::do_action(Options::route, map, {"G", "A"}, "pedestrian");
+  EXPECT_EQ(algorithm(result), "multilevel_dijkstra");
+  gurka::assert::raw::expect_path(result, {"EG", "BE", "AB"});
+}
+
+TEST_F(MultiLevelDijkstra, SameAsBidirectional) {
+  // without the overlay the same route comes from bidirectional a*, whatever the costing options
+  auto without = map;
+  without.config.put("mjolnir.partition_overlay", "");
+  const std::vector<std::unordered_map<std::string, std::string>> costing_options = {
+      {},
+      {{"/costing_options/auto/use_highways", "0"}},
+      {{"/costing_options/auto/use_living_streets", "0.1"},
+       {"/costing_options/auto/maneuver_penalty", "60"}},
+  };
+  for (const auto& options : costing_options) {
+    for (const auto& locations : std::vector<std::vector<std::string>>{{"A", "H"},
+                                                                       {"D", "G"},
+                                                                       {"H", "A"},
+                                                                       {"E", "D"},
+                                                                       {"G", "I"},
+                                                                       {"K", "A"}}) {
+      auto overlay = gurka::do_action(Options::route, map, locations, "auto", options);
+      auto bidir = gurka::do_action(Options::route, without, locations, "auto", options);
+      EXPECT_EQ(algorithm(overlay), "multilevel_dijkstra");
+      EXPECT_EQ(algorithm(bidir), "bidirectional_a*");
+      EXPECT_EQ(gurka::detail::get_paths(overlay), gurka::detail::get_paths(bidir));
+    }
+  }
+}
+
+TEST_F(MultiLevelDijkstra, FallsBackUntilCustomized) {
+  // without waiting for the metric the request doesn't hold up on it
+  auto no_wait = map;
+  no_wait.config.put("thor.overlay_metric_wait", 0);
+  auto result = gurka::do_action(Options::route, no_wait, {"A", "D"}, "auto",
+                                 {{"/costing_options/auto/use_tolls", "0.1"}});
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+}
+
+TEST_F(MultiLevelDijkstra, CustomizesOnRepeatedDemand) {
+  // costing options asked for once aren't worth a pass over the whole overlay
+  auto twice = map;
+  twice.config.put("thor.overlay_metric_min_requests", 2);
+  // every request has workers of its own, holding on to the customizer lets them share it
+  const auto& config = twice.config;
+  auto customizer =
+      thor::OverlayCustomizer::get(config.get<std::string>("mjolnir.partition_overlay"),
+                                   config.get_child("thor"), config.get_child("mjolnir"));
+  ASSERT_TRUE(customizer);
+  const std::unordered_map<std::string, std::string> options = {
+      {"/costing_options/auto/use_tolls", "0.3"}};
+  auto result = gurka::do_action(Options::route, twice, {"A", "D"}, "auto", options);
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+  result = gurka::do_action(Options::route, twice, {"A", "D"}, "auto", options);
+  EXPECT_EQ(algorithm(result), "multilevel_dijkstra");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+}
+
+TEST_F(MultiLevelDijkstra, OtherRequests) {
+  // the overlay has no notion of time and would need a metric of its own for excluded locations
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto",
+                                 {{"/date_time/type", "0"}, {"/date_time/value", "current"}});
+  EXPECT_NE(algorithm(result), "multilevel_dijkstra");
+
+  const auto& f = map.nodes.at("F");
+  result = gurka::do_action(Options::route, map, {"A", "D"}, "auto",
+                            {{"/exclude_locations/0/lat", std::to_string(f.lat())},
+                             {"/exclude_locations/0/lon", std::to_string(f.lng())}});
+  EXPECT_NE(algorithm(result), "multilevel_dijkstra");
+}
+
+TEST(MultiLevelDijkstraDestinationOnly, AvoidsDestinationOnlyShortcut) {
+  // going through the destination-only street is shorter than going around it
+  const std::string destonly_map = R"(
+      A----B-1--C----D
+           |    |
+           E----F
+    )";
+  const gurka::ways destonly_ways = {
+      {"AB", {{"highway", "residential"}}},
+      {"BC", {{"highway", "residential"}, {"motor_vehicle", "destination"}}},
+      {"CD", {{"highway", "residential"}}},
+      {"BE", {{"highway", "residential"}}},
+      {"EF", {{"highway", "residential"}}},
+      {"CF", {{"highway", "residential"}}},
+  };
+  auto map = build_map({}, "destonly", destonly_map, destonly_ways);
+
+  // bidirectional a* goes around it on its first pass and so do the metrics
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "multilevel_dijkstra");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EF", "CF", "CD"});
+
+  // routes into it are left to bidirectional a*
+  result = gurka::do_action(Options::route, map, {"A", "1"}, "auto");
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AB", "BC"});
+}
+
+TEST(MultiLevelDijkstraRestrictions, FallsBackOnComplexRestriction) {
+  // on top of the turn at B, going on to F after coming from A to E is not allowed
+  const gurka::relations relations = {
+      {{
+           {gurka::way_member, "AB", "from"},
+           {gurka::way_member, "BC", "to"},
+           {gurka::node_member, "B", "via"},
+       },
+       {{"type", "restriction"}, {"restriction", "no_straight_on"}}},
+      {{
+           {gurka::way_member, "AB", "from"},
+           {gurka::way_member, "BE", "via"},
+           {gurka::way_member, "EF", "to"},
+       },
+       {{"type", "restriction"}, {"restriction", "no_left_turn"}}},
+  };
+  auto map = build_map(relations, "complex");
+
+  // the overlay finds the path through E and F, which breaks the restriction
+  auto result = gurka::do_action(Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"AB", "BE", "EG", "GH", "FH", "CF", "CD"});
+
+  // routes the restriction doesn't apply to still use it
+  result = gurka::do_action(Options::route, map, {"E", "D"}, "auto");
+  EXPECT_EQ(algorithm(result), "multilevel_dijkstra");
+  gurka::assert::raw::expect_path(result, {"EF", "CF", "CD"});
+}
@@ -0,0 +1,112 @@
+#include "baldr/graphreader.h"
+#include "gurka.h"
+#include "test/test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::gurka;
+
+class NodeOrder : public ::testing::TestWithParam<std::string> {
+protected:
+  static gurka::nodelayout layout;
+  static gurka::ways ways;
+  static gurka::nodes nodes;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize_metres = 50;
+
+    const std::string ascii_map = R"(
+        A----B----C----D----E
+        |    |         |    |
+        |    F----G----H    |
+        |         |         |
+        I---------J---------K
+                  |         |
+                  L         M
+    )";
+
+    ways = {
+        {"ABCDE", {{"highway", "primary"}, {"name", "Hoofdweg"}, {"turn:lanes", "left|through"}}},
+        {"AI", {{"highway", "residential"}, {"name", "Westkade"}}},
+        {"BF", {{"highway", "residential"}, {"name", "Kerkstraat"}, {"maxweight", "3.5"}}},
+        {"FGH", {{"highway", "residential"}, {"name", "Molenweg"}}},
+        {"DH", {{"highway", "residential"}, {"name", "Schoolstraat"}, {"oneway", "yes"}}},
+        {"EK", {{"highway", "motorway_link"}, {"destination", "Utrecht"}, {"oneway", "yes"}}},
+        {"GJ", {{"highway", "residential"}, {"name", "Dorpsstraat"}}},
+        {"IJK", {{"highway", "secondary"}, {"name", "Zuidweg"}}},
+        {"JL", {{"highway", "service"}}},
+        {"KM", {{"highway", "service"}}},
+    };
+    nodes = {{"E", {{"highway", "motorway_junction"}, {"ref", "12"}}}};
+    layout = gurka::detail::map_to_coordinates(ascii_map, gridsize_metres, {5.1, 52.1});
+  }
+
+  gurka::map build(const std::string& node_order) {
+    return gurka::buildtiles(layout, ways, nodes, {},
+                             VALHALLA_BUILD_DIR "test/data/gurka_node_order_" +
+                                 (node_order.empty() ? std::string("none") : node_order),
+                             {{"mjolnir.node_order", node_order}});
+  }
+};
+
+gurka::nodelayout NodeOrder::layout = {};
+gurka::ways NodeOrder::ways = {};
+gurka::nodes NodeOrder::nodes = {};
+
+TEST_P(NodeOrder, SameRoutes) {
+  auto reference = build("");
+  auto map = build(GetParam());
+
+  // every edge still leads to a node whose opposing edge leads back
+  GraphReader reader(map.config.get_child("mjolnir"));
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      GraphId node_id = tile_id;
+      node_id.set_id(n);
+      const NodeInfo* node = tile->node(n);
+      for (uint32_t e = 0; e < node->edge_count(); ++e) {
+        GraphId edge_id = tile_id;
+        edge_id.set_id(node->edge_index() + e);
+        auto opp_edge = reader.directededge(reader.GetOpposingEdgeId(edge_id));
+        ASSERT_NE(opp_edge, nullptr);
+        EXPECT_EQ(opp_edge->endnode(), node_id);
+      }
+    }
+  }
+
+  // the edges are found with the attributes they had
+  auto BF = gurka::findEdgeByNodes(reader, layout, "B", "F");
+  ASSERT_NE(std::get<1>(BF), nullptr);
+  EXPECT_TRUE(std::get<1>(BF)->access_restriction());
+
+  for (const auto& waypoints : std::vector<std::vector<std::string>>{{"A", "M"},
+                                                                     {"L", "C"},
+                                                                     {"I", "E"},
+                                                                     {"H", "A"}}) {
+    auto expected = gurka::do_action(valhalla::Options::route, reference, waypoints, "auto");
+    auto result = gurka::do_action(valhalla::Options::route, map, waypoints, "auto");
+    const auto& expected_legs = expected.trip().routes(0).legs();
+    const auto& legs = result.trip().routes(0).legs();
+    ASSERT_EQ(legs.size(), expected_legs.size());
+    for (int i = 0; i < legs.size(); ++i) {
+      EXPECT_EQ(legs.Get(i).shape(), expected_legs.Get(i).shape());
+    }
+    EXPECT_EQ(result.directions().routes(0).legs(0).maneuver_size(),
+              expected.directions().routes(0).legs(0).maneuver_size());
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Renumber, NodeOrder, ::testing::Values("hilbert", "bfs"));
+
+TEST(Standalone, UnknownNodeOrder) {
+  const std::string ascii_map = R"(
+    A----B
+  )";
+  const gurka::ways ways = {{"AB", {{"highway", "residential"}}}};
+  auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  EXPECT_THROW(gurka::buildtiles(layout, ways, {}, {},
+                                 VALHALLA_BUILD_DIR "test/data/gurka_node_order_unknown",
+                                 {{"mjolnir.node_order", "zorder"}}),
+               std::runtime_error);
+}
@@ -1,15 +1,20 @@
 #include "baldr/curl_tilegetter.h"
+#include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
+#include "baldr/tilefetcher.h"
 #include "test.h"
 #include "tyr/actor.h"
 #include "valhalla/tile_server.h"
 
 #include <prime_server/prime_server.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -265,6 +270,167 @@ TEST(HttpTiles, test_interrupt) {
   }
 }
 
+TEST_F(HttpTilesWithCache, test_fetch_all) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  curl_tile_getter_t tile_getter(4, "", params.is_gzipped_tile);
+  url_tile_fetcher_t fetcher(&tile_getter, params.full_tile_url_pattern, "url_tile_cache", 4);
+
+  std::vector<GraphId> not_found;
+  auto tiles = fetcher.FetchAll(params.test_tile_ids, &not_found);
+  ASSERT_EQ(tiles.size(), params.test_tile_ids.size());
+  EXPECT_EQ(not_found, std::vector<GraphId>{params.get_nonexistent_tile_id()});
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const auto& expected_tile_id = params.test_tile_ids[i];
+    if (expected_tile_id == params.get_nonexistent_tile_id()) {
+      EXPECT_TRUE(tiles[i].empty());
+      continue;
+    }
+    ASSERT_FALSE(tiles[i].empty());
+    auto tile = GraphTile::Create(expected_tile_id, std::move(tiles[i]));
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(tile->id(), expected_tile_id);
+  }
+  auto stats = fetcher.Stats();
+  EXPECT_EQ(stats.downloads, 3);
+  EXPECT_EQ(stats.failures, 1);
+  EXPECT_EQ(stats.disk_hits, 0);
+
+  // the second time around the tiles come from disk
+  fetcher.FetchAll(params.test_tile_ids);
+  stats = fetcher.Stats();
+  EXPECT_EQ(stats.downloads, 3);
+  EXPECT_EQ(stats.disk_hits, 3);
+
+  // a broken copy on disk is replaced
+  const auto& tile_id = params.test_tile_ids.front();
+  std::filesystem::resize_file("url_tile_cache/" + GraphTile::FileSuffix(tile_id), 100);
+  auto data = fetcher.Fetch(tile_id);
+  ASSERT_FALSE(data.empty());
+  EXPECT_EQ(GraphTile::Create(tile_id, std::move(data))->id(), tile_id);
+  stats = fetcher.Stats();
+  EXPECT_EQ(stats.invalid, 1);
+  EXPECT_EQ(stats.downloads, 4);
+}
+
+TEST(HttpTiles, test_fetch_deduplicated) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  curl_tile_getter_t tile_getter(8, "", params.is_gzipped_tile);
+  url_tile_fetcher_t fetcher(&tile_getter, params.full_tile_url_pattern, "", 1);
+
+  // threads asking for the same tile at the same time share a single download
+  const auto& tile_id = params.test_tile_ids.front();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back([&]() { EXPECT_FALSE(fetcher.Fetch(tile_id).empty()); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto stats = fetcher.Stats();
+  EXPECT_GE(stats.downloads, 1);
+  EXPECT_EQ(stats.downloads + stats.joined, 8);
+}
+
+// counts how many requests it handles at once, pretending to fail every one of them
+class counting_tile_getter_t : public baldr::tile_getter_t {
+public:
+  response_t get(const std::string&) override {
+    auto active = ++active_;
+    size_t most = most_;
+    while (active > most && !most_.compare_exchange_weak(most, active)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    --active_;
+    return {};
+  }
+
+  std::atomic<size_t> active_{0};
+  std::atomic<size_t> most_{0};
+};
+
+TEST(HttpTiles, test_fetch_all_serial_without_thread_safe_getter) {
+  using namespace baldr;
+
+  // a getter that doesn't say it is thread-safe is never used from two threads at once
+  counting_tile_getter_t tile_getter;
+  url_tile_fetcher_t fetcher(&tile_getter, "127.0.0.1/{tilePath}", "", 4);
+  std::vector<GraphId> tile_ids{{0, 2, 0}, {1, 2, 0}, {2, 2, 0}, {3, 2, 0}};
+  auto tiles = fetcher.FetchAll(tile_ids);
+  ASSERT_EQ(tiles.size(), tile_ids.size());
+  for (const auto& tile : tiles) {
+    EXPECT_TRUE(tile.empty());
+  }
+  EXPECT_EQ(tile_getter.most_, 1);
+  EXPECT_EQ(fetcher.Stats().failures, tile_ids.size());
+}
+
+// answers the first request for every tile like an overloaded server would, with a 503
+class unavailable_once_tile_getter_t : public baldr::curl_tile_getter_t {
+public:
+  unavailable_once_tile_getter_t() : curl_tile_getter_t(1, "", false) {
+  }
+
+  response_t get(const std::string& url) override {
+    if (++requests_[url] == 1) {
+      return {};
+    }
+    return curl_tile_getter_t::get(url);
+  }
+
+  std::unordered_map<std::string, size_t> requests_;
+};
+
+TEST(HttpTiles, test_graphreader_retries_unavailable) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  auto* tile_getter = new unavailable_once_tile_getter_t;
+  GraphReader reader(make_conf("", params.is_gzipped_tile, 1).get_child("mjolnir"),
+                     std::unique_ptr<tile_getter_t>(tile_getter));
+
+  // a tile the server failed to send is asked for again
+  const auto& tile_id = params.test_tile_ids.front();
+  EXPECT_FALSE(reader.GetGraphTile(tile_id));
+  auto tile = reader.GetGraphTile(tile_id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->id(), tile_id);
+
+  // one the server doesn't have is only asked for until it says so
+  const auto missing_id = params.get_nonexistent_tile_id();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(reader.GetGraphTile(missing_id));
+  }
+  const auto url = make_single_point_url(get_tile_url(),
+                                         GraphTile::FileSuffix(missing_id, SUFFIX_NON_COMPRESSED,
+                                                               false));
+  EXPECT_EQ(tile_getter->requests_[url], 2);
+  EXPECT_EQ(tile_getter->requests_.size(), 2);
+}
+
+TEST_F(HttpTilesWithCache, test_graphreader_load_tiles) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  auto conf = make_conf("url_tile_cache", params.is_gzipped_tile, 4);
+  GraphReader reader(conf.get_child("mjolnir"));
+
+  // all tiles are fetched up front, after that they are in the cache
+  EXPECT_EQ(reader.LoadTiles(params.test_tile_ids), 3);
+  for (const auto& tile_id : params.test_tile_ids) {
+    if (tile_id != params.get_nonexistent_tile_id()) {
+      ASSERT_TRUE(reader.GetGraphTile(tile_id));
+    }
+  }
+  auto metrics = reader.GetTileMetrics();
+  EXPECT_EQ(metrics.hits, 3);
+  EXPECT_EQ(metrics.misses, 0);
+  EXPECT_EQ(metrics.tiles_loaded, 3);
+}
+
 class HttpTilesEnv : public ::testing::Environment {
 public:
   void SetUp() override {
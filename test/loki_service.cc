@@ -100,7 +100,7 @@ const std::vector<std::pair<uint16_t, std::string>>
          R"(","tileset_last_modified":0,"available_actions":["status","centroid","expansion","transit_available","trace_attributes","trace_route","isochrone","optimized_route","sources_to_targets","height","route","locate"]})"},
         {200,
          R"({"version":")" VALHALLA_VERSION
-         R"(","tileset_last_modified":0,"available_actions":["status","centroid","expansion","transit_available","trace_attributes","trace_route","isochrone","optimized_route","sources_to_targets","height","route","locate"],"has_tiles":false,"has_admins":false,"has_timezones":false,"has_live_traffic":false,"has_transit_tiles":false,"bbox":{"features":[],"type":"FeatureCollection"}})"},
+         R"(","tileset_last_modified":0,"available_actions":["status","centroid","expansion","transit_available","trace_attributes","trace_route","isochrone","optimized_route","sources_to_targets","height","route","locate"],"has_tiles":false,"has_admins":false,"has_timezones":false,"has_live_traffic":false,"has_transit_tiles":false,"bbox":{"features":[],"type":"FeatureCollection"},"tile_metrics":{"hits":0,"misses":0,"evictions":0,"tiles_loaded":0,"bytes_loaded":0,"load_latency":[],"level_touches":[0,0,0,0],"prefetch_hits":0,"prefetch_misses":0,"prefetch_wasted":0,"readers":1}})"},
         {405,
          R"({"error_code":101,"error":"Try a POST or GET request instead","status_code":405,"status":"Method Not Allowed"})"},
         {405,
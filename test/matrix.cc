@@ -5,6 +5,7 @@
 #include "sif/dynamiccost.h"
 #include "test.h"
 #include "thor/costmatrix.h"
+#include "thor/search_arena.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
@@ -284,6 +285,46 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_matrix_arena) {
+  loki_worker_t loki_worker(cfg);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+  const size_t locations = request.options().sources_size() + request.options().targets_size();
+
+  GraphReader reader(cfg.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+  set_hierarchy_limits(mode_costing[0]);
+
+  // the buffers of every location survive the request, however much each reserved
+  SearchArena arena;
+  CostMatrix cost_matrix;
+  cost_matrix.set_search_arena(&arena);
+  cost_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix().times();
+  cost_matrix.Clear();
+  EXPECT_EQ(arena.kept<std::vector<BDEdgeLabel>>(), locations);
+  EXPECT_EQ(arena.kept<AdjacencyList<BDEdgeLabel>>(), locations);
+  EXPECT_GT(arena.reserved<std::vector<BDEdgeLabel>>(), 0);
+
+  // and are what the next request borrows, which comes to the same answers
+  request.clear_matrix();
+  cost_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  EXPECT_EQ(arena.kept<std::vector<BDEdgeLabel>>(), 0);
+  EXPECT_EQ(arena.kept<AdjacencyList<BDEdgeLabel>>(), 0);
+  ASSERT_EQ(request.matrix().times().size(), expected.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(request.matrix().times()[i], expected[i]);
+  }
+  cost_matrix.Clear();
+  EXPECT_EQ(arena.kept<std::vector<BDEdgeLabel>>(), locations);
+}
+
 TEST(Matrix, test_timedistancematrix_forward) {
   // Input request is the same as `test_request`, but without the last target
   const auto test_request_more_sources = R"({
@@ -2,7 +2,11 @@
 #include "midgard/util.h"
 #include "test.h"
 
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 using namespace std;
 using namespace valhalla::baldr;
@@ -253,6 +257,123 @@ TEST(PredictedSpeeds, test_compress_decompress_accuracy) {
   EXPECT_LE(max_diff, 2.f) << "Low decompression accuracy"; // <= 2 KPH
 }
 
+std::vector<int16_t> make_profiles(uint32_t count) {
+  std::vector<int16_t> profiles;
+  std::array<float, kBucketsPerWeek> speeds;
+  for (uint32_t p = 0; p < count; ++p) {
+    for (uint32_t i = 0; i < kBucketsPerWeek; ++i)
+      speeds[i] = roundf(20.f + p + 15.f * sin(i / (10.f + p)));
+    auto compressed = compress_speed_buckets(speeds.data());
+    profiles.insert(profiles.end(), compressed.begin(), compressed.end());
+  }
+  return profiles;
+}
+
+TEST(PredictedSpeeds, test_decompress_batch) {
+  const uint32_t count = 17;
+  auto profiles = make_profiles(count);
+  std::vector<float> speeds(count);
+  for (uint32_t bucket : {0u, 1u, 287u, 1000u, kBucketsPerWeek - 1}) {
+    decompress_speed_buckets(profiles.data(), count, bucket, speeds.data());
+    for (uint32_t p = 0; p < count; ++p) {
+      const int16_t* coefficients = profiles.data() + p * kCoefficientCount;
+      EXPECT_EQ(speeds[p], decompress_speed_bucket(coefficients, bucket));
+
+      // same as the textbook DCT-III
+      double expected = coefficients[0] / sqrt(2.);
+      for (uint32_t c = 1; c < kCoefficientCount; ++c)
+        expected += coefficients[c] * cos(M_PI / kBucketsPerWeek * (bucket + 0.5) * c);
+      EXPECT_NEAR(speeds[p], expected * sqrt(2. / kBucketsPerWeek), 1e-3);
+    }
+  }
+}
+
+TEST(PredictedSpeeds, test_decoded_speed_cache) {
+  // every edge has its own profile except the last one which shares the first
+  const uint32_t count = 40;
+  auto profiles = make_profiles(count);
+  std::vector<uint32_t> offsets;
+  for (uint32_t p = 0; p < count; ++p)
+    offsets.push_back(p * kCoefficientCount);
+  offsets.push_back(0);
+
+  PredictedSpeeds uncached, cached;
+  for (auto* speeds : {&uncached, &cached}) {
+    speeds->set_offset(offsets.data());
+    speeds->set_profiles(profiles.data());
+  }
+  cached.set_cache(count);
+  ASSERT_NE(cached.cache(), nullptr);
+  EXPECT_EQ(uncached.cache(), nullptr);
+
+  // the bucket is decoded once it is used enough and then answers all the lookups
+  const uint32_t seconds = 1000 * kSpeedBucketSizeSeconds + 17;
+  for (uint32_t i = 0; i < 3; ++i) {
+    for (uint32_t idx = 0; idx < offsets.size(); ++idx)
+      EXPECT_EQ(cached.speed(idx, seconds), uncached.speed(idx, seconds));
+  }
+  EXPECT_EQ(cached.cache()->decoded(), 1);
+  float speed;
+  EXPECT_TRUE(cached.cache()->get(count - 1, 1000, speed));
+  EXPECT_EQ(speed, uncached.speed(count - 1, seconds));
+  EXPECT_FALSE(cached.cache()->get(count - 1, 1001, speed));
+
+  // a bucket which is hardly used is never decoded
+  EXPECT_EQ(cached.speed(3, seconds + kSpeedBucketSizeSeconds),
+            uncached.speed(3, seconds + kSpeedBucketSizeSeconds));
+  EXPECT_EQ(cached.cache()->decoded(), 1);
+
+  // the bucket replacing an older one in its slot is right as well
+  const uint32_t later = seconds + kDecodedSpeedSlots * kSpeedBucketSizeSeconds;
+  for (uint32_t i = 0; i < 3; ++i) {
+    for (uint32_t idx = 0; idx < offsets.size(); ++idx)
+      EXPECT_EQ(cached.speed(idx, later), uncached.speed(idx, later));
+  }
+  EXPECT_EQ(cached.cache()->decoded(), 2);
+  EXPECT_FALSE(cached.cache()->get(0, 1000, speed));
+}
+
+TEST(PredictedSpeeds, test_decoded_speed_cache_switch) {
+  // the first reader decides for the whole process, readers disagreeing later are ignored
+  EXPECT_TRUE(set_decoded_speed_cache(true));
+  EXPECT_TRUE(set_decoded_speed_cache(true));
+  EXPECT_FALSE(set_decoded_speed_cache(false));
+  EXPECT_TRUE(decoded_speed_cache());
+}
+
+TEST(PredictedSpeeds, test_decoded_speed_cache_threads) {
+  const uint32_t count = 64;
+  auto profiles = make_profiles(count);
+  std::vector<uint32_t> offsets;
+  for (uint32_t p = 0; p < count; ++p)
+    offsets.push_back(p * kCoefficientCount);
+
+  PredictedSpeeds cached;
+  cached.set_offset(offsets.data());
+  cached.set_profiles(profiles.data());
+  cached.set_cache(count);
+
+  // threads walking through different buckets keep replacing each others slots
+  std::atomic<uint32_t> wrong{0};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint32_t bucket = t; bucket < 200 + t; ++bucket) {
+        for (uint32_t i = 0; i < count * 2; ++i) {
+          const uint32_t idx = (i * 7 + t) % count;
+          float expected = decompress_speed_bucket(profiles.data() + offsets[idx], bucket);
+          if (cached.speed(idx, bucket * kSpeedBucketSizeSeconds) != expected)
+            ++wrong;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(wrong, 0);
+  EXPECT_GT(cached.cache()->decoded(), 0);
+}
+
 struct EncoderDecoderTest : public ::testing::Test {
   EncoderDecoderTest() {
     // fill in coefficients
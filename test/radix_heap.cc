@@ -0,0 +1,183 @@
+#include "baldr/adjacency_list.h"
+#include "baldr/radix_heap.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+std::vector<float> PopAll(RadixHeap<simple_label>& heap, const std::vector<simple_label>& labels) {
+  std::vector<float> popped;
+  for (auto label = heap.pop(); label != kInvalidLabel; label = heap.pop()) {
+    popped.push_back(labels[label].sortcost());
+  }
+  return popped;
+}
+
+TEST(RadixHeap, TestAddRemove) {
+  // fractions of a cost are kept apart too, unlike in buckets of a size
+  std::vector<simple_label> labels = {{67.5f}, {325.f},    {25.f},   {466.f}, {1000.f},
+                                      {0.25f}, {100005.f}, {67.25f}, {0.f},   {16442.f},
+                                      {278.f}, {1.1e8f},   {0.125f}, {1320209856.f}};
+  RadixHeap<simple_label> heap(0, 10000, 1, &labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    heap.add(i);
+  }
+  std::vector<float> expected;
+  for (const auto& label : labels) {
+    expected.push_back(label.sortcost());
+  }
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(PopAll(heap, labels), expected);
+  EXPECT_EQ(heap.pop(), kInvalidLabel);
+}
+
+TEST(RadixHeap, TestDecrease) {
+  std::vector<simple_label> labels = {{10.f}, {20.f}, {30.f}, {4000.f}};
+  RadixHeap<simple_label> heap(0, 10000, 1, &labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    heap.add(i);
+  }
+  EXPECT_EQ(heap.pop(), 0);
+
+  // into another bucket and within the same one
+  heap.decrease(3, 15.f);
+  labels[3].c = 15.f;
+  heap.decrease(2, 29.f);
+  labels[2].c = 29.f;
+  EXPECT_EQ(PopAll(heap, labels), (std::vector<float>{15.f, 20.f, 29.f}));
+}
+
+TEST(RadixHeap, TestBelowLastPopped) {
+  // a label costing less than the last one popped is popped next, like the double bucket queue
+  // does with costs below its current bucket
+  std::vector<simple_label> labels = {{10.f}, {50.f}, {5.f}};
+  RadixHeap<simple_label> heap(0, 10000, 1, &labels);
+  heap.add(0);
+  heap.add(1);
+  EXPECT_EQ(heap.pop(), 0);
+  heap.add(2);
+  EXPECT_EQ(heap.pop(), 2);
+  EXPECT_EQ(heap.pop(), 1);
+}
+
+TEST(RadixHeap, TestNegativeZero) {
+  // -0 costs nothing, like any cost below 0
+  std::vector<simple_label> labels = {{5.f}, {-0.f}, {1.f}, {-2.f}};
+  RadixHeap<simple_label> heap(0, 10000, 1, &labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    heap.add(i);
+  }
+  const uint32_t first = heap.pop();
+  const uint32_t second = heap.pop();
+  EXPECT_TRUE((first == 1 && second == 3) || (first == 3 && second == 1));
+  EXPECT_EQ(heap.pop(), 2);
+  EXPECT_EQ(heap.pop(), 0);
+}
+
+TEST(RadixHeap, TestClear) {
+  std::vector<simple_label> labels = {{67.f}, {325.f}, {25.f}, {466.f}};
+  RadixHeap<simple_label> heap(0, 10000, 1, &labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    heap.add(i);
+  }
+  EXPECT_EQ(heap.pop(), 2);
+  heap.clear();
+  EXPECT_EQ(heap.pop(), kInvalidLabel);
+  // the positions of the labels are kept too
+  EXPECT_GE(heap.reserved(), 2 * labels.size());
+
+  // starts over from the smallest cost
+  heap.reuse(0, 10000, 1, &labels);
+  heap.add(0);
+  heap.add(2);
+  EXPECT_EQ(PopAll(heap, labels), (std::vector<float>{25.f, 67.f}));
+}
+
+TEST(RadixHeap, TestSimulation) {
+  // expand like a dijkstra, every label popped must cost the least of those still in the heap
+  std::mt19937 gen(42);
+  std::vector<simple_label> labels{{10.f}};
+  RadixHeap<simple_label> heap(0, 1, 1, &labels);
+  heap.add(0);
+  std::unordered_set<uint32_t> added{0};
+  for (size_t i = 0; i < 2000; ++i) {
+    const auto label = heap.pop();
+    ASSERT_NE(label, kInvalidLabel);
+    const float min_cost = labels[label].sortcost();
+    for (auto other : added) {
+      ASSERT_LE(min_cost, labels[other].sortcost());
+    }
+    added.erase(label);
+
+    for (size_t j = 0; j < 10; ++j) {
+      const float newcost = min_cost + test::rand01(gen) * 1000.f;
+      if (j % 2 == 0 && !added.empty()) {
+        const auto other = *std::next(added.begin(), test::rand01(gen) * (added.size() - 1));
+        if (newcost < labels[other].sortcost()) {
+          heap.decrease(other, newcost);
+          labels[other].c = newcost;
+        }
+      } else {
+        added.insert(labels.size());
+        labels.push_back({newcost});
+        heap.add(labels.size() - 1);
+      }
+    }
+  }
+  const auto rest = PopAll(heap, labels);
+  EXPECT_EQ(rest.size(), added.size());
+  EXPECT_TRUE(std::is_sorted(rest.begin(), rest.end()));
+}
+
+TEST(AdjacencyList, TestBothQueues) {
+  // with whole costs and buckets of size 1 both queues pop in the same order
+  std::vector<simple_label> labels = {{67.f},  {325.f}, {25.f},    {466.f}, {1000.f}, {100005.f},
+                                      {758.f}, {167.f}, {16442.f}, {278.f}, {20000.f}};
+  for (const bool radix_heap : {false, true}) {
+    AdjacencyList<simple_label> adjlist(0, 10000, 1, &labels, radix_heap);
+    EXPECT_EQ(adjlist.radix_heap(), radix_heap);
+    for (uint32_t i = 0; i < labels.size(); ++i) {
+      adjlist.add(i);
+    }
+    std::vector<float> popped;
+    for (auto label = adjlist.pop(); label != kInvalidLabel; label = adjlist.pop()) {
+      popped.push_back(labels[label].sortcost());
+    }
+    EXPECT_EQ(popped.size(), labels.size());
+    EXPECT_TRUE(std::is_sorted(popped.begin(), popped.end()));
+  }
+
+  // switching between them once cleared
+  AdjacencyList<simple_label> adjlist(0, 10000, 1, &labels);
+  adjlist.add(0);
+  adjlist.clear();
+  adjlist.use_radix_heap(true);
+  adjlist.reuse(0, 10000, 1, &labels);
+  adjlist.add(1);
+  adjlist.add(2);
+  EXPECT_EQ(adjlist.pop(), 2);
+  EXPECT_EQ(adjlist.pop(), 1);
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -165,6 +165,65 @@ class TestBuildExtract(unittest.TestCase):
         valhalla_build_extract.create_extracts(config, True, tile_resolver, new_tile_extract)
         self.check_tar(new_tile_extract, exp_tuples, tile_count * INDEX_BIN_SIZE)
 
+    def test_create_compressed_extracts(self):
+        extract_path = TILE_PATH.joinpath("tiles_lz4_test.tar")
+        traffic_path = TILE_PATH.joinpath("traffic_lz4_test.tar")
+        config = {"mjolnir": {"tile_dir": str(TILE_PATH), "traffic_extract": str(traffic_path)}}
+
+        tile_resolver = TileResolver(TILE_PATH)
+        tile_resolver.matched_paths = tile_resolver.normalized_tile_paths
+        lz4 = valhalla_build_extract.Lz4()
+        valhalla_build_extract.create_extracts(config, True, tile_resolver, extract_path, lz4)
+
+        # every tile is compressed on its own and decompresses to the tile on disk
+        with tarfile.open(extract_path) as tar:
+            tiles = [m for m in tar.getmembers() if m.name.endswith('.gph')]
+            self.assertEqual(len(tiles), len(tile_resolver.matched_paths))
+            for member in tiles:
+                compressed = tar.extractfile(member).read()
+                self.assertTrue(compressed.startswith(valhalla_build_extract.LZ4_MAGIC))
+                original = TILE_PATH.joinpath(member.name).read_bytes()
+                self.assertEqual(lz4.decompress(compressed), original)
+
+        # the traffic skeleton is the same as for the uncompressed tiles
+        exp_tuples = ((1536, 25568, 25856), (28160, 410441, 64400), (93184, 6549282, 605360))
+        self.check_tar(traffic_path, exp_tuples, len(tiles) * INDEX_BIN_SIZE)
+
+        extract_path.unlink()
+        traffic_path.unlink()
+
+    def test_create_double_buffered_traffic(self):
+        extract_path = TILE_PATH.joinpath("tiles_double_buffer_test.tar")
+        traffic_path = TILE_PATH.joinpath("traffic_double_buffer_test.tar")
+        config = {"mjolnir": {"tile_dir": str(TILE_PATH), "traffic_extract": str(traffic_path)}}
+
+        tile_resolver = TileResolver(TILE_PATH)
+        tile_resolver.matched_paths = tile_resolver.normalized_tile_paths
+        valhalla_build_extract.create_extracts(
+            config, True, tile_resolver, extract_path, traffic_buffers=2
+        )
+
+        # every traffic tile has room for two sets of speeds and starts out on the first one
+        with tarfile.open(traffic_path) as tar:
+            tiles = [m for m in tar.getmembers() if m.name.endswith('.gph')]
+            self.assertEqual(len(tiles), len(tile_resolver.matched_paths))
+            for member in tiles:
+                header = struct.unpack(
+                    valhalla_build_extract.TRAFFIC_HEADER_FORMAT,
+                    tar.extractfile(member).read(valhalla_build_extract.TRAFFIC_HEADER_SIZE),
+                )
+                _, _, edge_count, _, speed_buffers, active_buffer = header
+                self.assertEqual(speed_buffers, 2)
+                self.assertEqual(active_buffer, 0)
+                self.assertEqual(
+                    member.size,
+                    valhalla_build_extract.TRAFFIC_HEADER_SIZE
+                    + 2 * valhalla_build_extract.TRAFFIC_SPEED_SIZE * edge_count,
+                )
+
+        extract_path.unlink()
+        traffic_path.unlink()
+
     def check_tar(self, p: Path, exp_tuples, end_index):
         with open(p, 'r+b') as f:
             f.seek(tarfile.BLOCKSIZE)
@@ -0,0 +1,162 @@
+#include "thor/search_arena.h"
+#include "baldr/graphtile.h"
+#include "test.h"
+
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+struct test_tile : public GraphTile {
+  using GraphTile::header_;
+};
+
+TEST(SearchArena, LabelsAreHandedOn) {
+  SearchArena arena;
+
+  // the labels given back are the ones borrowed next, emptied but still allocated
+  std::vector<BDEdgeLabel> labels;
+  labels.resize(1000);
+  const auto* data = labels.data();
+  const auto capacity = labels.capacity();
+  arena.give_back(labels);
+  EXPECT_EQ(labels.capacity(), 0);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), capacity);
+
+  std::vector<BDEdgeLabel> other;
+  arena.borrow(other);
+  EXPECT_TRUE(other.empty());
+  EXPECT_EQ(other.data(), data);
+  EXPECT_EQ(other.capacity(), capacity);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 0);
+
+  // the labels of another type are kept apart
+  std::vector<MMEdgeLabel> mmlabels;
+  arena.borrow(mmlabels);
+  EXPECT_EQ(mmlabels.capacity(), 0);
+
+  // nothing is handed to labels that have memory of their own
+  arena.give_back(other);
+  std::vector<BDEdgeLabel> own;
+  own.reserve(10);
+  arena.borrow(own);
+  EXPECT_EQ(own.capacity(), 10);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), capacity);
+
+  arena.clear();
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 0);
+  arena.borrow(other);
+  EXPECT_EQ(other.capacity(), 0);
+}
+
+TEST(SearchArena, KeepsUpToTheMaximum) {
+  SearchArena arena(1500, 0);
+
+  std::vector<BDEdgeLabel> first(1000), second(1000);
+  arena.give_back(first);
+  arena.give_back(second);
+  EXPECT_EQ(first.capacity(), 0);
+  EXPECT_EQ(second.capacity(), 0);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 1000);
+
+  // the second was freed
+  arena.borrow(first);
+  arena.borrow(second);
+  EXPECT_EQ(first.capacity(), 1000);
+  EXPECT_EQ(second.capacity(), 0);
+}
+
+TEST(SearchArena, CountsTheLabelsUsed) {
+  SearchArena arena(1500, 0);
+
+  // like the locations of a matrix, reserved for far more labels than they used
+  std::vector<std::vector<BDEdgeLabel>> locations(50);
+  for (auto& labels : locations) {
+    labels.reserve(100000);
+    labels.resize(20);
+  }
+  for (auto& labels : locations) {
+    arena.give_back(labels);
+  }
+  EXPECT_EQ(arena.kept<std::vector<BDEdgeLabel>>(), 50);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 1000);
+
+  // the labels an earlier search used still count when the next one uses fewer
+  for (auto& labels : locations) {
+    arena.borrow(labels);
+    EXPECT_EQ(labels.capacity(), 100000);
+  }
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 0);
+  for (auto& labels : locations) {
+    labels.resize(5);
+    arena.give_back(labels);
+  }
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 1000);
+
+  // a vector which used more labels than the arena has room left for is freed
+  arena.borrow(locations[0]);
+  locations[0].resize(600);
+  arena.give_back(locations[0]);
+  EXPECT_EQ(arena.kept<std::vector<BDEdgeLabel>>(), 49);
+  EXPECT_EQ(arena.reserved<std::vector<BDEdgeLabel>>(), 980);
+}
+
+TEST(SearchArena, AdjacencyListsAreHandedOn) {
+  SearchArena arena;
+
+  std::vector<BDEdgeLabel> labels(10);
+  AdjacencyList<BDEdgeLabel> adjacencylist(0.f, 100.f, 1, &labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    adjacencylist.add(i);
+  }
+  const auto reserved = adjacencylist.reserved();
+  EXPECT_GE(reserved, labels.size());
+  arena.give_back(adjacencylist);
+  EXPECT_EQ(adjacencylist.reserved(), 0);
+  EXPECT_EQ(arena.reserved<AdjacencyList<BDEdgeLabel>>(), reserved);
+
+  // the buckets come back empty
+  AdjacencyList<BDEdgeLabel> other;
+  arena.borrow(other);
+  EXPECT_EQ(other.reserved(), reserved);
+  other.reuse(0.f, 100.f, 1, &labels);
+  EXPECT_EQ(other.pop(), kInvalidLabel);
+  other.add(3);
+  EXPECT_EQ(other.pop(), 3);
+}
+
+TEST(SearchArena, EdgeStatusIsHandedOn) {
+  SearchArena arena;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // the arrays of the tiles move along with the edge status, every status reset
+  EdgeStatus edgestatus;
+  GraphId edge(555, 1, 10);
+  EdgeStatusInfo* first = edgestatus.GetPtr(edge, tile);
+  edgestatus.Set(edge, EdgeSet::kPermanent, 7, tile);
+  arena.give_back(edgestatus);
+  EXPECT_EQ(edgestatus.reserved(), 0);
+  EXPECT_EQ(edgestatus.Get(edge).set(), EdgeSet::kUnreachedOrReset);
+
+  EdgeStatus other;
+  arena.borrow(other);
+  EXPECT_EQ(other.reserved(), 1000);
+  EXPECT_EQ(other.Get(edge).set(), EdgeSet::kUnreachedOrReset);
+  EXPECT_EQ(other.GetPtr(edge, tile), first);
+  EXPECT_EQ(first->set(), EdgeSet::kUnreachedOrReset);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,18 +1,30 @@
 #include "baldr/graphreader.h"
+#include "filesystem.h"
 #include "test.h"
 
+#include <chrono>
+#include <fstream>
+#include <numeric>
+
 namespace vb = valhalla::baldr;
 
 class TestGraphReader : vb::GraphReader {
 public:
   using vb::GraphReader::GetGraphTile;
   using vb::GraphReader::GraphReader;
+  using vb::GraphReader::GetTileSet;
+  using vb::GraphReader::PinTiles;
+  using vb::GraphReader::extract_clock_;
+  using vb::GraphReader::ReloadExtracts;
   using vb::GraphReader::tile_extract_;
 };
 
 auto config_tar = test::make_config("test/data/utrecht_tiles",
                                     {{"mjolnir.tile_extract", "test/data/utrecht_tiles/tiles.tar"}});
 auto config_dir = test::make_config("test/data/utrecht_tiles");
+auto config_lz4 =
+    test::make_config("test/data/utrecht_tiles",
+                      {{"mjolnir.tile_extract", "test/data/utrecht_tiles/tiles_lz4.tar"}});
 
 TEST(TarIndexer, TestTrafficTar) {
   // read the tile headers from tar & dir tiles and memcmp them
@@ -29,9 +41,151 @@ TEST(TarIndexer, TestTrafficTar) {
   }
 }
 
+TEST(TarIndexer, TestCompressedTar) {
+  // the decompressed tiles have to be identical to the ones on disk
+  TestGraphReader reader_lz4(config_lz4.get_child("mjolnir"));
+  GraphReader reader_dir(config_dir.get_child("mjolnir"));
+  ASSERT_TRUE(reader_lz4.tile_extract_->compressed);
+  ASSERT_FALSE(reader_lz4.tile_extract_->tiles.empty());
+
+  for (const auto& tile_id : reader_dir.GetTileSet()) {
+    auto dir_tile = reader_dir.GetGraphTile(tile_id);
+    auto lz4_tile = reader_lz4.GetGraphTile(tile_id);
+    ASSERT_NE(lz4_tile, nullptr);
+
+    const auto* header = dir_tile->header();
+    ASSERT_EQ(header->end_offset(), lz4_tile->header()->end_offset());
+    ASSERT_EQ(memcmp(reinterpret_cast<const char*>(header),
+                     reinterpret_cast<const char*>(lz4_tile->header()), header->end_offset()),
+              0);
+  }
+}
+
 TEST(TarIndexer, CheckScanTar) {
   config_tar.add("mjolnir.data_processing.scan_tar", true);
   TestGraphReader reader_tar(config_tar.get_child("mjolnir"));
 
   ASSERT_NE(reader_tar.tile_extract_->checksum, 0);
 }
+
+TEST(TarIndexer, ReloadExtracts) {
+  const std::string extract = "test/data/utrecht_tiles/reload.tar";
+  auto copy = [](const std::string& from, const std::string& to) {
+    std::ofstream(to, std::ios::binary) << std::ifstream(from, std::ios::binary).rdbuf();
+  };
+  copy("test/data/utrecht_tiles/tiles.tar", extract);
+
+  auto config = test::make_config("test/data/utrecht_tiles",
+                                  {{"mjolnir.tile_extract", extract},
+                                   {"mjolnir.extract_reload_interval", "1"}});
+  TestGraphReader reader(config.get_child("mjolnir"));
+  // the interval passes when the test says so
+  auto now = std::chrono::steady_clock::now();
+  reader.extract_clock_ = [&now]() { return now; };
+  ASSERT_FALSE(reader.tile_extract_->compressed);
+  auto tile_id = *reader.GetTileSet().begin();
+  auto old_tile = reader.GetGraphTile(tile_id);
+  ASSERT_NE(old_tile, nullptr);
+  const auto old_size = old_tile->header()->end_offset();
+
+  // nothing changed yet
+  now += std::chrono::milliseconds(1100);
+  EXPECT_FALSE(reader.ReloadExtracts());
+
+  // a new build is moved into place, only picked up once the interval has passed
+  copy("test/data/utrecht_tiles/tiles_lz4.tar", extract + ".new");
+  ASSERT_TRUE(filesystem::rename(extract + ".new", extract));
+  EXPECT_FALSE(reader.ReloadExtracts());
+  now += std::chrono::milliseconds(1100);
+  EXPECT_TRUE(reader.ReloadExtracts());
+  EXPECT_TRUE(reader.tile_extract_->compressed);
+
+  // the tile handed out before still works off the previous mapping
+  EXPECT_EQ(old_tile->header()->end_offset(), old_size);
+  EXPECT_EQ(old_tile->header()->graphid().Tile_Base(), tile_id);
+  auto new_tile = reader.GetGraphTile(tile_id);
+  ASSERT_NE(new_tile, nullptr);
+  EXPECT_NE(new_tile, old_tile);
+  ASSERT_EQ(new_tile->header()->end_offset(), old_size);
+  EXPECT_EQ(memcmp(reinterpret_cast<const char*>(new_tile->header()),
+                   reinterpret_cast<const char*>(old_tile->header()), old_size),
+            0);
+
+  // broken replacements are ignored
+  std::ofstream(extract + ".new") << "not a tar";
+  ASSERT_TRUE(filesystem::rename(extract + ".new", extract));
+  now += std::chrono::milliseconds(1100);
+  EXPECT_FALSE(reader.ReloadExtracts());
+  EXPECT_NE(reader.GetGraphTile(tile_id), nullptr);
+
+  filesystem::remove(extract);
+}
+
+TEST(TarIndexer, ExtractPolicy) {
+  // an unknown advice is a configuration error
+  auto bad = test::make_config("test/data/utrecht_tiles",
+                               {{"mjolnir.tile_extract", "test/data/utrecht_tiles/tiles.tar"},
+                                {"mjolnir.tile_extract_advice", "fast"}});
+  EXPECT_THROW(GraphReader(bad.get_child("mjolnir")), std::runtime_error);
+
+  GraphReader reader_dir(config_dir.get_child("mjolnir"));
+  auto tiles = reader_dir.GetTileSet();
+  const std::string pin_list = "test/data/utrecht_tiles/pin_list.txt";
+  {
+    std::ofstream list(pin_list);
+    list << "# hot tiles\n";
+    for (const auto& id : tiles) {
+      list << GraphTile::FileSuffix(id) << "\n";
+    }
+  }
+
+  auto config = test::make_config("test/data/utrecht_tiles",
+                                  {{"mjolnir.tile_extract", "test/data/utrecht_tiles/tiles.tar"},
+                                   {"mjolnir.tile_extract_advice", "random"},
+                                   {"mjolnir.tile_extract_hugepages", "true"},
+                                   {"mjolnir.tile_extract_pin_list", pin_list}});
+  TestGraphReader reader(config.get_child("mjolnir"));
+  for (const auto& id : tiles) {
+    auto tile = reader.GetGraphTile(id);
+    ASSERT_NE(tile, nullptr);
+    EXPECT_EQ(tile->header()->graphid(), id);
+  }
+
+  // how much gets locked depends on ulimit -l, but never more than the tiles
+  size_t total = 0;
+  for (const auto& t : reader.tile_extract_->tiles) {
+    total += t.second.second;
+  }
+  EXPECT_LE(reader.PinTiles({tiles.begin(), tiles.end()}), total);
+  EXPECT_EQ(reader_dir.PinTiles({tiles.begin(), tiles.end()}), 0);
+
+  // the configured list is what the reader pinned when it loaded the extract, the tile
+  // directory has nothing to pin
+  EXPECT_EQ(reader.PinTiles(), reader.PinTiles({tiles.begin(), tiles.end()}));
+  EXPECT_EQ(reader_dir.PinTiles(), 0);
+
+  filesystem::remove(pin_list);
+}
+
+TEST(TarIndexer, TileMetrics) {
+  GraphReader reader(config_dir.get_child("mjolnir"));
+  auto tile_id = *reader.GetTileSet(2).begin();
+
+  auto tile = reader.GetGraphTile(tile_id);
+  ASSERT_NE(tile, nullptr);
+  EXPECT_EQ(reader.GetGraphTile(tile_id), tile);
+  EXPECT_EQ(reader.GetGraphTile(GraphId(tile_id.tileid(), tile_id.level(), 17)), tile);
+
+  auto metrics = reader.GetTileMetrics();
+  EXPECT_EQ(metrics.misses, 1);
+  EXPECT_EQ(metrics.hits, 2);
+  EXPECT_EQ(metrics.tiles_loaded, 1);
+  EXPECT_EQ(metrics.bytes_loaded, tile->header()->end_offset());
+  EXPECT_EQ(metrics.level_touches[2], 3);
+  EXPECT_EQ(std::accumulate(metrics.load_latency.begin(), metrics.load_latency.end(), uint64_t(0)),
+            1);
+  EXPECT_EQ(metrics.evictions, 0);
+
+  reader.Clear();
+  EXPECT_EQ(reader.GetTileMetrics().evictions, 1);
+}
@@ -1,4 +1,11 @@
+#include "baldr/graphtile.h"
 #include "baldr/traffictile.h"
+#include "baldr/trafficupdater.h"
+#include "microtar.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -116,6 +123,126 @@ TEST(Traffic, SpeedValid) {
   EXPECT_EQ(speed.encoded_speed1, 0);
 }
 
+TEST(Traffic, DoubleBufferedTile) {
+  using namespace valhalla::baldr;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speeds[2][2];
+  };
+#pragma pack(pop)
+
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 2;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  testdata.header.speed_buffers = 2;
+  testdata.speeds[0][1] = TrafficSpeed(20, 20, UNKNOWN_TRAFFIC_SPEED_RAW,
+                                       UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 0, 0, 0, false);
+  testdata.speeds[1][1] = TrafficSpeed(30, 30, UNKNOWN_TRAFFIC_SPEED_RAW,
+                                       UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 0, 0, 0, false);
+
+  TrafficTile tile(
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile)));
+  EXPECT_EQ(tile.buffer_mask, 1);
+  EXPECT_EQ(tile.trafficspeed(1).get_overall_speed(), 40);
+  testdata.header.active_buffer = 1;
+  EXPECT_EQ(tile.trafficspeed(1).get_overall_speed(), 60);
+
+  // without room for the second set of speeds the first one is all there is
+  TrafficTile truncated(std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata),
+                                                               sizeof(TestTile) -
+                                                                   sizeof(TrafficSpeed)));
+  EXPECT_EQ(truncated.buffer_mask, 0);
+  EXPECT_EQ(truncated.trafficspeed(1).get_overall_speed(), 40);
+}
+
+TEST(Traffic, Updater) {
+  using namespace valhalla::baldr;
+
+  // one double buffered and one single buffered tile
+  const std::string traffic_extract = VALHALLA_BUILD_DIR "test/data/traffic_updater.tar";
+  std::filesystem::create_directories(std::filesystem::path(traffic_extract).parent_path());
+  const GraphId double_id(100, 2, 0), single_id(200, 2, 0);
+  const uint32_t edge_count = 3;
+  {
+    mtar_t tar;
+    ASSERT_EQ(mtar_open(&tar, traffic_extract.c_str(), "w"), MTAR_ESUCCESS);
+    for (const auto& tile_id : {double_id, single_id}) {
+      TrafficTileHeader header{};
+      header.tile_id = tile_id;
+      header.directed_edge_count = edge_count;
+      header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+      header.speed_buffers = tile_id == double_id ? 2 : 1;
+      std::string tile(reinterpret_cast<const char*>(&header), sizeof(header));
+      tile.append(header.speed_buffers * edge_count * sizeof(TrafficSpeed), '\0');
+      auto name = GraphTile::FileSuffix(tile_id);
+      ASSERT_EQ(mtar_write_file_header(&tar, name.c_str(), tile.size()), MTAR_ESUCCESS);
+      ASSERT_EQ(mtar_write_data(&tar, tile.data(), tile.size()), MTAR_ESUCCESS);
+    }
+    mtar_finalize(&tar);
+    mtar_close(&tar);
+  }
+
+  traffic_updater_t updater(traffic_extract, std::chrono::milliseconds(200));
+  EXPECT_TRUE(updater.HasTile(double_id));
+  EXPECT_TRUE(updater.HasTile(single_id));
+  EXPECT_FALSE(updater.HasTile(GraphId(300, 2, 0)));
+
+  auto speed = [](uint32_t kph) {
+    return TrafficSpeed(kph >> 1, kph >> 1, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW,
+                        255, 0, 0, 0, 0, false);
+  };
+  updater.Update(GraphId(100, 2, 1), speed(50));
+  updater.Update(GraphId(100, 2, 1), speed(60));
+  updater.Update(GraphId(200, 2, 2), speed(70));
+  updater.Update(GraphId(200, 2, 3), speed(80));
+  updater.Update(GraphId(300, 2, 0), speed(90));
+  EXPECT_EQ(updater.Pending(), 5);
+  EXPECT_EQ(updater.Publish(1234), 3);
+  EXPECT_EQ(updater.Pending(), 0);
+
+  // readers mapping the extract see the updates
+  valhalla::midgard::tar archive(traffic_extract);
+  auto read = [&archive](const GraphId& tile_id) {
+    const auto& entry = archive.contents.at(GraphTile::FileSuffix(tile_id));
+    return TrafficTile(
+        std::make_unique<UnmanagedGraphMemory>(const_cast<char*>(entry.first), entry.second));
+  };
+  auto double_tile = read(double_id);
+  EXPECT_EQ(double_tile.header->active_buffer, 1);
+  EXPECT_EQ(double_tile.header->last_update, 1234);
+  EXPECT_EQ(double_tile.trafficspeed(1).get_overall_speed(), 60);
+  EXPECT_FALSE(double_tile.trafficspeed(0).speed_valid());
+  auto single_tile = read(single_id);
+  EXPECT_EQ(single_tile.header->active_buffer, 0);
+  EXPECT_EQ(single_tile.trafficspeed(2).get_overall_speed(), 70);
+
+  // the next batch starts from what readers have seen and flips back, but not before readers had
+  // the interval to let go of the set it writes to
+  updater.Update(GraphId(100, 2, 0), speed(40));
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(updater.Publish(1240), 1);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+  EXPECT_EQ(double_tile.header->active_buffer, 0);
+  EXPECT_EQ(double_tile.trafficspeed(0).get_overall_speed(), 40);
+  EXPECT_EQ(double_tile.trafficspeed(1).get_overall_speed(), 60);
+
+  auto stats = updater.Stats();
+  EXPECT_EQ(stats.batches, 2);
+  EXPECT_EQ(stats.edges, 4);
+  EXPECT_EQ(stats.dropped, 2);
+  EXPECT_EQ(stats.flips, 2);
+  EXPECT_EQ(stats.waits, 1);
+
+  // the single set of speeds has no retired set to wait on
+  updater.Update(GraphId(200, 2, 2), speed(30));
+  start = std::chrono::steady_clock::now();
+  EXPECT_EQ(updater.Publish(1250), 1);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+  EXPECT_EQ(updater.Stats().waits, 1);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/radix_heap.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The priority queue of the labels a path algorithm still has to expand, either a double bucket
+ * queue or a radix heap. Which one is picked per search with use_radix_heap() before calling
+ * `reuse`, so that the algorithms can be configured to use either.
+ */
+template <typename label_t> class AdjacencyList final {
+public:
+  /**
+   * Default c-tor creates empty object that needs to be initialized with `reuse` method
+   */
+  AdjacencyList() = default;
+
+  /**
+   * Constructor given a minimum cost, a range of costs held within the
+   * bucket sort, and a bucket size, see DoubleBucketQueue.
+   * @param mincost    Minimum cost.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   * @param labelcontainer  Container of labels with sortcosts.
+   * @param radix_heap Whether to use a radix heap rather than a double bucket queue.
+   */
+  AdjacencyList(const float mincost,
+                const float range,
+                const uint32_t bucketsize,
+                const std::vector<label_t>* labelcontainer,
+                const bool radix_heap = false)
+      : radix_heap_(radix_heap) {
+    reuse(mincost, range, bucketsize, labelcontainer);
+  }
+
+  AdjacencyList(AdjacencyList&&) = default;
+  AdjacencyList& operator=(AdjacencyList&&) = default;
+  AdjacencyList(const AdjacencyList&) = delete;
+  AdjacencyList& operator=(const AdjacencyList&) = delete;
+
+  /**
+   * Sets the queue to use from the next call to `reuse` on. The list must be cleared.
+   * @param radix_heap  Whether to use a radix heap rather than a double bucket queue.
+   */
+  void use_radix_heap(const bool radix_heap) {
+    radix_heap_ = radix_heap;
+  }
+
+  /**
+   * Whether the list uses a radix heap.
+   * @return true if it uses a radix heap, false for a double bucket queue
+   */
+  bool radix_heap() const {
+    return radix_heap_;
+  }
+
+  /**
+   * The same as c-tor, but without buffers reallocation. Before call this
+   * method you should clean up the current state (call `clear`).
+   * @param mincost    Minimum cost.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    if (radix_heap_) {
+      heap_.reuse(mincost, range, bucketsize, labelcontainer);
+    } else {
+      buckets_.reuse(mincost, range, bucketsize, labelcontainer);
+    }
+  }
+
+  /**
+   * Clear all labels from the list.
+   */
+  void clear() {
+    heap_.clear();
+    buckets_.clear();
+  }
+
+  /**
+   * Adds a label index to the list.
+   * @param   label  Label index to add to the list.
+   */
+  void add(const uint32_t label) {
+    if (radix_heap_) {
+      heap_.add(label);
+    } else {
+      buckets_.add(label);
+    }
+  }
+
+  /**
+   * The specified label index now has a smaller cost, must be called before the cost of the
+   * label is changed.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    if (radix_heap_) {
+      heap_.decrease(label, newcost);
+    } else {
+      buckets_.decrease(label, newcost);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the list.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the list is empty.
+   */
+  uint32_t pop() {
+    return radix_heap_ ? heap_.pop() : buckets_.pop();
+  }
+
+  /**
+   * The number of label indices the list has room for without allocating.
+   * @return  Returns the capacity of the buckets of both queues.
+   */
+  size_t reserved() const {
+    return heap_.reserved() + buckets_.reserved();
+  }
+
+private:
+  DoubleBucketQueue<label_t> buckets_;
+  RadixHeap<label_t> heap_;
+  bool radix_heap_ = false;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Reads many whole files at once. Built with ENABLE_IO_URING the reads are submitted to the kernel
+ * in batches through a single io_uring so the disk sees many requests in flight at the same time,
+ * otherwise (or if the ring cannot be set up, e.g. old kernels or seccomp) the files are read one
+ * after the other.
+ * @param paths        the files to read
+ * @param queue_depth  how many reads to keep in flight at the same time
+ * @return one buffer per path in the same order, std::nullopt if the file could not be read
+ */
+std::vector<std::optional<std::vector<char>>> read_files(const std::vector<std::string>& paths,
+                                                         unsigned queue_depth = 64);
+
+/**
+ * @return whether read_files uses io_uring on this build and kernel
+ */
+bool io_uring_available();
+
+} // namespace baldr
+} // namespace valhalla
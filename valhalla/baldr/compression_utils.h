@@ -2,7 +2,9 @@
 
 #include <zlib.h>
 
+#include <cstddef>
 #include <functional>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -27,5 +29,29 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
 bool inflate(const std::function<void(z_stream&)>& src_func,
              const std::function<int(z_stream&)>& dst_func);
 
+/* Compresses data into a single LZ4 frame which records the uncompressed size
+ * @param src    the data to compress
+ * @param size   the size of the data in bytes
+ * @param dst    where to write the frame to
+ * @param level  what compression level to use, 0 is fast, up to 12 for the high compression mode
+ * @return       returns true if the data was successfully compressed, false otherwise
+ */
+bool lz4_compress(const char* src, size_t size, std::vector<char>& dst, int level = 0);
+
+/* Decompresses a single LZ4 frame
+ * @param src   the frame
+ * @param size  the size of the frame in bytes
+ * @param dst   where to write the decompressed data to
+ * @return      returns true if the frame was successfully decompressed, false otherwise
+ */
+bool lz4_decompress(const char* src, size_t size, std::vector<char>& dst);
+
+/* Whether the data starts with the magic number of an LZ4 frame
+ * @param src   the data
+ * @param size  the size of the data in bytes
+ * @return      returns true if the data looks like an LZ4 frame
+ */
+bool is_lz4_frame(const char* src, size_t size);
+
 } // namespace baldr
 } // namespace valhalla
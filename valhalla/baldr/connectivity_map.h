@@ -3,8 +3,10 @@
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/midgard/sequence.h>
 
 #include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -15,13 +17,18 @@ namespace baldr {
 class connectivity_map_t {
 public:
   /**
-   * Constructs the connectivity map
+   * Constructs the connectivity map. If mjolnir.connectivity_map names a file written by
+   * valhalla_build_connectivity for the tiles of the reader the map is memory mapped from it,
+   * otherwise the tiles are colored by their proximity to one another.
    * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
    * @param graphreader optional pointer to the graph reader to use. If null, then the reader will be
    * constructed using pt.
+   * @param build_components  ignore the file and work out the components of each mode as well, by
+   *                          going through the edges of every tile
    */
   connectivity_map_t(const boost::property_tree::ptree& pt,
-                     const std::shared_ptr<GraphReader>& graph_reader = {});
+                     const std::shared_ptr<GraphReader>& graph_reader = {},
+                     bool build_components = false);
 
   /**
    * Alternative to GetTiles() to query whether a level even exists, e.g. transit.#
@@ -51,6 +58,35 @@ public:
                                         const baldr::PathLocation& location,
                                         float radius) const;
 
+  /**
+   * Are there components for the given access, ie. for the costings using that access mask.
+   *
+   * @param access  the access mask of the costing
+   * @return true if the components of that access were built
+   */
+  bool has_components(const uint32_t access) const;
+
+  /**
+   * Returns the components the edges of a location belong to for the given access. Two locations
+   * without a component in common can't be reached from one another using only edges with that
+   * access, whatever the level of the edges.
+   *
+   * @param access    the access mask of the costing
+   * @param location  the correlated location
+   * @param reader    graph reader to find the end nodes of the edges with
+   * @return components  the components of the edges, empty if there are none for the access
+   */
+  std::unordered_set<size_t> get_components(const uint32_t access,
+                                            const baldr::PathLocation& location,
+                                            GraphReader& reader) const;
+
+  /**
+   * Writes the map to a file which can be memory mapped by setting mjolnir.connectivity_map.
+   *
+   * @param file_name  the file to write
+   */
+  void save(const std::string& file_name) const;
+
   /**
    * Returns the geojson representing the connectivity map
    *
@@ -73,14 +109,38 @@ public:
    * @return Returns true if the level has data, false if it does not (no tiles present)
    */
   bool has_data(const uint32_t level) const {
-    auto c = colors.find(level);
-    return (c == colors.end()) ? false : c->second.size() > 0;
+    const auto* colors = find_layer(level, 0);
+    return colors != nullptr && colors->count > 0;
   }
 
 private:
+  // the colors of the tiles of a level, either by proximity (no access) or the components the
+  // edges with the given access form. tiles are sorted by id, a color goes with each of them
+  struct layer_t {
+    uint32_t level;
+    uint32_t access;
+    uint32_t count;
+    const uint32_t* tiles;
+    const uint32_t* colors;
+
+    // the color of a tile, 0 when it isn't in the layer
+    uint32_t find(const uint32_t tile_id) const;
+  };
+
+  const layer_t* find_layer(const uint32_t level, const uint32_t access) const;
+  bool load(const std::string& file_name);
+  void add_layer(const uint32_t level,
+                 const uint32_t access,
+                 const std::unordered_map<uint32_t, size_t>& colors);
+  void add_components(GraphReader& reader, const std::unordered_set<GraphId>& tiles);
+
   uint32_t transit_level;
-  // this is a map(tile_level, map(tile_id, tile_color))
-  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
+  // identifies the tileset the map is for, a file built for another one isn't used
+  uint64_t tileset;
+  std::vector<layer_t> layers;
+  // backs the layers when they were computed rather than mapped from a file
+  std::vector<std::vector<uint32_t>> storage;
+  midgard::mem_map<char> file;
 };
 } // namespace baldr
 } // namespace valhalla
@@ -0,0 +1,201 @@
+#ifndef VALHALLA_BALDR_CONTRACTIONGRAPH_H_
+#define VALHALLA_BALDR_CONTRACTIONGRAPH_H_
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+#include <valhalla/proto/options.pb.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Contraction hierarchy over the directed edges of the graph, written next to the tiles by the
+ * contraction stage of valhalla_build_tiles when mjolnir.contraction_hierarchy is set.
+ *
+ * The vertices of the hierarchy are the directed edges and its arcs are the turns from one edge
+ * onto the next, so that turn costs and simple turn restrictions are part of the arc costs. A
+ * vertex is the index of its edge in the sorted list of edges in the file. Every vertex keeps the
+ * arcs to the vertices contracted after it: the up arcs leave the vertex and are followed by the
+ * forward search, the down arcs enter it and are followed backwards by the reverse search. An arc
+ * which is a shortcut names the vertex it was contracted over, so that it can be unpacked into
+ * the two arcs it replaces.
+ *
+ * The costs are those of a single costing with fixed options, which the hierarchy only serves.
+ * Every arc also carries the time and the length of the edges it stands for.
+ *
+ * For one-to-all searches the vertices are also laid out in sweep order, from the top of the
+ * hierarchy down: a vertex comes after every vertex it has a down arc from. The down arcs are
+ * repeated by the position of their vertex in that order, so that a sweep relaxing them reads
+ * through memory front to back (see thor::ContractionSweep).
+ */
+class ContractionGraph {
+public:
+  static constexpr uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+
+  struct arc_t {
+    uint32_t vertex; // the other end of the arc
+    uint32_t middle; // the vertex a shortcut was contracted over, kNoVertex for a turn
+    float cost;
+    float secs;
+    uint32_t length;
+  };
+
+  // a down arc in sweep order, from the vertex at a position further up the hierarchy
+  struct sweep_arc_t {
+    uint32_t position;
+    float cost;
+    float secs;
+    uint32_t length;
+  };
+
+  /**
+   * Memory maps a hierarchy written by write(). A file which can't be mapped or isn't a hierarchy
+   * is logged and leaves the graph empty.
+   * @param file_name  the file to map
+   */
+  explicit ContractionGraph(const std::string& file_name);
+
+  /**
+   * Writes a hierarchy, next to the file and then moved into place so that services mapping the
+   * previous one keep working.
+   * @param file_name    the file to write
+   * @param costing      fingerprint() of the costing options the costs were computed with
+   * @param edges        the edge of every vertex, sorted
+   * @param up_offsets   the first up arc of every vertex and one past the last one of the last
+   * @param up_arcs      the up arcs, pointing at the vertex they lead to
+   * @param down_offsets the first down arc of every vertex and one past the last one of the last
+   * @param down_arcs    the down arcs, pointing at the vertex they come from
+   * @param sweep_order  the vertex at every position of the sweep
+   * @param sweep_offsets the first sweep arc of every position and one past the last one of the
+   *                      last
+   * @param sweep_arcs   the down arcs of the vertices in sweep order
+   */
+  static void write(const std::string& file_name,
+                    const std::string& costing,
+                    const std::vector<GraphId>& edges,
+                    const std::vector<uint64_t>& up_offsets,
+                    const std::vector<arc_t>& up_arcs,
+                    const std::vector<uint64_t>& down_offsets,
+                    const std::vector<arc_t>& down_arcs,
+                    const std::vector<uint32_t>& sweep_order,
+                    const std::vector<uint64_t>& sweep_offsets,
+                    const std::vector<sweep_arc_t>& sweep_arcs);
+
+  /**
+   * The fingerprint of costing options, requests with the same fingerprint as the hierarchy get
+   * the same costs out of it as from searching the graph. Hierarchy limits only prune searches
+   * and are left out.
+   * @param options  the costing options
+   * @return the fingerprint
+   */
+  static std::string fingerprint(const Costing_Options& options);
+
+  /**
+   * Was a hierarchy mapped.
+   * @return true if there are no vertices
+   */
+  bool empty() const {
+    return vertex_count_ == 0;
+  }
+
+  /**
+   * The fingerprint of the costing options the hierarchy was built with.
+   * @return the fingerprint
+   */
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  uint32_t vertex_count() const {
+    return vertex_count_;
+  }
+
+  /**
+   * The vertex of a directed edge.
+   * @param edge_id  the directed edge
+   * @return the vertex, kNoVertex if the edge isn't in the hierarchy
+   */
+  uint32_t vertex(const GraphId& edge_id) const;
+
+  /**
+   * The directed edge of a vertex.
+   * @param vertex  the vertex
+   * @return the directed edge
+   */
+  GraphId edge(const uint32_t vertex) const {
+    return edges_[vertex];
+  }
+
+  const arc_t* up_begin(const uint32_t vertex) const {
+    return up_arcs_ + up_offsets_[vertex];
+  }
+  const arc_t* up_end(const uint32_t vertex) const {
+    return up_arcs_ + up_offsets_[vertex + 1];
+  }
+  const arc_t* down_begin(const uint32_t vertex) const {
+    return down_arcs_ + down_offsets_[vertex];
+  }
+  const arc_t* down_end(const uint32_t vertex) const {
+    return down_arcs_ + down_offsets_[vertex + 1];
+  }
+
+  /**
+   * The position of a vertex in the sweep order.
+   * @param vertex  the vertex
+   * @return the position
+   */
+  uint32_t sweep_position(const uint32_t vertex) const {
+    return sweep_positions_[vertex];
+  }
+
+  /**
+   * The vertex at a position of the sweep order.
+   * @param position  the position
+   * @return the vertex
+   */
+  uint32_t sweep_vertex(const uint32_t position) const {
+    return sweep_order_[position];
+  }
+
+  const sweep_arc_t* sweep_begin(const uint32_t position) const {
+    return sweep_arcs_ + sweep_offsets_[position];
+  }
+  const sweep_arc_t* sweep_end(const uint32_t position) const {
+    return sweep_arcs_ + sweep_offsets_[position + 1];
+  }
+
+  /**
+   * Unpacks the arc from one vertex to another into the turns it stands for.
+   * @param from      the vertex the arc leaves
+   * @param to        the vertex the arc enters
+   * @param vertices  receives the vertices after from, up to and including to
+   * @return false if there is no such arc
+   */
+  bool unpack(const uint32_t from, const uint32_t to, std::vector<uint32_t>& vertices) const;
+
+private:
+  const arc_t* find_arc(const uint32_t from, const uint32_t to) const;
+
+  uint32_t vertex_count_;
+  std::string costing_;
+  const GraphId* edges_;
+  const uint64_t* up_offsets_;
+  const arc_t* up_arcs_;
+  const uint64_t* down_offsets_;
+  const arc_t* down_arcs_;
+  const uint32_t* sweep_order_;
+  const uint32_t* sweep_positions_;
+  const uint64_t* sweep_offsets_;
+  const sweep_arc_t* sweep_arcs_;
+  midgard::mem_map<char> file_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CONTRACTIONGRAPH_H_
@@ -30,15 +30,22 @@ public:
     long http_code = 0;
     auto tile_data = curler.get()(url, http_code, gzipped_, interrupt_);
     response_t result;
-    // TODO: Check other codes.
     if (http_code == 200) {
       result.bytes_ = std::move(tile_data);
       result.status_ = tile_getter_t::status_code_t::SUCCESS;
+    } else if (http_code == 404) {
+      // only a 404 says there is no such tile, anything else may work the next time around
+      result.status_ = tile_getter_t::status_code_t::NOT_FOUND;
     }
 
     return result;
   }
 
+  // every request uses a curler of its own from the pool
+  bool thread_safe() const override {
+    return true;
+  }
+
   bool gzipped() const override {
     return gzipped_;
   }
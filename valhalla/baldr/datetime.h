@@ -80,6 +80,94 @@ struct dt_info_t {
  */
 const tz_db_t& get_tz_db();
 
+/**
+ * The UTC offsets of all our time zones over a span of years, so that time dependent routing can
+ * look up the offset of a tz index at a given time without going through the date library. Every
+ * zone keeps the transitions within the span and an index of which transition is in effect at the
+ * start of each ~12 day bucket. Zones change their offset at most a few times a year so a lookup
+ * is a bucket read and a step or two forward. The table is immutable once built and lookups don't
+ * allocate, so threads share it freely.
+ */
+struct tz_offsets_t {
+  /**
+   * Builds the offsets of every zone in the tz db.
+   * @param begin  first second since epoch covered
+   * @param end    first second since epoch no longer covered
+   */
+  tz_offsets_t(int64_t begin, int64_t end);
+
+  /**
+   * Gets the offset from UTC of a time zone at a point in time.
+   * @param tz_index  our tz index of the time zone
+   * @param seconds   seconds since epoch
+   * @param offset    receives the offset in seconds
+   * @return false if the time zone or the time is not covered
+   */
+  inline bool offset(size_t tz_index, int64_t seconds, int32_t& offset) const {
+    if (tz_index >= zones_.size() || seconds < begin_ || seconds >= end_) {
+      return false;
+    }
+    const zone_t& zone = zones_[tz_index];
+    if (zone.count == 0) {
+      return false;
+    }
+    uint32_t i = zone.first;
+    if (zone.count > 1) {
+      // start from the transition at the beginning of the bucket and move up to the time
+      i += buckets_[zone.buckets + ((seconds - begin_) >> kBucketShift)];
+      const uint32_t last = zone.first + zone.count - 1;
+      while (i < last && begins_[i + 1] <= seconds) {
+        ++i;
+      }
+    }
+    offset = offsets_[i];
+    return true;
+  }
+
+  int64_t begin() const {
+    return begin_;
+  }
+
+  int64_t end() const {
+    return end_;
+  }
+
+protected:
+  // 2^20 seconds is a little over 12 days
+  static constexpr uint32_t kBucketShift = 20;
+
+  struct zone_t {
+    // first transition of the zone
+    uint32_t first = 0;
+    // number of transitions, 0 if the zone is not in the tz db
+    uint32_t count = 0;
+    // first bucket of the zone, only zones with more than one transition have buckets
+    uint32_t buckets = 0;
+  };
+
+  int64_t begin_;
+  int64_t end_;
+  std::vector<zone_t> zones_;
+  // when each transition starts and the offset from then on
+  std::vector<int64_t> begins_;
+  std::vector<int32_t> offsets_;
+  // per bucket the transition in effect at its start, relative to the first one of the zone
+  std::vector<uint16_t> buckets_;
+};
+
+/**
+ * Get the timezone offsets singleton, built on first use
+ * @return  timezone offsets
+ */
+const tz_offsets_t& get_tz_offsets();
+
+/**
+ * Sets how many years before and after the current one the timezone offsets cover. Only has an
+ * effect before they are first used, 0 leaves every lookup to the date library.
+ * @param years  years on either side of the current one
+ */
+void set_tz_offset_years(uint32_t years);
+
 /**
  * Get a formatted date from a string.
  * @param date       in the format of 2015-05-06T08:00
@@ -135,6 +223,20 @@ int timezone_diff(const uint64_t seconds,
                   const date::time_zone* dest_tz,
                   tz_sys_info_cache_t* cache = nullptr);
 
+/**
+ * Get the difference between two timezones by our tz index. Uses the timezone offsets when they
+ * cover the time and the timezone pointers otherwise.
+ * @param   seconds       seconds since epoch
+ * @param   origin_index  tz index for origin
+ * @param   dest_index    tz index for dest
+ * @param   cache         a cache for timezone sys_info lookup when not covered by the offsets
+ * @return Returns the seconds difference between the 2 timezones.
+ */
+int timezone_diff(const uint64_t seconds,
+                  const size_t origin_index,
+                  const size_t dest_index,
+                  tz_sys_info_cache_t* cache = nullptr);
+
 /**
  * Get the iso date time from seconds since epoch and timezone.
  * @param   seconds      seconds since epoch
@@ -225,6 +327,25 @@ bool is_conditional_active(const bool type,
                            const uint64_t current_time,
                            const date::time_zone* time_zone);
 
+/**
+ * Same as above with the timezone given by our tz index, which gets the local time from the
+ * timezone offsets when they cover the current time.
+ */
+bool is_conditional_active(const bool type,
+                           const uint8_t begin_hrs,
+                           const uint8_t begin_mins,
+                           const uint8_t end_hrs,
+                           const uint8_t end_mins,
+                           const uint8_t dow,
+                           const uint8_t begin_week,
+                           const uint8_t begin_month,
+                           const uint8_t begin_day_dow,
+                           const uint8_t end_week,
+                           const uint8_t end_month,
+                           const uint8_t end_day_dow,
+                           const uint64_t current_time,
+                           const size_t tz_index);
+
 /**
  * Gets the second of the week in local time from an epoch time and timezone
  * @param epoch_time   the time from which to offset
@@ -175,6 +175,18 @@ public:
     return label;
   }
 
+  /**
+   * The number of label indices the buckets have room for without allocating.
+   * @return  Returns the capacity of the low-level buckets and the overflow bucket.
+   */
+  size_t reserved() const {
+    size_t reserved = overflowbucket_.capacity();
+    for (const auto& bucket : buckets_) {
+      reserved += bucket.capacity();
+    }
+    return reserved;
+  }
+
 private:
   float bucketrange_; // Total range of costs in lower level buckets
   float bucketsize_;  // Bucket size (range of costs in same bucket)
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * How the kernel should treat the memory mapped tile extract. By default it is left to readahead
+ * and the page cache, which under memory pressure lets tiles of rarely used regions push out the
+ * dense ones every request needs. Configured in the mjolnir section:
+ *
+ *   tile_extract_advice     readahead for the whole extract: normal (default), random or sequential
+ *   tile_extract_hugepages  ask for the extract to be backed by transparent huge pages
+ *   tile_extract_pin_list   file listing the hot tiles to lock into memory
+ */
+struct extract_policy_t {
+  enum class advice_t { normal, random, sequential };
+
+  advice_t advice = advice_t::normal;
+  bool hugepages = false;
+  std::string pin_list;
+
+  extract_policy_t() = default;
+  explicit extract_policy_t(const boost::property_tree::ptree& pt);
+
+  /**
+   * @return true if the extract should be left to the kernel's defaults
+   */
+  bool is_default() const {
+    return advice == advice_t::normal && !hugepages && pin_list.empty();
+  }
+};
+
+/**
+ * Applies the readahead advice and huge page request to a mapped extract. Huge pages need a
+ * kernel with transparent huge pages for read-only files (CONFIG_READ_ONLY_THP_FOR_FS), where the
+ * extract is collapsed right away if the kernel supports it or by khugepaged in the background
+ * otherwise. Failures are logged and ignored, the extract works the same either way.
+ * @param data    start of the mapping
+ * @param size    size of the mapping in bytes
+ * @param policy  the policy to apply
+ */
+void advise_extract(const char* data, size_t size, const extract_policy_t& policy);
+
+/**
+ * Faults the given ranges of a mapped extract in and locks them into memory, with the default
+ * readahead whatever the advice for the rest of the extract was. Stops at the first range the
+ * kernel won't lock, usually because of the RLIMIT_MEMLOCK (ulimit -l) of the process. The locks
+ * are released when the extract is unmapped.
+ * @param ranges  start and size in bytes of each tile to lock
+ * @return the number of bytes locked
+ */
+size_t lock_tiles(const std::vector<std::pair<char*, size_t>>& ranges);
+
+/**
+ * Reads a list of tiles, one per line either as the numeric graphid value or the tile's path
+ * within the tile directory (e.g. 2/000/818/660.gph). Empty lines and lines starting with # are
+ * skipped, so are lines that are neither.
+ * @param path  the file to read
+ * @return the tile bases in the order listed, empty if the file couldn't be read
+ */
+std::vector<GraphId> read_tile_list(const std::string& path);
+
+} // namespace baldr
+} // namespace valhalla
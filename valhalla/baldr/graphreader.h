@@ -4,20 +4,29 @@
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/tilegetter.h>
 #include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/baldr/tilemetrics.h>
+#include <valhalla/baldr/tilefetcher.h>
+#include <valhalla/baldr/tileprefetcher.h>
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace valhalla {
 class IncidentsTile;
+class TileMetrics;
 namespace midgard {
 struct tar;
 }
@@ -49,7 +58,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   virtual void Reserve(size_t tile_size) = 0;
 
@@ -91,6 +100,14 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  virtual uint64_t Evictions() const {
+    return 0;
+  }
 };
 
 /**
@@ -107,7 +124,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -150,6 +167,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  uint64_t Evictions() const override;
+
 protected:
   inline uint32_t get_offset(const GraphId& graphid) const {
     return graphid.level() < 4 ? index_offsets_[graphid.level()] + graphid.tileid()
@@ -175,6 +198,9 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // The number of tiles dropped so far
+  uint64_t evictions_ = 0;
 };
 
 /**
@@ -191,7 +217,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -234,6 +260,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  uint64_t Evictions() const override;
+
 protected:
   // The actual cached GraphTile objects
   std::unordered_map<uint64_t, graph_tile_ptr> cache_;
@@ -243,6 +275,9 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // The number of tiles dropped so far
+  uint64_t evictions_ = 0;
 };
 
 /**
@@ -266,7 +301,7 @@ public:
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -309,6 +344,12 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  uint64_t Evictions() const override;
+
 protected:
   struct KeyValue {
     KeyValue(GraphId id_, graph_tile_ptr tile_) : id(id_), tile(std::move(tile_)) {
@@ -351,6 +392,9 @@ protected:
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // The number of tiles dropped so far
+  uint64_t evictions_ = 0;
 };
 
 /**
@@ -367,7 +411,7 @@ public:
   SynchronizedTileCache(TileCache& cache, std::mutex& mutex);
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
-   * @param tile_size appeoximate size of one tile
+   * @param tile_size approximate size of one tile
    */
   void Reserve(size_t tile_size) override;
 
@@ -410,11 +454,179 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  uint64_t Evictions() const override;
+
 private:
   TileCache& cache_;
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Thread-safe tile cache which spreads tiles over shards keyed by their tile base.
+ * Reads never take a lock: every shard publishes an open addressing table which readers
+ * probe with atomic loads while writers, serialized per shard, insert into it in place.
+ * Tables that get replaced (on growth or clear) are only freed once every reader which
+ * could still see them is done (a minimal RCU grace period). Readers announce themselves on
+ * counters of their own thread's cache line rather than on a counter shared by the shard.
+ * The cache never evicts single tiles, overcommitted caches are trimmed by clearing them.
+ * Since tiles are shared between threads it should be used with thread safe tile ref counts.
+ */
+class ShardedTileCache : public TileCache {
+public:
+  static constexpr size_t kDefaultShardCount = 64;
+
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of shards, rounded up to the next power of 2
+   */
+  ShardedTileCache(size_t max_size, size_t shard_count = kDefaultShardCount);
+
+  /**
+   * Destructor.
+   */
+  ~ShardedTileCache() override;
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size approximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already cached the
+   * same tile the previously cached copy is kept and returned.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Some implementations may simply clear the entire cache
+   */
+  void Trim() override;
+
+  /**
+   * Lets you know how many tiles the cache dropped so far, to make room or when cleared.
+   * @return the number of evicted tiles
+   */
+  uint64_t Evictions() const override;
+
+protected:
+  // A slot of the open addressing table, the tile is written before the key is published
+  struct Slot {
+    std::atomic<uint64_t> key{kInvalidGraphId};
+    graph_tile_ptr tile;
+  };
+
+  // Fixed capacity (power of 2) table, it is replaced by a bigger one when half full
+  struct Table {
+    explicit Table(size_t capacity);
+    size_t mask;
+    size_t count;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  // Shards live on their own cache lines so that readers of different shards don't contend
+  struct alignas(64) Shard {
+    std::atomic<Table*> table{nullptr};
+    // serializes writers of this shard
+    std::mutex mutex;
+    // size in bytes of the tiles held by this shard
+    size_t size = 0;
+  };
+
+  /**
+   * Hashes the tile base of the graphid, the high bits pick the shard the low bits the slot
+   */
+  static inline uint64_t hash(const GraphId& graphid) {
+    return graphid.Tile_Base().value * 0x9E3779B97F4A7C15ull;
+  }
+
+  inline Shard& shard(uint64_t hash) const {
+    return shards_[(hash >> 40) & shard_mask_];
+  }
+
+  /**
+   * Lock-free lookup of a tile in the shard
+   */
+  graph_tile_ptr Find(const Shard& shard, uint64_t key, uint64_t hash) const;
+
+  /**
+   * Inserts into a table which must have room for the tile, the shard must be locked
+   */
+  static graph_tile_ptr& Insert(Table& table, uint64_t key, uint64_t hash, graph_tile_ptr tile);
+
+  /**
+   * Copies the tiles of the table into a new table of the given capacity
+   */
+  static Table* Rehash(const Table& table, size_t capacity);
+
+  /**
+   * Publishes a new table for the shard and frees the previous one once no reader can see it
+   * anymore, the shard must be locked
+   */
+  void Replace(Shard& shard, Table* table);
+
+  std::unique_ptr<Shard[]> shards_;
+  size_t shard_mask_;
+
+  // Capacity of freshly created shard tables
+  size_t table_capacity_;
+
+  // Readers register under the parity of the current epoch on the counters of the slot their
+  // thread was given, each slot on a cache line of its own. Threads share slots once there are
+  // more of them than slots, that only makes them contend again.
+  static constexpr size_t kReaderSlots = 64;
+  struct alignas(64) ReaderSlot {
+    std::atomic<uint32_t> readers[2]{};
+  };
+  std::unique_ptr<ReaderSlot[]> reader_slots_;
+  std::atomic<uint32_t> epoch_{0};
+  // a grace period flips the epoch twice, two of them at once could leave a parity unchecked
+  std::mutex grace_mutex_;
+
+  // The current cache size in bytes
+  std::atomic<size_t> cache_size_;
+
+  // The max cache size in bytes
+  size_t max_cache_size_;
+
+  // The number of tiles dropped so far
+  std::atomic<uint64_t> evictions_{0};
+};
+
 /**
  * Creates tile caches.
  */
@@ -508,19 +720,123 @@ public:
     return GetGraphTile(pointll, TileHierarchy::levels().back().level);
   }
 
+  /**
+   * Hints that the tile containing the given graphid will likely be needed soon so that it can
+   * be loaded in the background. Does nothing unless tile prefetching is enabled.
+   * @param graphid  any graphid within the tile
+   */
+  void Prefetch(const GraphId& graphid) {
+    if (prefetcher_ && !cache_->Contains(graphid.Tile_Base())) {
+      prefetcher_->Prefetch(graphid.Tile_Base());
+    }
+  }
+
+  /**
+   * Hints that a search is expanding within the tile of the given graphid so that the tiles
+   * around it, which its frontier will enter next, can be loaded in the background. Does
+   * nothing unless tile prefetching is enabled.
+   * @param graphid  any graphid within the tile being expanded
+   */
+  void PrefetchNeighbors(const GraphId& graphid) {
+    if (prefetcher_ && graphid.Tile_Base() != last_prefetched_) {
+      PrefetchNeighborsOf(graphid.Tile_Base());
+    }
+  }
+
+  /**
+   * Returns how well the tile prefetching has worked out so far, all zeros if it is disabled.
+   * @return the prefetch counters
+   */
+  tile_prefetcher_t::stats_t GetPrefetchStats() const {
+    return prefetcher_ ? prefetcher_->Stats() : tile_prefetcher_t::stats_t{0, 0, 0};
+  }
+
+  /**
+   * Loads the given tiles from the tile directory into the cache in as few batches of disk reads
+   * as possible (using io_uring where it is available). Tiles which are cached already are skipped,
+   * gzipped tiles are loaded one at a time. The batches are read in chunks and no further chunk is
+   * read once the cache is over its limit. With a tile url the tiles are fetched concurrently on
+   * up to max_concurrent_reader_users connections instead. Does nothing unless tiles are kept as
+   * loose files or fetched from a tile url.
+   * @param tile_ids  the tiles to load, any graphid within the tile will do
+   * @return the number of tiles that were newly loaded
+   */
+  size_t LoadTiles(const std::vector<GraphId>& tile_ids);
+
+  /**
+   * Loads all tiles of all levels intersecting the bounding box into the cache, see above. Does
+   * nothing if more than the configured tile_batch_max_tiles (64 by default) would be needed.
+   * @param bbox  the bounding box
+   * @return the number of tiles that were newly loaded
+   */
+  size_t LoadTiles(const midgard::AABB2<midgard::PointLL>& bbox);
+
   /**
    * Clears the cache
    */
   virtual void Clear() {
     cache_->Clear();
+    if (prefetcher_) {
+      prefetcher_->Clear();
+    }
+    prefetched_neighbors_.clear();
+    last_prefetched_ = {};
   }
 
+  /**
+   * Returns how this reader got at its tiles so far: cache hits and misses, the tiles its cache
+   * evicted, the tiles it loaded and how long that took and how often each level was accessed.
+   * Call it from the thread using the reader, the cache isn't necessarily thread-safe.
+   * @return the tile access counters
+   */
+  tile_metrics_t::snapshot_t GetTileMetrics() const;
+
+  /**
+   * Adds the tile access counters and prefetch stats of this reader to the given totals, unless
+   * they already include this reader, so that the workers handling a status request can sum up
+   * their readers without counting one they share twice.
+   * @param metrics  the totals of the readers so far
+   */
+  void AddTileMetrics(TileMetrics& metrics) const;
+
+  /**
+   * Locks the given tiles of the memory mapped extract into memory so that they are never paged
+   * out, e.g. the ones requests hit the most. The pinned tiles get the default readahead back and
+   * are read in right away, whatever tile_extract_advice says for the rest of the extract. Does
+   * nothing unless tiles come from an extract. The locks go away with the extract.
+   * @param tile_ids  the tiles to lock, any graphid within the tile will do
+   * @return the number of bytes locked, less than asked for if it went over ulimit -l
+   */
+  size_t PinTiles(const std::vector<GraphId>& tile_ids);
+
+  /**
+   * Locks the tiles listed in tile_extract_pin_list into memory. Called whenever an extract is
+   * loaded, also when a replaced one is swapped in.
+   * @return the number of bytes locked
+   */
+  size_t PinTiles();
+
+  /**
+   * Swaps in the tile and traffic extracts if they were replaced on disk since they were loaded,
+   * checking at most every extract_reload_interval seconds (never by default). Tiles handed out
+   * before keep the previous extracts mapped until the last of them is gone, so call this in
+   * between requests like Trim. Replace the files by renaming new ones over them, files that are
+   * rewritten in place might be picked up half written.
+   * @return true if new extracts were swapped in, the cache is cleared in that case
+   */
+  bool ReloadExtracts();
+
   /**
    * Tries to ensure the cache footprint below allowed maximum
    * In some cases may even remove the entire cache.
    */
   virtual void Trim() {
     cache_->Trim();
+    if (prefetcher_) {
+      prefetcher_->Clear();
+    }
+    prefetched_neighbors_.clear();
+    last_prefetched_ = {};
   }
 
   /**
@@ -976,11 +1292,25 @@ protected:
     std::shared_ptr<midgard::tar> archive;
     std::shared_ptr<midgard::tar> traffic_archive;
     uint64_t checksum;
+    // whether the tiles are lz4 compressed and need to be decompressed before use
+    bool compressed = false;
   };
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
   get_extract_instance(const boost::property_tree::ptree& pt);
 
+  // What is needed to load the extracts again and tell whether they were replaced on disk
+  boost::property_tree::ptree extract_config_;
+  bool traffic_readonly_;
+  std::chrono::seconds extract_reload_interval_;
+  std::chrono::steady_clock::time_point next_extract_check_;
+  // tells the time for the reload checks, tests move it along instead of waiting
+  std::function<std::chrono::steady_clock::time_point()> extract_clock_ = []() {
+    return std::chrono::steady_clock::now();
+  };
+  using file_stamp_t = std::array<uint64_t, 4>;
+  std::array<file_stamp_t, 2> extract_stamps_;
+
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
@@ -988,13 +1318,66 @@ protected:
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
   const std::string tile_url_;
+  std::unique_ptr<url_tile_fetcher_t> url_fetcher_;
 
+  // Tiles the tile url answered with a 404, they aren't asked for again
   std::mutex _404s_lock;
   std::unordered_set<GraphId> _404s;
 
   std::unique_ptr<TileCache> cache_;
 
   bool enable_incidents_;
+
+  /**
+   * Loads a tile from the extract, the tile directory or the tile url and puts it in the cache
+   * @param base  the tile base of the tile
+   * @return the tile or nullptr if there is no such tile
+   */
+  graph_tile_ptr LoadGraphTile(const GraphId& base);
+
+  // Counts how the tiles were gotten at
+  tile_metrics_t metrics_;
+  // Identifies this reader among those summed up by AddTileMetrics
+  uint64_t id_;
+
+  /**
+   * Loads a tile from the tile directory along with its live traffic, if any
+   * @param base  the tile base of the tile
+   * @return the tile or nullptr if it isn't on disk
+   */
+  graph_tile_ptr LoadTileFromDir(const GraphId& base) const;
+
+  /**
+   * Fetches a tile from the tile url, or the copy kept in the tile directory, along with its
+   * live traffic, if any
+   * @param base       the tile base of the tile
+   * @param not_found  if given, set to whether the tile url doesn't have the tile
+   * @return the tile or nullptr if it couldn't be fetched
+   */
+  graph_tile_ptr LoadTileFromUrl(const GraphId& base, bool* not_found = nullptr) const;
+
+  /**
+   * Fetches a batch of tiles from the tile url concurrently and puts them in the cache
+   * @param bases  the tile bases of the tiles which aren't cached yet
+   * @return the number of tiles that were fetched
+   */
+  size_t FetchTiles(const std::vector<GraphId>& bases);
+
+  // The most tiles we are willing to load in one batch for a bounding box
+  size_t batch_max_tiles_;
+
+  /**
+   * Queues the tiles surrounding the given tile for prefetching
+   * @param base  the tile base of the tile being expanded
+   */
+  void PrefetchNeighborsOf(const GraphId& base);
+
+  // Tiles whose neighbors have already been hinted at
+  GraphId last_prefetched_;
+  std::unordered_set<GraphId> prefetched_neighbors_;
+
+  // Declared last so that its threads are stopped before anything they use is destroyed
+  std::unique_ptr<tile_prefetcher_t> prefetcher_;
 };
 
 class LimitedGraphReader {
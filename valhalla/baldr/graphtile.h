@@ -10,10 +10,12 @@
 #include <valhalla/baldr/graphmemory.h>
 #include <valhalla/baldr/graphtileheader.h>
 #include <valhalla/baldr/graphtileptr.h>
+#include <valhalla/baldr/hotedges.h>
 #include <valhalla/baldr/laneconnectivity.h>
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/nodetransition.h>
 #include <valhalla/baldr/predictedspeeds.h>
+#include <valhalla/baldr/shortcutedges.h>
 #include <valhalla/baldr/sign.h>
 #include <valhalla/baldr/signinfo.h>
 #include <valhalla/baldr/traffictile.h>
@@ -65,8 +67,11 @@ public:
    * size of the tile data. This is used for memory mapped (mmap) tiles.
    * @param  graphid  Tile Id.
    * @param  ptr      Pointer to the start of the tile's data.
+   * @param  traffic_memory  The live traffic of the tile, if any.
    */
-  static graph_tile_ptr Create(const GraphId& graphid, std::vector<char>&& memory);
+  static graph_tile_ptr Create(const GraphId& graphid,
+                               std::vector<char>&& memory,
+                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
 
   /**
    * Constructs given the graph Id, pointer to the tile data, and the
@@ -239,6 +244,24 @@ public:
                              " directededgecount= " + std::to_string(header_->directededgecount()));
   }
 
+  /**
+   * Get the hot edge columns of the tile, which hold copies of the directed edge attributes looked
+   * at while relaxing edges. Only present in tiles built with mjolnir.hot_edges enabled.
+   * @return  Returns the columns, empty if the tile has none.
+   */
+  const HotEdges& hot_edges() const {
+    return hot_edges_;
+  }
+
+  /**
+   * Get the edges superseded by each shortcut of the tile. Only present in tiles built with
+   * mjolnir.shortcut_edges enabled.
+   * @return  Returns the shortcut edges, empty if the tile has none.
+   */
+  const ShortcutEdges& shortcut_edges() const {
+    return shortcut_edges_;
+  }
+
   /**
    * Get a pointer to an edge extension.
    * @param  idx  Index of the directed edge within the current tile.
@@ -872,6 +895,12 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Column oriented copy of the hot directed edge attributes (optional)
+  HotEdges hot_edges_;
+
+  // Edges superseded by each shortcut (optional)
+  ShortcutEdges shortcut_edges_;
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
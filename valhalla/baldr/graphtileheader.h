@@ -18,7 +18,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 9;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -574,6 +574,38 @@ public:
     predictedspeeds_offset_ = offset;
   }
 
+  /**
+   * Gets the offset to the hot edge columns.
+   * @return  Returns the offset (bytes) to the hot edge columns, 0 if the tile has none.
+   */
+  uint32_t hot_edges_offset() const {
+    return hot_edges_offset_;
+  }
+
+  /**
+   * Sets the offset to the hot edge columns within the tile.
+   * @param offset Offset to the hot edge columns, 0 if the tile has none.
+   */
+  void set_hot_edges_offset(const uint32_t offset) {
+    hot_edges_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the shortcut edges, the edges each shortcut of the tile supersedes.
+   * @return  Returns the offset (bytes) to the shortcut edges, 0 if the tile has none.
+   */
+  uint32_t shortcut_edges_offset() const {
+    return shortcut_edges_offset_;
+  }
+
+  /**
+   * Sets the offset to the shortcut edges within the tile.
+   * @param offset Offset to the shortcut edges, 0 if the tile has none.
+   */
+  void set_shortcut_edges_offset(const uint32_t offset) {
+    shortcut_edges_offset_ = offset;
+  }
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -689,6 +721,12 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_ = 0;
 
+  // Offset to the beginning of the (optional) hot edge columns
+  uint32_t hot_edges_offset_ = 0;
+
+  // Offset to the beginning of the (optional) shortcut edges
+  uint32_t shortcut_edges_offset_ = 0;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
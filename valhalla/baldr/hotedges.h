@@ -0,0 +1,207 @@
+#ifndef VALHALLA_BALDR_HOTEDGES_H_
+#define VALHALLA_BALDR_HOTEDGES_H_
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/graphid.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace valhalla {
+namespace baldr {
+
+// Flags kept in the hot edge columns
+constexpr uint8_t kHotEdgeShortcut = 1;
+constexpr uint8_t kHotEdgeLeavesTile = 2;
+constexpr uint8_t kHotEdgeNotThru = 4;
+constexpr uint8_t kHotEdgeDestOnly = 8;
+constexpr uint8_t kHotEdgeDeadend = 16;
+constexpr uint8_t kHotEdgeToll = 32;
+constexpr uint8_t kHotEdgePredictedSpeed = 64;
+
+/**
+ * Size in bytes of the hot edge columns for the given number of directed edges, including the
+ * padding to keep whatever follows 8-byte aligned.
+ * @param  count  Number of directed edges in the tile.
+ * @return Returns the size of the columns.
+ */
+size_t hot_edges_size(uint32_t count);
+
+/**
+ * Copies the attributes path finding looks at on every edge out of the directed edges into
+ * columns, one array per attribute in the order given by HotEdges.
+ * @param  edges  The directed edges of the tile.
+ * @param  count  Number of directed edges.
+ * @return Returns the columns, hot_edges_size(count) bytes.
+ */
+std::string encode_hot_edges(const DirectedEdge* edges, uint32_t count);
+
+/**
+ * Optional column oriented copy of the directed edge attributes which are looked at every time an
+ * edge is relaxed. A directed edge is 48 bytes so reading any of its attributes pulls a whole
+ * cache line per edge, while the columns fit the same attribute of 8 to 64 edges into one. The
+ * columns are an addition to the directed edges and never replace them, tiles without them work
+ * exactly as before.
+ */
+class HotEdges {
+public:
+  /**
+   * Constructor.
+   */
+  HotEdges()
+      : endnode_(nullptr), length_(nullptr), forwardaccess_(nullptr), reverseaccess_(nullptr),
+        speed_(nullptr), classification_(nullptr), use_(nullptr), superseded_(nullptr),
+        shortcut_(nullptr), flags_(nullptr), localedgeidx_(nullptr) {
+  }
+
+  /**
+   * Set the pointers to the columns within the GraphTile.
+   * @param  data   Pointer to the start of the columns.
+   * @param  count  Number of directed edges in the tile.
+   */
+  void set_data(const char* data, uint32_t count);
+
+  /**
+   * Are the columns available in this tile.
+   * @return  Returns true if the tile has the columns.
+   */
+  bool empty() const {
+    return endnode_ == nullptr;
+  }
+
+  /**
+   * Get the end node of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the GraphId of the end node.
+   */
+  GraphId endnode(uint32_t idx) const {
+    return GraphId(endnode_[idx]);
+  }
+
+  /**
+   * Get the length of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the length in meters.
+   */
+  uint32_t length(uint32_t idx) const {
+    return length_[idx];
+  }
+
+  /**
+   * Get the access modes in the forward direction of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the access mask (bit mask of kAutoAccess etc.).
+   */
+  uint32_t forwardaccess(uint32_t idx) const {
+    return forwardaccess_[idx];
+  }
+
+  /**
+   * Get the access modes in the reverse direction of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the access mask (bit mask of kAutoAccess etc.).
+   */
+  uint32_t reverseaccess(uint32_t idx) const {
+    return reverseaccess_[idx];
+  }
+
+  /**
+   * Get the speed of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the speed in KPH.
+   */
+  uint32_t speed(uint32_t idx) const {
+    return speed_[idx];
+  }
+
+  /**
+   * Get the road class of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the road class.
+   */
+  RoadClass classification(uint32_t idx) const {
+    return static_cast<RoadClass>(classification_[idx]);
+  }
+
+  /**
+   * Get the use of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the use.
+   */
+  Use use(uint32_t idx) const {
+    return static_cast<Use>(use_[idx]);
+  }
+
+  /**
+   * Get the mask of the shortcut superseding a directed edge, see DirectedEdge::superseded.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the mask, 0 if the edge is not superseded.
+   */
+  uint32_t superseded(uint32_t idx) const {
+    return superseded_[idx];
+  }
+
+  /**
+   * Get the shortcut mask of a directed edge, see DirectedEdge::shortcut.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the mask, 0 if the edge is not a shortcut.
+   */
+  uint32_t shortcut(uint32_t idx) const {
+    return shortcut_[idx];
+  }
+
+  /**
+   * Get the flags of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns a bit mask of kHotEdgeShortcut etc.
+   */
+  uint8_t flags(uint32_t idx) const {
+    return flags_[idx];
+  }
+
+  /**
+   * Get the index of a directed edge within the edges of its start node, path finding compares it
+   * to the predecessor's opposing index to find the u-turn before looking at any edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return  Returns the local edge index.
+   */
+  uint32_t localedgeidx(uint32_t idx) const {
+    return localedgeidx_[idx];
+  }
+
+  bool is_shortcut(uint32_t idx) const {
+    return flags_[idx] & kHotEdgeShortcut;
+  }
+
+  bool leaves_tile(uint32_t idx) const {
+    return flags_[idx] & kHotEdgeLeavesTile;
+  }
+
+  bool not_thru(uint32_t idx) const {
+    return flags_[idx] & kHotEdgeNotThru;
+  }
+
+  bool destonly(uint32_t idx) const {
+    return flags_[idx] & kHotEdgeDestOnly;
+  }
+
+protected:
+  const uint64_t* endnode_;
+  const uint32_t* length_;
+  const uint16_t* forwardaccess_;
+  const uint16_t* reverseaccess_;
+  const uint8_t* speed_;
+  const uint8_t* classification_;
+  const uint8_t* use_;
+  const uint8_t* superseded_;
+  const uint8_t* shortcut_;
+  const uint8_t* flags_;
+  const uint8_t* localedgeidx_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_HOTEDGES_H_
@@ -0,0 +1,94 @@
+#ifndef VALHALLA_BALDR_LANDMARKDISTANCES_H_
+#define VALHALLA_BALDR_LANDMARKDISTANCES_H_
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Shortest path distances between a few landmark nodes and every node of the graph, written next
+ * to the tiles by the landmark distances stage of valhalla_build_tiles when
+ * mjolnir.landmark_distances is set. They are for the ALT (A*, landmarks and triangle
+ * inequality) lower bounds: d(v, t) >= d(L, t) - d(L, v) and d(v, t) >= d(v, L) - d(t, L).
+ *
+ * Distances are in meters along any edge some mode may take in its direction, so they bound the
+ * length of the paths of every costing which doesn't ignore oneways. The nodes of every level of
+ * the hierarchy are in the tables, joined by their transitions.
+ */
+class LandmarkDistances {
+public:
+  static constexpr uint32_t kUnreached = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kMaxLandmarks = 64;
+
+  /**
+   * Memory maps the distances written by write(). A file which can't be mapped or doesn't hold
+   * landmark distances is logged and leaves the distances empty.
+   * @param file_name  the file to map
+   */
+  explicit LandmarkDistances(const std::string& file_name);
+
+  /**
+   * Writes landmark distances, next to the file and then moved into place so that services
+   * mapping the previous ones keep working.
+   * @param file_name     the file to write
+   * @param tiles         the tiles whose nodes are in the tables, sorted
+   * @param node_offsets  where the nodes of each tile start, one more than there are tiles
+   * @param landmarks     the landmark nodes
+   * @param distances     per node, per landmark the distance from the landmark to the node and the
+   *                      distance from the node to the landmark
+   */
+  static void write(const std::string& file_name,
+                    const std::vector<GraphId>& tiles,
+                    const std::vector<uint32_t>& node_offsets,
+                    const std::vector<GraphId>& landmarks,
+                    const std::vector<uint32_t>& distances);
+
+  /**
+   * Were landmark distances mapped.
+   * @return true if there are no landmarks
+   */
+  bool empty() const {
+    return landmark_count_ == 0;
+  }
+
+  uint32_t landmark_count() const {
+    return landmark_count_;
+  }
+
+  uint32_t node_count() const {
+    return node_offsets_ == nullptr ? 0 : node_offsets_[tile_count_];
+  }
+
+  GraphId landmark(const uint32_t index) const {
+    return landmarks_[index];
+  }
+
+  /**
+   * The distances of a node, two per landmark: from the landmark to the node and from the node to
+   * the landmark, kUnreached where there is no path.
+   * @param node  the node
+   * @return the distances, nullptr if the node isn't in the tables
+   */
+  const uint32_t* distances(const GraphId& node) const;
+
+private:
+  uint32_t landmark_count_;
+  uint32_t tile_count_;
+  const GraphId* landmarks_;
+  const GraphId* tiles_;
+  const uint32_t* node_offsets_;
+  const uint32_t* distances_;
+  midgard::mem_map<char> file_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_LANDMARKDISTANCES_H_
@@ -0,0 +1,161 @@
+#ifndef VALHALLA_BALDR_PARTITIONOVERLAY_H_
+#define VALHALLA_BALDR_PARTITIONOVERLAY_H_
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Multi-level partition of the directed edges of the graph, written next to the tiles by the
+ * partition stage of valhalla_build_tiles when mjolnir.partition_overlay is set.
+ *
+ * Like in the contraction hierarchy the vertices are the directed edges, a vertex is the index of
+ * its edge in the sorted list of edges in the file, and the turns from one edge onto the next are
+ * the arcs. Every level puts each vertex into a cell, the cells of a level are made of whole
+ * cells of the level below. A turn from a vertex in one cell onto a vertex in another makes the
+ * first an exit of its cell and the second an entry of its cell. Level 0 has the smallest cells.
+ *
+ * The partition only depends on the graph, which turns a costing allows and what they cost is
+ * up to the metric customized for it (see thor::OverlayMetric).
+ */
+class PartitionOverlay {
+public:
+  static constexpr uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kMaxLevels = 8;
+
+  // the cells of one level and their boundary vertices, grouped by cell and sorted in each
+  struct level_t {
+    std::vector<uint32_t> cells;
+    std::vector<uint32_t> entry_offsets;
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> exit_offsets;
+    std::vector<uint32_t> exits;
+  };
+
+  /**
+   * Memory maps an overlay written by write(). A file which can't be mapped or isn't an overlay is
+   * logged and leaves the overlay empty.
+   * @param file_name  the file to map
+   */
+  explicit PartitionOverlay(const std::string& file_name);
+
+  /**
+   * Writes an overlay, next to the file and then moved into place so that services mapping the
+   * previous one keep working.
+   * @param file_name  the file to write
+   * @param edges      the edge of every vertex, sorted
+   * @param levels     the levels, the cell of every vertex and the boundary of every cell
+   */
+  static void write(const std::string& file_name,
+                    const std::vector<GraphId>& edges,
+                    const std::vector<level_t>& levels);
+
+  /**
+   * Was an overlay mapped.
+   * @return true if there are no vertices
+   */
+  bool empty() const {
+    return vertex_count_ == 0;
+  }
+
+  uint32_t vertex_count() const {
+    return vertex_count_;
+  }
+
+  uint32_t level_count() const {
+    return level_count_;
+  }
+
+  uint32_t cell_count(const uint32_t level) const {
+    return levels_[level].cell_count;
+  }
+
+  /**
+   * The vertex of a directed edge.
+   * @param edge_id  the directed edge
+   * @return the vertex, kNoVertex if the edge isn't in the overlay
+   */
+  uint32_t vertex(const GraphId& edge_id) const;
+
+  /**
+   * The directed edge of a vertex.
+   * @param vertex  the vertex
+   * @return the directed edge
+   */
+  GraphId edge(const uint32_t vertex) const {
+    return edges_[vertex];
+  }
+
+  uint32_t cell(const uint32_t level, const uint32_t vertex) const {
+    return levels_[level].cells[vertex];
+  }
+
+  const uint32_t* entries_begin(const uint32_t level, const uint32_t cell) const {
+    return levels_[level].entries + levels_[level].entry_offsets[cell];
+  }
+  const uint32_t* entries_end(const uint32_t level, const uint32_t cell) const {
+    return levels_[level].entries + levels_[level].entry_offsets[cell + 1];
+  }
+  const uint32_t* exits_begin(const uint32_t level, const uint32_t cell) const {
+    return levels_[level].exits + levels_[level].exit_offsets[cell];
+  }
+  const uint32_t* exits_end(const uint32_t level, const uint32_t cell) const {
+    return levels_[level].exits + levels_[level].exit_offsets[cell + 1];
+  }
+
+  /**
+   * Where a vertex is among the entries of its cell.
+   * @param level   the level
+   * @param vertex  the vertex
+   * @return the index of the vertex in the entries of its cell, kNoVertex if it isn't an entry
+   */
+  uint32_t entry_index(const uint32_t level, const uint32_t vertex) const {
+    const uint32_t c = cell(level, vertex);
+    return find(entries_begin(level, c), entries_end(level, c), vertex);
+  }
+
+  /**
+   * Where a vertex is among the exits of its cell.
+   * @param level   the level
+   * @param vertex  the vertex
+   * @return the index of the vertex in the exits of its cell, kNoVertex if it isn't an exit
+   */
+  uint32_t exit_index(const uint32_t level, const uint32_t vertex) const {
+    const uint32_t c = cell(level, vertex);
+    return find(exits_begin(level, c), exits_end(level, c), vertex);
+  }
+
+private:
+  static uint32_t find(const uint32_t* begin, const uint32_t* end, const uint32_t vertex) {
+    const uint32_t* found = std::lower_bound(begin, end, vertex);
+    return found == end || *found != vertex ? kNoVertex : static_cast<uint32_t>(found - begin);
+  }
+
+  struct mapped_level_t {
+    uint32_t cell_count;
+    const uint32_t* cells;
+    const uint32_t* entry_offsets;
+    const uint32_t* entries;
+    const uint32_t* exit_offsets;
+    const uint32_t* exits;
+  };
+
+  uint32_t vertex_count_;
+  uint32_t level_count_;
+  const GraphId* edges_;
+  mapped_level_t levels_[kMaxLevels];
+  midgard::mem_map<char> file_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_PARTITIONOVERLAY_H_
@@ -4,6 +4,8 @@
 #include <valhalla/midgard/util.h>
 
 #include <array>
+#include <atomic>
+#include <memory>
 
 namespace valhalla {
 namespace baldr {
@@ -34,6 +36,33 @@ std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speed
  */
 float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx);
 
+/**
+ * Recover the speed in the same bucket of a run of consecutive speed profiles, e.g. all the
+ * profiles of a tile.
+ * @param profiles    Transformed speed buckets of the profiles (count x 200 values).
+ * @param count       Number of profiles.
+ * @param bucket_idx  Index of the bucket we want to recover.
+ * @param speeds      Receives the speed value (in KPH) of every profile (count values).
+ */
+void decompress_speed_buckets(const int16_t* profiles,
+                              uint32_t count,
+                              uint32_t bucket_idx,
+                              float* speeds);
+
+/**
+ * Enable or disable caching decoded speeds in the tiles, see DecodedSpeedCache. Enabled by
+ * default. Tiles are shared between the readers of a process, so this is decided once for the
+ * whole process: the first call wins and later calls asking for the opposite are ignored.
+ * @param enabled  Whether to cache.
+ * @return  Returns false if the process had already decided otherwise.
+ */
+bool set_decoded_speed_cache(bool enabled);
+
+/**
+ * @return  Returns whether tiles cache their decoded speeds.
+ */
+bool decoded_speed_cache();
+
 /**
  * Pack transformed speed values into base64-encoded string.
  * @param coefficients  Array of transformed speed buckets (must be 200 values).
@@ -48,6 +77,76 @@ std::string encode_compressed_speeds(const int16_t* coefficients);
  */
 std::array<int16_t, kCoefficientCount> decode_compressed_speeds(const std::string& encoded);
 
+// Number of buckets a tile keeps decoded, consecutive buckets never share a slot
+constexpr uint32_t kDecodedSpeedSlots = 4;
+
+/**
+ * Speeds of all the profiles of a tile decoded for a few buckets of the week. Decoding the speed
+ * of a single edge is a 200 term sum so requests which look at many edges around the same time of
+ * the week are better off decoding the whole tile for that bucket once. A bucket is decoded once
+ * it was asked for often enough, the tables are shared by every thread using the tile.
+ *
+ * Every slot is guarded by a sequence lock: readers never wait, a reader which overlaps a writer
+ * replacing the slot simply counts as a miss and decodes the speed itself.
+ */
+class DecodedSpeedCache {
+public:
+  /**
+   * Constructor.
+   * @param  profiles  Pointer to the compressed speed profiles of the tile.
+   * @param  count     Number of profiles.
+   */
+  DecodedSpeedCache(const int16_t* profiles, uint32_t count);
+
+  /**
+   * Get the decoded speed of a profile if its bucket is cached.
+   * @param  profile  Index of the profile.
+   * @param  bucket   Bucket of the week.
+   * @param  speed    Receives the speed in KPH.
+   * @return Returns true if the bucket was cached.
+   */
+  bool get(const uint32_t profile, const uint32_t bucket, float& speed) const {
+    const slot_t& slot = slots_[bucket % kDecodedSpeedSlots];
+    const uint32_t version = slot.version.load(std::memory_order_acquire);
+    if ((version & 1) || slot.bucket.load(std::memory_order_acquire) != bucket) {
+      return false;
+    }
+    speed = slot.speeds[profile].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.version.load(std::memory_order_relaxed) == version;
+  }
+
+  /**
+   * Note that a bucket was not cached, decodes it for the whole tile once it was missed often
+   * enough.
+   * @param  bucket  Bucket of the week.
+   */
+  void miss(const uint32_t bucket);
+
+  /**
+   * @return  Returns the number of buckets decoded since construction.
+   */
+  uint32_t decoded() const {
+    return decoded_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  struct slot_t {
+    std::atomic<uint32_t> version{0}; // odd while the slot is being written
+    std::atomic<uint32_t> bucket{kBucketsPerWeek};
+    std::atomic<uint32_t> candidate{kBucketsPerWeek};
+    std::atomic<uint32_t> misses{0};
+    std::unique_ptr<std::atomic<float>[]> speeds;
+  };
+
+  const int16_t* profiles_;
+  uint32_t count_;
+  uint32_t threshold_;
+  std::atomic_flag writing_ = ATOMIC_FLAG_INIT;
+  std::atomic<uint32_t> decoded_{0};
+  std::array<slot_t, kDecodedSpeedSlots> slots_;
+};
+
 /**
  * Class to access predicted speed information within a tile.
  */
@@ -76,6 +175,22 @@ public:
     profiles_ = profiles;
   }
 
+  /**
+   * Cache decoded speeds for the profiles, see DecodedSpeedCache. Call after set_profiles.
+   * @param  count  Number of profiles in the tile.
+   */
+  void set_cache(uint32_t count) {
+    cache_ = count ? std::make_unique<DecodedSpeedCache>(profiles_, count) : nullptr;
+  }
+
+  /**
+   * Get the decoded speed cache of the tile.
+   * @return Returns the cache, nullptr if the tile doesn't cache decoded speeds.
+   */
+  const DecodedSpeedCache* cache() const {
+    return cache_.get();
+  }
+
   /**
    * Get the speed given the edge Id and the seconds of the week.
    * @param  idx  Directed edge index.
@@ -86,15 +201,24 @@ public:
     // (otherwise an exception would be thrown when getting the directed edge) and the profile
     // offset is valid. If there is no predicted speed profile this method will not be called due
     // to DirectedEdge::has_predicted_speed being false.
-    const int16_t* coefficients = profiles_ + offset_[idx];
-
-    return decompress_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
+    const uint32_t offset = offset_[idx];
+    const uint32_t bucket = seconds_of_week / kSpeedBucketSizeSeconds;
+    if (cache_) {
+      float speed;
+      if (cache_->get(offset / kCoefficientCount, bucket, speed)) {
+        return speed;
+      }
+      cache_->miss(bucket);
+    }
+
+    return decompress_speed_bucket(profiles_ + offset, bucket);
   }
 
 protected:
   const uint32_t* offset_;  // Offset into the array of compressed speed profiles
                             // for each directed edge
   const int16_t* profiles_; // Compressed speed profiles
+  std::unique_ptr<DecodedSpeedCache> cache_; // Decoded speeds, if enabled
 };
 
 } // namespace baldr
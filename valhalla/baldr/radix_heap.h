@@ -0,0 +1,239 @@
+#pragma once
+
+#include <valhalla/baldr/graphconstants.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix heap - a priority queue for monotone keys, see Ahuja et al., "Faster Algorithms for the
+ * Shortest Path Problem". Keys are the bits of the non-negative float sort costs, which order the
+ * same way as the costs do. Bucket i holds the labels whose key first differs from the key last
+ * popped in bit i - 1, so a label moves down the buckets at most 32 times, each time the bucket it
+ * is in has the smallest keys. Unlike the double bucket queue it has no range to tune and no
+ * overflow bucket, and it pops labels in exact cost order.
+ *
+ * The keys must not be smaller than the one last popped, which the path algorithms hold to as
+ * long as their heuristics are consistent. Like the double bucket queue a label costing less than
+ * that is taken to cost as much, so it is popped next.
+ *
+ * It has the interface of DoubleBucketQueue so that the adjacency lists can use either.
+ */
+template <typename label_t> class RadixHeap final {
+public:
+  /**
+   * Default c-tor creates empty object that needs to be initialized with `reuse` method
+   */
+  RadixHeap() {
+    reuse(0.f, 1.f, 1, nullptr);
+  }
+
+  /**
+   * Constructor given the same arguments as the double bucket queue.
+   * @param mincost    Minimum cost, unused as the first key can be anything.
+   * @param range      Cost range, unused as there is no overflow.
+   * @param bucketsize Bucket size, unused as the keys are the exact costs.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  RadixHeap(const float mincost,
+            const float range,
+            const uint32_t bucketsize,
+            const std::vector<label_t>* labelcontainer) {
+    reuse(mincost, range, bucketsize, labelcontainer);
+  }
+
+  RadixHeap(RadixHeap&&) = default;
+  RadixHeap& operator=(RadixHeap&&) = default;
+  RadixHeap(const RadixHeap&) = delete;
+  RadixHeap& operator=(const RadixHeap&) = delete;
+
+  /**
+   * The same as c-tor, but without buffers reallocation. Before call this
+   * method you should clean up the current state (call `clear`).
+   * @param mincost    Minimum cost, unused.
+   * @param range      Cost range, unused.
+   * @param bucketsize Bucket size, unused.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float /*mincost*/,
+             const float /*range*/,
+             const uint32_t /*bucketsize*/,
+             const std::vector<label_t>* labelcontainer) {
+    labelcontainer_ = labelcontainer;
+    last_ = 0;
+  }
+
+  /**
+   * Clear all labels from the buckets, keeping their memory.
+   */
+  void clear() {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    size_ = 0;
+    last_ = 0;
+  }
+
+  /**
+   * Adds a label index to the bucket of its sort cost.
+   * @param   label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    if (label >= positions_.size()) {
+      positions_.resize(std::max<size_t>(label + 1, labelcontainer_->size()));
+    }
+    put({key((*labelcontainer_)[label].sortcost()), label});
+    ++size_;
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Moves it to the bucket of the new cost,
+   * must be called before the cost of the label is changed.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    const uint32_t k = key(newcost);
+    const auto prev = index(key((*labelcontainer_)[label].sortcost()));
+    auto& prevbucket = buckets_[prev];
+    const uint32_t position = positions_[label];
+    if (position >= prevbucket.size() || prevbucket[position].label != label) {
+      return;
+    }
+    if (prev == index(k)) {
+      prevbucket[position].key = k;
+    } else {
+      prevbucket[position] = prevbucket.back();
+      positions_[prevbucket[position].label] = position;
+      prevbucket.pop_back();
+      put({k, label});
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the heap.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the heap is empty.
+   */
+  uint32_t pop() {
+    if (size_ == 0) {
+      return baldr::kInvalidLabel;
+    }
+
+    // the lowest costs are in the first bucket with any, moving them down makes the smallest of
+    // them the new last key and puts all labels with that key in bucket 0
+    if (buckets_[0].empty()) {
+      size_t i = 1;
+      while (buckets_[i].empty()) {
+        ++i;
+      }
+      auto& bucket = buckets_[i];
+      last_ = std::numeric_limits<uint32_t>::max();
+      for (const auto& entry : bucket) {
+        last_ = std::min(last_, entry.key);
+      }
+      for (const auto& entry : bucket) {
+        put(entry);
+      }
+      bucket.clear();
+    }
+
+    const uint32_t label = buckets_[0].back().label;
+    buckets_[0].pop_back();
+    --size_;
+    return label;
+  }
+
+  /**
+   * The number of label indices the buckets and the bucket positions have room for without
+   * allocating.
+   * @return  Returns the capacity of the buckets and positions.
+   */
+  size_t reserved() const {
+    size_t reserved = positions_.capacity();
+    for (const auto& bucket : buckets_) {
+      reserved += bucket.capacity();
+    }
+    return reserved;
+  }
+
+private:
+  // a label index and the key it is in its bucket by
+  struct entry_t {
+    uint32_t key;
+    uint32_t label;
+  };
+
+  // Bucket 0 for the last key popped and one for each bit of the keys
+  std::array<std::vector<entry_t>, 33> buckets_;
+
+  // The key last popped, none of the labels in the buckets has a smaller one
+  uint32_t last_;
+
+  // Number of labels in the buckets
+  size_t size_ = 0;
+
+  // The position of each label in its bucket, so that decreasing its cost needn't look for it
+  std::vector<uint32_t> positions_;
+
+  // Access to a container of labels to get cost given the label index.
+  const std::vector<label_t>* labelcontainer_;
+
+  /**
+   * The key of a cost, not smaller than the one last popped. The bits of non-negative floats
+   * compare like the floats do.
+   * @param   cost  Cost.
+   * @return  Returns the key.
+   */
+  uint32_t key(const float cost) const {
+    // not std::max, which gives back -0.f whose sign bit would make it the largest key
+    const float c = cost > 0.f ? cost : 0.f;
+    uint32_t k;
+    std::memcpy(&k, &c, sizeof(k));
+    return std::max(k, last_);
+  }
+
+  /**
+   * Adds an entry to the bucket of its key.
+   * @param   entry  Label index and key.
+   */
+  void put(const entry_t& entry) {
+    auto& bucket = buckets_[index(entry.key)];
+    positions_[entry.label] = static_cast<uint32_t>(bucket.size());
+    bucket.push_back(entry);
+  }
+
+  /**
+   * The bucket of a key, by the highest bit it differs from the last key popped in.
+   * @param   k  Key.
+   * @return  Returns the index of the bucket.
+   */
+  size_t index(const uint32_t k) const {
+    const uint32_t diff = k ^ last_;
+    if (diff == 0) {
+      return 0;
+    }
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanReverse(&bit, diff);
+    return bit + 1;
+#else
+    return 32 - __builtin_clz(diff);
+#endif
+  }
+};
+
+} // namespace baldr
+} // namespace valhalla
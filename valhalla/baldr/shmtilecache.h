@@ -0,0 +1,156 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphmemory.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/graphtileptr.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Tile cache in a POSIX shared memory segment which all processes on a host attach to by name,
+ * so that several service processes keep a single copy of every tile instead of one each.
+ *
+ * The segment holds a hash table of the cached tiles and an arena with their bytes. Changes to it
+ * take a robust process shared mutex, lookups don't: every entry carries a version which writers
+ * keep odd while they change it, readers pin an entry without the lock and only keep the pin if
+ * its version didn't move. Tiles handed out point straight into the segment and pin their entry
+ * until the last reference is gone, only unpinned entries are evicted (by a clock sweep which
+ * spares recently used ones) and only as many as it takes to fit a new tile.
+ *
+ * Every attached process holds the robust mutex of an owner record on a thread of its own and
+ * leases its pins under the token of that record. Whoever can lock the mutex of a record knows its
+ * process is gone, whatever pid namespace it lived in, and reclaims its pins and the tiles it was
+ * copying in. That happens whenever a process attaches or everything else is pinned. If a process
+ * crashes while holding the lock the segment is given up and a fresh one is created, processes
+ * still using tiles of the old one keep it mapped.
+ *
+ * Every instance keeps a few of the tiles it used last so that the hot path doesn't even have to
+ * probe the table. Instances are not thread-safe, just like the other per reader caches, but any
+ * number of them in any number of processes can share the same segment.
+ */
+class ShmTileCache : public TileCache {
+public:
+  // Loads the live traffic of a tile, the traffic isn't shared through the segment
+  using traffic_loader_t = std::function<std::unique_ptr<const GraphMemory>(const GraphId&)>;
+
+  struct stats_t {
+    // tiles in the segment
+    uint64_t tiles;
+    // bytes used by the tiles
+    uint64_t used;
+    // bytes available for tiles
+    uint64_t capacity;
+    // tiles evicted to make room for others or cleared
+    uint64_t evictions;
+  };
+
+  /**
+   * Constructor. Attaches to the segment or creates it if this is the first process to use it.
+   * @param name         name of the shared memory segment, e.g. "/valhalla_tiles"
+   * @param max_size     bytes available for tiles when the segment is created
+   * @param local_tiles  how many of its recently used tiles this instance keeps at hand
+   */
+  ShmTileCache(const std::string& name, size_t max_size, size_t local_tiles = 16);
+
+  ~ShmTileCache() override;
+
+  /**
+   * The segment is sized on creation, nothing to reserve.
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Copies a tile into the shared segment, evicting unused tiles if needed. If there is no room
+   * the tile is simply not shared.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * The segment never grows beyond its size.
+   * @return false
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears all tiles which are not in use by any process from the segment.
+   */
+  void Clear() override;
+
+  /**
+   * Drops the tiles this instance keeps at hand.
+   */
+  void Trim() override;
+
+  /**
+   * @return the tiles evicted from the segment by any process
+   */
+  uint64_t Evictions() const override;
+
+  /**
+   * Sets how to load the live traffic for the tiles handed out by the cache.
+   * @param loader  the traffic loader
+   */
+  void SetTrafficLoader(traffic_loader_t loader);
+
+  /**
+   * @return the current state of the segment
+   */
+  stats_t Stats() const;
+
+  /**
+   * Removes the segment name from the system, processes attached to it keep using it.
+   * @param name  name of the shared memory segment
+   */
+  static void Remove(const std::string& name);
+
+  struct segment_t;
+
+protected:
+  /**
+   * @return the segment, reattached if it was given up since the last call
+   */
+  const std::shared_ptr<segment_t>& Segment() const;
+
+  /**
+   * Remembers a tile as recently used by this instance.
+   */
+  void Remember(const GraphId& graphid, const graph_tile_ptr& tile) const;
+
+  std::string name_;
+  size_t max_size_;
+  size_t local_tiles_;
+  traffic_loader_t traffic_loader_;
+
+  mutable std::shared_ptr<segment_t> segment_;
+  mutable std::unordered_map<GraphId, graph_tile_ptr> local_;
+  mutable std::deque<GraphId> local_order_;
+};
+
+} // namespace baldr
+} // namespace valhalla
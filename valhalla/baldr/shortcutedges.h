@@ -0,0 +1,95 @@
+#ifndef VALHALLA_BALDR_SHORTCUTEDGES_H_
+#define VALHALLA_BALDR_SHORTCUTEDGES_H_
+
+#include <valhalla/baldr/graphid.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Serializes the edges superseded by the shortcuts of a tile. A shortcut which could not be
+ * recovered is kept with no edges so that nobody tries to recover it again.
+ * @param  shortcuts  Index of each shortcut within the tile and the edges it supersedes, in order.
+ *                    Sorted by shortcut index.
+ * @return Returns the serialized shortcut edges, a multiple of 8 bytes.
+ */
+std::string
+encode_shortcut_edges(const std::vector<std::pair<uint32_t, std::vector<GraphId>>>& shortcuts);
+
+/**
+ * Optional list of the edges every shortcut of a tile supersedes, computed when the tiles are
+ * built. Recovering a shortcut otherwise means walking the graph from its begin node, which is
+ * what GraphReader does for every shortcut of the tileset on startup when shortcut_caching is on.
+ * With the list in the tile a shortcut is looked up in place, straight from the mapped tile.
+ *
+ * The list is a count of shortcuts, the shortcut indices sorted with the position of their first
+ * edge (and one more entry marking the end of the last one) and then the edges themselves.
+ */
+class ShortcutEdges {
+public:
+  /**
+   * Constructor.
+   */
+  ShortcutEdges() : count_(0), shortcuts_(nullptr), edges_(nullptr) {
+  }
+
+  /**
+   * Set the pointers to the shortcut edges within the GraphTile.
+   * @param  data  Pointer to the start of the shortcut edges.
+   */
+  void set_data(const char* data);
+
+  /**
+   * Number of bytes the shortcut edges take up starting at the given data.
+   * @param  data  Pointer to the start of the shortcut edges.
+   * @param  available  Number of bytes available at data.
+   * @return Returns the size, 0 if the available bytes can't hold the shortcut edges.
+   */
+  static size_t size(const char* data, size_t available);
+
+  /**
+   * Are the shortcut edges available in this tile.
+   * @return  Returns true if the tile has them.
+   */
+  bool empty() const {
+    return shortcuts_ == nullptr;
+  }
+
+  /**
+   * Get the number of shortcuts in the list.
+   * @return  Returns the number of shortcuts.
+   */
+  uint32_t count() const {
+    return count_;
+  }
+
+  /**
+   * Get the edges a shortcut supersedes.
+   * @param  idx    Index of the shortcut within the tile.
+   * @param  edges  Receives the edges in the order they are traversed, empty if the shortcut
+   *                could not be recovered when the tile was built.
+   * @return  Returns false if the shortcut is not in the list.
+   */
+  bool get(uint32_t idx, std::vector<GraphId>& edges) const;
+
+protected:
+  struct shortcut_t {
+    uint32_t index;
+    uint32_t first_edge;
+  };
+
+  uint32_t count_;
+  const shortcut_t* shortcuts_;
+  const GraphId* edges_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHORTCUTEDGES_H_
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/tilegetter.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Fetches tiles from the tile url, keeping a copy of each tile in a local directory so that it
+ * is only ever downloaded once. Copies on disk are checked before they are used, a truncated or
+ * otherwise broken copy is removed and the tile is downloaded again. New copies are written to a
+ * temporary file first and then moved into place so that no reader sees a partial tile.
+ *
+ * Fetches of the same tile are deduplicated across all fetchers in the process: if any thread is
+ * already downloading a tile the others wait for it instead of sending another request. Batches
+ * of tiles are fetched concurrently on as many threads as the tile getter has connections, if the
+ * tile getter is thread-safe.
+ */
+class url_tile_fetcher_t {
+public:
+  struct stats_t {
+    // tiles downloaded from the tile url
+    uint64_t downloads;
+    // tiles found in the local directory
+    uint64_t disk_hits;
+    // fetches which waited for a download of the same tile by another thread
+    uint64_t joined;
+    // copies in the local directory which were broken and removed
+    uint64_t invalid;
+    // tiles which could not be fetched
+    uint64_t failures;
+  };
+
+  /**
+   * Constructor.
+   * @param tile_getter  the tile getter to download with, must outlive the fetcher
+   * @param tile_url     the tile url with the {tilePath} pattern
+   * @param cache_dir    where to keep the downloaded tiles, nothing is kept if empty
+   * @param concurrency  how many tiles of a batch to fetch at once
+   */
+  url_tile_fetcher_t(tile_getter_t* tile_getter,
+                     const std::string& tile_url,
+                     const std::string& cache_dir,
+                     size_t concurrency);
+
+  /**
+   * Gets a tile from the local directory or downloads it.
+   * @param base       the tile base of the tile
+   * @param not_found  if given, set to whether the tile getter said the tile doesn't exist, as
+   *                   opposed to failing to get it for some other reason
+   * @return the uncompressed tile data, empty if the tile could not be fetched
+   */
+  std::vector<char> Fetch(const GraphId& base, bool* not_found = nullptr);
+
+  /**
+   * Gets a batch of tiles, fetching up to the configured number of them at once if the tile getter
+   * is thread-safe and one after the other otherwise.
+   * @param bases      the tile bases of the tiles
+   * @param not_found  if given, receives the tile bases of the tiles the tile getter said don't
+   *                   exist
+   * @return the uncompressed data of each tile in the same order, empty for those which could
+   *         not be fetched
+   */
+  std::vector<std::vector<char>> FetchAll(const std::vector<GraphId>& bases,
+                                          std::vector<GraphId>* not_found = nullptr);
+
+  /**
+   * @return the counters since construction
+   */
+  stats_t Stats() const;
+
+protected:
+  /**
+   * Reads and checks the copy of a tile in the local directory, removing it if it is broken.
+   * @param base  the tile base of the tile
+   * @param data  receives the uncompressed tile data
+   * @return true if there was a valid copy
+   */
+  bool LoadFromDisk(const GraphId& base, std::vector<char>& data);
+
+  /**
+   * Downloads a tile and keeps a copy of it in the local directory.
+   * @param base  the tile base of the tile
+   * @param data  receives the uncompressed tile data
+   * @return SUCCESS if the tile was downloaded, NOT_FOUND if the tile getter said it doesn't exist
+   */
+  tile_getter_t::status_code_t Download(const GraphId& base, std::vector<char>& data);
+
+  tile_getter_t* tile_getter_;
+  std::string tile_url_;
+  std::string cache_dir_;
+  size_t concurrency_;
+
+  std::atomic<uint64_t> downloads_;
+  std::atomic<uint64_t> disk_hits_;
+  std::atomic<uint64_t> joined_;
+  std::atomic<uint64_t> invalid_;
+  std::atomic<uint64_t> failures_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -12,11 +12,12 @@ namespace baldr {
  */
 class tile_getter_t {
 public:
-  // TODO: Consider other error codes.
   /**
-   * Operation status code.
+   * Operation status code. NOT_FOUND means the server answered that it doesn't have the tile,
+   * FAILURE is anything else that went wrong (timeouts, server errors, connection errors) and
+   * might not happen again on the next request.
    */
-  enum class status_code_t { SUCCESS, FAILURE };
+  enum class status_code_t { SUCCESS, FAILURE, NOT_FOUND };
 
   /**
    * Raw bytes we get as a response.
@@ -36,6 +37,14 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Whether get may be called from several threads at once. Batches of tiles are only fetched
+   * concurrently with getters which are, all others get one tile at a time.
+   */
+  virtual bool thread_safe() const {
+    return false;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Counters about how a GraphReader gets at its tiles. They are only ever written by the thread
+ * using the reader, so plain relaxed stores do instead of read-modify-write atomics and keep the
+ * overhead on the hot path at a couple of instructions, while any thread can take a snapshot.
+ */
+class tile_metrics_t {
+public:
+  // bucket i of the load latency histogram counts loads that took less than 2^i microseconds, the
+  // last bucket counts all the slower ones
+  static constexpr size_t kLatencyBuckets = 24;
+  // tile accesses are counted per hierarchy level, including transit
+  static constexpr size_t kLevels = 4;
+
+  struct snapshot_t {
+    // tiles found in the cache
+    uint64_t hits;
+    // tiles that were not in the cache
+    uint64_t misses;
+    // tiles dropped from the cache, to make room or by clearing it, filled in by the reader
+    uint64_t evictions;
+    // tiles loaded from an extract, the tile directory or a url
+    uint64_t tiles_loaded;
+    // bytes of those tiles
+    uint64_t bytes_loaded;
+    // how long loading the tiles took
+    std::array<uint64_t, kLatencyBuckets> load_latency;
+    // tile accesses per hierarchy level
+    std::array<uint64_t, kLevels> level_touches;
+  };
+
+  tile_metrics_t() {
+    for (auto& bucket : load_latency_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    for (auto& level : level_touches_) {
+      level.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Records an access to a tile of the given level and whether the cache had it.
+   */
+  void access(uint32_t level, bool hit) {
+    add(level_touches_[level < kLevels ? level : kLevels - 1], 1);
+    add(hit ? hits_ : misses_, 1);
+  }
+
+  /**
+   * Records a tile that had to be loaded.
+   * @param bytes    size of the tile
+   * @param elapsed  how long it took
+   */
+  void loaded(size_t bytes, std::chrono::steady_clock::duration elapsed) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    size_t bucket = 0;
+    while (bucket < kLatencyBuckets - 1 && (int64_t(1) << bucket) <= us) {
+      ++bucket;
+    }
+    add(load_latency_[bucket], 1);
+    add(tiles_loaded_, 1);
+    add(bytes_loaded_, bytes);
+  }
+
+  /**
+   * @return the current value of all the counters
+   */
+  snapshot_t snapshot() const {
+    snapshot_t snapshot{hits_.load(std::memory_order_relaxed),
+                        misses_.load(std::memory_order_relaxed),
+                        0,
+                        tiles_loaded_.load(std::memory_order_relaxed),
+                        bytes_loaded_.load(std::memory_order_relaxed),
+                        {},
+                        {}};
+    for (size_t i = 0; i < kLatencyBuckets; ++i) {
+      snapshot.load_latency[i] = load_latency_[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kLevels; ++i) {
+      snapshot.level_touches[i] = level_touches_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+protected:
+  static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> tiles_loaded_{0};
+  std::atomic<uint64_t> bytes_loaded_{0};
+  std::array<std::atomic<uint64_t>, kLatencyBuckets> load_latency_;
+  std::array<std::atomic<uint64_t>, kLevels> level_touches_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtileptr.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Loads tiles on a small pool of background threads ahead of the time they are needed.
+ * The searches hint at tiles their frontier is about to enter, the tiles are loaded and
+ * decompressed in the background and parked until the reader asks for them. A parked tile is
+ * handed over to exactly one reader so the tile ref count never crosses threads concurrently.
+ */
+class tile_prefetcher_t {
+public:
+  // Loads a tile given its tile base, returns nullptr if the tile could not be loaded
+  using loader_t = std::function<graph_tile_ptr(const GraphId&)>;
+
+  struct stats_t {
+    // tiles the reader needed which had been prefetched
+    uint64_t hits;
+    // tiles the reader needed and had to load itself
+    uint64_t misses;
+    // prefetched tiles which were dropped before the reader ever asked for them
+    uint64_t wasted;
+  };
+
+  /**
+   * Constructor.
+   * @param loader       how to load a tile
+   * @param threads      number of background loader threads
+   * @param max_tiles    maximum number of tiles queued or parked at any time
+   */
+  tile_prefetcher_t(loader_t loader, size_t threads, size_t max_tiles);
+
+  /**
+   * Stops and joins the background threads, parked tiles are dropped.
+   */
+  ~tile_prefetcher_t();
+
+  tile_prefetcher_t(const tile_prefetcher_t&) = delete;
+  tile_prefetcher_t& operator=(const tile_prefetcher_t&) = delete;
+
+  /**
+   * Queues a tile to be loaded in the background. Tiles already queued or parked and hints
+   * beyond the configured maximum are ignored.
+   * @param tile_base  the tile base of the tile
+   */
+  void Prefetch(const GraphId& tile_base);
+
+  /**
+   * Hands over a parked tile and counts the hit, or counts a miss if it was not (yet) loaded.
+   * @param tile_base  the tile base of the tile
+   * @return the prefetched tile or nullptr
+   */
+  graph_tile_ptr Take(const GraphId& tile_base);
+
+  /**
+   * Drops all queued and parked tiles, tiles being loaded right now are dropped once loaded.
+   */
+  void Clear();
+
+  /**
+   * Blocks until every tile queued so far has been loaded and parked or dropped.
+   */
+  void Wait();
+
+  /**
+   * @return the hit/miss counters since construction
+   */
+  stats_t Stats() const;
+
+protected:
+  void Work();
+
+  loader_t loader_;
+  size_t max_tiles_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable signal_;
+  // signalled whenever nothing is queued or being loaded anymore
+  std::condition_variable idle_;
+  bool stop_;
+
+  // tiles waiting for a loader thread
+  std::deque<GraphId> queue_;
+  // tiles queued or being loaded
+  std::unordered_set<GraphId> pending_;
+  // bumped on clear so that loads started before it aren't parked
+  uint64_t generation_;
+  // loaded tiles waiting for the reader and the order in which they were parked
+  struct parked_t {
+    graph_tile_ptr tile;
+    std::list<GraphId>::iterator order;
+  };
+  std::unordered_map<GraphId, parked_t> parked_;
+  std::list<GraphId> parked_order_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> wasted_;
+
+  std::vector<std::thread> threads_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -174,8 +174,8 @@ struct TimeInfo {
     // if the timezone changed we need to account for that offset as well
     if (next_tz_index != timezone_index) {
       namespace dt = baldr::DateTime;
-      int tz_diff = dt::timezone_diff(lt, dt::get_tz_db().from_index(timezone_index),
-                                      dt::get_tz_db().from_index(next_tz_index), tz_cache);
+      int tz_diff = dt::timezone_diff(lt, static_cast<size_t>(timezone_index),
+                                      static_cast<size_t>(next_tz_index), tz_cache);
       sw += tz_diff;
     }
 
@@ -220,8 +220,8 @@ struct TimeInfo {
     // if the timezone changed we need to account for that offset as well
     if (next_tz_index != timezone_index) {
       namespace dt = baldr::DateTime;
-      int tz_diff = dt::timezone_diff(lt, dt::get_tz_db().from_index(timezone_index),
-                                      dt::get_tz_db().from_index(next_tz_index), tz_cache);
+      int tz_diff = dt::timezone_diff(lt, static_cast<size_t>(timezone_index),
+                                      static_cast<size_t>(next_tz_index), tz_cache);
       sw += tz_diff;
     }
 
@@ -187,8 +187,8 @@ struct TrafficTileHeader {
   uint64_t last_update; // seconds since epoch
   uint32_t directed_edge_count;
   uint32_t traffic_tile_version;
-  uint32_t spare2;
-  uint32_t spare3;
+  uint32_t speed_buffers; // 0 or 1 for a single set of speeds, 2 if the speeds are double buffered
+  uint32_t active_buffer; // which set of speeds readers use, flipped once an update is complete
 };
 
 #ifndef C_ONLY_INTERFACE
@@ -204,8 +204,12 @@ static_assert(sizeof(TrafficSpeed) == sizeof(uint64_t),
 /**
  * A tile of live traffic data.  The layout is:
  *
- * TrafficTileHeader (24 bytes)
- * n x TrafficSpeed entries (n x 2 bytes)
+ * TrafficTileHeader (32 bytes)
+ * n x TrafficSpeed entries (n x 8 bytes)
+ *
+ * A double buffered tile (speed_buffers == 2) has a second set of n entries right after the first.
+ * Readers use the set named by active_buffer while a writer fills in the other one and then flips
+ * active_buffer, so that readers only ever see complete updates of a tile.
  */
 #ifndef C_ONLY_INTERFACE
 namespace {
@@ -243,6 +247,12 @@ public:
         speeds(memory_ ? reinterpret_cast<volatile TrafficSpeed*>(memory_->data +
                                                                   sizeof(TrafficTileHeader))
                        : nullptr) {
+    // only trust the second set of speeds if it is really there
+    if (header && header->speed_buffers > 1 &&
+        memory_->size >= sizeof(TrafficTileHeader) + 2 * sizeof(TrafficSpeed) *
+                                                         size_t(header->directed_edge_count)) {
+      buffer_mask = 1;
+    }
   }
 
   const volatile TrafficSpeed& trafficspeed(const uint32_t directed_edge_offset) const {
@@ -254,7 +264,9 @@ public:
                                std::to_string(directed_edge_offset) +
                                ", edge count: " + std::to_string(header->directed_edge_count));
 
-    return *(speeds + directed_edge_offset);
+    // the address of the speed depends on the active buffer so it is never read ahead of it
+    const uint32_t buffer = header->active_buffer & buffer_mask;
+    return *(speeds + buffer * header->directed_edge_count + directed_edge_offset);
   }
 
   // Returns true if this tile is valid or not
@@ -272,6 +284,8 @@ public:
   // our control (another process accessing a mmap'd file for example)
   volatile TrafficTileHeader* header;
   volatile TrafficSpeed* speeds;
+  // 1 if the tile holds a second set of speeds, 0 otherwise
+  uint32_t buffer_mask = 0;
 };
 
 } // namespace baldr
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/traffictile.h>
+#include <valhalla/midgard/sequence.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Writes live traffic into a traffic extract while services keep routing on it. Updates are staged
+ * per tile and only written into the extract when they are published. Tiles of a double buffered
+ * extract (see valhalla_build_extract --double-buffer-traffic) get their updates written into the
+ * set of speeds readers aren't using and then the active set is flipped, so readers see either
+ * all or none of the updates a tile got in a batch. Tiles with a single set of speeds are written
+ * one speed at a time, every speed is a single 64 bit store so readers never see half of one.
+ *
+ * There is no grace period tracking readers, a reader still on the set a flip retired would see
+ * the next batch being written into it. Readers only ever look up one speed at a time and copy it
+ * right away, so the updater makes sure a tile isn't flipped again before the minimum publish
+ * interval has passed since its last flip, waiting out the rest of it if need be.
+ *
+ * Only one updater should write to an extract at a time.
+ */
+class traffic_updater_t {
+public:
+  static constexpr std::chrono::milliseconds kDefaultMinPublishInterval{1000};
+
+  struct stats_t {
+    // batches published
+    uint64_t batches;
+    // speeds written into the extract
+    uint64_t edges;
+    // updates dropped because the extract has no such tile or edge
+    uint64_t dropped;
+    // tiles whose active set of speeds was flipped
+    uint64_t flips;
+    // times publishing waited for readers to let go of a set of speeds
+    uint64_t waits;
+  };
+
+  /**
+   * Constructor. Maps the traffic extract for writing.
+   * @param traffic_extract        path to the traffic extract
+   * @param min_publish_interval   how long readers get to let go of a retired set of speeds
+   *                               before it is written to again
+   */
+  explicit traffic_updater_t(
+      const std::string& traffic_extract,
+      std::chrono::milliseconds min_publish_interval = kDefaultMinPublishInterval);
+
+  /**
+   * Stages the speed of an edge for the next batch, a later update of the same edge wins.
+   * @param edge   the directed edge
+   * @param speed  the live speed of the edge
+   */
+  void Update(const GraphId& edge, const TrafficSpeed& speed);
+
+  /**
+   * @return how many updates are staged
+   */
+  size_t Pending() const;
+
+  /**
+   * Writes the staged updates into the extract and makes them visible to readers.
+   * @param last_update  seconds since epoch to record in the updated tiles
+   * @return how many speeds were written
+   */
+  size_t Publish(uint64_t last_update);
+
+  /**
+   * @return whether the extract has a traffic tile for the given tile
+   */
+  bool HasTile(const GraphId& tile_id) const;
+
+  /**
+   * @return the counters since construction
+   */
+  stats_t Stats() const;
+
+protected:
+  struct tile_t {
+    TrafficTileHeader* header;
+    TrafficSpeed* speeds;
+    bool double_buffered;
+    // when the active set was last flipped
+    std::chrono::steady_clock::time_point flipped;
+  };
+
+  /**
+   * Writes the updates of one tile.
+   * @param tile         the traffic tile
+   * @param updates      edge index and speed of every update of the tile
+   * @param last_update  seconds since epoch to record in the tile
+   * @return how many speeds were written
+   */
+  size_t Publish(tile_t& tile,
+                 const std::vector<std::pair<uint32_t, TrafficSpeed>>& updates,
+                 uint64_t last_update);
+
+  std::chrono::milliseconds min_publish_interval_;
+  std::shared_ptr<midgard::tar> archive_;
+  std::unordered_map<GraphId, tile_t> tiles_;
+  std::unordered_map<GraphId, std::vector<std::pair<uint32_t, TrafficSpeed>>> staged_;
+  size_t pending_;
+  stats_t stats_;
+};
+
+} // namespace baldr
+} // namespace valhalla
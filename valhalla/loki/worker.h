@@ -53,6 +53,7 @@ protected:
   void parse_costing(Api& request, bool allow_none = false);
   void locations_from_shape(Api& request);
   void check_hierarchy_distance(Api& request);
+  uint32_t component_access(const Options& options) const;
 
   void init_locate(Api& request);
   void init_route(Api& request);
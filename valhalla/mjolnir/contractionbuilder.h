@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the contraction hierarchy (see baldr::ContractionGraph) of the default auto
+ * costing over the Valhalla graph tiles.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Contracts every edge cars can use, one after the other, and writes the hierarchy to
+   * mjolnir.contraction_hierarchy. The tiles have to be complete, restrictions and all.
+   * @param  pt  Config with the tile directory and the hierarchy file
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
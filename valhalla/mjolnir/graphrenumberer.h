@@ -0,0 +1,29 @@
+#ifndef VALHALLA_MJOLNIR_GRAPHRENUMBERER_H
+#define VALHALLA_MJOLNIR_GRAPHRENUMBERER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to renumber the nodes within each local tile for locality. Nodes and directed edges
+ * are numbered in the order they were ingested from OSM, so nodes which are close in the graph
+ * can be far apart in the tile and every search jumps around in memory. Renumbering puts them
+ * along a Hilbert curve across the tile (mjolnir.node_order = hilbert) or in breadth first order
+ * (mjolnir.node_order = bfs) so neighbouring nodes and their edges share cache lines and pages.
+ */
+class GraphRenumberer {
+public:
+  /**
+   * Renumber the nodes and directed edges of the local tiles in place. Runs after the graph has
+   * been enhanced and filtered, before transit and hierarchies are added.
+   * @param pt Configuration file
+   */
+  static void Renumber(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_GRAPHRENUMBERER_H
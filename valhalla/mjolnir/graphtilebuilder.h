@@ -73,6 +73,18 @@ public:
    */
   void Update(const std::vector<NodeInfo>& nodes, const std::vector<DirectedEdge>& directededges);
 
+  /**
+   * Reorders the nodes of a deserialized tile. The directed edges of each node move along with
+   * it and keep their order at the node, so local edge indexes and opposing indexes stay valid.
+   * Everything within the tile indexed by node or directed edge (signs, turn lanes, access
+   * restrictions, lane connectivity) is remapped. End nodes are left for the caller to update as
+   * they can be in other tiles. Tiles with transitions, transit data or complex restrictions
+   * cannot be reordered.
+   * @param  order  Old index of the node to put at each position.
+   * @return Returns the new index of each directed edge, by old index.
+   */
+  std::vector<uint32_t> ReorderNodes(const std::vector<uint32_t>& order);
+
   /**
    * Get the current list of node builders.
    * @return  Returns the node info builders.
@@ -499,6 +511,23 @@ public:
    */
   void UpdatePredictedSpeeds(const std::vector<DirectedEdge>& directededges);
 
+  /**
+   * Appends the hot edge columns, a column oriented copy of the directed edge attributes looked
+   * at while relaxing edges, to the stored tile. Replaces the columns the tile already has.
+   * StoreTileData and UpdatePredictedSpeeds keep the columns of a tile which has them in sync
+   * with its directed edges, any other change to the directed edges has to add them again.
+   */
+  void AddHotEdges();
+
+  /**
+   * Adds the edges superseded by each shortcut of the stored tile, so that readers can recover
+   * shortcuts without walking the graph. Replaces the shortcut edges the tile already has.
+   * StoreTileData and UpdatePredictedSpeeds keep them as long as the directed edges stay the same.
+   * @param  shortcuts  Index of each shortcut within the tile and the edges it supersedes, sorted
+   *                    by shortcut index. Shortcuts which could not be recovered have no edges.
+   */
+  void AddShortcutEdges(const std::vector<std::pair<uint32_t, std::vector<GraphId>>>& shortcuts);
+
   /**
    * Adds a landmark to the given edge id by modifying its edgeinfo to add a name and tagged value
    *
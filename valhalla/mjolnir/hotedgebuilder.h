@@ -0,0 +1,25 @@
+#ifndef VALHALLA_MJOLNIR_HOTEDGEBUILDER_H
+#define VALHALLA_MJOLNIR_HOTEDGEBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to add the hot edge columns (see baldr::HotEdges) to the Valhalla graph tiles.
+ */
+class HotEdgeBuilder {
+public:
+  /**
+   * Adds the hot edge columns to all tiles in the tile directory. Has to run after the last
+   * stage which changes the directed edges without keeping the columns in sync.
+   * @param  pt  Config with the tile directory and concurrency
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_HOTEDGEBUILDER_H
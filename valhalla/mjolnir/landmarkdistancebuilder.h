@@ -0,0 +1,27 @@
+#ifndef VALHALLA_MJOLNIR_LANDMARKDISTANCEBUILDER_H
+#define VALHALLA_MJOLNIR_LANDMARKDISTANCEBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to select landmarks in the Valhalla graph tiles and to measure the distances
+ * between them and every node (see baldr::LandmarkDistances).
+ */
+class LandmarkDistanceBuilder {
+public:
+  /**
+   * Selects mjolnir.landmark_count landmarks far from each other in the largest component of the
+   * graph, each the node farthest from the landmarks before it, and writes the distances from and
+   * to each of them to mjolnir.landmark_distances.
+   * @param  pt  Config with the tile directory and the landmark distances file
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_LANDMARKDISTANCEBUILDER_H
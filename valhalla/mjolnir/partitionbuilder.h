@@ -0,0 +1,28 @@
+#ifndef VALHALLA_MJOLNIR_PARTITIONBUILDER_H
+#define VALHALLA_MJOLNIR_PARTITIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the multi-level partition (see baldr::PartitionOverlay) of the Valhalla
+ * graph tiles.
+ */
+class PartitionBuilder {
+public:
+  /**
+   * Puts every edge into a cell of each level of a nested grid and writes the cells and their
+   * boundaries to mjolnir.partition_overlay. The cells of the lowest level are
+   * mjolnir.partition_cell_size degrees wide, those of every level above four times as wide as
+   * those below, for mjolnir.partition_levels levels.
+   * @param  pt  Config with the tile directory and the overlay file
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_PARTITIONBUILDER_H
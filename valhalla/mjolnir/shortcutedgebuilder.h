@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_SHORTCUTEDGEBUILDER_H
+#define VALHALLA_MJOLNIR_SHORTCUTEDGEBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to add the edges superseded by each shortcut (see baldr::ShortcutEdges) to the
+ * Valhalla graph tiles.
+ */
+class ShortcutEdgeBuilder {
+public:
+  /**
+   * Recovers every shortcut in the tile directory and stores the edges it supersedes in its tile.
+   * Recovery walks opposing edges so this has to run after the graph validator.
+   * @param  pt  Config with the tile directory and concurrency
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_SHORTCUTEDGEBUILDER_H
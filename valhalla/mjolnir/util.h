@@ -29,14 +29,18 @@ enum class BuildStage : int8_t {
   kBuild = 5,
   kEnhance = 6,
   kFilter = 7,
-  kTransit = 8,
-  kBss = 9,
-  kHierarchy = 10,
-  kShortcuts = 11,
-  kRestrictions = 12,
-  kElevation = 13,
-  kValidate = 14,
-  kCleanup = 15
+  kRenumber = 8,
+  kTransit = 9,
+  kBss = 10,
+  kHierarchy = 11,
+  kShortcuts = 12,
+  kRestrictions = 13,
+  kElevation = 14,
+  kValidate = 15,
+  kContraction = 16,
+  kPartition = 17,
+  kLandmarkDistances = 18,
+  kCleanup = 19
 };
 
 constexpr uint8_t kMinor = 1;
@@ -54,6 +58,7 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"build", BuildStage::kBuild},
        {"enhance", BuildStage::kEnhance},
        {"filter", BuildStage::kFilter},
+       {"renumber", BuildStage::kRenumber},
        {"transit", BuildStage::kTransit},
        {"bss", BuildStage::kBss},
        {"hierarchy", BuildStage::kHierarchy},
@@ -61,6 +66,9 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"contraction", BuildStage::kContraction},
+       {"partition", BuildStage::kPartition},
+       {"landmarkdistances", BuildStage::kLandmarkDistances},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -78,6 +86,7 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kBuild), "build"},
        {static_cast<int8_t>(BuildStage::kEnhance), "enhance"},
        {static_cast<int8_t>(BuildStage::kFilter), "filter"},
+       {static_cast<int8_t>(BuildStage::kRenumber), "renumber"},
        {static_cast<int8_t>(BuildStage::kTransit), "transit"},
        {static_cast<int8_t>(BuildStage::kBss), "bss"},
        {static_cast<int8_t>(BuildStage::kHierarchy), "hierarchy"},
@@ -85,6 +94,9 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kContraction), "contraction"},
+       {static_cast<int8_t>(BuildStage::kPartition), "partition"},
+       {static_cast<int8_t>(BuildStage::kLandmarkDistances), "landmarkdistances"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
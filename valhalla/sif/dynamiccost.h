@@ -240,6 +240,14 @@ public:
     pass_ = pass;
   }
 
+  /**
+   * Does the costing take edges against their direction where the other direction is allowed.
+   * @return  Returns true if oneways are ignored.
+   */
+  bool ignore_oneways() const {
+    return ignore_oneways_;
+  }
+
   /**
    * Returns the maximum transfer distance between stops that you are willing
    * to travel for this mode.  It is the max distance you are willing to
@@ -613,8 +621,7 @@ public:
                                                        cr->begin_month(), cr->begin_day_dow(),
                                                        cr->end_week(), cr->end_month(),
                                                        cr->end_day_dow(), current_time,
-                                                       baldr::DateTime::get_tz_db().from_index(
-                                                           tz_index))) {
+                                                       static_cast<size_t>(tz_index))) {
               // We triggered a complex restriction, so make sure we reset edge-status' for
               // earlier edges in restriction that were already marked as permanent
               reset_edge_status(edge_ids_in_complex_restriction);
@@ -655,7 +662,7 @@ public:
                                                   td.begin_week(), td.begin_month(),
                                                   td.begin_day_dow(), td.end_week(), td.end_month(),
                                                   td.end_day_dow(), current_time,
-                                                  baldr::DateTime::get_tz_db().from_index(tz_index));
+                                                  static_cast<size_t>(tz_index));
   }
 
   /***
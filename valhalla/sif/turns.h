@@ -0,0 +1,31 @@
+#pragma once
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+
+#include <functional>
+
+namespace valhalla {
+namespace sif {
+
+// what this function calls with each edge turned onto and the cost of the turn and of that edge
+using TurnCallback = std::function<
+    void(const baldr::GraphId& edge_id, const baldr::DirectedEdge* edge, const Cost& cost)>;
+
+/**
+ * Finds the turns a search takes from the end of an edge, the way the path algorithms expand:
+ * onto the edges the costing allows at the end node and at the nodes it transitions to, and back
+ * onto the opposing edge only where none of those is allowed. Shortcuts are never turned onto.
+ * The costs are those without time, so they only hold for costings without time dependent speeds.
+ *
+ * @param reader   used to get access to graph data. modifiable because its got a cache
+ * @param costing  the costing deciding which turns are allowed and what they cost
+ * @param edge_id  the edge to turn from
+ * @param turn_cb  the callback called with every turn
+ */
+void for_each_turn(baldr::GraphReader& reader,
+                   const sif::DynamicCost& costing,
+                   const baldr::GraphId& edge_id,
+                   const TurnCallback& turn_cb);
+
+} // namespace sif
+} // namespace valhalla
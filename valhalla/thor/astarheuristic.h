@@ -1,23 +1,33 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/landmarkdistances.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
+#include <valhalla/proto/api.pb.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace valhalla {
 namespace thor {
 
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
- * a destination within the shortest path computation.
+ * a destination within the shortest path computation. The straight line
+ * distance can be raised by the lower bounds landmark distances give for
+ * the network distance, see InitLandmarks().
  */
 class AStarHeuristic {
 public:
   /**
    * Constructor.
    */
-  AStarHeuristic() : distapprox_({}), costfactor_(1.0f) {
+  AStarHeuristic() : distapprox_({}), costfactor_(1.0f), landmarks_(nullptr), to_location_(true) {
   }
 
   /**
@@ -33,8 +43,25 @@ public:
   void Init(const midgard::PointLL& ll, const float factor) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    landmarks_ = nullptr;
   }
 
+  /**
+   * Uses the landmark distances for the network distance to the location (or from it), after
+   * Init(). Paths to the location get to it through the nodes of its edges, paths from it leave
+   * through them, so the distance between a node and the closest of those nodes is bounded below
+   * by the triangle inequality with every landmark. Costings ignoring oneways mustn't use them.
+   * @param  landmarks    Landmark distances, nullptr to only use the straight line distance.
+   * @param  graphreader  Graph reader to get the nodes of the location edges.
+   * @param  location     The location the heuristic estimates the cost to (or from).
+   * @param  to_location  True if the cost is from a node to the location, false if it is from the
+   *                      location to a node.
+   */
+  void InitLandmarks(const baldr::LandmarkDistances* landmarks,
+                     baldr::GraphReader& graphreader,
+                     const valhalla::Location& location,
+                     const bool to_location);
+
   /**
    * Get the distance to the destination given the lat,lng.
    * @param   ll  Current latitude, longitude.
@@ -77,10 +104,73 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic given the lat,lng of a node and the node itself,
+   * whose landmark distances may bound the distance better than the
+   * straight line does. Also return the straight line distance via an
+   * argument.
+   * @param   ll    Lat,lng of the node
+   * @param   node  The node
+   * @param   dist  Straight line distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node, float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    return (landmarks_ ? std::max(dist, LandmarkDistance(node)) : dist) * costfactor_;
+  }
+
+  /**
+   * Get the A* heuristic given the lat,lng of a node and the node itself.
+   * @param   ll    Lat,lng of the node
+   * @param   node  The node
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node) const {
+    float dist;
+    return Get(ll, node, dist);
+  }
+
 private:
+  /**
+   * The largest lower bound any landmark gives for the network distance
+   * between a node and the location.
+   * @param   node  The node
+   * @return  Returns the distance (meters), 0 if the node has no landmark distances.
+   */
+  float LandmarkDistance(const baldr::GraphId& node) const {
+    const uint32_t* distances = landmarks_->distances(node);
+    if (distances == nullptr) {
+      return 0.0f;
+    }
+    // Going to the location, x is the distance from a landmark to a node and y the one from the
+    // node to the landmark, and the other way around going from it. bounds_ holds the smallest x
+    // and the largest y of the location nodes.
+    float dist = 0.0f;
+    for (const auto& bound : bounds_) {
+      const uint32_t x = distances[bound.first + !to_location_];
+      const uint32_t y = distances[bound.first + to_location_];
+      if (bound.second.first != kUnreached && x != kUnreached) {
+        dist = std::max(dist, static_cast<float>(bound.second.first) - static_cast<float>(x));
+      }
+      if (bound.second.second != kUnreached && y != kUnreached) {
+        dist = std::max(dist, static_cast<float>(y) - static_cast<float>(bound.second.second));
+      }
+    }
+    return dist;
+  }
+
+  static constexpr uint32_t kUnreached = baldr::LandmarkDistances::kUnreached;
+
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
+
+  const baldr::LandmarkDistances* landmarks_; // Landmark distances, if used
+  bool to_location_;                          // Estimating the cost to the location or from it
+  // per landmark, the offset of its distances and the bounds of those of the location nodes
+  std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t>>> bounds_;
 };
 
 } // namespace thor
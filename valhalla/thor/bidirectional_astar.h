@@ -1,7 +1,7 @@
 #ifndef VALHALLA_THOR_BIDIRECTIONAL_ASTAR_H_
 #define VALHALLA_THOR_BIDIRECTIONAL_ASTAR_H_
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/adjacency_list.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/edgelabel.h>
@@ -9,6 +9,7 @@
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/search_arena.h>
 
 #include <cstdint>
 #include <memory>
@@ -81,7 +82,19 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Sets the arena to borrow the edge labels, adjacency lists and edge status from when a search
+   * starts and to give them back to when it is cleared.
+   * @param  arena  the arena of the worker thread, nullptr to keep the memory in the algorithm
+   */
+  void set_search_arena(SearchArena* arena) {
+    search_arena_ = arena;
+  }
+
 protected:
+  // The arena the memory of the searches is borrowed from, if any
+  SearchArena* search_arena_ = nullptr;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -108,9 +121,10 @@ protected:
   std::vector<sif::BDEdgeLabel> edgelabels_forward_;
   std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
 
-  // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_forward_;
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_reverse_;
+  // Adjacency list - approximate double bucket sort or radix heap
+  baldr::AdjacencyList<sif::BDEdgeLabel> adjacencylist_forward_;
+  baldr::AdjacencyList<sif::BDEdgeLabel> adjacencylist_reverse_;
+  bool radix_heap_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_forward_;
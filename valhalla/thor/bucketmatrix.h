@@ -0,0 +1,227 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/common.pb.h>
+#include <valhalla/proto_conversions.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/matrixalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * An entry in the bucket of an edge reached by the backward search from a target. Unless it is
+ * one of the target's own edges the cost and distance are those from the end of the edge to the
+ * target, including the turn at the end of the edge. For the target's own edges they are those of
+ * the target's label of the edge, see BucketMatrix::SetTarget.
+ */
+struct BucketEntry {
+  uint32_t target : 31;
+  uint32_t initial : 1;
+  uint32_t distance;
+  sif::Cost cost;
+};
+
+/**
+ * Class to compute cost (cost + time + distance) matrices among many locations. A backward
+ * search from every target leaves an entry in the bucket of each edge it reaches, afterwards a
+ * forward search from every source connects to the targets through the buckets of the edges it
+ * settles. Both searches use the highway hierarchy like CostMatrix, but only one search is held
+ * in memory at a time and each of them runs only as far as it needs to.
+ * This follows Knopp et al., "Computing Many-to-Many Shortest Paths Using Highway Hierarchies".
+ */
+class BucketMatrix : public MatrixAlgorithm {
+public:
+  /**
+   * Default constructor. Most internal values are set when a query is made so
+   * the constructor mainly just sets some internals to a default empty value.
+   */
+  BucketMatrix(const boost::property_tree::ptree& config = {});
+
+  ~BucketMatrix();
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  request               the full request
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return Whether all connections were found
+   */
+  bool SourceToTarget(Api& request,
+                      baldr::GraphReader& graphreader,
+                      const sif::mode_costing_t& mode_costing,
+                      const sif::travel_mode_t mode,
+                      const float max_matrix_distance) override;
+
+  /**
+   * Clear the temporary information generated during time+distance
+   * matrix construction.
+   */
+  void Clear() override;
+
+  /**
+   * Get the algorithm's name
+   * @return the name of the algorithm
+   */
+  inline const std::string& name() override {
+    return MatrixAlgoToString(Matrix::BucketMatrix);
+  }
+
+protected:
+  uint32_t max_reserved_labels_count_;
+
+  // Access mode used by the costing method
+  uint32_t access_mode_;
+
+  // Current travel mode
+  sif::TravelMode mode_;
+
+  // Current costing mode
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  // The path distance thresholds of the backward and the forward searches
+  float backward_pathdist_threshold_;
+  float forward_pathdist_threshold_;
+
+  bool ignore_hierarchy_limits_;
+
+  // Edge labels, adjacency list, edge status and hierarchy limits of the current search
+  std::vector<sif::BDEdgeLabel> edgelabels_;
+  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacency_;
+  EdgeStatus edgestatus_;
+  std::vector<valhalla::HierarchyLimits> hierarchy_limits_;
+
+  // The labels of the targets' own edges and the cost up to which the backward search of each
+  // target settled every edge, the highest float if it reached all it could
+  std::vector<std::vector<sif::BDEdgeLabel>> target_labels_;
+  std::vector<float> target_radius_;
+
+  // The best connection (cost and distance) between each source and target so far and whether
+  // it is final
+  std::vector<std::pair<sif::Cost, uint32_t>> best_connection_;
+  std::vector<bool> found_;
+
+  // when doing timezone differencing a timezone cache speeds up the computation
+  baldr::DateTime::tz_sys_info_cache_t tz_cache_;
+
+  /**
+   * Initialize the best connections. Any locations that are the same get 0 time and distance,
+   * connections found on a previous pass keep their time and distance.
+   * @param  sources  List of source locations.
+   * @param  targets  List of target locations.
+   * @param  matrix   The matrix of a previous pass.
+   */
+  void Initialize(const google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
+                  const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+                  const valhalla::Matrix& matrix);
+
+  /**
+   * Run the backward search from a target until it has covered the given cost or the path
+   * distance threshold and add its edges to their buckets.
+   * @param  target       Index of the target.
+   * @param  radius       The cost the search should cover.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      The request options.
+   */
+  void BackwardSearch(const uint32_t target,
+                      const float radius,
+                      baldr::GraphReader& graphreader,
+                      const valhalla::Options& options);
+
+  /**
+   * Run the forward search from a source until no target's connection can get any better.
+   * @param  source       Index of the source.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      The request options.
+   */
+  void ForwardSearch(const uint32_t source,
+                     baldr::GraphReader& graphreader,
+                     const valhalla::Options& options);
+
+  /**
+   * Expand the settled edge of the current search at its end node.
+   * @param  pred_idx     Index of the settled edge's label.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void Expand(const uint32_t pred_idx, baldr::GraphReader& graphreader);
+
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  bool ExpandInner(baldr::GraphReader& graphreader,
+                   const sif::BDEdgeLabel& pred,
+                   const baldr::DirectedEdge* opp_pred_edge,
+                   const baldr::NodeInfo* nodeinfo,
+                   const uint32_t pred_idx,
+                   const EdgeMetadata& meta,
+                   uint32_t& shortcuts,
+                   const graph_tile_ptr& tile,
+                   const baldr::TimeInfo& time_info);
+
+  /**
+   * Check the buckets of the opposing edge of a forward search edge for connections to targets.
+   * @param  source       Source index.
+   * @param  fwd_pred     Edge label of the forward search.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      The request options to check for the position along origin and
+   *                      destination edges.
+   */
+  void CheckConnections(const uint32_t source,
+                        const sif::BDEdgeLabel& fwd_pred,
+                        baldr::GraphReader& graphreader,
+                        const valhalla::Options& options);
+
+  /**
+   * The highest cost a forward search from a source has to reach for none of its connections to
+   * get any better.
+   * @param  source  Source index.
+   * @return the cost
+   */
+  float CostBound(const uint32_t source) const;
+
+  /**
+   * Add the labels of the edges of a source to the forward search.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  origin       The source location.
+   */
+  void SetSource(baldr::GraphReader& graphreader, const valhalla::Location& origin);
+
+  /**
+   * Add the labels of the edges of a target to the backward search.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  dest         The target location.
+   * @param  target       Index of the target.
+   */
+  void
+  SetTarget(baldr::GraphReader& graphreader, const valhalla::Location& dest, const uint32_t target);
+
+  /**
+   * Reset the label, adjacency list and edge status and the hierarchy limits for the next search.
+   */
+  void ResetSearch();
+
+private:
+  class BucketMap;
+  // The entries of the targets whose backward searches reached each edge
+  std::unique_ptr<BucketMap> buckets_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
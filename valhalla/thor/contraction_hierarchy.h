@@ -0,0 +1,138 @@
+#ifndef VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
+#define VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
+
+#include <valhalla/baldr/contractiongraph.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Bidirectional dijkstra over the contraction hierarchy built by the contraction stage of
+ * valhalla_build_tiles (see baldr::ContractionGraph). Both searches only ever go up the
+ * hierarchy, so that they settle a few hundred edges however far apart the locations are. The
+ * path found is unpacked into the edges of the graph and recosted like that of any other
+ * algorithm.
+ *
+ * The hierarchy knows the costs of a single costing and has no notion of time, of complex
+ * restrictions or of a second pass. Routes it can't serve are left to the other algorithms, see
+ * CanRoute(), and so are paths breaking a complex restriction.
+ */
+class ContractionHierarchy : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config     the thor config
+   * @param file_name  the contraction hierarchy of the tiles, none if empty
+   */
+  explicit ContractionHierarchy(const boost::property_tree::ptree& config = {},
+                                const std::string& file_name = "");
+
+  /**
+   * Can the hierarchy route between the locations. It has to have been built for the costing
+   * options of the request and the route must not depend on time or ask for alternates.
+   * @param  origin       Origin location
+   * @param  destination  Destination location
+   * @param  options      The request options
+   * @return true if GetBestPath() can be used
+   */
+  bool CanRoute(const valhalla::Location& origin,
+                const valhalla::Location& destination,
+                const Options& options) const;
+
+  /**
+   * Form path between and origin and destination location using the hierarchy.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of each edge), nothing if the
+   *          hierarchy has no path or the one it has breaks a complex restriction.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+  /**
+   * The hierarchy the routes are searched on.
+   * @return the hierarchy, none if there is none or it couldn't be mapped
+   */
+  const std::shared_ptr<const baldr::ContractionGraph>& graph() const {
+    return graph_;
+  }
+
+protected:
+  struct label_t {
+    uint32_t vertex;
+    uint32_t predecessor; // label the vertex was reached from, kInvalidLabel for a location edge
+    float cost;
+  };
+
+  // the labels of one of the searches and the label of each vertex it reached
+  struct search_t {
+    using entry_t = std::pair<float, uint32_t>;
+
+    std::vector<label_t> labels;
+    std::unordered_map<uint32_t, uint32_t> reached;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+
+    void add(const uint32_t vertex, const uint32_t predecessor, const float cost);
+    uint32_t find(const uint32_t vertex) const;
+    float min_cost() const;
+    void clear();
+  };
+
+  /**
+   * Settles the cheapest label of one search and relaxes the arcs going up from it, unless
+   * the vertex can be reached cheaper from above.
+   * @return the label which was settled, kInvalidLabel if it was already
+   */
+  template <const ExpansionType expansion_direction> uint32_t Settle();
+
+  /**
+   * Unpacks the vertices both searches met at into the edges of the path.
+   * @param  forward_idx  label of the meeting vertex in the forward search
+   * @param  reverse_idx  label of the meeting vertex in the reverse search
+   * @param  edges        receives the edges from the origin to the destination
+   * @return false if an arc could not be unpacked
+   */
+  bool Unpack(uint32_t forward_idx, uint32_t reverse_idx, std::vector<baldr::GraphId>& edges) const;
+
+  std::shared_ptr<const baldr::ContractionGraph> graph_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+  search_t forward_;
+  search_t reverse_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
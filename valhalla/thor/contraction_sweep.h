@@ -0,0 +1,202 @@
+#ifndef VALHALLA_THOR_CONTRACTION_SWEEP_H_
+#define VALHALLA_THOR_CONTRACTION_SWEEP_H_
+
+#include <valhalla/baldr/contractiongraph.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * One-to-all search over the contraction hierarchy built by the contraction stage of
+ * valhalla_build_tiles (see baldr::ContractionGraph), following Delling et al., "PHAST: Hardware-
+ * Accelerated Shortest Path Trees". A dijkstra going only up the hierarchy from the origins is
+ * followed by a single pass over all vertices from the top of the hierarchy down, which relaxes
+ * the down arcs in the order they are laid out in the file. That settles every edge of the graph
+ * without a priority queue, reading the arcs and the costs front to back.
+ *
+ * Like ContractionHierarchy it only knows the costs of the costing the hierarchy was built for,
+ * without time or complex restrictions, see CanSweep().
+ */
+class ContractionSweep {
+public:
+  // the cost, time and distance from the origins to the end of an edge
+  struct reached_t {
+    float cost;
+    float secs;
+    uint32_t length;
+  };
+
+  // an edge of an origin and what it takes to get from the origin to its end
+  struct origin_t {
+    baldr::GraphId edge_id;
+    float percent_along;
+    reached_t reached;
+  };
+
+  /**
+   * Constructor.
+   * @param config  the thor config
+   * @param graph   the contraction hierarchy of the tiles, none if null
+   */
+  explicit ContractionSweep(const boost::property_tree::ptree& config = {},
+                            std::shared_ptr<const baldr::ContractionGraph> graph = nullptr);
+
+  /**
+   * Can the hierarchy be swept from the origins. It has to have been built for the costing
+   * options of the request and the origins must not have a time.
+   * @param  origins  The origin locations
+   * @param  options  The request options
+   * @return true if Sweep() can be used
+   */
+  bool CanSweep(const google::protobuf::RepeatedPtrField<valhalla::Location>& origins,
+                const Options& options) const;
+
+  /**
+   * Whether matrices from a single source should be swept. The sweep always goes over the whole
+   * graph, no matter how close together the targets are.
+   * @return true if matrices should be swept
+   */
+  bool matrices() const {
+    return matrices_;
+  }
+
+  /**
+   * How many targets a matrix from a single source needs for the sweep to beat a dijkstra.
+   * @return the number of targets
+   */
+  uint32_t min_targets() const {
+    return min_targets_;
+  }
+
+  /**
+   * Whether isochrones should be swept.
+   * @return true if isochrones should be swept
+   */
+  bool isochrones() const {
+    return isochrones_;
+  }
+
+  /**
+   * Computes the cost, time and distance from the origins to the end of every edge of the
+   * hierarchy.
+   * @param  origins      The origin locations
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      The costing the hierarchy was built for.
+   */
+  void Sweep(const google::protobuf::RepeatedPtrField<valhalla::Location>& origins,
+             baldr::GraphReader& graphreader,
+             const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Computes the cost, time and distance from the origin to the end of every edge of the
+   * hierarchy.
+   * @param  origin       The origin location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      The costing the hierarchy was built for.
+   */
+  void Sweep(const valhalla::Location& origin,
+             baldr::GraphReader& graphreader,
+             const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * The cost, time and distance from the origins of the last sweep to a point along an edge,
+   * the cost is infinite if the point can't be reached.
+   * @param  edge         The edge and the point along it
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @return what it takes to get to the point
+   */
+  reached_t Reach(const valhalla::PathEdge& edge, baldr::GraphReader& graphreader) const;
+
+  /**
+   * The number of positions of the sweep, the vertices of the hierarchy.
+   * @return the number of positions
+   */
+  uint32_t size() const {
+    return static_cast<uint32_t>(reached_.size());
+  }
+
+  /**
+   * The edge at a position of the sweep.
+   * @param  position  the position
+   * @return the edge
+   */
+  baldr::GraphId edge(const uint32_t position) const {
+    return graph_->edge(graph_->sweep_vertex(position));
+  }
+
+  /**
+   * What it took the last sweep to get to the end of the edge at a position.
+   * @param  position  the position
+   * @return the cost, time and distance, the cost is infinite if the edge wasn't reached
+   */
+  const reached_t& reached(const uint32_t position) const {
+    return reached_[position];
+  }
+
+  /**
+   * The origin edges of the last sweep.
+   * @return the origin edges
+   */
+  const std::vector<origin_t>& origins() const {
+    return origins_;
+  }
+
+  /**
+   * Set a callback to periodically call to see if the sweep should be aborted.
+   * @param  interrupt  the function to call
+   */
+  void set_interrupt(const std::function<void()>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
+  /**
+   * Clear the temporary information generated during the sweep.
+   */
+  void Clear();
+
+protected:
+  /**
+   * Adds the part of the location's edges ahead of it to the origins and seeds the upward search
+   * with the turns off their ends.
+   * @param  origin       The origin location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void Seed(const valhalla::Location& origin, baldr::GraphReader& graphreader);
+
+  /**
+   * Runs the upward search from the seeds and sweeps down the hierarchy.
+   */
+  void Run();
+
+  static constexpr reached_t kUnreached = {std::numeric_limits<float>::infinity(), 0.f, 0};
+
+  std::shared_ptr<const baldr::ContractionGraph> graph_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+  bool matrices_;
+  uint32_t min_targets_;
+  bool isochrones_;
+  bool clear_reserved_memory_;
+  const std::function<void()>* interrupt_;
+
+  // what it takes to get to the end of the edge at every position of the sweep
+  std::vector<reached_t> reached_;
+  // the positions the seeds of the upward search are at
+  std::vector<uint32_t> seeds_;
+  std::vector<origin_t> origins_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_SWEEP_H_
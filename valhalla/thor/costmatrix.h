@@ -1,7 +1,7 @@
 #ifndef VALHALLA_THOR_COSTMATRIX_H_
 #define VALHALLA_THOR_COSTMATRIX_H_
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/adjacency_list.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/common.pb.h>
@@ -12,10 +12,13 @@
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/matrixalgorithm.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/search_arena.h>
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 namespace valhalla {
@@ -47,6 +50,21 @@ struct LocationStatus {
   }
 };
 
+/**
+ * What the expansion of a location changed for the locations of the other direction while the
+ * locations of one direction were expanded in parallel. It is applied once they all finished, in
+ * the order of the locations, so that the result is the same as if they were expanded one by one.
+ */
+struct DeferredUpdates {
+  // Whether the location was expanded at all
+  bool expanded = false;
+  // The locations of the other direction it connected to, with the sum of the label counts of
+  // both at the time
+  std::vector<std::pair<uint32_t, uint32_t>> connections;
+  // The edges it reached
+  std::vector<baldr::GraphId> reached;
+};
+
 /**
  * Best connection. Information about the best connection found between
  * a source and target pair.
@@ -84,8 +102,12 @@ public:
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  config         The thor config
+   * @param  reader_config  The mjolnir config, the extra threads expanding the locations of a
+   *                        request in parallel read the graph through readers of their own
    */
-  CostMatrix(const boost::property_tree::ptree& config = {});
+  CostMatrix(const boost::property_tree::ptree& config = {},
+             const boost::property_tree::ptree& reader_config = {});
 
   ~CostMatrix();
 
@@ -118,10 +140,24 @@ public:
     return MatrixAlgoToString(Matrix::CostMatrix);
   }
 
+  /**
+   * Sets the arena to borrow the edge labels, adjacency lists and edge status of the locations
+   * from when a matrix is started and to give them back to when it is cleared.
+   * @param  arena  the arena of the worker thread, nullptr to keep the memory in the algorithm
+   */
+  void set_search_arena(SearchArena* arena) {
+    search_arena_ = arena;
+  }
+
 protected:
+  // The arena the memory of the locations is borrowed from, if any
+  SearchArena* search_arena_ = nullptr;
+
   uint32_t max_reserved_labels_count_;
   uint32_t max_reserved_locations_count_;
   bool check_reverse_connection_;
+  // whether the adjacency lists are radix heaps rather than double bucket queues
+  bool radix_heap_;
 
   // upper bound for the number of additional iterations per expansion once a connection has been
   // found
@@ -150,7 +186,7 @@ protected:
 
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each location
   std::array<std::vector<std::vector<valhalla::HierarchyLimits>>, 2> hierarchy_limits_;
-  std::array<std::vector<baldr::DoubleBucketQueue<sif::BDEdgeLabel>>, 2> adjacency_;
+  std::array<std::vector<baldr::AdjacencyList<sif::BDEdgeLabel>>, 2> adjacency_;
   std::array<std::vector<std::vector<sif::BDEdgeLabel>>, 2> edgelabel_;
   std::array<std::vector<EdgeStatus>, 2> edgestatus_;
 
@@ -165,6 +201,19 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // The number of threads expanding the locations of a request, the graph readers of all but the
+  // calling thread and the config to make them from
+  uint32_t thread_count_;
+  // How many labels each location settles before the other direction takes its turn
+  uint32_t expansion_batch_;
+  boost::property_tree::ptree reader_config_;
+  std::vector<std::unique_ptr<baldr::GraphReader>> readers_;
+
+  // While the locations of one direction are expanded in parallel, what each of them changes for
+  // the other direction waits here
+  bool deferring_;
+  std::array<std::vector<DeferredUpdates>, 2> deferred_;
+
   /**
    * Form the initial time distance matrix given the sources
    * and destinations.
@@ -205,6 +254,23 @@ protected:
                                baldr::GraphReader& graphreader,
                                const valhalla::Options& options);
 
+  /**
+   * Expand every location of one direction which isn't done yet by one edge, on the calling
+   * thread or spread over the worker threads if there are enough locations to go around.
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      The request options.
+   * @param  time_infos   The time info objects for the sources
+   * @param  invariant    Whether time should be treated as invariant
+   */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
+  void ExpandLocations(const uint32_t n,
+                       baldr::GraphReader& graphreader,
+                       const valhalla::Options& options,
+                       const std::vector<baldr::TimeInfo>& time_infos,
+                       const bool invariant);
+
   template <const MatrixExpansionType expansion_direction,
             const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
   bool Expand(const uint32_t index,
@@ -244,12 +310,36 @@ protected:
                                const valhalla::Options& options);
 
   /**
-   * Update status when a connection is found.
+   * Update status when a connection is found. If the locations are expanded in parallel the
+   * status of the location of the other direction is only updated afterwards.
    * @param  source  Source index
    * @param  target  Target index
    */
+  template <const MatrixExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == MatrixExpansionType::forward>
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
+  /**
+   * Remove a location of the other direction from the unfound connections of a location. Once
+   * all of them are found the location may only expand for a limited number of iterations.
+   * @param  is_fwd       Whether the location is a source
+   * @param  index        Index of the location
+   * @param  other_index  Index of the location of the other direction
+   * @param  label_count  The sum of the label counts of both locations at the connection
+   */
+  void RemoveConnection(const bool is_fwd,
+                        const uint32_t index,
+                        const uint32_t other_index,
+                        const uint32_t label_count);
+
+  /**
+   * Mark a location whose search is exhausted as done and stop expanding the locations of the
+   * other direction which only had it left to find.
+   * @param  is_fwd  Whether the location is a source
+   * @param  index   Index of the location
+   */
+  void ExhaustLocation(const bool is_fwd, const uint32_t index);
+
   /**
    * Iterate the backward search from the target/destination location.
    * @param  index        Index of the target location.
@@ -350,10 +440,15 @@ protected:
 
 private:
   class ReachedMap;
+  class WorkerPool;
 
   // Mark each source/target edge with a list of source/target indexes that have reached it
   std::unique_ptr<ReachedMap> targets_;
   std::unique_ptr<ReachedMap> sources_;
+
+  // The threads expanding the locations along with the calling one, started on the first request
+  // with enough locations
+  std::unique_ptr<WorkerPool> pool_;
 };
 
 } // namespace thor
@@ -1,7 +1,7 @@
 #ifndef VALHALLA_THOR_Dijkstras_H_
 #define VALHALLA_THOR_Dijkstras_H_
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/adjacency_list.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
@@ -11,6 +11,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/search_arena.h>
 
 #include <cstdint>
 #include <memory>
@@ -81,6 +82,15 @@ public:
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Sets the arena to borrow the edge labels, adjacency list and edge status from when an
+   * expansion starts and to give them back to when it is cleared.
+   * @param  arena  the arena of the worker thread, nullptr to keep the memory in the algorithm
+   */
+  void set_search_arena(SearchArena* arena) {
+    search_arena_ = arena;
+  }
+
 protected:
   /**
    * Compute the best first graph traversal from a list of origin locations
@@ -151,9 +161,18 @@ protected:
   // if `true` clean reserved memory for edge labels
   bool clear_reserved_memory_;
 
-  // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_;
-  baldr::DoubleBucketQueue<sif::MMEdgeLabel> mmadjacencylist_;
+  // edge status entries the edge status keeps allocated between expansions
+  size_t max_reserved_edge_status_count_;
+
+  // whether the adjacency lists are radix heaps rather than double bucket queues
+  bool radix_heap_;
+
+  // The arena the memory of the expansions is borrowed from, if any
+  SearchArena* search_arena_ = nullptr;
+
+  // Adjacency list - approximate double bucket sort or radix heap
+  baldr::AdjacencyList<sif::BDEdgeLabel> adjacencylist_;
+  baldr::AdjacencyList<sif::MMEdgeLabel> mmadjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -178,7 +197,7 @@ protected:
    */
   template <typename label_container_t>
   void Initialize(label_container_t& labels,
-                  baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                  baldr::AdjacencyList<typename label_container_t::value_type>& queue,
                   const uint32_t bucketsize);
 
   /**
@@ -3,7 +3,10 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
+#include <cstddef>
+#include <limits>
 #include <unordered_map>
+#include <vector>
 
 // handy macro for shifting the 7bit path index value so that it can be or'd with the tile/level id
 #define SHIFT_path_id(x) (static_cast<uint32_t>(x) << 25u)
@@ -45,12 +48,21 @@ struct EdgeStatusInfo {
   }
 };
 
+// Default number of edge status entries an EdgeStatus keeps allocated between searches
+constexpr size_t kMaxReservedEdgeStatusCount = 4000000;
+
 /**
  * Class to define / lookup the status and index of an edge in the edge label
  * list during shortest path algorithms. This method stores status info for
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * Each tile touched gets a slot with its array once, the slots are kept when the edge status is
+ * cleared so the next search reuses them instead of allocating them again. Clearing just moves on
+ * to the next generation, the array of a slot from an older generation is reset the first time
+ * the new search touches its tile. The arrays are only freed once they hold more entries than
+ * the maximum to keep reserved.
  */
 class EdgeStatus {
 public:
@@ -59,29 +71,46 @@ public:
    */
   EdgeStatus() = default;
 
-  // in order no to delete objects twice in destructor we should explicitly
-  // forbid copying
+  // copying would duplicate every array
   EdgeStatus(const EdgeStatus&) = delete;
   EdgeStatus& operator=(const EdgeStatus&) = delete;
   EdgeStatus(EdgeStatus&&) = default;
   EdgeStatus& operator=(EdgeStatus&&) = default;
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
+   * Set the number of edge status entries to keep allocated when clearing.
+   * @param  max_reserved  Maximum number of entries, 0 frees the arrays on every clear.
+   */
+  void set_max_reserved(const size_t max_reserved) {
+    max_reserved_ = max_reserved;
+  }
+
+  /**
+   * The number of edge status entries allocated over all tiles.
+   * @return  Returns the number of entries.
    */
-  ~EdgeStatus() {
-    clear();
+  size_t reserved() const {
+    return reserved_;
   }
 
   /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the status of all edges. The arrays of the tiles are kept for the next search unless
+   * they hold more entries than the maximum to keep reserved.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    last_slot_ = kNoSlot;
+    if (reserved_ > max_reserved_) {
+      slots_.clear();
+      slot_index_.clear();
+      reserved_ = 0;
+    }
+    // on the rare wrap around the slots start over with a fresh generation
+    if (++generation_ == 0) {
+      for (auto& slot : slots_) {
+        slot.generation = 0;
+      }
+      generation_ = 1;
     }
-    edgestatus_.clear();
   }
 
   /**
@@ -98,17 +127,7 @@ public:
            const uint32_t index,
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
-    assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    *GetPtr(edgeid, tile, path_id) = {set, index};
   }
 
   /**
@@ -121,12 +140,11 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
-    } else {
+    const auto slot = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (slot == kNoSlot) {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
+    slots_[slot].edges[edgeid.id()].set_ = static_cast<uint32_t>(set);
   }
 
   /**
@@ -138,8 +156,23 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto slot = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    return slot == kNoSlot ? EdgeStatusInfo() : slots_[slot].edges[edgeid.id()];
+  }
+
+  /**
+   * Get the status info of a directed edge like Get does but without remembering the tile it
+   * was found in, so that several threads can look up edges at the same time as long as none
+   * of them modifies the edge status meanwhile.
+   * @param   edgeid     GraphId of the directed edge.
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo GetShared(const baldr::GraphId& edgeid) const {
+    const auto index = slot_index_.find(edgeid.tile_value());
+    if (index == slot_index_.cend() || slots_[index->second].generation != generation_) {
+      return EdgeStatusInfo();
+    }
+    return slots_[index->second].edges[edgeid.id()];
   }
 
   /**
@@ -155,23 +188,64 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+    const uint32_t key = edgeid.tile_value() | SHIFT_path_id(path_id);
+    auto slot = find(key);
+    if (slot == kNoSlot) {
+      slot = activate(key, tile->header()->directededgecount());
     }
+    return &slots_[slot].edges[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // The status of the edges of a tile, valid while the generation is the current one
+  struct slot_t {
+    uint32_t generation;
+    std::vector<EdgeStatusInfo> edges;
+  };
+
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+  // The slot of a tile if it was touched in the current generation. Consecutive lookups are
+  // mostly for the same tile so the last one found is remembered.
+  uint32_t find(const uint32_t key) const {
+    if (last_slot_ != kNoSlot && last_key_ == key) {
+      return last_slot_;
+    }
+    const auto index = slot_index_.find(key);
+    if (index == slot_index_.cend() || slots_[index->second].generation != generation_) {
+      return kNoSlot;
+    }
+    last_key_ = key;
+    last_slot_ = index->second;
+    return index->second;
+  }
+
+  // Gives the tile a slot for the current generation, reusing the one from an earlier search
+  uint32_t activate(const uint32_t key, const uint32_t edge_count) {
+    auto index = slot_index_.emplace(key, static_cast<uint32_t>(slots_.size())).first;
+    if (index->second == slots_.size()) {
+      slots_.emplace_back();
+    }
+    auto& slot = slots_[index->second];
+    reserved_ -= slot.edges.capacity();
+    slot.edges.assign(edge_count, EdgeStatusInfo());
+    reserved_ += slot.edges.capacity();
+    slot.generation = generation_;
+    last_key_ = key;
+    last_slot_ = index->second;
+    return index->second;
+  }
+
+  // Slots by tile value and path id
+  std::unordered_map<uint32_t, uint32_t> slot_index_;
+  // The slots of the tiles touched so far, pointers to their arrays survive adding slots
+  std::vector<slot_t> slots_;
+  uint32_t generation_ = 1;
+  // Entries allocated over all slots and how many of them to keep when clearing
+  size_t reserved_ = 0;
+  size_t max_reserved_ = kMaxReservedEdgeStatusCount;
+  mutable uint32_t last_key_ = 0;
+  mutable uint32_t last_slot_ = kNoSlot;
 };
 
 } // namespace thor
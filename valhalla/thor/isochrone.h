@@ -9,6 +9,7 @@
 #include <valhalla/proto/common.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/contraction_sweep.h>
 #include <valhalla/thor/dijkstras.h>
 #include <valhalla/thor/edgestatus.h>
 
@@ -67,6 +68,16 @@ public:
     inner_expansion_callback_ = std::move(callback);
   }
 
+  /**
+   * Set the sweep over the contraction hierarchy which replaces the forward expansion when it
+   * can, see ContractionSweep::isochrones().
+   *
+   * @param contraction_sweep  the sweep, none if null
+   */
+  void set_contraction_sweep(ContractionSweep* contraction_sweep) {
+    contraction_sweep_ = contraction_sweep;
+  }
+
 protected:
   // when we expand up to a node we color the cells of the grid that the edge that ends at the
   // node touches
@@ -90,6 +101,7 @@ protected:
   float max_meters_;
   std::shared_ptr<midgard::GriddedData<2>> isotile_;
   expansion_callback_t inner_expansion_callback_;
+  ContractionSweep* contraction_sweep_;
 
   /**
    * Constructs the isotile - 2-D gridded data containing the time
@@ -115,6 +127,38 @@ protected:
                      const float secs0,
                      const float dist0);
 
+  /**
+   * Updates the isotile along an edge, or along the part of an origin edge ahead of the origin.
+   * @param  tile    Graph tile of the edge.
+   * @param  edge    The edge.
+   * @param  ll0     Lat,lon at the start of the edge.
+   * @param  ll1     Lat,lon at the end of the edge.
+   * @param  origin  True if only the part of the edge ahead of the origin is marked.
+   * @param  secs0   Seconds at the start of the edge or the origin.
+   * @param  dist0   Meters at the start of the edge or the origin.
+   * @param  secs1   Seconds at the end of the edge.
+   * @param  dist1   Meters at the end of the edge.
+   */
+  void UpdateIsoTile(const graph_tile_ptr& tile,
+                     const baldr::DirectedEdge* edge,
+                     const midgard::PointLL& ll0,
+                     const midgard::PointLL& ll1,
+                     const bool origin,
+                     const float secs0,
+                     const float dist0,
+                     const float secs1,
+                     const float dist1);
+
+  /**
+   * Marks the isotile from a sweep over the contraction hierarchy instead of an expansion.
+   * @param  api          Request information
+   * @param  graphreader  Graph reader
+   * @param  costing      The costing of the request.
+   */
+  void SweepIsoTile(valhalla::Api& api,
+                    baldr::GraphReader& graphreader,
+                    const std::shared_ptr<sif::DynamicCost>& costing);
+
   /**
    * Updates the isotile along short segment
    * @param from Segment begin
@@ -30,7 +30,11 @@ public:
    */
   MatrixAlgorithm(const boost::property_tree::ptree& config)
       : interrupt_(nullptr), has_time_(false), not_thru_pruning_(true), expansion_callback_(),
-        clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)) {
+        clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+        max_reserved_edge_status_count_(
+            clear_reserved_memory_ ? 0
+                                   : config.get<size_t>("max_reserved_edge_status_count",
+                                                        kMaxReservedEdgeStatusCount)) {
   }
 
   MatrixAlgorithm(const MatrixAlgorithm&) = delete;
@@ -151,6 +155,9 @@ protected:
   // if `true` clean reserved memory for edge labels
   bool clear_reserved_memory_;
 
+  // edge status entries each edge status keeps allocated between searches
+  size_t max_reserved_edge_status_count_;
+
   // on first pass, resizes all PBF sequences and defaults to 0 or ""
   inline static void
   reserve_pbf_arrays(valhalla::Matrix& matrix, size_t size, bool verbose, uint32_t pass = 0) {
@@ -0,0 +1,136 @@
+#ifndef VALHALLA_THOR_MULTILEVEL_DIJKSTRA_H_
+#define VALHALLA_THOR_MULTILEVEL_DIJKSTRA_H_
+
+#include <valhalla/baldr/partitionoverlay.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/thor/overlay_customizer.h>
+#include <valhalla/thor/overlay_metric.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Dijkstra over the partition overlay built by the partition stage of valhalla_build_tiles (see
+ * baldr::PartitionOverlay). Near the locations the search follows the turns of the graph, further
+ * away it crosses whole cells through the cliques of the overlay metric of the costing, the
+ * larger the cells the further away. The path found is unpacked into the edges of the graph and
+ * recosted like that of any other algorithm.
+ *
+ * Metrics are customized in the background for the costing options of a request the first time
+ * they are seen, until then such requests are left to the other algorithms. The workers of a
+ * process share the metrics (see OverlayCustomizer). Like the contraction hierarchy the overlay has
+ * no notion
+ * of time, of complex restrictions or of a second pass. Routes it can't serve are left to the
+ * other algorithms, see CanRoute(), and so are paths breaking a complex restriction.
+ */
+class MultiLevelDijkstra : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config         the thor config
+   * @param file_name      the partition overlay of the tiles, none if empty
+   * @param reader_config  the mjolnir config the metrics are customized with
+   */
+  explicit MultiLevelDijkstra(const boost::property_tree::ptree& config = {},
+                              const std::string& file_name = "",
+                              const boost::property_tree::ptree& reader_config = {});
+
+  /**
+   * Can the overlay route between the locations. The route must not depend on time, ask for
+   * alternates or exclude locations, which would need a metric for this request alone. And the
+   * metric of its costing options must be customized, which is started here if it isn't yet.
+   * @param  origin       Origin location
+   * @param  destination  Destination location
+   * @param  options      The request options
+   * @return true if GetBestPath() can be used
+   */
+  bool CanRoute(const valhalla::Location& origin,
+                const valhalla::Location& destination,
+                const Options& options) const;
+
+  /**
+   * Form path between and origin and destination location using the overlay.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @param  options  The request options, whose costing options select the metric
+   * @return  Returns the path edges (and elapsed time/modes at end of each edge), nothing if the
+   *          overlay has no path or the one it has breaks a complex restriction.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "multilevel_dijkstra";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  struct label_t {
+    uint32_t vertex;
+    uint32_t predecessor; // label the vertex was reached from, kInvalidLabel for a location edge
+    float cost;
+    uint8_t clique; // the query level of the clique the vertex was reached through, 0 for a turn
+  };
+
+  /**
+   * The query level of a vertex: the lowest overlay level at which it is in a cell with an edge of
+   * the locations, or the number of levels if there is none.
+   * @param  vertex  the vertex
+   * @return the query level
+   */
+  uint8_t QueryLevel(const uint32_t vertex) const;
+
+  /**
+   * Adds a label for a vertex unless it was reached cheaper already.
+   */
+  void
+  Add(const uint32_t vertex, const uint32_t predecessor, const float cost, const uint8_t clique);
+
+  std::shared_ptr<OverlayCustomizer> customizer_;
+  std::shared_ptr<const baldr::PartitionOverlay> overlay_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  // how long a request waits for the metric of its costing options to be customized
+  std::chrono::milliseconds metric_wait_;
+
+  // per overlay level, the cells of the edges of the locations
+  std::vector<std::vector<uint32_t>> location_cells_;
+
+  using entry_t = std::pair<float, uint32_t>;
+  std::vector<label_t> labels_;
+  std::unordered_map<uint32_t, uint32_t> reached_;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_MULTILEVEL_DIJKSTRA_H_
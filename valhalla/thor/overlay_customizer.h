@@ -0,0 +1,123 @@
+#ifndef VALHALLA_THOR_OVERLAY_CUSTOMIZER_H_
+#define VALHALLA_THOR_OVERLAY_CUSTOMIZER_H_
+
+#include <valhalla/baldr/partitionoverlay.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/thor/overlay_metric.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Customizes the metrics of a partition overlay (see OverlayMetric) on a background thread for
+ * all the thor workers of a process which map the same overlay. A request whose costing options
+ * have no metric yet queues one and is routed by another algorithm in the meantime, so that no
+ * request has to wait for the whole extract to be customized and every set of costing options is
+ * customized once per process rather than once per worker. The most recently used metrics are
+ * kept.
+ *
+ * Each metric is a pass over the whole extract, so options are only queued once they were asked
+ * for a few times and the queue is bounded. A full queue drops the options nobody waits for, and
+ * options which could not be customized are only tried again after a while.
+ */
+class OverlayCustomizer {
+public:
+  /**
+   * The customizer of an overlay, shared by all who ask for the same file while any of them still
+   * holds on to it.
+   * @param file_name      the partition overlay
+   * @param config         the thor config
+   * @param reader_config  the mjolnir config, the background thread reads the graph with it
+   * @return the customizer or nullptr if there is no overlay
+   */
+  static std::shared_ptr<OverlayCustomizer> get(const std::string& file_name,
+                                                const boost::property_tree::ptree& config,
+                                                const boost::property_tree::ptree& reader_config);
+
+  /**
+   * Constructor, starts the background thread.
+   * @param overlay        the overlay
+   * @param config         the thor config
+   * @param reader_config  the mjolnir config, the background thread reads the graph with it
+   */
+  OverlayCustomizer(std::shared_ptr<const baldr::PartitionOverlay> overlay,
+                    const boost::property_tree::ptree& config,
+                    const boost::property_tree::ptree& reader_config);
+
+  /**
+   * Stops the background thread, abandoning the metric it is customizing.
+   */
+  ~OverlayCustomizer();
+
+  OverlayCustomizer(const OverlayCustomizer&) = delete;
+  OverlayCustomizer& operator=(const OverlayCustomizer&) = delete;
+
+  /**
+   * @return the overlay
+   */
+  const std::shared_ptr<const baldr::PartitionOverlay>& overlay() const {
+    return overlay_;
+  }
+
+  /**
+   * The metric of the costing options, which are queued for customization if they have none yet.
+   * @param costing  the costing and its options
+   * @param wait     how long to wait for the metric if it isn't customized yet
+   * @return the metric or nullptr if it isn't customized (yet)
+   */
+  std::shared_ptr<const OverlayMetric>
+  Get(const Costing& costing, const std::chrono::milliseconds wait = std::chrono::milliseconds(0));
+
+protected:
+  void Work();
+
+  // the metric for the costing options if it is kept, must be called holding the lock
+  std::shared_ptr<const OverlayMetric> Find(const std::string& key);
+
+  // queues the costing options unless the queue is full of options someone waits for, must be
+  // called holding the lock
+  bool Queue(const std::string& key, const Costing& costing);
+
+  std::shared_ptr<const baldr::PartitionOverlay> overlay_;
+  boost::property_tree::ptree reader_config_;
+  size_t max_metrics_;
+  size_t max_queued_;
+  size_t min_requests_;
+
+  std::mutex mutex_;
+  std::condition_variable signal_;
+  std::atomic<bool> stop_;
+
+  // the metrics kept, the most recently used first
+  std::list<std::pair<std::string, std::shared_ptr<const OverlayMetric>>> metrics_;
+  // costing options waiting to be customized, those queued or being customized, how often those
+  // not queued yet were asked for, how many requests wait for each and when those which could not
+  // be customized failed
+  std::deque<std::pair<std::string, Costing>> queue_;
+  std::unordered_set<std::string> queued_;
+  std::unordered_map<std::string, size_t> requests_;
+  std::unordered_map<std::string, size_t> waiting_;
+  std::unordered_map<std::string, std::chrono::steady_clock::time_point> failed_;
+
+  std::thread thread_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_OVERLAY_CUSTOMIZER_H_
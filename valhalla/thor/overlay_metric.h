@@ -0,0 +1,88 @@
+#ifndef VALHALLA_THOR_OVERLAY_METRIC_H_
+#define VALHALLA_THOR_OVERLAY_METRIC_H_
+
+#include <valhalla/baldr/partitionoverlay.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The costs of crossing the cells of a baldr::PartitionOverlay with one costing: for every cell
+ * of every level, the cheapest cost from each of its entries to each of its exits without leaving
+ * the cell. These cliques are customized level by level, those of a level from the turns between
+ * the cells below it and from their cliques, which takes a small part of the time building the
+ * overlay takes. That way every set of costing options can have its own metric.
+ *
+ * Searches over the overlay follow arcs at a query level (see arcs()). At query level 0 those are
+ * the turns of the graph, at query level l > 0 the cliques of overlay level l - 1 and the turns
+ * between its cells.
+ */
+class OverlayMetric {
+public:
+  // called with the vertex turned onto and the cost of the turn and of the edge turned onto
+  using turn_cb_t = std::function<void(const uint32_t vertex, const float cost)>;
+  // calls the callback with every turn the costing allows from a vertex
+  using turns_t = std::function<void(const uint32_t vertex, const turn_cb_t& turn_cb)>;
+  // called with the vertex an arc leads to, its cost and the query level of a clique or 0
+  using arc_cb_t =
+      std::function<void(const uint32_t vertex, const float cost, const uint8_t clique)>;
+
+  /**
+   * Customizes the cliques of every cell of the overlay.
+   * @param overlay  the overlay, which has to outlive the metric
+   * @param turns    the turns of the costing to customize the metric for
+   */
+  OverlayMetric(const baldr::PartitionOverlay& overlay, const turns_t& turns);
+
+  /**
+   * Calls the callback with the arcs out of a vertex at a query level. At a query level above 0
+   * these are the cliques from the vertex if it is an entry of its cell and the turns out of the
+   * cell if it is an exit.
+   * @param turns        the turns of the costing the metric was customized for
+   * @param query_level  the query level
+   * @param vertex       the vertex
+   * @param arc_cb       the callback called with every arc
+   */
+  void arcs(const turns_t& turns,
+            const uint8_t query_level,
+            const uint32_t vertex,
+            const arc_cb_t& arc_cb) const;
+
+  /**
+   * Unpacks a clique into the turns it stands for.
+   * @param turns     the turns of the costing the metric was customized for
+   * @param clique    the query level of the clique
+   * @param from      the entry the clique leaves
+   * @param to        the exit the clique enters
+   * @param vertices  receives the vertices after from, up to and including to
+   * @return false if the clique can't be unpacked, because the turns aren't those it was
+   *         customized with
+   */
+  bool unpack(const turns_t& turns,
+              const uint8_t clique,
+              const uint32_t from,
+              const uint32_t to,
+              std::vector<uint32_t>& vertices) const;
+
+  /**
+   * How many costs the cliques of all cells add up to.
+   * @return the number of costs
+   */
+  size_t size() const;
+
+protected:
+  const baldr::PartitionOverlay& overlay_;
+  // per level, where the cliques of each cell start and the costs of all of them, those from the
+  // first entry to every exit first
+  std::vector<std::vector<uint64_t>> offsets_;
+  std::vector<std::vector<float>> costs_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_OVERLAY_METRIC_H_
@@ -2,6 +2,7 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/landmarkdistances.h>
 #include <valhalla/baldr/tilehierarchy.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
@@ -10,6 +11,7 @@
 #include <valhalla/thor/pathinfo.h>
 
 #include <functional>
+#include <memory>
 #include <vector>
 
 namespace valhalla {
@@ -29,10 +31,14 @@ public:
   /**
    * Constructor
    */
-  PathAlgorithm(uint32_t max_reserved_labels_count, bool clear_reserved_memory)
+  PathAlgorithm(uint32_t max_reserved_labels_count,
+                bool clear_reserved_memory,
+                size_t max_reserved_edge_status_count = kMaxReservedEdgeStatusCount)
       : interrupt(nullptr), has_ferry_(false), not_thru_pruning_(true), expansion_callback_(),
         max_reserved_labels_count_(max_reserved_labels_count),
-        clear_reserved_memory_(clear_reserved_memory) {
+        clear_reserved_memory_(clear_reserved_memory),
+        max_reserved_edge_status_count_(clear_reserved_memory ? 0
+                                                              : max_reserved_edge_status_count) {
   }
 
   PathAlgorithm(const PathAlgorithm&) = delete;
@@ -136,7 +142,26 @@ public:
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Sets the landmark distances the A* heuristics of the algorithm may bound the cost to the
+   * destination with, see AStarHeuristic::InitLandmarks().
+   * @param  landmarks  the landmark distances, nullptr for none
+   */
+  void set_landmark_distances(const std::shared_ptr<const baldr::LandmarkDistances>& landmarks) {
+    landmarks_ = landmarks;
+  }
+
 protected:
+  /**
+   * The landmark distances the heuristics can use with a costing. They only bound the length of
+   * paths along edges in the direction some mode may take them.
+   * @param  costing  the costing
+   * @return the landmark distances, nullptr if there are none or the costing ignores oneways
+   */
+  const baldr::LandmarkDistances* landmark_distances(const sif::DynamicCost& costing) const {
+    return costing.ignore_oneways() ? nullptr : landmarks_.get();
+  }
+
   const std::function<void()>* interrupt;
 
   bool has_ferry_; // Indicates whether the path has a ferry
@@ -146,6 +171,9 @@ protected:
   // for tracking the expansion of the algorithm visually
   expansion_callback_t expansion_callback_;
 
+  // landmark distances for the A* heuristics, if any
+  std::shared_ptr<const baldr::LandmarkDistances> landmarks_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
@@ -153,6 +181,9 @@ protected:
 
   // if `true` clean reserved memory for edge labels
   bool clear_reserved_memory_;
+
+  // edge status entries each edge status keeps allocated between searches
+  size_t max_reserved_edge_status_count_;
 };
 
 /**
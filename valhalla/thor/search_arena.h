@@ -0,0 +1,187 @@
+#pragma once
+
+#include <valhalla/baldr/adjacency_list.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of labels the arena keeps over all label vectors or adjacency lists of a type
+constexpr size_t kMaxReservedArenaLabelCount = 4000000;
+
+/**
+ * The memory of the searches of a worker thread, kept between its requests. An algorithm given
+ * the arena borrows the edge labels, adjacency lists and edge status it needs when it initializes
+ * a search and gives them back when it is cleared, so whichever search comes next, of the same
+ * algorithm or not, starts out with buffers that are already allocated and touched.
+ *
+ * The containers are moved in and out of the members of the algorithms, the addresses of the
+ * members stay the same. Giving back empties the containers, which for the edge status just moves
+ * on to its next generation. The arena keeps them only up to a maximum number of entries per type
+ * and frees the rest, so a single huge request doesn't pin its memory for the life of the thread.
+ * Label vectors count the labels their searches used rather than what they reserved, so that the
+ * vectors of every location of a matrix, each reserved for a long search, are kept too.
+ *
+ * Like the algorithms themselves an arena must only be used by one thread at a time.
+ */
+class SearchArena {
+public:
+  /**
+   * Constructor.
+   * @param  max_reserved_labels       Labels to keep over all label vectors of a type, and label
+   *                                   indices over all adjacency lists of a type
+   * @param  max_reserved_edge_status  Edge status entries to keep over all edge status
+   */
+  explicit SearchArena(const size_t max_reserved_labels = kMaxReservedArenaLabelCount,
+                       const size_t max_reserved_edge_status = kMaxReservedEdgeStatusCount)
+      : max_reserved_labels_(max_reserved_labels),
+        max_reserved_edge_status_(max_reserved_edge_status) {
+  }
+
+  SearchArena(const SearchArena&) = delete;
+  SearchArena& operator=(const SearchArena&) = delete;
+
+  /**
+   * Hands memory given back earlier to a member of an algorithm. Members that already have memory
+   * of their own keep it.
+   * @param  memory  the label vector, adjacency list or edge status to take the memory over
+   */
+  template <typename T> void borrow(T& memory) {
+    auto& pool = std::get<pool_t<T>>(pools_);
+    if (pool.spares.empty() || entries(memory) > 0) {
+      return;
+    }
+    const size_t touched = pool.touched.back();
+    pool.reserved -= touched;
+    memory = std::move(pool.spares.back());
+    pool.spares.pop_back();
+    pool.touched.pop_back();
+    lend(pool, memory, touched);
+  }
+
+  /**
+   * Takes the memory of a member of an algorithm, leaving it empty. The memory is freed if the
+   * arena already keeps as much as it may.
+   * @param  memory  the label vector, adjacency list or edge status to take the memory of
+   */
+  template <typename T> void give_back(T& memory) {
+    auto& pool = std::get<pool_t<T>>(pools_);
+    const size_t touched = take(pool, memory);
+    if (entries(memory) > 0 && pool.reserved + touched <= max_reserved<T>()) {
+      pool.reserved += touched;
+      pool.spares.push_back(std::move(memory));
+      pool.touched.push_back(touched);
+    }
+    memory = T();
+  }
+
+  /**
+   * The number of entries kept for a type of memory. Label vectors count the labels searches have
+   * used, not what they reserved, as only those take up pages.
+   * @return the number of labels, label indices or edge status entries
+   */
+  template <typename T> size_t reserved() const {
+    return std::get<pool_t<T>>(pools_).reserved;
+  }
+
+  /**
+   * The number of containers kept for a type of memory.
+   * @return the number of label vectors, adjacency lists or edge status
+   */
+  template <typename T> size_t kept() const {
+    return std::get<pool_t<T>>(pools_).spares.size();
+  }
+
+  /**
+   * Frees all the memory kept.
+   */
+  void clear() {
+    pools_ = {};
+  }
+
+protected:
+  // Label vectors lent out at most, more are forgotten
+  static constexpr size_t kMaxLent = 4096;
+
+  // the memory given back of a type, how many entries of each the searches touched and how many
+  // of all of them, and the label vectors lent out with how many of their labels were touched
+  template <typename T> struct pool_t {
+    std::vector<T> spares;
+    std::vector<size_t> touched;
+    size_t reserved = 0;
+    std::vector<std::pair<const void*, size_t>> lent;
+  };
+
+  // Label vectors are reserved far beyond what most searches use, only the labels a search used
+  // take up pages. A vector lent out keeps the pages earlier searches touched.
+  template <typename label_t>
+  static void lend(pool_t<std::vector<label_t>>& pool,
+                   const std::vector<label_t>& labels,
+                   const size_t touched) {
+    if (pool.lent.size() >= kMaxLent) {
+      pool.lent.clear();
+    }
+    pool.lent.emplace_back(labels.data(), touched);
+  }
+
+  template <typename T> static void lend(pool_t<T>&, const T&, const size_t) {
+  }
+
+  // empties the memory and returns how many of its entries were touched
+  template <typename label_t>
+  static size_t take(pool_t<std::vector<label_t>>& pool, std::vector<label_t>& labels) {
+    size_t touched = labels.size();
+    for (auto lent = pool.lent.begin(); lent != pool.lent.end(); ++lent) {
+      if (lent->first == labels.data()) {
+        touched = std::max(touched, lent->second);
+        pool.lent.erase(lent);
+        break;
+      }
+    }
+    labels.clear();
+    return touched;
+  }
+
+  template <typename T> static size_t take(pool_t<T>&, T& memory) {
+    memory.clear();
+    return entries(memory);
+  }
+
+  template <typename label_t> static size_t entries(const std::vector<label_t>& labels) {
+    return labels.capacity();
+  }
+
+  template <typename label_t>
+  static size_t entries(const baldr::AdjacencyList<label_t>& adjacencylist) {
+    return adjacencylist.reserved();
+  }
+
+  static size_t entries(const EdgeStatus& edgestatus) {
+    return edgestatus.reserved();
+  }
+
+  template <typename T> size_t max_reserved() const {
+    return std::is_same<T, EdgeStatus>::value ? max_reserved_edge_status_ : max_reserved_labels_;
+  }
+
+  size_t max_reserved_labels_;
+  size_t max_reserved_edge_status_;
+
+  std::tuple<pool_t<std::vector<sif::BDEdgeLabel>>,
+             pool_t<std::vector<sif::MMEdgeLabel>>,
+             pool_t<baldr::AdjacencyList<sif::BDEdgeLabel>>,
+             pool_t<baldr::AdjacencyList<sif::MMEdgeLabel>>,
+             pool_t<EdgeStatus>>
+      pools_;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -7,6 +7,7 @@
 #include <valhalla/proto_conversions.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/contraction_sweep.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/matrixalgorithm.h>
 
@@ -77,6 +78,15 @@ public:
     dest_edges_.clear();
   };
 
+  /**
+   * Set the sweep over the contraction hierarchy which computes the rows of sources with many
+   * targets, see ContractionSweep::min_targets().
+   * @param  contraction_sweep  the sweep, none if null
+   */
+  void set_contraction_sweep(ContractionSweep* contraction_sweep) {
+    contraction_sweep_ = contraction_sweep;
+  }
+
   /**
    * Get the algorithm's name
    * @return the name of the algorithm
@@ -116,6 +126,9 @@ protected:
 
   sif::travel_mode_t mode_;
 
+  // Computes the rows of sources with many targets in one go, if there is a contraction hierarchy
+  ContractionSweep* contraction_sweep_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
@@ -169,6 +182,21 @@ protected:
               const baldr::TimeInfo& time_info,
               const bool invariant = false);
 
+  /**
+   * Computes the row of a source from a sweep over the contraction hierarchy, which reaches all
+   * the targets at once.
+   * @param  request              the full request
+   * @param  graphreader          Graph reader for accessing routing graph.
+   * @param  origin_index         Index of the source.
+   * @param  time_info            Time info of the source.
+   * @param  max_matrix_distance  Maximum arc-length distance for current mode.
+   */
+  void SweepOrigin(Api& request,
+                   baldr::GraphReader& graphreader,
+                   const uint32_t origin_index,
+                   const baldr::TimeInfo& time_info,
+                   const float max_matrix_distance);
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -14,10 +14,15 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/bucketmatrix.h>
 #include <valhalla/thor/centroid.h>
+#include <valhalla/thor/contraction_hierarchy.h>
+#include <valhalla/thor/contraction_sweep.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/multilevel_dijkstra.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/search_arena.h>
 #include <valhalla/thor/timedistancebssmatrix.h>
 #include <valhalla/thor/timedistancematrix.h>
 #include <valhalla/thor/triplegbuilder.h>
@@ -39,7 +44,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -65,7 +75,7 @@ public:
   void set_interrupt(const std::function<void()>* interrupt) override;
 
 protected:
-  std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm* path_algorithm,
+  std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm*& path_algorithm,
                                                     Location& origin,
                                                     Location& destination,
                                                     const std::string& costing,
@@ -111,17 +121,25 @@ protected:
   sif::CostFactory factory;
   sif::mode_costing_t mode_costing;
 
+  // the memory of the searches kept between requests, shared by the algorithms
+  SearchArena search_arena;
+
   // Path algorithms (TODO - perhaps use a map?))
   BidirectionalAStar bidir_astar;
   AStarBSSAlgorithm bss_astar;
   MultiModalPathAlgorithm multi_modal_astar;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  ContractionHierarchy contraction_hierarchy;
+  // one-to-all searches over the same contraction hierarchy
+  ContractionSweep contraction_sweep;
+  MultiLevelDijkstra multilevel_dijkstra;
 
   // Time distance matrix
   CostMatrix costmatrix_;
   TimeDistanceMatrix time_distance_matrix_;
   TimeDistanceBSSMatrix time_distance_bss_matrix_;
+  BucketMatrix bucket_matrix_;
 
   Isochrone isochrone_gen;
   std::shared_ptr<meili::MapMatcher> matcher;